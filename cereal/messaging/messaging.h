@@ -74,6 +74,8 @@ public:
   inline bool allValid(const std::vector<const char *> &service_list = {}) { return all_(service_list, true, false); }
   inline bool allAliveAndValid(const std::vector<const char *> &service_list = {}) { return all_(service_list, true, true); }
   void drain();
+  // waits for a message on any of the sockets without receiving it
+  bool poll(int timeout = 1000);
   ~SubMaster();
 
   uint64_t frame = 0;
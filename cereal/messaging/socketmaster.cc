@@ -151,6 +151,10 @@ void SubMaster::drain() {
   }
 }
 
+bool SubMaster::poll(int timeout) {
+  return poller_->poll(timeout).size() > 0;
+}
+
 bool SubMaster::updated(const char *name) const {
   return services_.at(name)->updated;
 }
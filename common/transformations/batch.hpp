@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <eigen3/Eigen/Dense>
+
+// The batched conversions transpose blocks of points into one array per component, so
+// Eigen runs the arithmetic and square roots on SIMD packets. Eigen has no double
+// precision packets for the trigonometric functions, those are evaluated per point.
+#define BATCH_BLOCK 64
+typedef Eigen::Array<double, BATCH_BLOCK, 1> BatchArray;
+typedef Eigen::Array<bool, BATCH_BLOCK, 1> BatchMask;
+
+// calls f(const BatchArray *in, BatchArray *out) for each block of n points stored as
+// consecutive in_dim / out_dim values. Each block is read before it is written, so in and
+// out can be the same buffer when in_dim == out_dim. A partial last block is padded with
+// its first point.
+template <int in_dim, int out_dim, typename F>
+inline void for_each_block(const double *in, double *out, size_t n, F f) {
+  BatchArray in_block[in_dim], out_block[out_dim];
+  for (size_t start = 0; start < n; start += BATCH_BLOCK) {
+    const int count = std::min(n - start, (size_t)BATCH_BLOCK);
+    const double *src = in + start * in_dim;
+    for (int i = 0; i < BATCH_BLOCK; i++) {
+      const double *p = src + (i < count ? i : 0) * in_dim;
+      for (int j = 0; j < in_dim; j++) {
+        in_block[j][i] = p[j];
+      }
+    }
+
+    f(in_block, out_block);
+
+    double *dst = out + start * out_dim;
+    for (int i = 0; i < count; i++) {
+      for (int j = 0; j < out_dim; j++) {
+        dst[i * out_dim + j] = out_block[j][i];
+      }
+    }
+  }
+}
+
+inline BatchArray batch_atan2(const BatchArray &y, const BatchArray &x) {
+  return y.binaryExpr(x, [](double a, double b) { return std::atan2(a, b); });
+}
@@ -5,6 +5,7 @@
 #include <eigen3/Eigen/Dense>
 
 #include "coordinates.hpp"
+#include "batch.hpp"
 
 
 
@@ -63,6 +64,42 @@ Geodetic ecef2geodetic(ECEF e){
   return to_degrees({lat, lon, h});
 }
 
+void geodetic2ecef_batch(const double *geodetic, double *ecef, size_t n) {
+  for_each_block<3, 3>(geodetic, ecef, n, [](const BatchArray *g, BatchArray *e) {
+    BatchArray lat = g[0] * M_PI / 180.0;
+    BatchArray lon = g[1] * M_PI / 180.0;
+    BatchArray sin_lat = lat.sin(), cos_lat = lat.cos();
+    BatchArray xi = (1.0 - esq * sin_lat.square()).sqrt();
+    e[0] = (a / xi + g[2]) * cos_lat * lon.cos();
+    e[1] = (a / xi + g[2]) * cos_lat * lon.sin();
+    e[2] = (a / xi * (1.0 - esq) + g[2]) * sin_lat;
+  });
+}
+
+void ecef2geodetic_batch(const double *ecef, double *geodetic, size_t n) {
+  // same steps as ecef2geodetic
+  for_each_block<3, 3>(ecef, geodetic, n, [](const BatchArray *e, BatchArray *g) {
+    const BatchArray &x = e[0], &y = e[1], &z = e[2];
+
+    BatchArray r = (x * x + y * y).sqrt();
+    double Esq = a * a - b * b;
+    BatchArray F = 54 * b * b * z * z;
+    BatchArray G = r * r + (1 - esq) * z * z - esq * Esq;
+    BatchArray C = (esq * esq * F * r * r) / G.cube();
+    BatchArray S = (1 + C + (C * C + 2 * C).sqrt()).unaryExpr([](double v) { return cbrt(v); });
+    BatchArray P = F / (3 * (S + 1 / S + 1).square() * G * G);
+    BatchArray Q = (1 + 2 * esq * esq * P).sqrt();
+    BatchArray r_0 = -(P * esq * r) / (1 + Q) + (0.5 * a * a * (1 + 1.0 / Q) - P * (1 - esq) * z * z / (Q * (1 + Q)) - 0.5 * P * r * r).sqrt();
+    BatchArray U = ((r - esq * r_0).square() + z * z).sqrt();
+    BatchArray V = ((r - esq * r_0).square() + (1 - esq) * z * z).sqrt();
+    BatchArray Z_0 = b * b * z / (a * V);
+
+    g[0] = ((z + e1sq * Z_0) / r).atan() * 180.0 / M_PI;
+    g[1] = batch_atan2(y, x) * 180.0 / M_PI;
+    g[2] = U * (1 - b * b / (a * V));
+  });
+}
+
 LocalCoord::LocalCoord(Geodetic g, ECEF e){
   init_ecef <<  e.x, e.y, e.z;
 
@@ -100,3 +137,34 @@ Geodetic LocalCoord::ned2geodetic(NED n){
   ECEF e = ned2ecef(n);
   return ::ecef2geodetic(e);
 }
+
+void LocalCoord::ecef2ned_batch(const double *ecef, double *ned, size_t n) {
+  const Eigen::Matrix3d &m = ecef2ned_matrix;
+  const Eigen::Vector3d &o = init_ecef;
+  for_each_block<3, 3>(ecef, ned, n, [&](const BatchArray *e, BatchArray *out) {
+    BatchArray dx = e[0] - o[0], dy = e[1] - o[1], dz = e[2] - o[2];
+    for (int i = 0; i < 3; i++) {
+      out[i] = m(i, 0) * dx + m(i, 1) * dy + m(i, 2) * dz;
+    }
+  });
+}
+
+void LocalCoord::ned2ecef_batch(const double *ned, double *ecef, size_t n) {
+  const Eigen::Matrix3d &m = ned2ecef_matrix;
+  const Eigen::Vector3d &o = init_ecef;
+  for_each_block<3, 3>(ned, ecef, n, [&](const BatchArray *p, BatchArray *out) {
+    for (int i = 0; i < 3; i++) {
+      out[i] = m(i, 0) * p[0] + m(i, 1) * p[1] + m(i, 2) * p[2] + o[i];
+    }
+  });
+}
+
+void LocalCoord::geodetic2ned_batch(const double *geodetic, double *ned, size_t n) {
+  geodetic2ecef_batch(geodetic, ned, n);
+  ecef2ned_batch(ned, ned, n);
+}
+
+void LocalCoord::ned2geodetic_batch(const double *ned, double *geodetic, size_t n) {
+  ned2ecef_batch(ned, geodetic, n);
+  ecef2geodetic_batch(geodetic, geodetic, n);
+}
@@ -6,6 +6,7 @@
 
 #include "orientation.hpp"
 #include "coordinates.hpp"
+#include "batch.hpp"
 
 Eigen::Quaterniond ensure_unique(Eigen::Quaterniond quat){
   if (quat.w() > 0){
@@ -63,6 +64,114 @@ Eigen::Matrix3d rot(Eigen::Vector3d axis, double angle){
 }
 
 
+static void ensure_unique_block(BatchArray *q) {
+  BatchArray sign = (q[0] > 0).select(BatchArray::Ones(), -BatchArray::Ones());
+  for (int i = 0; i < 4; i++) {
+    q[i] *= sign;
+  }
+}
+
+static void euler2quat_block(const BatchArray *euler, BatchArray *q) {
+  // expanded product of the z, y and x axis rotations in euler2quat
+  BatchArray cx = (0.5 * euler[0]).cos(), sx = (0.5 * euler[0]).sin();
+  BatchArray cy = (0.5 * euler[1]).cos(), sy = (0.5 * euler[1]).sin();
+  BatchArray cz = (0.5 * euler[2]).cos(), sz = (0.5 * euler[2]).sin();
+  q[0] = cx * cy * cz + sx * sy * sz;
+  q[1] = sx * cy * cz - cx * sy * sz;
+  q[2] = cx * sy * cz + sx * cy * sz;
+  q[3] = cx * cy * sz - sx * sy * cz;
+  ensure_unique_block(q);
+}
+
+static void quat2euler_block(const BatchArray *q, BatchArray *euler) {
+  const BatchArray &w = q[0], &x = q[1], &y = q[2], &z = q[3];
+  euler[0] = batch_atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y));
+  euler[1] = (2 * (w * y - z * x)).max(-1.0).min(1.0).asin();
+  euler[2] = batch_atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z));
+}
+
+static void quat2rot_block(const BatchArray *q, BatchArray *r) {
+  // same as Eigen::Quaterniond::toRotationMatrix
+  const BatchArray &w = q[0], &x = q[1], &y = q[2], &z = q[3];
+  BatchArray tx = 2 * x, ty = 2 * y, tz = 2 * z;
+  BatchArray twx = tx * w, twy = ty * w, twz = tz * w;
+  BatchArray txx = tx * x, txy = ty * x, txz = tz * x;
+  BatchArray tyy = ty * y, tyz = tz * y, tzz = tz * z;
+  r[0] = 1 - (tyy + tzz);
+  r[1] = txy - twz;
+  r[2] = txz + twy;
+  r[3] = txy + twz;
+  r[4] = 1 - (txx + tzz);
+  r[5] = tyz - twx;
+  r[6] = txz - twy;
+  r[7] = tyz + twx;
+  r[8] = 1 - (txx + tyy);
+}
+
+static void rot2quat_block(const BatchArray *m, BatchArray *q) {
+  // the branches of Eigen's Quaternion(Matrix3d) are all evaluated and selected per point
+  BatchArray t = (m[0] + m[4] + m[8] + 1).sqrt();
+  BatchArray s = 0.5 / t;
+  q[0] = 0.5 * t;
+  q[1] = (m[7] - m[5]) * s;
+  q[2] = (m[2] - m[6]) * s;
+  q[3] = (m[3] - m[1]) * s;
+
+  // without a positive trace, start from the largest diagonal element
+  BatchMask trace_pos = (m[0] + m[4] + m[8]) > 0;
+  BatchMask gt_1 = m[4] > m[0];
+  BatchMask gt_2 = m[8] > gt_1.select(m[4], m[0]);
+  BatchMask largest[3] = {!gt_1 && !gt_2, gt_1 && !gt_2, gt_2};
+  for (int i = 0; i < 3; i++) {
+    int j = (i + 1) % 3, k = (j + 1) % 3;
+    BatchArray c[4];
+    t = (m[i * 4] - m[j * 4] - m[k * 4] + 1).sqrt();
+    s = 0.5 / t;
+    c[i + 1] = 0.5 * t;
+    c[0] = (m[k * 3 + j] - m[j * 3 + k]) * s;
+    c[j + 1] = (m[j * 3 + i] + m[i * 3 + j]) * s;
+    c[k + 1] = (m[k * 3 + i] + m[i * 3 + k]) * s;
+
+    BatchMask use = !trace_pos && largest[i];
+    for (int l = 0; l < 4; l++) {
+      q[l] = use.select(c[l], q[l]);
+    }
+  }
+  ensure_unique_block(q);
+}
+
+void euler2quat_batch(const double *euler, double *quat, size_t n) {
+  for_each_block<3, 4>(euler, quat, n, euler2quat_block);
+}
+
+void quat2euler_batch(const double *quat, double *euler, size_t n) {
+  for_each_block<4, 3>(quat, euler, n, quat2euler_block);
+}
+
+void quat2rot_batch(const double *quat, double *rot, size_t n) {
+  for_each_block<4, 9>(quat, rot, n, quat2rot_block);
+}
+
+void rot2quat_batch(const double *rot, double *quat, size_t n) {
+  for_each_block<9, 4>(rot, quat, n, rot2quat_block);
+}
+
+void euler2rot_batch(const double *euler, double *rot, size_t n) {
+  for_each_block<3, 9>(euler, rot, n, [](const BatchArray *e, BatchArray *r) {
+    BatchArray q[4];
+    euler2quat_block(e, q);
+    quat2rot_block(q, r);
+  });
+}
+
+void rot2euler_batch(const double *rot, double *euler, size_t n) {
+  for_each_block<9, 3>(rot, euler, n, [](const BatchArray *r, BatchArray *e) {
+    BatchArray q[4];
+    rot2quat_block(r, q);
+    quat2euler_block(q, e);
+  });
+}
+
 Eigen::Vector3d ecef_euler_from_ned(ECEF ecef_init, Eigen::Vector3d ned_pose) {
   /*
     Using Rotations to Build Aerospace Coordinate Systems
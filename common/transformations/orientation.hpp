@@ -15,3 +15,11 @@ Eigen::Matrix3d rot_matrix(double roll, double pitch, double yaw);
 Eigen::Matrix3d rot(Eigen::Vector3d axis, double angle);
 Eigen::Vector3d ecef_euler_from_ned(ECEF ecef_init, Eigen::Vector3d ned_pose);
 Eigen::Vector3d ned_euler_from_ecef(ECEF ecef_init, Eigen::Vector3d ecef_pose);
+
+// batched versions over n consecutive quaternions (w, x, y, z), euler angles or row major rotation matrices
+void euler2quat_batch(const double *euler, double *quat, size_t n);
+void quat2euler_batch(const double *quat, double *euler, size_t n);
+void quat2rot_batch(const double *quat, double *rot, size_t n);
+void rot2quat_batch(const double *rot, double *quat, size_t n);
+void euler2rot_batch(const double *euler, double *rot, size_t n);
+void rot2euler_batch(const double *rot, double *euler, size_t n);
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+import time
+import unittest
+
+import numpy as np
+
+from common.transformations import transformations as tf
+from common.transformations.coordinates import LocalCoord, ecef2geodetic, geodetic2ecef
+from common.transformations.orientation import euler2quat, euler2rot, quat2euler, quat2rot, rot2euler, rot2quat
+
+N_PARITY = 10000
+N_BENCHMARK = 1000000
+N_BENCHMARK_SINGLE = 20000
+
+
+def random_euler(rng, n):
+  euler = rng.uniform(-np.pi, np.pi, (n, 3))
+  euler[:, 1] /= 2
+  # the axes, gimbal lock and a negative w in every block
+  euler[:8] = [[0, 0, 0], [np.pi, 0, 0], [0, np.pi / 2, 0], [0, -np.pi / 2, 0],
+               [0, 0, np.pi], [0, 0, -np.pi / 2], [np.pi / 2, np.pi / 2, np.pi / 2], [-3, 1, 3]]
+  return euler
+
+
+def random_geodetic(rng, n):
+  geodetic = np.column_stack([rng.uniform(-90, 90, n), rng.uniform(-180, 180, n), rng.uniform(-500, 10000, n)])
+  geodetic[:4] = [[0, 0, 0], [89.999, 0, 0], [-89.999, 180, 0], [37.7, -122.4, 10]]
+  return geodetic
+
+
+class TestBatchTransformations(unittest.TestCase):
+  def setUp(self):
+    self.rng = np.random.default_rng(0)
+
+  def assertParity(self, batch, single, inp, atol):
+    # the batched kernels group the same operations differently only in a few places
+    expected = np.array([single(x) for x in inp])
+    np.testing.assert_allclose(batch(inp), expected, rtol=0, atol=atol)
+
+  def test_orientation_parity(self):
+    euler = random_euler(self.rng, N_PARITY)
+    quat = tf.euler2quat_batch(euler)
+    rot = tf.quat2rot_batch(quat)
+
+    self.assertParity(tf.euler2quat_batch, tf.euler2quat_single, euler, 1e-15)
+    self.assertParity(tf.quat2euler_batch, tf.quat2euler_single, quat, 1e-12)
+    self.assertParity(tf.quat2rot_batch, tf.quat2rot_single, quat, 1e-15)
+    self.assertParity(tf.rot2quat_batch, tf.rot2quat_single, rot, 1e-15)
+    self.assertParity(tf.euler2rot_batch, tf.euler2rot_single, euler, 1e-14)
+    self.assertParity(tf.rot2euler_batch, tf.rot2euler_single, rot, 1e-12)
+
+  def test_coordinates_parity(self):
+    geodetic = random_geodetic(self.rng, N_PARITY)
+    ecef = tf.geodetic2ecef_batch(geodetic)
+    ned = self.rng.uniform(-1e4, 1e4, (N_PARITY, 3))
+    lc = LocalCoord.from_geodetic([37.7, -122.4, 10])
+
+    self.assertParity(tf.geodetic2ecef_batch, tf.geodetic2ecef_single, geodetic, 1e-8)
+    self.assertParity(tf.ecef2geodetic_batch, tf.ecef2geodetic_single, ecef, 1e-9)
+    self.assertParity(lc.ned2ecef_batch, lc.ned2ecef_single, ned, 1e-8)
+    self.assertParity(lc.ecef2ned_batch, lc.ecef2ned_single, lc.ned2ecef_batch(ned), 1e-8)
+    self.assertParity(lc.ned2geodetic_batch, lc.ned2geodetic_single, ned, 1e-9)
+    self.assertParity(lc.geodetic2ned_batch, lc.geodetic2ned_single, lc.ned2geodetic_batch(ned), 1e-8)
+
+  def test_shapes(self):
+    lc = LocalCoord.from_ecef([-2712470.0, 4259140.0, 3884640.0])
+    for f, input_shape, output_shape in [(euler2quat, (3,), (4,)), (quat2euler, (4,), (3,)), (quat2rot, (4,), (3, 3)),
+                                         (rot2quat, (3, 3), (4,)), (euler2rot, (3,), (3, 3)), (rot2euler, (3, 3), (3,)),
+                                         (geodetic2ecef, (3,), (3,)), (ecef2geodetic, (3,), (3,)), (lc.ned2ecef, (3,), (3,))]:
+      self.assertEqual(f(np.ones(input_shape)).shape, output_shape)
+      self.assertEqual(f(np.ones((5,) + input_shape).tolist()).shape, (5,) + output_shape)
+      # points in a partial block are independent of the padding
+      np.testing.assert_array_equal(f(np.ones((70,) + input_shape))[-1], f(np.ones(input_shape)))
+
+  def test_benchmark(self):
+    euler = random_euler(self.rng, N_BENCHMARK)
+    geodetic = random_geodetic(self.rng, N_BENCHMARK)
+    lc = LocalCoord.from_geodetic([37.7, -122.4, 10])
+    for name, batch, single, inp in [('euler2rot', tf.euler2rot_batch, tf.euler2rot_single, euler),
+                                     ('rot2euler', tf.rot2euler_batch, tf.rot2euler_single, tf.euler2rot_batch(euler)),
+                                     ('geodetic2ecef', tf.geodetic2ecef_batch, tf.geodetic2ecef_single, geodetic),
+                                     ('ecef2geodetic', tf.ecef2geodetic_batch, tf.ecef2geodetic_single, tf.geodetic2ecef_batch(geodetic)),
+                                     ('ecef2ned', lc.ecef2ned_batch, lc.ecef2ned_single, tf.geodetic2ecef_batch(geodetic))]:
+      t = time.monotonic()
+      batch(inp)
+      batch_time = (time.monotonic() - t) / N_BENCHMARK
+
+      t = time.monotonic()
+      for x in inp[:N_BENCHMARK_SINGLE]:
+        single(x)
+      single_time = (time.monotonic() - t) / N_BENCHMARK_SINGLE
+      print(f"{name}: batch {batch_time * 1e9:.1f} ns, single {single_time * 1e9:.1f} ns per point")
+
+
+if __name__ == "__main__":
+  unittest.main()
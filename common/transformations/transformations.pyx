@@ -15,6 +15,14 @@ from common.transformations.transformations cimport ned_euler_from_ecef as ned_e
 from common.transformations.transformations cimport geodetic2ecef as geodetic2ecef_c
 from common.transformations.transformations cimport ecef2geodetic as ecef2geodetic_c
 from common.transformations.transformations cimport LocalCoord_c
+from common.transformations.transformations cimport euler2quat_batch as euler2quat_batch_c
+from common.transformations.transformations cimport quat2euler_batch as quat2euler_batch_c
+from common.transformations.transformations cimport quat2rot_batch as quat2rot_batch_c
+from common.transformations.transformations cimport rot2quat_batch as rot2quat_batch_c
+from common.transformations.transformations cimport euler2rot_batch as euler2rot_batch_c
+from common.transformations.transformations cimport rot2euler_batch as rot2euler_batch_c
+from common.transformations.transformations cimport geodetic2ecef_batch as geodetic2ecef_batch_c
+from common.transformations.transformations cimport ecef2geodetic_batch as ecef2geodetic_batch_c
 
 
 import cython
@@ -54,6 +62,42 @@ cdef Geodetic list2geodetic(geodetic):
     g.alt = geodetic[2]
     return g
 
+ctypedef void (*batch_func)(const double*, double*, size_t)
+
+cdef np.ndarray[double, ndim=2, mode="c"] batch_input(inp, int size):
+    return np.ascontiguousarray(inp, dtype=np.double).reshape(-1, size)
+
+cdef np.ndarray run_batch(batch_func f, inp, tuple input_shape, tuple output_shape):
+    # one call into the batched kernel for the whole array of n inputs
+    cdef np.ndarray[double, ndim=2, mode="c"] i = batch_input(inp, np.prod(input_shape))
+    cdef np.ndarray[double, ndim=2, mode="c"] o = np.empty((i.shape[0], np.prod(output_shape)))
+    f(<double*>i.data, <double*>o.data, i.shape[0])
+    return o.reshape((i.shape[0],) + output_shape)
+
+def euler2quat_batch(euler):
+    return run_batch(euler2quat_batch_c, euler, (3,), (4,))
+
+def quat2euler_batch(quat):
+    return run_batch(quat2euler_batch_c, quat, (4,), (3,))
+
+def quat2rot_batch(quat):
+    return run_batch(quat2rot_batch_c, quat, (4,), (3, 3))
+
+def rot2quat_batch(rot):
+    return run_batch(rot2quat_batch_c, rot, (3, 3), (4,))
+
+def euler2rot_batch(euler):
+    return run_batch(euler2rot_batch_c, euler, (3,), (3, 3))
+
+def rot2euler_batch(rot):
+    return run_batch(rot2euler_batch_c, rot, (3, 3), (3,))
+
+def geodetic2ecef_batch(geodetic):
+    return run_batch(geodetic2ecef_batch_c, geodetic, (3,), (3,))
+
+def ecef2geodetic_batch(ecef):
+    return run_batch(ecef2geodetic_batch_c, ecef, (3,), (3,))
+
 def euler2quat_single(euler):
     cdef Vector3 e = Vector3(euler[0], euler[1], euler[2])
     cdef Quaternion q = euler2quat_c(e)
@@ -170,5 +214,33 @@ cdef class LocalCoord:
         cdef Geodetic g = self.lc.ned2geodetic(n)
         return [g.lat, g.lon, g.alt]
 
+    def ecef2ned_batch(self, ecef):
+        assert self.lc
+        cdef np.ndarray[double, ndim=2, mode="c"] e = batch_input(ecef, 3)
+        cdef np.ndarray[double, ndim=2, mode="c"] n = np.empty_like(e)
+        self.lc.ecef2ned_batch(<double*>e.data, <double*>n.data, e.shape[0])
+        return n
+
+    def ned2ecef_batch(self, ned):
+        assert self.lc
+        cdef np.ndarray[double, ndim=2, mode="c"] n = batch_input(ned, 3)
+        cdef np.ndarray[double, ndim=2, mode="c"] e = np.empty_like(n)
+        self.lc.ned2ecef_batch(<double*>n.data, <double*>e.data, n.shape[0])
+        return e
+
+    def geodetic2ned_batch(self, geodetic):
+        assert self.lc
+        cdef np.ndarray[double, ndim=2, mode="c"] g = batch_input(geodetic, 3)
+        cdef np.ndarray[double, ndim=2, mode="c"] n = np.empty_like(g)
+        self.lc.geodetic2ned_batch(<double*>g.data, <double*>n.data, g.shape[0])
+        return n
+
+    def ned2geodetic_batch(self, ned):
+        assert self.lc
+        cdef np.ndarray[double, ndim=2, mode="c"] n = batch_input(ned, 3)
+        cdef np.ndarray[double, ndim=2, mode="c"] g = np.empty_like(n)
+        self.lc.ned2geodetic_batch(<double*>n.data, <double*>g.data, n.shape[0])
+        return g
+
     def __dealloc__(self):
         del self.lc
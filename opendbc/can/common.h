@@ -31,7 +31,7 @@ public:
   unsigned int size;
 
   std::vector<Signal> parse_sigs;
-  std::vector<double> vals;
+  std::vector<double> vals;  // scratch, published on a valid parse
 
   uint16_t ts;
   uint64_t seen;
@@ -43,6 +43,10 @@ public:
   bool ignore_checksum = false;
   bool ignore_counter = false;
 
+  // this message's signals in the parser's arrays
+  double *latest_vals = nullptr;
+  uint16_t *latest_ts = nullptr;
+
   bool parse(uint64_t sec, uint16_t ts_, uint8_t * dat);
   bool update_counter_generic(int64_t v, int cnt_size);
 };
@@ -55,10 +59,19 @@ private:
   const DBC *dbc = NULL;
   std::unordered_map<uint32_t, MessageState> message_states;
 
+  void init_signal_values();
+
 public:
   bool can_valid = false;
   uint64_t last_sec = 0;
 
+  // the latest valid value and timestamp of every parsed signal, laid out once by address,
+  // so they can be read in place
+  std::vector<uint32_t> signal_addresses;
+  std::vector<const char *> signal_names;
+  std::vector<double> signal_values;
+  std::vector<uint16_t> signal_ts;
+
   CANParser(int abus, const std::string& dbc_name,
             const std::vector<MessageParseOptions> &options,
             const std::vector<SignalParseOptions> &sigoptions);
@@ -70,6 +83,8 @@ public:
   void UpdateCans(uint64_t sec, const capnp::DynamicStruct::Reader& cans);
   void UpdateValid(uint64_t sec);
   std::vector<SignalValue> query_latest();
+  // the messages parsed in the last update, or all of them before the first
+  std::vector<uint32_t> query_updated();
 };
 
 class CANPacker {
@@ -75,9 +75,14 @@ cdef extern from "common.h":
 
   cdef cppclass CANParser:
     bool can_valid
+    vector[uint32_t] signal_addresses
+    vector[const char*] signal_names
+    vector[double] signal_values
+    vector[uint16_t] signal_ts
     CANParser(int, string, vector[MessageParseOptions], vector[SignalParseOptions])
     void update_string(string, bool)
     vector[SignalValue] query_latest()
+    vector[uint32_t] query_updated()
 
   cdef cppclass CANPacker:
    CANPacker(string)
@@ -87,6 +87,9 @@ bool MessageState::parse(uint64_t sec, uint16_t ts_, uint8_t * dat) {
   ts = ts_;
   seen = sec;
 
+  std::copy(vals.begin(), vals.end(), latest_vals);
+  std::fill(latest_ts, latest_ts + vals.size(), ts);
+
   return true;
 }
 
@@ -166,6 +169,7 @@ CANParser::CANParser(int abus, const std::string& dbc_name,
       }
     }
   }
+  init_signal_values();
 }
 
 CANParser::CANParser(int abus, const std::string& dbc_name, bool ignore_checksum, bool ignore_counter)
@@ -193,6 +197,32 @@ CANParser::CANParser(int abus, const std::string& dbc_name, bool ignore_checksum
 
     message_states[state.address] = state;
   }
+  init_signal_values();
+}
+
+void CANParser::init_signal_values() {
+  std::vector<MessageState *> states;
+  for (auto &kv : message_states) {
+    states.push_back(&kv.second);
+  }
+  std::sort(states.begin(), states.end(), [](auto a, auto b) { return a->address < b->address; });
+
+  for (const auto state : states) {
+    for (int i = 0; i < state->parse_sigs.size(); i++) {
+      signal_addresses.push_back(state->address);
+      signal_names.push_back(state->parse_sigs[i].name);
+      signal_values.push_back(state->vals[i]);
+      signal_ts.push_back(state->ts);
+    }
+  }
+
+  // the arrays don't move after this
+  size_t pos = 0;
+  for (auto state : states) {
+    state->latest_vals = signal_values.data() + pos;
+    state->latest_ts = signal_ts.data() + pos;
+    pos += state->parse_sigs.size();
+  }
 }
 
 #ifndef DYNAMIC_CAPNP
@@ -291,12 +321,22 @@ std::vector<SignalValue> CANParser::query_latest() {
       const Signal &sig = state.parse_sigs[i];
       ret.push_back((SignalValue){
         .address = state.address,
-        .ts = state.ts,
+        .ts = state.latest_ts[i],
         .name = sig.name,
-        .value = state.vals[i],
+        .value = state.latest_vals[i],
       });
     }
   }
 
   return ret;
 }
+
+std::vector<uint32_t> CANParser::query_updated() {
+  std::vector<uint32_t> ret;
+  for (const auto& kv : message_states) {
+    if (last_sec == 0 || kv.second.seen == last_sec) {
+      ret.push_back(kv.first);
+    }
+  }
+  return ret;
+}
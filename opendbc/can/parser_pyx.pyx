@@ -9,21 +9,89 @@ from libcpp.map cimport map
 from libcpp cimport bool
 
 from .common cimport CANParser as cpp_CANParser
-from .common cimport SignalParseOptions, MessageParseOptions, dbc_lookup, SignalValue, DBC
+from .common cimport SignalParseOptions, MessageParseOptions, dbc_lookup, DBC
 
 import os
 import numbers
 from collections import defaultdict
+from collections.abc import Mapping
 
 cdef int CAN_INVALID_CNT = 5
 
+
+cdef class MessageValues:
+  """The latest values (or timestamps) of a message's signals, read from the parser when they're accessed"""
+  cdef:
+    object parser  # keeps the arrays alive
+    dict index
+    const double *_values
+    const uint16_t *_ts
+
+  def __getitem__(self, name):
+    cdef size_t i = self.index[name]
+    if self._ts != NULL:
+      return self._ts[i]
+    return self._values[i]
+
+  def get(self, name, default=None):
+    return self[name] if name in self.index else default
+
+  def __contains__(self, name):
+    return name in self.index
+
+  def __iter__(self):
+    return iter(self.index)
+
+  def __len__(self):
+    return len(self.index)
+
+  def keys(self):
+    return self.index.keys()
+
+  def values(self):
+    return [self[name] for name in self.index]
+
+  def items(self):
+    return [(name, self[name]) for name in self.index]
+
+  def copy(self):
+    return dict(self.items())
+
+  def __copy__(self):
+    return self.copy()
+
+  def __eq__(self, other):
+    return self.copy() == (other.copy() if isinstance(other, MessageValues) else other)
+
+  def __repr__(self):
+    return repr(self.copy())
+
+Mapping.register(MessageValues)
+
+
+cdef class CANSignal:
+  """A requested signal, resolved once, its latest value and timestamp are read straight from the parser"""
+  cdef:
+    object parser
+    const double *_value
+    const uint16_t *_ts
+
+  @property
+  def value(self):
+    return self._value[0]
+
+  @property
+  def ts(self):
+    return self._ts[0]
+
+
 cdef class CANParser:
   cdef:
     cpp_CANParser *can
     const DBC *dbc
     map[string, uint32_t] msg_name_to_address
     map[uint32_t, string] address_to_msg_name
-    vector[SignalValue] can_values
+    dict signal_index
     bool test_mode_enabled
 
   cdef readonly:
@@ -54,10 +122,6 @@ cdef class CANParser:
 
       self.msg_name_to_address[name] = msg.address
       self.address_to_msg_name[msg.address] = name
-      self.vl[msg.address] = {}
-      self.vl[name] = {}
-      self.ts[msg.address] = {}
-      self.ts[name] = {}
 
     # Convert message names into addresses
     for i in range(len(signals)):
@@ -101,13 +165,52 @@ cdef class CANParser:
       message_options_v.push_back(mpo)
 
     self.can = new cpp_CANParser(bus, dbc_name, message_options_v, signal_options_v)
+    self.init_vl()
     self.update_vl()
 
+  def __dealloc__(self):
+    del self.can
+
+  cdef init_vl(self):
+    # the signals of each message, by name
+    self.signal_index = {}
+    cdef size_t i
+    cdef const char *sig_name
+    for i in range(self.can.signal_values.size()):
+      sig_name = self.can.signal_names[i]
+      self.signal_index.setdefault(self.can.signal_addresses[i], {})[<unicode>sig_name] = i
+
+    cdef MessageValues vl, ts
+    for i in range(self.dbc[0].num_msgs):
+      msg = self.dbc[0].msgs[i]
+      address, name = msg.address, msg.name.decode('utf8')
+      index = self.signal_index.get(address, {})
+      vl = MessageValues.__new__(MessageValues)
+      vl.parser = self
+      vl.index = index
+      vl._values = self.can.signal_values.data()
+      ts = MessageValues.__new__(MessageValues)
+      ts.parser = self
+      ts.index = index
+      ts._ts = self.can.signal_ts.data()
+
+      # two ways to lookup: address or msg name
+      self.vl[address] = self.vl[name] = vl
+      self.ts[address] = self.ts[name] = ts
+
+  def get_signal(self, msg, sig):
+    """a handle to a requested signal, for reading it every update without the lookups of vl"""
+    address = msg if isinstance(msg, numbers.Number) else self.msg_name_to_address[msg.encode('utf8')]
+    cdef size_t i = self.signal_index[address][sig]
+    cdef CANSignal s = CANSignal.__new__(CANSignal)
+    s.parser = self
+    s._value = &self.can.signal_values[i]
+    s._ts = &self.can.signal_ts[i]
+    return s
+
   cdef unordered_set[uint32_t] update_vl(self):
-    cdef string sig_name
     cdef unordered_set[uint32_t] updated_val
 
-    can_values = self.can.query_latest()
     valid = self.can.can_valid
 
     # Update invalid flag
@@ -116,18 +219,9 @@ cdef class CANParser:
         self.can_invalid_cnt = 0
     self.can_valid = self.can_invalid_cnt < CAN_INVALID_CNT
 
-    for cv in can_values:
-      # Cast char * directly to unicode
-      name = <unicode>self.address_to_msg_name[cv.address].c_str()
-      cv_name = <unicode>cv.name
-
-      self.vl[cv.address][cv_name] = cv.value
-      self.ts[cv.address][cv_name] = cv.ts
-
-      self.vl[name][cv_name] = cv.value
-      self.ts[name][cv_name] = cv.ts
-
-      updated_val.insert(cv.address)
+    # the values are already in place, only the updated messages are returned
+    for address in self.can.query_updated():
+      updated_val.insert(address)
 
     return updated_val
 
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+import copy
+import time
+import unittest
+
+from opendbc.can.packer import CANPacker
+from opendbc.can.parser import CANParser
+from selfdrive.boardd.boardd import can_list_to_can_capnp
+
+DBC = "honda_civic_touring_2016_can_generated"
+SIGNALS = [
+  ("STEER_ANGLE", "STEERING_SENSORS", 0),
+  ("STEER_ANGLE_RATE", "STEERING_SENSORS", 0),
+  ("XMISSION_SPEED", "ENGINE_DATA", 0),
+  ("ENGINE_RPM", "ENGINE_DATA", 0),
+  ("PEDAL_GAS", "POWERTRAIN_DATA", 0),
+  ("BRAKE_SWITCH", "POWERTRAIN_DATA", 0),
+]
+CHECKS = [("STEERING_SENSORS", 100), ("ENGINE_DATA", 100), ("POWERTRAIN_DATA", 100)]
+
+
+def expected_values(i):
+  return {
+    "STEERING_SENSORS": {"STEER_ANGLE": (i % 1000) * 0.1 - 50, "STEER_ANGLE_RATE": i % 300},
+    "ENGINE_DATA": {"XMISSION_SPEED": (i % 100) * 0.5, "ENGINE_RPM": 800 + i % 3000},
+    "POWERTRAIN_DATA": {"PEDAL_GAS": i % 256, "BRAKE_SWITCH": i % 2},
+  }
+
+
+class TestCANParser(unittest.TestCase):
+  def setUp(self):
+    self.packer = CANPacker(DBC)
+    self.cp = CANParser(DBC, SIGNALS, CHECKS, 0)
+
+  def frame(self, i, msgs=None):
+    values = expected_values(i)
+    can = [self.packer.make_can_msg(msg, 0, values[msg], i % 4) for msg in (msgs or values)]
+    # the bus time is the frame number
+    return can_list_to_can_capnp([[addr, i, dat, bus] for addr, _, dat, bus in can])
+
+  def assertValues(self, i, msgs=None):
+    for msg, sigs in expected_values(i).items():
+      if msgs is not None and msg not in msgs:
+        continue
+      for sig, value in sigs.items():
+        self.assertAlmostEqual(self.cp.vl[msg][sig], value, places=5)
+        self.assertEqual(self.cp.ts[msg][sig], i)
+        s = self.cp.get_signal(msg, sig)
+        self.assertEqual(s.value, self.cp.vl[msg][sig])
+        self.assertEqual(s.ts, self.cp.ts[msg][sig])
+
+  def test_values(self):
+    for msg, sigs in expected_values(0).items():
+      self.assertEqual(dict(self.cp.vl[msg]), {s: 0 for s in list(sigs) + ["COUNTER", "CHECKSUM"]})
+
+    for i in range(1, 50):
+      updated = self.cp.update_strings([self.frame(i)])
+      self.assertEqual(updated, {330, 344, 380})
+      self.assertValues(i)
+      self.assertIs(self.cp.vl[330], self.cp.vl["STEERING_SENSORS"])
+
+  def test_updated(self):
+    self.cp.update_strings([self.frame(1)])
+    self.assertEqual(self.cp.update_strings([self.frame(2, ["ENGINE_DATA"])]), {344})
+    self.assertValues(2, ["ENGINE_DATA"])
+    self.assertValues(1, ["STEERING_SENSORS", "POWERTRAIN_DATA"])
+
+    # messages that aren't parsed are empty, signals that aren't parsed are missing
+    self.assertEqual(len(self.cp.vl["GEARBOX"]), 0)
+    self.assertNotIn("STEER_WHEEL_ANGLE", self.cp.vl["STEERING_SENSORS"])
+    with self.assertRaises(KeyError):
+      self.cp.vl["STEERING_SENSORS"]["STEER_WHEEL_ANGLE"]
+    with self.assertRaises(KeyError):
+      self.cp.get_signal("STEERING_SENSORS", "STEER_WHEEL_ANGLE")
+
+  def test_bad_checksum(self):
+    self.cp.update_strings([self.frame(1)])
+    addr, _, dat, bus = self.packer.make_can_msg("STEERING_SENSORS", 0, expected_values(2)["STEERING_SENSORS"], 2)
+    dat = dat[:-1] + bytes([dat[-1] ^ 0x1])
+    self.assertEqual(self.cp.update_strings([can_list_to_can_capnp([[addr, 2, dat, bus]])]), set())
+    self.assertValues(1, ["STEERING_SENSORS"])
+
+  def test_copy(self):
+    self.cp.update_strings([self.frame(1)])
+    live = self.cp.vl["ENGINE_DATA"]
+    snapshot = copy.copy(live)
+    self.assertIsInstance(snapshot, dict)
+    self.assertEqual(snapshot, live.copy())
+
+    self.cp.update_strings([self.frame(2)])
+    self.assertEqual(snapshot["ENGINE_RPM"], 801)
+    self.assertEqual(live["ENGINE_RPM"], 802)
+
+  def test_benchmark(self):
+    frames = [self.frame(i) for i in range(2000)]
+    handles = [self.cp.get_signal(msg, sig) for sig, msg, _ in SIGNALS]
+
+    def run(read):
+      values = []
+      t = time.monotonic()
+      for f in frames:
+        self.cp.update_strings([f])
+        values.append(read())
+      return (time.monotonic() - t) / len(frames) * 1e6, values
+
+    t_vl, vl_values = run(lambda: [self.cp.vl[msg][sig] for sig, msg, _ in SIGNALS])
+    t_handles, handle_values = run(lambda: [s.value for s in handles])
+    print(f"{len(SIGNALS)} signals per update: vl {t_vl:.1f} us, handles {t_handles:.1f} us")
+
+    # only the values are checked, the timings depend on the machine
+    self.assertEqual(handle_values, vl_values)
+
+
+if __name__ == "__main__":
+  unittest.main()
@@ -0,0 +1,51 @@
+// minimal code to fake a panda for the safety code on the host
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ALLOW_DEBUG
+#define UNUSED(x) ((void)(x))
+
+#define MIN(a,b) \
+ ({ __typeof__ (a) _a = (a); \
+     __typeof__ (b) _b = (b); \
+   (_a < _b) ? _a : _b; })
+
+#define MAX(a,b) \
+ ({ __typeof__ (a) _a = (a); \
+     __typeof__ (b) _b = (b); \
+   (_a > _b) ? _a : _b; })
+
+#define ABS(a) \
+ ({ __typeof__ (a) _a = (a); \
+   (_a > 0) ? _a : (-_a); })
+
+#define GET_BUS(msg) (((msg)->RDTR >> 4) & 0xFF)
+#define GET_LEN(msg) ((msg)->RDTR & 0xF)
+#define GET_ADDR(msg) ((((msg)->RIR & 4) != 0) ? ((msg)->RIR >> 3) : ((msg)->RIR >> 21))
+#define GET_BYTE(msg, b) (((int)(b) > 3) ? (((msg)->RDHR >> (8U * ((unsigned int)(b) % 4U))) & 0xFFU) : (((msg)->RDLR >> (8U * (unsigned int)(b))) & 0xFFU))
+#define GET_BYTES_04(msg) ((msg)->RDLR)
+#define GET_BYTES_48(msg) ((msg)->RDHR)
+#define GET_FLAG(value, mask) (((__typeof__(mask))(value) & (mask)) == (mask))
+
+typedef struct {
+  uint32_t RIR;
+  uint32_t RDTR;
+  uint32_t RDLR;
+  uint32_t RDHR;
+} CAN_FIFOMailBox_TypeDef;
+
+// the faults are read from the fault state instead
+void puts(const char *a) {
+  (void)a;
+}
+
+void puth(unsigned int i) {
+  (void)i;
+}
+
+// the safety code reads the time from this
+uint32_t timer_cnt = 0;
+uint32_t microsecond_timer_get(void) {
+  return timer_cnt;
+}
@@ -45,6 +45,12 @@ int16_t current_safety_param = 0;
 const safety_hooks *current_hooks = &nooutput_hooks;
 const addr_checks *current_rx_checks = &default_rx_checks;
 
+// lookup table of the current rx checks, built when the safety mode is set
+AddrCheckLookup addr_check_lookup[MAX_ADDR_CHECK_MSGS];
+int addr_check_lookup_len = 0;
+const AddrCheckStruct *addr_check_lookup_list = NULL;  // NULL if the checks didn't fit
+int addr_check_lookup_list_len = 0;
+
 int safety_rx_hook(CAN_FIFOMailBox_TypeDef *to_push) {
   return current_hooks->rx(to_push);
 }
@@ -97,7 +103,7 @@ uint32_t get_ts_elapsed(uint32_t ts, uint32_t ts_last) {
   return ts - ts_last;
 }
 
-int get_addr_check_index(CAN_FIFOMailBox_TypeDef *to_push, AddrCheckStruct addr_list[], const int len) {
+int get_addr_check_index_linear(CAN_FIFOMailBox_TypeDef *to_push, AddrCheckStruct addr_list[], const int len) {
   int bus = GET_BUS(to_push);
   int addr = GET_ADDR(to_push);
   int length = GET_LEN(to_push);
@@ -126,6 +132,81 @@ int get_addr_check_index(CAN_FIFOMailBox_TypeDef *to_push, AddrCheckStruct addr_
   return index;
 }
 
+// by address, then bus and length. the entries with the same ones keep the order of the
+// checks and their messages, so the first match is the one the linear scan finds
+bool addr_check_lookup_less(const AddrCheckLookup *a, uint32_t addr, uint8_t bus_len) {
+  return (a->addr < addr) || ((a->addr == addr) && (a->bus_len < bus_len));
+}
+
+void init_addr_check_lookup(const addr_checks *rx_checks) {
+  bool fits = true;
+  addr_check_lookup_len = 0;
+  for (int i = 0; fits && (i < rx_checks->len); i++) {
+    for (uint8_t j = 0U; rx_checks->check[i].msg[j].addr != 0; j++) {
+      const CanMsgCheck *msg = &rx_checks->check[i].msg[j];
+      if ((addr_check_lookup_len == (int)MAX_ADDR_CHECK_MSGS) || (msg->bus > 15) || (msg->len > 15)) {
+        fits = false;
+        break;
+      }
+
+      AddrCheckLookup entry = {.addr = (uint32_t)msg->addr, .bus_len = (uint8_t)((msg->bus << 4) | msg->len),
+                               .check = (uint8_t)i, .msg = j};
+      int k = addr_check_lookup_len;
+      while ((k > 0) && addr_check_lookup_less(&entry, addr_check_lookup[k - 1].addr, addr_check_lookup[k - 1].bus_len)) {
+        addr_check_lookup[k] = addr_check_lookup[k - 1];
+        k--;
+      }
+      addr_check_lookup[k] = entry;
+      addr_check_lookup_len++;
+    }
+  }
+  addr_check_lookup_list = fits ? rx_checks->check : NULL;
+  addr_check_lookup_list_len = rx_checks->len;
+}
+
+// same as get_addr_check_index_linear, with a binary search in the lookup table of the current rx checks
+int get_addr_check_index(CAN_FIFOMailBox_TypeDef *to_push, AddrCheckStruct addr_list[], const int len) {
+  int index = -1;
+  if ((addr_list != addr_check_lookup_list) || (len != addr_check_lookup_list_len)) {
+    index = get_addr_check_index_linear(to_push, addr_list, len);
+  } else if (GET_BUS(to_push) <= 15U) {
+    uint32_t addr = GET_ADDR(to_push);
+    uint8_t bus_len = (uint8_t)((GET_BUS(to_push) << 4) | GET_LEN(to_push));
+
+    // the first entry that isn't less than the message
+    int lo = 0;
+    int hi = addr_check_lookup_len;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (addr_check_lookup_less(&addr_check_lookup[mid], addr, bus_len)) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    for (int k = lo; k < addr_check_lookup_len; k++) {
+      const AddrCheckLookup *entry = &addr_check_lookup[k];
+      if ((entry->addr != addr) || (entry->bus_len != bus_len)) {
+        break;
+      }
+      // if multiple msgs are allowed, the first one seen is the only one checked after
+      AddrCheckStruct *check = &addr_list[entry->check];
+      if (!check->msg_seen) {
+        check->index = entry->msg;
+        check->msg_seen = true;
+      }
+      if (check->index == entry->msg) {
+        index = entry->check;
+        break;
+      }
+    }
+  } else {
+    // no checks on the other buses
+  }
+  return index;
+}
+
 // 1Hz safety function called by main. Now just a check for lagging safety messages
 void safety_tick(const addr_checks *rx_checks) {
   uint32_t ts = microsecond_timer_get();
@@ -315,6 +396,7 @@ int set_safety_hooks(uint16_t mode, int16_t param) {
       current_rx_checks->check[j].index = 0;
       current_rx_checks->check[j].msg_seen = false;
     }
+    init_addr_check_lookup(current_rx_checks);
   }
   return set_status;
 }
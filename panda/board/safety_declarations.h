@@ -48,6 +48,17 @@ typedef struct {
   int len;
 } addr_checks;
 
+// the messages of the current rx checks sorted by address, to find the check of a
+// received message with a binary search instead of scanning all of them
+#define MAX_ADDR_CHECK_MSGS 64U
+
+typedef struct {
+  uint32_t addr;
+  uint8_t bus_len;  // bus << 4 | len
+  uint8_t check;    // index in the rx checks
+  uint8_t msg;      // index in the msg array of the check
+} AddrCheckLookup;
+
 int safety_rx_hook(CAN_FIFOMailBox_TypeDef *to_push);
 int safety_tx_hook(CAN_FIFOMailBox_TypeDef *to_send);
 int safety_tx_lin_hook(int lin_num, uint8_t *data, int len);
@@ -65,6 +76,9 @@ float interpolate(struct lookup_t xy, float x);
 void gen_crc_lookup_table(uint8_t poly, uint8_t crc_lut[]);
 bool msg_allowed(CAN_FIFOMailBox_TypeDef *to_send, const CanMsg msg_list[], int len);
 int get_addr_check_index(CAN_FIFOMailBox_TypeDef *to_push, AddrCheckStruct addr_list[], const int len);
+int get_addr_check_index_linear(CAN_FIFOMailBox_TypeDef *to_push, AddrCheckStruct addr_list[], const int len);
+bool addr_check_lookup_less(const AddrCheckLookup *a, uint32_t addr, uint8_t bus_len);
+void init_addr_check_lookup(const addr_checks *rx_checks);
 void update_counter(AddrCheckStruct addr_list[], int index, uint8_t counter);
 void update_addr_timestamp(AddrCheckStruct addr_list[], int index);
 bool is_msg_valid(AddrCheckStruct addr_list[], int index);
@@ -0,0 +1,80 @@
+import os
+import numpy as np
+
+from cffi import FFI
+from common.ffi_wrapper import suffix
+
+safety_dir = os.path.dirname(os.path.abspath(__file__))
+libpandasafety_fn = os.path.join(safety_dir, "libpandasafety" + suffix())
+
+ffi = FFI()
+ffi.cdef("""
+typedef struct {
+  uint32_t RIR;
+  uint32_t RDTR;
+  uint32_t RDLR;
+  uint32_t RDHR;
+} CAN_FIFOMailBox_TypeDef;
+
+typedef struct {
+  uint32_t ts;
+  uint32_t addr;
+  uint8_t bus;
+  uint8_t len;
+  bool tx;
+  uint8_t data[8];
+} replay_frame;
+
+typedef struct {
+  int result;
+  int fwd_bus;
+  bool controls_allowed;
+  uint32_t cycles;
+} replay_result;
+
+int safety_rx_hook(CAN_FIFOMailBox_TypeDef *to_push);
+int safety_tx_hook(CAN_FIFOMailBox_TypeDef *to_send);
+int safety_fwd_hook(int bus_num, CAN_FIFOMailBox_TypeDef *to_fwd);
+int set_safety_mode(uint16_t mode, int16_t param);
+void set_controls_allowed(bool c);
+bool get_controls_allowed(void);
+bool get_relay_malfunction(void);
+uint32_t get_faults(void);
+void set_unsafe_mode(int mode);
+void set_timer(uint32_t t);
+int get_rx_check_msgs(int *addr, int *bus, int *len, int max);
+bool addr_check_lookup_matches(CAN_FIFOMailBox_TypeDef *to_push);
+void safety_replay(const replay_frame *frames, int n, replay_result *results);
+""")
+
+libpandasafety = ffi.dlopen(libpandasafety_fn)
+
+# numpy views of the replay structs, the layouts are checked against the C ones
+FRAME_DTYPE = np.dtype([('ts', np.uint32), ('addr', np.uint32), ('bus', np.uint8), ('len', np.uint8),
+                        ('tx', np.bool_), ('data', np.uint8, 8)], align=True)
+RESULT_DTYPE = np.dtype([('result', np.int32), ('fwd_bus', np.int32), ('controls_allowed', np.bool_),
+                         ('cycles', np.uint32)], align=True)
+
+for dtype, name in ((FRAME_DTYPE, "replay_frame"), (RESULT_DTYPE, "replay_result")):
+  assert dtype.itemsize == ffi.sizeof(name)
+  for field in dtype.names:
+    assert dtype.fields[field][1] == ffi.offsetof(name, field)
+
+
+def make_msg(bus, addr, length=8, dat=b''):
+  dat = dat.ljust(8, b'\x00')
+  msg = ffi.new('CAN_FIFOMailBox_TypeDef *')
+  msg[0].RIR = (addr << 3) | 4 if addr >= 0x800 else addr << 21
+  msg[0].RDTR = (bus << 4) | length
+  msg[0].RDLR = int.from_bytes(dat[:4], 'little')
+  msg[0].RDHR = int.from_bytes(dat[4:8], 'little')
+  return msg
+
+
+def replay(frames):
+  """runs an array of FRAME_DTYPE through the current safety mode, an array of RESULT_DTYPE per frame"""
+  frames = np.ascontiguousarray(frames, dtype=FRAME_DTYPE)
+  results = np.zeros(len(frames), dtype=RESULT_DTYPE)
+  libpandasafety.safety_replay(ffi.cast("replay_frame *", frames.ctypes.data), len(frames),
+                               ffi.cast("replay_result *", results.ctypes.data))
+  return results
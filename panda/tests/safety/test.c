@@ -0,0 +1,153 @@
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "fake_stm.h"
+#include "faults.h"
+#include "safety.h"
+
+// the safety code built for the host, with helpers to set and read its state
+
+void set_controls_allowed(bool c) {
+  controls_allowed = c;
+}
+
+bool get_controls_allowed(void) {
+  return controls_allowed;
+}
+
+bool get_relay_malfunction(void) {
+  return relay_malfunction;
+}
+
+uint32_t get_faults(void) {
+  return faults;
+}
+
+void set_unsafe_mode(int mode) {
+  unsafe_mode = mode;
+}
+
+void set_timer(uint32_t t) {
+  timer_cnt = t;
+}
+
+int set_safety_mode(uint16_t mode, int16_t param) {
+  controls_allowed = false;
+  unsafe_mode = 0;
+  faults = 0U;
+  fault_status = FAULT_STATUS_NONE;
+  timer_cnt = 0U;
+  return set_safety_hooks(mode, param);
+}
+
+// the messages of the current rx checks
+int get_rx_check_msgs(int *addr, int *bus, int *len, int max) {
+  int n = 0;
+  for (int i = 0; i < current_rx_checks->len; i++) {
+    for (int j = 0; (current_rx_checks->check[i].msg[j].addr != 0) && (n < max); j++) {
+      addr[n] = current_rx_checks->check[i].msg[j].addr;
+      bus[n] = current_rx_checks->check[i].msg[j].bus;
+      len[n] = current_rx_checks->check[i].msg[j].len;
+      n++;
+    }
+  }
+  return n;
+}
+
+// runs the lookup and the linear scan from the same state of the current rx checks,
+// true if they find the same check and leave the same state. the lookup's is kept
+bool addr_check_lookup_matches(CAN_FIFOMailBox_TypeDef *to_push) {
+  AddrCheckStruct *checks = current_rx_checks->check;
+  const int len = current_rx_checks->len;
+  int index[MAX_ADDR_CHECK_MSGS];
+  bool seen[MAX_ADDR_CHECK_MSGS];
+  for (int i = 0; i < len; i++) {
+    index[i] = checks[i].index;
+    seen[i] = checks[i].msg_seen;
+  }
+
+  int linear = get_addr_check_index_linear(to_push, checks, len);
+  int linear_index[MAX_ADDR_CHECK_MSGS];
+  bool linear_seen[MAX_ADDR_CHECK_MSGS];
+  for (int i = 0; i < len; i++) {
+    linear_index[i] = checks[i].index;
+    linear_seen[i] = checks[i].msg_seen;
+    checks[i].index = index[i];
+    checks[i].msg_seen = seen[i];
+  }
+
+  bool same = get_addr_check_index(to_push, checks, len) == linear;
+  for (int i = 0; i < len; i++) {
+    same = same && (checks[i].index == linear_index[i]) && (checks[i].msg_seen == linear_seen[i]);
+  }
+  return same;
+}
+
+// ***** replay *****
+
+typedef struct {
+  uint32_t ts;  // us
+  uint32_t addr;
+  uint8_t bus;
+  uint8_t len;
+  bool tx;      // sent by openpilot, checked by the tx hook instead of received
+  uint8_t data[8];
+} replay_frame;
+
+typedef struct {
+  int result;   // what the hook returned, 1 if valid or allowed
+  int fwd_bus;  // where a received frame is forwarded, -1 if it isn't
+  bool controls_allowed;
+  uint32_t cycles;  // in the hook
+} replay_result;
+
+// the time stamp counter where there is one, nanoseconds otherwise
+static inline uint64_t cycle_count(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return ((uint64_t)t.tv_sec * 1000000000ULL) + (uint64_t)t.tv_nsec;
+#endif
+}
+
+static void to_mailbox(const replay_frame *f, CAN_FIFOMailBox_TypeDef *msg) {
+  msg->RIR = (f->addr >= 0x800U) ? ((f->addr << 3) | 4U) : (f->addr << 21);
+  msg->RDTR = ((uint32_t)f->bus << 4) | (f->len & 0xFU);
+  msg->RDLR = f->data[0] | (f->data[1] << 8) | (f->data[2] << 16) | ((uint32_t)f->data[3] << 24);
+  msg->RDHR = f->data[4] | (f->data[5] << 8) | (f->data[6] << 16) | ((uint32_t)f->data[7] << 24);
+}
+
+// feeds the frames through the hooks of the current safety mode in order, with the
+// 1Hz safety tick run as the time stamps pass each second like on the panda
+void safety_replay(const replay_frame *frames, int n, replay_result *results) {
+  uint32_t last_tick = (n > 0) ? frames[0].ts : 0U;
+  for (int i = 0; i < n; i++) {
+    const replay_frame *f = &frames[i];
+    replay_result *r = &results[i];
+
+    timer_cnt = f->ts;
+    while (get_ts_elapsed(timer_cnt, last_tick) >= 1000000U) {
+      last_tick += 1000000U;
+      safety_mode_cnt += 1U;
+      safety_tick(current_rx_checks);
+    }
+
+    CAN_FIFOMailBox_TypeDef msg;
+    to_mailbox(f, &msg);
+    uint64_t start = cycle_count();
+    if (f->tx) {
+      r->result = safety_tx_hook(&msg);
+      r->cycles = (uint32_t)(cycle_count() - start);
+      r->fwd_bus = -1;
+    } else {
+      r->result = safety_rx_hook(&msg);
+      r->cycles = (uint32_t)(cycle_count() - start);
+      r->fwd_bus = safety_fwd_hook(f->bus, &msg);
+    }
+    r->controls_allowed = controls_allowed;
+  }
+}
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Replays the CAN of a drive, or a synthetic stream, through the panda safety code built
+for the host (scons --test). Reports what the hooks decided and the cycles spent in them.
+
+The decisions can be saved and compared against another build of the safety code:
+  replay_drive.py rlog.bz2 --save before.npy
+  replay_drive.py rlog.bz2 --compare before.npy
+"""
+import argparse
+import json
+import sys
+
+import numpy as np
+
+from cereal import car
+from panda.tests.safety.libpandasafety_py import libpandasafety, replay, FRAME_DTYPE
+
+SafetyModel = car.CarParams.SafetyModel
+
+
+def frames_from_logs(fns):
+  """the received and sent CAN of the logs, with the safety config of the first panda"""
+  from tools.lib.logreader import LogReader
+
+  mode, param = None, 0
+  ts, addr, bus, length, tx, data = [], [], [], [], [], []
+  for fn in fns:
+    for msg in LogReader(fn):
+      which = msg.which()
+      if which == 'carParams' and mode is None and len(msg.carParams.safetyConfigs):
+        mode = msg.carParams.safetyConfigs[0].safetyModel.raw
+        param = msg.carParams.safetyConfigs[0].safetyParam
+      elif which in ('can', 'sendcan'):
+        t = (msg.logMonoTime // 1000) & 0xFFFFFFFF
+        for c in getattr(msg, which):
+          # the ones sent are in can again with 128 added to src
+          if c.src >= 128:
+            continue
+          ts.append(t)
+          addr.append(c.address)
+          bus.append(c.src)
+          length.append(len(c.dat))
+          tx.append(which == 'sendcan')
+          data.append(c.dat[:8].ljust(8, b'\x00'))
+
+  frames = np.zeros(len(ts), dtype=FRAME_DTYPE)
+  frames['ts'], frames['addr'], frames['bus'], frames['len'], frames['tx'] = ts, addr, bus, length, tx
+  frames['data'] = np.frombuffer(b''.join(data), dtype=np.uint8).reshape(-1, 8)
+  return frames, mode, param
+
+
+def synthetic_frames(seconds, n_rx=40, n_tx=4, seed=0):
+  """random data at 100Hz on random addresses, most of which the safety mode doesn't check"""
+  rng = np.random.default_rng(seed)
+  rx_addrs = rng.integers(0x20, 0x7ff, n_rx)
+  tx_addrs = rng.integers(0x20, 0x7ff, n_tx)
+  per_tick = n_rx + n_tx
+  n = seconds * 100 * per_tick
+
+  frames = np.zeros(n, dtype=FRAME_DTYPE)
+  frames['ts'] = np.repeat(np.arange(seconds * 100, dtype=np.uint32) * 10000, per_tick)
+  frames['addr'] = np.tile(np.concatenate([rx_addrs, tx_addrs]), seconds * 100)
+  frames['bus'] = np.tile(np.concatenate([rng.integers(0, 3, n_rx), np.zeros(n_tx)]), seconds * 100)
+  frames['len'] = 8
+  frames['tx'] = np.tile(np.arange(per_tick) >= n_rx, seconds * 100)
+  frames['data'] = rng.integers(0, 256, (n, 8))
+  return frames
+
+
+def cycle_stats(cycles):
+  if len(cycles) == 0:
+    return {}
+  return {
+    'mean': float(np.mean(cycles)),
+    'median': float(np.median(cycles)),
+    'p99': float(np.percentile(cycles, 99)),
+    'max': int(np.max(cycles)),
+  }
+
+
+def summarize(frames, results):
+  rx, tx = ~frames['tx'], frames['tx']
+  allowed = results['controls_allowed']
+  return {
+    'frames': len(frames),
+    'rx': {'count': int(rx.sum()), 'invalid': int((results['result'][rx] == 0).sum()),
+           'forwarded': int((results['fwd_bus'][rx] != -1).sum()), 'cycles': cycle_stats(results['cycles'][rx])},
+    'tx': {'count': int(tx.sum()), 'blocked': int((results['result'][tx] == 0).sum()),
+           'cycles': cycle_stats(results['cycles'][tx])},
+    'controls_allowed': {'frames': int(allowed.sum()),
+                         'transitions': int(np.count_nonzero(allowed[1:] != allowed[:-1]))},
+    'relay_malfunction': bool(libpandasafety.get_relay_malfunction()),
+    'faults': int(libpandasafety.get_faults()),
+  }
+
+
+def safety_mode(s):
+  return int(s) if s.isdigit() else SafetyModel.schema.enumerants[s]
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument("logs", nargs="*", help="rlogs of a drive, in order")
+  parser.add_argument("--synthetic", type=int, metavar="SECONDS", help="replay random CAN instead of logs")
+  parser.add_argument("--mode", type=safety_mode, help="safety model name or number, from carParams by default")
+  parser.add_argument("--param", type=int, help="safety param, from carParams by default")
+  parser.add_argument("--engaged", action="store_true", help="start with controls allowed")
+  parser.add_argument("--json", action="store_true", help="print the summary as json")
+  parser.add_argument("--save", help="save the decisions to a .npy file")
+  parser.add_argument("--compare", help="compare the decisions to the ones saved in a .npy file")
+  args = parser.parse_args()
+
+  if args.synthetic:
+    frames, mode, param = synthetic_frames(args.synthetic), None, 0
+  elif args.logs:
+    frames, mode, param = frames_from_logs(args.logs)
+  else:
+    parser.error("logs or --synthetic are needed")
+
+  mode = args.mode if args.mode is not None else mode
+  param = args.param if args.param is not None else param
+  if mode is None:
+    parser.error("no carParams in the logs, --mode is needed")
+  if libpandasafety.set_safety_mode(mode, param) != 0:
+    sys.exit(f"safety mode {mode} isn't supported")
+  libpandasafety.set_controls_allowed(args.engaged)
+
+  results = replay(frames)
+  summary = summarize(frames, results)
+  summary['mode'], summary['param'] = mode, param
+
+  if args.json:
+    print(json.dumps(summary, indent=2))
+  else:
+    print(f"safety mode {mode} param {param}, {summary['frames']} frames")
+    for hook in ('rx', 'tx'):
+      s = summary[hook]
+      extra = f"{s['invalid']} invalid, {s['forwarded']} forwarded" if hook == 'rx' else f"{s['blocked']} blocked"
+      cycles = ", ".join(f"{k} {v:.0f}" for k, v in s['cycles'].items())
+      print(f"{hook}: {s['count']} frames, {extra}, cycles: {cycles}")
+    c = summary['controls_allowed']
+    print(f"controls allowed for {c['frames']} frames, {c['transitions']} transitions")
+    print(f"relay malfunction: {summary['relay_malfunction']}, faults: {summary['faults']:#x}")
+
+  decisions = results[['result', 'fwd_bus', 'controls_allowed']]
+  if args.save:
+    np.save(args.save, decisions)
+  if args.compare:
+    expected = np.load(args.compare)
+    if len(expected) != len(decisions):
+      sys.exit(f"{len(decisions)} frames, {len(expected)} saved")
+    mismatch = np.flatnonzero(expected != decisions)
+    if len(mismatch):
+      i = mismatch[0]
+      sys.exit(f"{len(mismatch)} decisions differ, first at frame {i} "
+               f"(addr {frames['addr'][i]:#x} bus {frames['bus'][i]}): {decisions[i]} != {expected[i]}")
+    print("decisions match")
@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+import os
+import unittest
+
+import numpy as np
+
+from panda.tests.safety import libpandasafety_py
+
+BUILT = os.path.exists(libpandasafety_py.libpandasafety_fn)
+if BUILT:
+  from panda.tests.safety.libpandasafety_py import libpandasafety, make_msg, replay
+  from panda.tests.safety_replay.replay_drive import synthetic_frames
+
+SAFETY_TOYOTA = 2
+
+
+@unittest.skipUnless(BUILT, "libpandasafety isn't built, run scons --test")
+class TestReplayDrive(unittest.TestCase):
+  def test_same_as_hooks(self):
+    # less than a second, so the safety tick doesn't run
+    frames = synthetic_frames(1)
+
+    libpandasafety.set_safety_mode(SAFETY_TOYOTA, 0)
+    libpandasafety.set_controls_allowed(True)
+    results = replay(frames)
+
+    libpandasafety.set_safety_mode(SAFETY_TOYOTA, 0)
+    libpandasafety.set_controls_allowed(True)
+    for f, r in zip(frames, results):
+      libpandasafety.set_timer(int(f['ts']))
+      msg = make_msg(int(f['bus']), int(f['addr']), int(f['len']), f['data'].tobytes())
+      if f['tx']:
+        self.assertEqual(r['result'], libpandasafety.safety_tx_hook(msg))
+      else:
+        self.assertEqual(r['result'], libpandasafety.safety_rx_hook(msg))
+        self.assertEqual(r['fwd_bus'], libpandasafety.safety_fwd_hook(int(f['bus']), msg))
+      self.assertEqual(r['controls_allowed'], libpandasafety.get_controls_allowed())
+
+  def test_lagging_messages(self):
+    # none of the checked messages are sent, the safety tick disengages
+    frames = synthetic_frames(5)
+    libpandasafety.set_safety_mode(SAFETY_TOYOTA, 0)
+    libpandasafety.set_controls_allowed(True)
+    results = replay(frames)
+    self.assertTrue(results['controls_allowed'][0])
+    self.assertFalse(results['controls_allowed'][-1])
+    self.assertEqual(np.count_nonzero(np.diff(results['controls_allowed'].astype(int))), 1)
+    self.assertTrue(np.all(results['cycles'] > 0))
+
+
+if __name__ == "__main__":
+  unittest.main()
@@ -6,7 +6,8 @@ using namespace Eigen;
 
 EKFSym::EKFSym(std::string name, Map<MatrixXdr> Q, Map<VectorXd> x_initial, Map<MatrixXdr> P_initial, int dim_main,
     int dim_main_err, int N, int dim_augment, int dim_augment_err, std::vector<int> maha_test_kinds,
-    std::vector<int> quaternion_idxs, std::vector<std::string> global_vars, double max_rewind_age)
+    std::vector<int> quaternion_idxs, std::vector<std::string> global_vars, double max_rewind_age,
+    int rewind_checkpoint_interval)
 {
   // TODO: add logger
 
@@ -40,6 +41,14 @@ EKFSym::EKFSym(std::string name, Map<MatrixXdr> Q, Map<VectorXd> x_initial, Map<
   this->Q = Q;
 
   this->max_rewind_age = max_rewind_age;
+  assert(rewind_checkpoint_interval > 0);
+  this->rewind_checkpoint_interval = rewind_checkpoint_interval;
+
+  // observations before the first rewindable one are kept back to its checkpoint
+  this->rewind_obscache.resize(REWIND_TO_KEEP + rewind_checkpoint_interval);
+  this->rewind_states.resize(REWIND_TO_KEEP / rewind_checkpoint_interval + 2,
+                             std::make_pair(VectorXd(this->dim_x), MatrixXdr(this->dim_err, this->dim_err)));
+
   this->init_state(x_initial, P_initial, NAN);
 }
 
@@ -51,11 +60,11 @@ void EKFSym::init_state(Map<VectorXd> state, Map<MatrixXdr> covs, double filter_
   this->reset_rewind();
 }
 
-VectorXd EKFSym::state() {
+const VectorXd& EKFSym::state() {
   return this->x;
 }
 
-MatrixXdr EKFSym::covs() {
+const MatrixXdr& EKFSym::covs() {
   return this->P;
 }
 
@@ -86,73 +95,118 @@ std::optional<Estimate> EKFSym::predict_and_update_batch(double t, int kind, std
 {
   // TODO handle rewinding at this level
 
-  std::deque<Observation> rewound;
-  if (!std::isnan(this->filter_time) && t < this->filter_time) {
-    if (this->rewind_t.empty() || t < this->rewind_t.front() || t < this->rewind_t.back() - this->max_rewind_age) {
-      LOGD("observation too old at %d with filter at %d, ignoring!", t, this->filter_time);
-      return std::nullopt;
-    }
-    rewound = this->rewind(t);
+  int rewound;
+  Observation *obs = this->rewind_insert(t, &rewound);
+  if (obs == nullptr) {
+    return std::nullopt;
   }
 
-  Observation obs;
-  obs.t = t;
-  obs.kind = kind;
-  obs.extra_args = extra_args;
-  for (Map<VectorXd> zi : z_map) {
-    obs.z.push_back(zi);
-  }
-  for (Map<MatrixXdr> Ri : R_map) {
-    obs.R.push_back(Ri);
-  }
+  obs->t = t;
+  obs->kind = kind;
+  obs->extra_args = extra_args;
+  obs->z.assign(z_map.begin(), z_map.end());
+  obs->R.assign(R_map.begin(), R_map.end());
 
-  std::optional<Estimate> res = std::make_optional(this->predict_and_update_batch(obs, augment));
+  std::optional<Estimate> res = std::make_optional(this->predict_and_update_batch(*obs, augment));
 
   // optional fast forward
-  while (!rewound.empty()) {
-    this->predict_and_update_batch(rewound.front(), false);
-    rewound.pop_front();
-  }
+  this->fast_forward(rewound);
 
   return res;
 }
 
+bool EKFSym::predict_and_update(double t, int kind, const Ref<const VectorXd>& z, const Ref<const MatrixXdr>& R) {
+  int rewound;
+  Observation *obs = this->rewind_insert(t, &rewound);
+  if (obs == nullptr) {
+    return false;
+  }
+
+  // reuses the storage of the observation that was in this slot before
+  obs->t = t;
+  obs->kind = kind;
+  obs->z.resize(1);
+  obs->z[0] = z;
+  obs->R.resize(1);
+  obs->R[0] = R;
+  obs->extra_args.resize(1);
+  obs->extra_args[0].clear();
+
+  this->replay(*obs);
+  this->checkpoint();
+  this->fast_forward(rewound);
+  return true;
+}
+
 void EKFSym::reset_rewind() {
-  this->rewind_obscache.clear();
-  this->rewind_t.clear();
-  this->rewind_states.clear();
+  this->rewind_begin = 0;
+  this->rewind_end = 0;
 }
 
-std::deque<Observation> EKFSym::rewind(double t) {
-  std::deque<Observation> rewound;
+Observation* EKFSym::rewind_insert(double t, int *rewound) {
+  // returns the rewind buffer slot for an observation at t, rewinding the filter to right before t
+  // if needed. The observations after it are moved up a slot and replayed by fast_forward.
+  uint64_t pos = this->rewind_end;
+  if (!std::isnan(this->filter_time) && t < this->filter_time) {
+    if (this->rewind_begin == this->rewind_end || t < this->rewind_obs(this->rewind_begin).t ||
+        t < this->rewind_obs(this->rewind_end - 1).t - this->max_rewind_age) {
+      LOGD("observation too old at %d with filter at %d, ignoring!", t, this->filter_time);
+      return nullptr;
+    }
 
-  // rewind observations until t is after previous observation
-  while (this->rewind_t.back() > t) {
-    rewound.push_front(this->rewind_obscache.back());
-    this->rewind_t.pop_back();
-    this->rewind_states.pop_back();
-    this->rewind_obscache.pop_back();
+    // rewind observations until t is after previous observation
+    while (this->rewind_obs(pos - 1).t > t) {
+      pos--;
+    }
+
+    // set the state to the time right before that, replaying from the last checkpoint
+    uint64_t last = pos - 1;
+    uint64_t cp = last - last % this->rewind_checkpoint_interval;
+    const auto &state = this->rewind_states[(cp / this->rewind_checkpoint_interval) % this->rewind_states.size()];
+    this->filter_time = this->rewind_obs(cp).t;
+    this->x = state.first;
+    this->P = state.second;
+    for (uint64_t seq = cp + 1; seq <= last; seq++) {
+      this->replay(this->rewind_obs(seq));
+    }
+
+    // the ring always has a free slot past rewind_end, swapping keeps the storage of every slot
+    for (uint64_t seq = this->rewind_end; seq > pos; seq--) {
+      std::swap(this->rewind_obs(seq), this->rewind_obs(seq - 1));
+    }
   }
 
-  // set the state to the time right before that
-  this->filter_time = this->rewind_t.back();
-  this->x = this->rewind_states.back().first;
-  this->P = this->rewind_states.back().second;
+  *rewound = this->rewind_end - pos;
+  this->rewind_end = pos;
+  return &this->rewind_obs(pos);
+}
 
-  return rewound;
+void EKFSym::fast_forward(int rewound) {
+  for (int i = 0; i < rewound; i++) {
+    this->replay(this->rewind_obs(this->rewind_end));
+    this->checkpoint();
+  }
 }
 
-void EKFSym::checkpoint(Observation& obs) {
-  // push to rewinder
-  this->rewind_t.push_back(this->filter_time);
-  this->rewind_states.push_back(std::make_pair(this->x, this->P));
-  this->rewind_obscache.push_back(obs);
+void EKFSym::checkpoint() {
+  // the observation at rewind_end has been applied
+  uint64_t seq = this->rewind_end++;
+  if (seq % this->rewind_checkpoint_interval == 0) {
+    auto &state = this->rewind_states[(seq / this->rewind_checkpoint_interval) % this->rewind_states.size()];
+    state.first = this->x;
+    state.second = this->P;
+  }
 
   // only keep a certain number around
-  if (this->rewind_t.size() > REWIND_TO_KEEP) {
-    this->rewind_t.pop_front();
-    this->rewind_states.pop_front();
-    this->rewind_obscache.pop_front();
+  if (this->rewind_end - this->rewind_begin > REWIND_TO_KEEP) {
+    this->rewind_begin++;
+  }
+}
+
+void EKFSym::replay(const Observation& obs) {
+  this->predict(obs.t);
+  for (int i = 0; i < obs.z.size(); i++) {
+    this->update(obs.kind, obs.z[i], obs.R[i], obs.extra_args[i]);
   }
 }
 
@@ -177,7 +231,12 @@ Estimate EKFSym::predict_and_update_batch(Observation& obs, bool augment) {
     assert(obs.z[i].rows() == obs.R[i].cols());
 
     // update state
-    y.push_back(this->update(obs.kind, obs.z[i], obs.R[i], obs.extra_args[i]));
+    this->update(obs.kind, obs.z[i], obs.R[i], obs.extra_args[i]);
+    if (this->msckf && std::find(this->feature_track_kinds.begin(), this->feature_track_kinds.end(), obs.kind) != this->feature_track_kinds.end()) {
+      y.push_back(this->y.head(this->y.rows() - obs.extra_args[i].size()));
+    } else {
+      y.push_back(this->y);
+    }
   }
 
   res.xk = this->x;
@@ -189,7 +248,7 @@ Estimate EKFSym::predict_and_update_batch(Observation& obs, bool augment) {
   //   this->augment();
   // }
 
-  this->checkpoint(obs);
+  this->checkpoint();
 
   return res;
 }
@@ -209,14 +268,12 @@ void EKFSym::predict(double t) {
   this->filter_time = t;
 }
 
-VectorXd EKFSym::update(int kind, VectorXd z, MatrixXdr R, std::vector<double> extra_args) {
-  this->ekf->updates.at(kind)(this->x.data(), this->P.data(), z.data(), R.data(), extra_args.data());
+void EKFSym::update(int kind, const VectorXd& z, const MatrixXdr& R, const std::vector<double>& extra_args) {
+  // the generated update overwrites z with the innovation, it doesn't write R and extra_args
+  this->y = z;
+  this->ekf->updates.at(kind)(this->x.data(), this->P.data(), this->y.data(), const_cast<double *>(R.data()),
+                              const_cast<double *>(extra_args.data()));
   this->normalize_quaternions();
-
-  if (this->msckf && std::find(this->feature_track_kinds.begin(), this->feature_track_kinds.end(), kind) != this->feature_track_kinds.end()) {
-    return z.head(z.rows() - extra_args.size());
-  }
-  return z;
 }
 
 extra_routine_t EKFSym::get_extra_routine(const std::string& routine) {
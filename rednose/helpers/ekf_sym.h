@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <map>
 #include <cmath>
+#include <cstdint>
 #include <optional>
 
 #include <eigen3/Eigen/Dense>
@@ -46,11 +47,12 @@ public:
       Eigen::Map<MatrixXdr> P_initial, int dim_main, int dim_main_err, int N = 0, int dim_augment = 0,
       int dim_augment_err = 0, std::vector<int> maha_test_kinds = std::vector<int>(),
       std::vector<int> quaternion_idxs = std::vector<int>(),
-      std::vector<std::string> global_vars = std::vector<std::string>(), double max_rewind_age = 1.0);
+      std::vector<std::string> global_vars = std::vector<std::string>(), double max_rewind_age = 1.0,
+      int rewind_checkpoint_interval = 1);
   void init_state(Eigen::Map<Eigen::VectorXd> state, Eigen::Map<MatrixXdr> covs, double filter_time);
 
-  Eigen::VectorXd state();
-  MatrixXdr covs();
+  const Eigen::VectorXd& state();
+  const MatrixXdr& covs();
   void set_filter_time(double t);
   double get_filter_time();
   void normalize_quaternions();
@@ -61,21 +63,28 @@ public:
   void predict(double t);
   std::optional<Estimate> predict_and_update_batch(double t, int kind, std::vector<Eigen::Map<Eigen::VectorXd>> z,
       std::vector<Eigen::Map<MatrixXdr>> R, std::vector<std::vector<double>> extra_args = {{}}, bool augment = false);
+  // single measurement without an Estimate, doesn't allocate once the rewind buffer has been filled.
+  // returns false if the observation is too old to rewind to
+  bool predict_and_update(double t, int kind, const Eigen::Ref<const Eigen::VectorXd>& z, const Eigen::Ref<const MatrixXdr>& R);
 
   extra_routine_t get_extra_routine(const std::string& routine);
 
 private:
-  std::deque<Observation> rewind(double t);
-  void checkpoint(Observation& obs);
+  Observation* rewind_insert(double t, int *rewound);
+  void fast_forward(int rewound);
+  void checkpoint();
+  Observation& rewind_obs(uint64_t seq) { return this->rewind_obscache[seq % this->rewind_obscache.size()]; }
 
   Estimate predict_and_update_batch(Observation& obs, bool augment);
-  Eigen::VectorXd update(int kind, Eigen::VectorXd z, MatrixXdr R, std::vector<double> extra_args);
+  void replay(const Observation& obs);
+  void update(int kind, const Eigen::VectorXd& z, const MatrixXdr& R, const std::vector<double>& extra_args);
 
   // stuct with linked sympy generated functions
   const EKF *ekf = NULL;
 
   Eigen::VectorXd x;  // state
   MatrixXdr P;  // covs
+  Eigen::VectorXd y;  // innovation of the last update
 
   bool msckf;
   int N;
@@ -99,10 +108,16 @@ private:
   MatrixXdr Q;
 
   // rewind stuff
+  // Observations [rewind_begin, rewind_end) can be rewound to. They are kept in a
+  // preallocated ring, with the state after every rewind_checkpoint_interval-th
+  // one. Rewinding restores the nearest checkpoint and replays the observations after it,
+  // so globals set in between are not rewound unless the interval is 1.
   double max_rewind_age;
-  std::deque<double> rewind_t;
-  std::deque<std::pair<Eigen::VectorXd, MatrixXdr>> rewind_states;
-  std::deque<Observation> rewind_obscache;
+  int rewind_checkpoint_interval;
+  uint64_t rewind_begin;
+  uint64_t rewind_end;
+  std::vector<Observation> rewind_obscache;
+  std::vector<std::pair<Eigen::VectorXd, MatrixXdr>> rewind_states;
 
   Eigen::VectorXd augment_times;
 
@@ -104,11 +104,13 @@ def gen_code(folder, name, f_sym, dt_sym, x_sym, obs_eqs, dim_x, dim_err, eskf_p
   # state propagation function
   sympy_functions.append(('f_fun', f_sym, [x_sym, dt_sym]))
   sympy_functions.append(('F_fun', F_sym, [x_sym, dt_sym]))
+  sympy_functions.append(('f_F_fun', [f_sym, F_sym], [x_sym, dt_sym]))  # shares cse for predict
 
   # observation functions
   for h_sym, kind, ea_sym, H_sym, He_sym in obs_eqs:
     sympy_functions.append(('h_%d' % kind, h_sym, [x_sym, ea_sym]))
     sympy_functions.append(('H_%d' % kind, H_sym, [x_sym, ea_sym]))
+    sympy_functions.append(('hH_%d' % kind, [h_sym, H_sym], [x_sym, ea_sym]))  # shares cse for update
     if msckf and kind in feature_track_kinds:
       sympy_functions.append(('He_%d' % kind, He_sym, [x_sym, ea_sym]))
 
@@ -125,6 +127,7 @@ def gen_code(folder, name, f_sym, dt_sym, x_sym, obs_eqs, dim_x, dim_err, eskf_p
   pre_code += "#define EDIM %d\n" % dim_err
   pre_code += "#define MEDIM %d\n" % dim_main_err
   pre_code += "typedef void (*Hfun)(double *, double *, double *);\n"
+  pre_code += "typedef void (*HHfun)(double *, double *, double *, double *);\n"
 
   if global_vars is not None:
     for var in global_vars:
@@ -135,12 +138,15 @@ def gen_code(folder, name, f_sym, dt_sym, x_sym, obs_eqs, dim_x, dim_err, eskf_p
   post_code += "extern \"C\" {\n\n"
 
   for h_sym, kind, ea_sym, H_sym, He_sym in obs_eqs:
+    z_dim = h_sym.shape[0]
     if msckf and kind in feature_track_kinds:
       He_str = 'He_%d' % kind
       # ea_dim = ea_sym.shape[0]
+      r_dim = z_dim - 3  # null space projection removes the ea dimensions
     else:
       He_str = 'NULL'
       # ea_dim = 1 # not really dim of ea but makes c function work
+      r_dim = z_dim
     maha_thresh = chi2_ppf(0.95, int(h_sym.shape[0]))  # mahalanobis distance for outlier detection
     maha_test = kind in maha_test_kinds
 
@@ -148,7 +154,7 @@ def gen_code(folder, name, f_sym, dt_sym, x_sym, obs_eqs, dim_x, dim_err, eskf_p
 
     header += f"void {name}_update_{kind}(double *in_x, double *in_P, double *in_z, double *in_R, double *in_ea);\n"
     post_code += f"void {name}_update_{kind}(double *in_x, double *in_P, double *in_z, double *in_R, double *in_ea) {{\n"
-    post_code += f"  update<{h_sym.shape[0]}, 3, {int(maha_test)}>(in_x, in_P, h_{kind}, H_{kind}, {He_str}, in_z, in_R, in_ea, MAHA_THRESH_{kind});\n"
+    post_code += f"  update<{z_dim}, 3, {r_dim}, {int(maha_test)}>(in_x, in_P, hH_{kind}, {He_str}, in_z, in_R, in_ea, MAHA_THRESH_{kind});\n"
     post_code += "}\n"
 
   # For ffi loading of specific functions
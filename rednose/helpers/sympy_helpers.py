@@ -112,11 +112,33 @@ def quat_matrix_r(p):
                     [p[3],  p[2], -p[1],  p[0]]])
 
 
+def count_ops(exprs, cse=False):
+  elements = [e for expr in exprs for e in (expr if isinstance(expr, sp.MatrixBase) else [expr])]
+  if cse:
+    replacements, elements = sp.cse(elements)
+    elements = elements + [e for _, e in replacements]
+  return sum(sp.count_ops(e) for e in elements)
+
+
 def sympy_into_c(sympy_functions, global_vars=None):
   from sympy.utilities import codegen
+
+  # common subexpressions are pulled out of every routine. A routine with a list
+  # of expressions gets one output per expression, sharing subexpressions between
+  # them (e.g. a function and its jacobian).
+  gen = codegen.C99CodeGen(project='ekf', cse=True)
+
   routines = []
+  op_counts = []
   for name, expr, args in sympy_functions:
-    r = codegen.make_routine(name, expr, language="C99", global_vars=global_vars)
+    exprs = expr if isinstance(expr, list) else [expr]
+    op_counts.append((name, count_ops(exprs), count_ops(exprs, cse=True)))
+
+    if isinstance(expr, list):
+      outputs = [sp.MatrixSymbol(f'out_{i}', *e.shape) for i, e in enumerate(expr)]
+      r = gen.routine(name, [sp.Eq(o, e) for o, e in zip(outputs, expr)], None, global_vars=global_vars)
+    else:
+      r = gen.routine(name, expr, None, global_vars=global_vars)
 
     # argument ordering input to sympy is broken with function with output arguments
     nargs = []
@@ -147,9 +169,16 @@ def sympy_into_c(sympy_functions, global_vars=None):
     # add routine to list
     routines.append(r)
 
-  [(_, c_code), (_, c_header)] = codegen.get_code_generator('C', 'ekf', 'C99').write(routines, "ekf")
+  [(_, c_code), (_, c_header)] = gen.write(routines, "ekf")
   c_header = '\n'.join(x for x in c_header.split("\n") if len(x) > 0 and x[0] != '#')
 
   c_code = '\n'.join(x for x in c_code.split("\n") if len(x) > 0 and x[0] != '#')
 
-  return c_header, c_code
+  # op counts before and after cse, so changes to the models show up in generated code diffs
+  ops_before = sum(before for _, before, _ in op_counts)
+  ops_after = sum(after for _, _, after in op_counts)
+  report = f"// ops without/with cse: {ops_before}/{ops_after}\n"
+  report += "".join(f"//   {name}: {before}/{after}\n" for name, before, after in op_counts)
+  print(f"sympy_into_c: {len(op_counts)} routines, {ops_before} ops without cse, {ops_after} with")
+
+  return c_header, report + c_code
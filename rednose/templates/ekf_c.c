@@ -12,8 +12,7 @@ void predict(double *in_x, double *in_P, double *in_Q, double dt) {
   double in_F[EDIM*EDIM] = {0};
 
   // functions from sympy
-  f_fun(in_x, dt, nx);
-  F_fun(in_x, dt, in_F);
+  f_F_fun(in_x, dt, nx, in_F);
 
 
   EEM F(in_F);
@@ -34,14 +33,17 @@ void predict(double *in_x, double *in_P, double *in_Q, double dt) {
 
 // note: extra_args dim only correct when null space projecting
 // otherwise 1
-template <int ZDIM, int EADIM, bool MAHA_TEST>
-void update(double *in_x, double *in_P, Hfun h_fun, Hfun H_fun, Hfun Hea_fun, double *in_z, double *in_R, double *in_ea, double MAHA_THRESHOLD) {
+// RDIM is the dimension of the observation after null space projection,
+// ZDIM - EADIM when Hea_fun is used, ZDIM otherwise. All matrices are fixed size,
+// so an update does no heap allocation.
+template <int ZDIM, int EADIM, int RDIM, bool MAHA_TEST>
+void update(double *in_x, double *in_P, HHfun hH_fun, Hfun Hea_fun, double *in_z, double *in_R, double *in_ea, double MAHA_THRESHOLD) {
   typedef Eigen::Matrix<double, ZDIM, ZDIM, Eigen::RowMajor> ZZM;
   typedef Eigen::Matrix<double, ZDIM, DIM, Eigen::RowMajor> ZDM;
-  typedef Eigen::Matrix<double, Eigen::Dynamic, EDIM, Eigen::RowMajor> XEM;
-  //typedef Eigen::Matrix<double, EDIM, ZDIM, Eigen::RowMajor> EZM;
-  typedef Eigen::Matrix<double, Eigen::Dynamic, 1> X1M;
-  typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> XXM;
+  typedef Eigen::Matrix<double, RDIM, RDIM, Eigen::RowMajor> RRM;
+  typedef Eigen::Matrix<double, RDIM, DIM, Eigen::RowMajor> RDM;
+  typedef Eigen::Matrix<double, RDIM, EDIM, Eigen::RowMajor> REM;
+  typedef Eigen::Matrix<double, RDIM, 1> R1M;
 
   double in_hx[ZDIM] = {0};
   double in_H[ZDIM * DIM] = {0};
@@ -56,20 +58,22 @@ void update(double *in_x, double *in_P, Hfun h_fun, Hfun H_fun, Hfun Hea_fun, do
   ZZM pre_R(in_R);
 
   // functions from sympy
-  h_fun(in_x, in_ea, in_hx);
-  H_fun(in_x, in_ea, in_H);
+  hH_fun(in_x, in_ea, in_hx, in_H);
   ZDM pre_H(in_H);
 
   // get y (y = z - hx)
   Eigen::Matrix<double, ZDIM, 1> pre_y(in_hx); pre_y = z - pre_y;
-  X1M y; XXM H; XXM R;
-  if (Hea_fun){
+  R1M y; RDM H; RRM R;
+  if constexpr (RDIM != ZDIM) {
     typedef Eigen::Matrix<double, ZDIM, EADIM, Eigen::RowMajor> ZAM;
     double in_Hea[ZDIM * EADIM] = {0};
     Hea_fun(in_x, in_ea, in_Hea);
     ZAM Hea(in_Hea);
-    XXM A = Hea.transpose().fullPivLu().kernel();
 
+    // the kernel has at least ZDIM - EADIM columns, its storage is bounded by ZDIM
+    Eigen::FullPivLU<Eigen::Matrix<double, EADIM, ZDIM, Eigen::RowMajor>> lu(Hea.transpose());
+    Eigen::Matrix<double, ZDIM, Eigen::Dynamic, 0, ZDIM, ZDIM> kernel = lu.kernel();
+    Eigen::Matrix<double, ZDIM, RDIM> A = kernel.leftCols(RDIM);
 
     y = A.transpose() * pre_y;
     H = A.transpose() * pre_H;
@@ -82,27 +86,33 @@ void update(double *in_x, double *in_P, Hfun h_fun, Hfun H_fun, Hfun Hea_fun, do
   // get modified H
   H_mod_fun(in_x, in_H_mod);
   DEM H_mod(in_H_mod);
-  XEM H_err = H * H_mod;
+  REM H_err = H * H_mod;
+
+  // S is symmetric positive definite, so both the mahalanobis test and the
+  // kalman gain are solved with its cholesky factorization
+  REM HP = H_err * P;
+  RRM S = (HP * H_err.transpose()) + R;
+  Eigen::LLT<RRM> llt(S);
 
   // Do mahalobis distance test
   if (MAHA_TEST){
-    XXM a = (H_err * P * H_err.transpose() + R).inverse();
-    double maha_dist = y.transpose() * a * y;
+    double maha_dist = y.dot(llt.solve(y));
     if (maha_dist > MAHA_THRESHOLD){
       R = 1.0e16 * R;
+      S = (HP * H_err.transpose()) + R;
+      llt.compute(S);
     }
   }
 
-  // Outlier resilient weighting
-  double weight = 1;//(1.5)/(1 + y.squaredNorm()/R.sum());
-
   // kalman gains and I_KH
-  XXM S = ((H_err * P) * H_err.transpose()) + R/weight;
-  XEM KT = S.fullPivLu().solve(H_err * P.transpose());
-  //EZM K = KT.transpose(); TODO: WHY DOES THIS NOT COMPILE?
-  //EZM K = S.fullPivLu().solve(H_err * P.transpose()).transpose();
-  //std::cout << "Here is the matrix rot:\n" << K << std::endl;
-  EEM I_KH = Eigen::Matrix<double, EDIM, EDIM>::Identity() - (KT.transpose() * H_err);
+  // P is symmetric, so H_err * P.transpose() == HP
+  REM KT;
+  if (llt.info() == Eigen::Success) {
+    KT = llt.solve(HP);
+  } else {
+    // not positive definite due to rounding, fall back to LU
+    KT = S.fullPivLu().solve(HP);
+  }
 
   // update state by injecting dx
   Eigen::Matrix<double, EDIM, 1> dx(delta_x);
@@ -111,13 +121,13 @@ void update(double *in_x, double *in_P, Hfun h_fun, Hfun H_fun, Hfun Hea_fun, do
   err_fun(in_x, delta_x, x_new);
   Eigen::Matrix<double, DIM, 1> x(x_new);
 
-  // update cov
-  P = ((I_KH * P) * I_KH.transpose()) + ((KT.transpose() * R) * KT);
+  // update cov, the joseph form (I - KH) P (I - KH)^T + K R K^T with both
+  // products by (I - KH) done as rank RDIM corrections instead of EDIM x EDIM products
+  EEM I_KH_P = P - (KT.transpose() * HP);
+  P = I_KH_P - ((I_KH_P * H_err.transpose()) * KT) + ((KT.transpose() * R) * KT);
 
   // copy out state
   memcpy(in_x, x.data(), DIM * sizeof(double));
   memcpy(in_P, P.data(), EDIM * EDIM * sizeof(double));
-  memcpy(in_z, y.data(), y.rows() * sizeof(double));
+  memcpy(in_z, y.data(), RDIM * sizeof(double));
 }
-
-
@@ -1,4 +1,11 @@
+#include <cstring>
+
 #include "cereal/messaging/messaging.h"
+#include "selfdrive/common/timing.h"
+
+// controlsd sends one of these every cycle, the message is built in the same zeroed first segment each time
+#define CAN_LIST_MSG_WORDS 1024
+static kj::Array<capnp::word> msg_segment = kj::heapArray<capnp::word>(CAN_LIST_MSG_WORDS);
 
 typedef struct {
 	long address;
@@ -10,8 +17,11 @@ typedef struct {
 extern "C" {
 
 void can_list_to_can_capnp_cpp(const std::vector<can_frame> &can_list, std::string &out, bool sendCan, bool valid) {
-  MessageBuilder msg;
-  auto event = msg.initEvent(valid);
+  memset(msg_segment.begin(), 0, msg_segment.size() * sizeof(capnp::word));
+  capnp::MallocMessageBuilder msg(msg_segment);
+  auto event = msg.initRoot<cereal::Event>();
+  event.setLogMonoTime(nanos_since_boot());
+  event.setValid(valid);
 
   auto canData = sendCan ? event.initSendcan(can_list.size()) : event.initCan(can_list.size());
   int j = 0;
@@ -5,11 +5,13 @@
 #include <cassert>
 #include <cstdio>
 #include <chrono>
+#include <future>
 #include <thread>
 
 #include "libyuv.h"
 #include <jpeglib.h>
 
+#include "selfdrive/camerad/imgproc/stats.h"
 #include "selfdrive/camerad/imgproc/utils.h"
 #include "selfdrive/common/clutil.h"
 #include "selfdrive/common/modeldata.h"
@@ -88,10 +90,11 @@ void CameraBuf::init(cl_device_id device_id, cl_context context, CameraState *s,
 
   rgb2yuv = std::make_unique<Rgb2Yuv>(context, device_id, rgb_width, rgb_height, rgb_stride);
 
+  // profiled for the per-stage times in FrameData
 #ifdef __APPLE__
-  q = CL_CHECK_ERR(clCreateCommandQueue(context, device_id, 0, &err));
+  q = CL_CHECK_ERR(clCreateCommandQueue(context, device_id, CL_QUEUE_PROFILING_ENABLE, &err));
 #else
-  const cl_queue_properties props[] = {0};  //CL_QUEUE_PRIORITY_KHR, CL_QUEUE_PRIORITY_HIGH_KHR, 0};
+  const cl_queue_properties props[] = {CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0};  //CL_QUEUE_PRIORITY_KHR, CL_QUEUE_PRIORITY_HIGH_KHR, 0};
   q = CL_CHECK_ERR(clCreateCommandQueueWithProperties(context, device_id, props, &err));
 #endif
 }
@@ -105,6 +108,14 @@ CameraBuf::~CameraBuf() {
   if (q) CL_CHECK(clReleaseCommandQueue(q));
 }
 
+// time the command took on the device, in seconds
+static float event_time(cl_event event) {
+  cl_ulong start = 0, end = 0;
+  CL_CHECK(clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL));
+  CL_CHECK(clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL));
+  return (end - start) * 1e-9;
+}
+
 bool CameraBuf::acquire() {
   if (!safe_queue.try_pop(cur_buf_idx, 1)) return false;
 
@@ -117,7 +128,9 @@ bool CameraBuf::acquire() {
   cur_frame_data = camera_bufs_metadata[cur_buf_idx];
   cur_rgb_buf = vipc_server->get_buffer(rgb_type);
 
-  cl_event debayer_event;
+  // q is in-order, so rgb2yuv runs after the debayer without a host wait in between
+  double start_time = millis_since_boot();
+  cl_event debayer_event, rgb2yuv_event;
   cl_mem camrabuf_cl = camera_bufs[cur_buf_idx].buf_cl;
   if (camera_state->ci.bayer) {
     CL_CHECK(clSetKernelArg(krnl_debayer, 0, sizeof(cl_mem), &camrabuf_cl));
@@ -145,11 +158,13 @@ bool CameraBuf::acquire() {
                                cur_rgb_buf->len, 0, 0, &debayer_event));
   }
 
-  clWaitForEvents(1, &debayer_event);
-  CL_CHECK(clReleaseEvent(debayer_event));
-
   cur_yuv_buf = vipc_server->get_buffer(yuv_type);
-  rgb2yuv->queue(q, cur_rgb_buf->buf_cl, cur_yuv_buf->buf_cl);
+  rgb2yuv->queue(q, cur_rgb_buf->buf_cl, cur_yuv_buf->buf_cl, &rgb2yuv_event);
+  cur_frame_data.processing_time = (millis_since_boot() - start_time) / 1000.0;
+  cur_frame_data.debayer_time = event_time(debayer_event);
+  cur_frame_data.rgb2yuv_time = event_time(rgb2yuv_event);
+  CL_CHECK(clReleaseEvent(debayer_event));
+  CL_CHECK(clReleaseEvent(rgb2yuv_event));
 
   VisionIpcBufExtra extra = {
                         cur_frame_data.frame_id,
@@ -188,6 +203,9 @@ void fill_frame_data(cereal::FrameData::Builder &framed, const FrameMetadata &fr
   framed.setLensSag(frame_data.lens_sag);
   framed.setLensErr(frame_data.lens_err);
   framed.setLensTruePos(frame_data.lens_true_pos);
+  framed.setProcessingTime(frame_data.processing_time);
+  framed.setDebayerTime(frame_data.debayer_time);
+  framed.setRgb2yuvTime(frame_data.rgb2yuv_time);
 }
 
 kj::Array<uint8_t> get_frame_image(const CameraBuf *b) {
@@ -216,23 +234,10 @@ kj::Array<uint8_t> get_frame_image(const CameraBuf *b) {
   return kj::mv(frame_image);
 }
 
-static kj::Array<capnp::byte> yuv420_to_jpeg(const CameraBuf *b, int thumbnail_width, int thumbnail_height) {
-  // make the buffer big enough. jpeg_write_raw_data requires 16-pixels aligned height to be used.
-  std::unique_ptr<uint8[]> buf(new uint8_t[(thumbnail_width * ((thumbnail_height + 15) & ~15) * 3) / 2]);
-  uint8_t *y_plane = buf.get();
-  uint8_t *u_plane = y_plane + thumbnail_width * thumbnail_height;
-  uint8_t *v_plane = u_plane + (thumbnail_width * thumbnail_height) / 4;
-  {
-    int result = libyuv::I420Scale(
-        b->cur_yuv_buf->y, b->rgb_width, b->cur_yuv_buf->u, b->rgb_width / 2, b->cur_yuv_buf->v, b->rgb_width / 2,
-        b->rgb_width, b->rgb_height,
-        y_plane, thumbnail_width, u_plane, thumbnail_width / 2, v_plane, thumbnail_width / 2,
-        thumbnail_width, thumbnail_height, libyuv::kFilterNone);
-    if (result != 0) {
-      LOGE("Generate YUV thumbnail failed.");
-      return {};
-    }
-  }
+static kj::Array<capnp::byte> yuv420_to_jpeg(const uint8_t *yuv, int width, int height) {
+  const uint8_t *y_plane = yuv;
+  const uint8_t *u_plane = y_plane + width * height;
+  const uint8_t *v_plane = u_plane + (width * height) / 4;
 
   struct jpeg_compress_struct cinfo;
   struct jpeg_error_mgr jerr;
@@ -243,8 +248,8 @@ static kj::Array<capnp::byte> yuv420_to_jpeg(const CameraBuf *b, int thumbnail_w
   size_t thumbnail_len = 0;
   jpeg_mem_dest(&cinfo, &thumbnail_buffer, &thumbnail_len);
 
-  cinfo.image_width = thumbnail_width;
-  cinfo.image_height = thumbnail_height;
+  cinfo.image_width = width;
+  cinfo.image_height = height;
   cinfo.input_components = 3;
 
   jpeg_set_defaults(&cinfo);
@@ -266,11 +271,11 @@ static kj::Array<capnp::byte> yuv420_to_jpeg(const CameraBuf *b, int thumbnail_w
 
   for (int line = 0; line < cinfo.image_height; line += 16) {
     for (int i = 0; i < 16; ++i) {
-      y[i] = y_plane + (line + i) * cinfo.image_width;
+      y[i] = (JSAMPROW)y_plane + (line + i) * cinfo.image_width;
       if (i % 2 == 0) {
         int offset = (cinfo.image_width / 2) * ((i + line) / 2);
-        u[i / 2] = u_plane + offset;
-        v[i / 2] = v_plane + offset;
+        u[i / 2] = (JSAMPROW)u_plane + offset;
+        v[i / 2] = (JSAMPROW)v_plane + offset;
       }
     }
     jpeg_write_raw_data(&cinfo, planes, 16);
@@ -285,43 +290,51 @@ static kj::Array<capnp::byte> yuv420_to_jpeg(const CameraBuf *b, int thumbnail_w
 }
 
 static void publish_thumbnail(PubMaster *pm, const CameraBuf *b) {
-  auto thumbnail = yuv420_to_jpeg(b, b->rgb_width / 4, b->rgb_height / 4);
-  if (thumbnail.size() == 0) return;
-
-  MessageBuilder msg;
-  auto thumbnaild = msg.initEvent().initThumbnail();
-  thumbnaild.setFrameId(b->cur_frame_data.frame_id);
-  thumbnaild.setTimestampEof(b->cur_frame_data.timestamp_eof);
-  thumbnaild.setThumbnail(thumbnail);
-
-  pm->send("thumbnail", msg);
-}
+  // jpeg encoding takes ~10ms, so it runs on its own thread. skip this thumbnail if the last one isn't done
+  static std::future<void> encoder;
+  if (encoder.valid() && encoder.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    LOGW("thumbnail encoder busy, skipping frame %d", b->cur_frame_data.frame_id);
+    return;
+  }
 
-float set_exposure_target(const CameraBuf *b, int x_start, int x_end, int x_skip, int y_start, int y_end, int y_skip) {
-  int lum_med;
-  uint32_t lum_binning[256] = {0};
-  const uint8_t *pix_ptr = b->cur_yuv_buf->y;
-
-  unsigned int lum_total = 0;
-  for (int y = y_start; y < y_end; y += y_skip) {
-    for (int x = x_start; x < x_end; x += x_skip) {
-      uint8_t lum = pix_ptr[(y * b->rgb_width) + x];
-      lum_binning[lum]++;
-      lum_total += 1;
-    }
+  // downscale here, the yuv buffer is reused once the processing thread moves on.
+  // make the buffer big enough. jpeg_write_raw_data requires 16-pixels aligned height to be used.
+  const int thumbnail_width = b->rgb_width / 4, thumbnail_height = b->rgb_height / 4;
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[(thumbnail_width * ((thumbnail_height + 15) & ~15) * 3) / 2]);
+  uint8_t *y_plane = buf.get();
+  uint8_t *u_plane = y_plane + thumbnail_width * thumbnail_height;
+  uint8_t *v_plane = u_plane + (thumbnail_width * thumbnail_height) / 4;
+  int result = libyuv::I420Scale(
+      b->cur_yuv_buf->y, b->rgb_width, b->cur_yuv_buf->u, b->rgb_width / 2, b->cur_yuv_buf->v, b->rgb_width / 2,
+      b->rgb_width, b->rgb_height,
+      y_plane, thumbnail_width, u_plane, thumbnail_width / 2, v_plane, thumbnail_width / 2,
+      thumbnail_width, thumbnail_height, libyuv::kFilterNone);
+  if (result != 0) {
+    LOGE("Generate YUV thumbnail failed.");
+    return;
   }
 
+  encoder = std::async(std::launch::async, [=, buf = std::move(buf), frame_data = b->cur_frame_data]() {
+    auto thumbnail = yuv420_to_jpeg(buf.get(), thumbnail_width, thumbnail_height);
+    if (thumbnail.size() == 0) return;
 
-  // Find mean lumimance value
-  unsigned int lum_cur = 0;
-  for (lum_med = 255; lum_med >= 0; lum_med--) {
-    lum_cur += lum_binning[lum_med];
+    MessageBuilder msg;
+    auto thumbnaild = msg.initEvent().initThumbnail();
+    thumbnaild.setFrameId(frame_data.frame_id);
+    thumbnaild.setTimestampEof(frame_data.timestamp_eof);
+    thumbnaild.setThumbnail(thumbnail);
 
-    if (lum_cur >= lum_total / 2) {
-      break;
-    }
-  }
+    pm->send("thumbnail", msg);
+  });
+}
+
+float set_exposure_target(const CameraBuf *b, int x_start, int x_end, int x_skip, int y_start, int y_end, int y_skip) {
+  uint32_t lum_binning[256];
+  const uint32_t lum_total = histogram_u8(b->cur_yuv_buf->y, b->rgb_width,
+                                          x_start, x_end, x_skip, y_start, y_end, y_skip, lum_binning);
 
+  // Find median lumimance value
+  const int lum_med = histogram_upper_bound(lum_binning, lum_total / 2);
   return lum_med / 256.0;
 }
 
@@ -342,10 +355,12 @@ void *processing_thread(MultiCameraState *cameras, CameraState *cs, process_thre
   while (!do_exit) {
     if (!cs->buf.acquire()) continue;
 
+    // auto exposure and the thumbnail downscale read the yuv buffer, so they stay on this
+    // thread. AE feeds the next exposure, and the 1/4 downscale only reads every 4th pixel.
+    // only the jpeg encode of the thumbnail runs on a worker
     callback(cameras, cs, cnt);
 
     if (cs == &(cameras->road_cam) && cameras->pm && cnt % 100 == 3) {
-      // this takes 10ms???
       publish_thumbnail(cameras->pm, &(cs->buf));
     }
     cs->buf.release();
@@ -85,6 +85,11 @@ typedef struct FrameMetadata {
   float lens_sag;
   float lens_err;
   float lens_true_pos;
+
+  // Processing, in seconds
+  float processing_time;
+  float debayer_time;
+  float rgb2yuv_time;
 } FrameMetadata;
 
 typedef struct CameraExpInfo {
@@ -50,17 +50,20 @@ void run_camera(CameraState *s) {
   size_t buf_idx = 0;
   std::unique_ptr<uint8_t[]> rgb_buf = std::make_unique<uint8_t[]>(s->frame->getRGBSize());
   while (!do_exit) {
-    if (stream_frame_id == s->frame->getFrameCount()) {
-      // loop stream
-      stream_frame_id = 0;
-    }
-    if (s->frame->get(stream_frame_id++, rgb_buf.get(), nullptr)) {
+    if (s->frame->get(stream_frame_id, rgb_buf.get(), nullptr)) {
       s->buf.camera_bufs_metadata[buf_idx] = {.frame_id = frame_id};
       auto &buf = s->buf.camera_bufs[buf_idx];
       CL_CHECK(clEnqueueWriteBuffer(buf.copy_q, buf.buf_cl, CL_TRUE, 0, s->frame->getRGBSize(), rgb_buf.get(), 0, NULL, NULL));
       s->buf.queue(buf_idx);
       ++frame_id;
       buf_idx = (buf_idx + 1) % FRAME_BUF_COUNT;
+      ++stream_frame_id;
+    } else if (stream_frame_id >= s->frame->getFrameCount()) {
+      // loop stream. the count blocks until the file is indexed, which it is once a get past the end fails
+      stream_frame_id = 0;
+    } else {
+      // skip a frame that failed to decode
+      ++stream_frame_id;
     }
     util::sleep_for(1000 / s->fps);
   }
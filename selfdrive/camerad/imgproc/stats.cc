@@ -0,0 +1,140 @@
+#include "selfdrive/camerad/imgproc/stats.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+uint32_t histogram_u8(const uint8_t *img, int stride,
+                      int x_start, int x_end, int x_skip,
+                      int y_start, int y_end, int y_skip,
+                      uint32_t hist[256]) {
+  // consecutive pixels are often equal, so spread them over separate
+  // lanes to avoid stalling on read-modify-write of the same bin
+  uint32_t lanes[4][256];
+  memset(lanes, 0, sizeof(lanes));
+
+  uint32_t total = 0;
+  for (int y = y_start; y < y_end; y += y_skip) {
+    const uint8_t *row = img + y * stride;
+    int x = x_start;
+    for (; x + 3 * x_skip < x_end; x += 4 * x_skip) {
+      lanes[0][row[x]]++;
+      lanes[1][row[x + x_skip]]++;
+      lanes[2][row[x + 2 * x_skip]]++;
+      lanes[3][row[x + 3 * x_skip]]++;
+      total += 4;
+    }
+    for (; x < x_end; x += x_skip) {
+      lanes[0][row[x]]++;
+      total += 1;
+    }
+  }
+
+  for (int i = 0; i < 256; i++) {
+    hist[i] = lanes[0][i] + lanes[1][i] + lanes[2][i] + lanes[3][i];
+  }
+  return total;
+}
+
+int histogram_upper_bound(const uint32_t hist[256], uint32_t count) {
+  uint32_t cur = 0;
+  int v = 255;
+  for (; v > 0; v--) {
+    cur += hist[v];
+    if (cur >= count) break;
+  }
+  return v;
+}
+
+int histogram_percentile(const uint32_t hist[256], uint32_t total, float p) {
+  const uint32_t count = std::max<uint32_t>(1, p * total);
+  uint32_t cur = 0;
+  int v = 0;
+  for (; v < 255; v++) {
+    cur += hist[v];
+    if (cur >= count) break;
+  }
+  return v;
+}
+
+MeanVar mean_var_s16(const int16_t *v, int size) {
+  int i = 0;
+  int64_t sum = 0;
+  int16_t max = 0;
+#if defined(__ARM_NEON)
+  int64x2_t vsum = vdupq_n_s64(0);
+  int16x8_t vmax = vdupq_n_s16(0);
+  for (; i + 8 <= size; i += 8) {
+    const int16x8_t x = vld1q_s16(v + i);
+    vsum = vpadalq_s32(vsum, vpaddlq_s16(x));
+    vmax = vmaxq_s16(vmax, x);
+  }
+  sum = vgetq_lane_s64(vsum, 0) + vgetq_lane_s64(vsum, 1);
+  max = vmaxvq_s16(vmax);
+#elif defined(__SSE2__)
+  const __m128i ones = _mm_set1_epi16(1);
+  __m128i vmax = _mm_setzero_si128();
+  while (i + 8 <= size) {
+    // int32 lanes can hold 2^15 pairs of int16 before overflowing
+    __m128i vsum = _mm_setzero_si128();
+    for (int n = 0; n < (1 << 14) && i + 8 <= size; n++, i += 8) {
+      const __m128i x = _mm_loadu_si128((const __m128i *)(v + i));
+      vsum = _mm_add_epi32(vsum, _mm_madd_epi16(x, ones));
+      vmax = _mm_max_epi16(vmax, x);
+    }
+    int32_t s[4];
+    _mm_storeu_si128((__m128i *)s, vsum);
+    sum += (int64_t)s[0] + s[1] + s[2] + s[3];
+  }
+  int16_t m[8];
+  _mm_storeu_si128((__m128i *)m, vmax);
+  max = *std::max_element(m, m + 8);
+#endif
+  for (; i < size; i++) {
+    sum += v[i];
+    max = std::max(max, v[i]);
+  }
+  const int16_t mean = sum / size;
+
+  i = 0;
+  int64_t var = 0;
+#if defined(__ARM_NEON)
+  const int16x8_t vmean = vdupq_n_s16(mean);
+  int64x2_t vvar = vdupq_n_s64(0);
+  for (; i + 8 <= size; i += 8) {
+    const int16x8_t d = vsubq_s16(vld1q_s16(v + i), vmean);
+    vvar = vpadalq_s32(vvar, vmull_s16(vget_low_s16(d), vget_low_s16(d)));
+    vvar = vpadalq_s32(vvar, vmull_s16(vget_high_s16(d), vget_high_s16(d)));
+  }
+  var = vgetq_lane_s64(vvar, 0) + vgetq_lane_s64(vvar, 1);
+#elif defined(__SSE2__)
+  const __m128i vmean = _mm_set1_epi16(mean);
+  while (i + 8 <= size) {
+    // each madd lane adds at most 2 * 16383^2 < 2^30, so 7 steps fit in uint32
+    __m128i vvar = _mm_setzero_si128();
+    for (int n = 0; n < 7 && i + 8 <= size; n++, i += 8) {
+      const __m128i d = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(v + i)), vmean);
+      vvar = _mm_add_epi32(vvar, _mm_madd_epi16(d, d));
+    }
+    uint32_t s[4];
+    _mm_storeu_si128((__m128i *)s, vvar);
+    var += (int64_t)s[0] + s[1] + s[2] + s[3];
+  }
+#endif
+  for (; i < size; i++) {
+    const int d = v[i] - mean;
+    var += d * d;
+  }
+
+  return {mean, max, (float)var / size};
+}
+
+uint16_t laplacian_score(const int16_t *lap, int size) {
+  const MeanVar mv = mean_var_s16(lap, size);
+  return std::min(5 * mv.var + mv.max, (float)65535);
+}
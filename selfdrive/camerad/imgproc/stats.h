@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// per-frame image statistics for auto-exposure and focus, vectorized where it pays off
+
+// 256-bin histogram of an 8-bit plane over the strided roi [x_start, x_end) x [y_start, y_end).
+// returns the number of pixels counted
+uint32_t histogram_u8(const uint8_t *img, int stride,
+                      int x_start, int x_end, int x_skip,
+                      int y_start, int y_end, int y_skip,
+                      uint32_t hist[256]);
+
+// highest value v such that at least count pixels are >= v
+int histogram_upper_bound(const uint32_t hist[256], uint32_t count);
+
+// value at fraction p (0-1) of the distribution, counted from the bottom
+int histogram_percentile(const uint32_t hist[256], uint32_t total, float p);
+
+// mean (truncated to int16, like the original focus code) and variance around it.
+// values are expected within +-16383 of the mean, which holds for any 3x3 laplacian of 8-bit data
+struct MeanVar {
+  int16_t mean;
+  int16_t max;
+  float var;
+};
+MeanVar mean_var_s16(const int16_t *v, int size);
+
+// sharpness score of one roi from its laplacian
+uint16_t laplacian_score(const int16_t *lap, int size);
@@ -0,0 +1,110 @@
+// checks the image statistics against the scalar code they replaced, and times them on a full frame
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "selfdrive/camerad/imgproc/stats.h"
+
+static int median_ref(const uint8_t *pix_ptr, int stride, int x_start, int x_end, int x_skip, int y_start, int y_end, int y_skip) {
+  int lum_med;
+  uint32_t lum_binning[256] = {0};
+  unsigned int lum_total = 0;
+  for (int y = y_start; y < y_end; y += y_skip) {
+    for (int x = x_start; x < x_end; x += x_skip) {
+      uint8_t lum = pix_ptr[(y * stride) + x];
+      lum_binning[lum]++;
+      lum_total += 1;
+    }
+  }
+  unsigned int lum_cur = 0;
+  for (lum_med = 255; lum_med >= 0; lum_med--) {
+    lum_cur += lum_binning[lum_med];
+    if (lum_cur >= lum_total / 2) {
+      break;
+    }
+  }
+  return lum_med;
+}
+
+static uint16_t lapmap_ref(const int16_t *lap, int size) {
+  int16_t max = 0;
+  int sum = 0;
+  for (int i = 0; i < size; ++i) {
+    const int16_t v = lap[i];
+    sum += v;
+    if (v > max) max = v;
+  }
+  const int16_t mean = sum / size;
+  int var = 0;
+  for (int i = 0; i < size; ++i) {
+    var += std::pow(lap[i] - mean, 2);
+  }
+  const float fvar = (float)var / size;
+  return std::min(5 * fvar + max, (float)65535);
+}
+
+template <typename F>
+static double time_ms(F f, int iters) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iters; i++) f();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iters;
+}
+
+int main() {
+  const int width = 1928, height = 1208;
+  std::vector<uint8_t> frame(width * height);
+  for (int i = 0; i < frame.size(); i++) {
+    // mostly smooth with noise, like a real frame
+    frame[i] = ((i % width) / 8 + (i / width) / 8 + rand() % 16) & 0xff;
+  }
+
+  // median against the scalar loop, over a variety of rois and skips
+  for (int n = 0; n < 500; n++) {
+    const int x_skip = 1 + rand() % 4, y_skip = 1 + rand() % 4;
+    const int x_start = rand() % (width - 1), y_start = rand() % (height - 1);
+    const int x_end = x_start + 1 + rand() % (width - x_start), y_end = y_start + 1 + rand() % (height - y_start);
+
+    uint32_t hist[256];
+    uint32_t total = histogram_u8(frame.data(), width, x_start, x_end, x_skip, y_start, y_end, y_skip, hist);
+    const int med = histogram_upper_bound(hist, total / 2);
+    assert(med == median_ref(frame.data(), width, x_start, x_end, x_skip, y_start, y_end, y_skip));
+
+    uint32_t sum = 0;
+    for (int i = 0; i < 256; i++) sum += hist[i];
+    assert(sum == total);
+    assert(histogram_percentile(hist, total, 0.0) <= histogram_percentile(hist, total, 0.5));
+    assert(histogram_percentile(hist, total, 0.5) <= histogram_percentile(hist, total, 1.0));
+  }
+
+  // laplacian score against the scalar version, including odd sizes for the tails.
+  // keep the values small enough to not overflow the int accumulators in the scalar version
+  std::vector<int16_t> lap(width * height);
+  for (int n = 0; n < 200; n++) {
+    const int size = 1 + rand() % 30000;
+    for (int i = 0; i < size; i++) lap[i] = (rand() % 511) - 255;
+    assert(laplacian_score(lap.data(), size) == lapmap_ref(lap.data(), size));
+  }
+  printf("statistics match the scalar implementations\n");
+
+  // full resolution benchmark, same roi as the tici road camera
+  const int iters = 50;
+  uint32_t hist[256];
+  volatile int med;
+  double t_hist = time_ms([&]() {
+    uint32_t total = histogram_u8(frame.data(), width, 96, 1832, 2, 242, 1148, 4, hist);
+    med = histogram_upper_bound(hist, total / 2);
+  }, iters);
+  double t_hist_ref = time_ms([&]() { med = median_ref(frame.data(), width, 96, 1832, 2, 242, 1148, 4); }, iters);
+  for (int i = 0; i < lap.size(); i++) lap[i] = (rand() % 61) - 30;
+  volatile uint16_t score;
+  double t_lap = time_ms([&]() { score = laplacian_score(lap.data(), lap.size()); }, iters);
+  double t_lap_ref = time_ms([&]() { score = lapmap_ref(lap.data(), lap.size()); }, iters);
+  printf("%dx%d median: %.3f ms (scalar %.3f ms)\n", width, height, t_hist, t_hist_ref);
+  printf("%dx%d laplacian score: %.3f ms (scalar %.3f ms)\n", width, height, t_lap, t_lap_ref);
+  return 0;
+}
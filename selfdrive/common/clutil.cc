@@ -1,14 +1,19 @@
 #include "selfdrive/common/clutil.h"
 
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <memory>
 #include <vector>
 
+#include "selfdrive/common/swaglog.h"
+#include "selfdrive/common/timing.h"
 #include "selfdrive/common/util.h"
+#include "selfdrive/hardware/hw.h"
 
 namespace {  // helper functions
 
@@ -56,6 +61,98 @@ void cl_print_build_errors(cl_program program, cl_device_id device) {
   std::cout << "build failed; status=" << status << ", log:" << std::endl << log << std::endl; 
 }
 
+// *** program binary cache ***
+// binaries are keyed on everything that affects the compiler output. the key is
+// stored in the file as well, so a hash collision is a cache miss, not a bad program.
+
+const char CL_CACHE_MAGIC[4] = {'C', 'L', 'B', '1'};
+
+uint64_t fnv1a_64(const std::string &s) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (unsigned char c : s) {
+    h = (h ^ c) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+std::string cl_cache_key(cl_device_id device_id, const std::string &src, const char *args) {
+  cl_platform_id platform;
+  CL_CHECK(clGetDeviceInfo(device_id, CL_DEVICE_PLATFORM, sizeof(platform), &platform, NULL));
+  std::string key = get_platform_info(platform, CL_PLATFORM_VERSION) + '\0' +
+                    get_device_info(device_id, CL_DEVICE_NAME) + '\0' +
+                    get_device_info(device_id, CL_DEVICE_VERSION) + '\0' +
+                    get_device_info(device_id, CL_DRIVER_VERSION) + '\0' +
+                    (args ? args : "") + '\0';
+  return key + src;
+}
+
+std::string cl_cache_path(const std::string &key) {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)fnv1a_64(key));
+  return Path::cl_cache() + name;
+}
+
+// cache file: magic | key size | key | binary
+cl_program cl_program_from_cache(cl_context ctx, cl_device_id device_id, const std::string &key, const char *args) {
+  std::string dat = util::read_file(cl_cache_path(key));
+  const size_t header_size = sizeof(CL_CACHE_MAGIC) + sizeof(uint64_t);
+  if (dat.size() <= header_size || memcmp(dat.data(), CL_CACHE_MAGIC, sizeof(CL_CACHE_MAGIC)) != 0) {
+    return NULL;
+  }
+  uint64_t key_size = 0;
+  memcpy(&key_size, dat.data() + sizeof(CL_CACHE_MAGIC), sizeof(key_size));
+  if (key_size != key.size() || dat.size() <= header_size + key_size ||
+      dat.compare(header_size, key_size, key) != 0) {
+    return NULL;
+  }
+
+  const unsigned char *binary = (const unsigned char *)dat.data() + header_size + key_size;
+  size_t binary_size = dat.size() - header_size - key_size;
+  cl_int err = CL_SUCCESS, status = CL_SUCCESS;
+  cl_program prg = clCreateProgramWithBinary(ctx, 1, &device_id, &binary_size, &binary, &status, &err);
+  if (prg == NULL || err != CL_SUCCESS || status != CL_SUCCESS) {
+    return NULL;
+  }
+  if (clBuildProgram(prg, 1, &device_id, args, NULL, NULL) != CL_SUCCESS) {
+    clReleaseProgram(prg);
+    return NULL;
+  }
+  return prg;
+}
+
+void cl_program_to_cache(cl_program prg, const std::string &key) {
+  size_t binary_size = 0;
+  if (clGetProgramInfo(prg, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, NULL) != CL_SUCCESS || binary_size == 0) {
+    return;
+  }
+  std::string binary(binary_size, '\0');
+  unsigned char *bufs[1] = {(unsigned char *)binary.data()};
+  if (clGetProgramInfo(prg, CL_PROGRAM_BINARIES, sizeof(bufs), &bufs, NULL) != CL_SUCCESS) {
+    return;
+  }
+
+  uint64_t key_size = key.size();
+  std::string dat(CL_CACHE_MAGIC, sizeof(CL_CACHE_MAGIC));
+  dat.append((const char *)&key_size, sizeof(key_size));
+  dat += key;
+  dat += binary;
+
+  // write to a temp file and rename, so concurrent readers never see a partial binary. the
+  // temp file is unique, programs with the same source can be cached from several threads at once
+  const std::string cache_dir = Path::cl_cache();
+  if (!util::create_directories(cache_dir, 0775)) return;
+  const std::string path = cl_cache_path(key);
+  std::string tmp_path = path + ".XXXXXX";
+  int fd = mkstemp(tmp_path.data());
+  if (fd < 0) return;
+  fchmod(fd, 0664);
+  ssize_t n = HANDLE_EINTR(write(fd, dat.data(), dat.size()));
+  close(fd);
+  if (n < 0 || (size_t)n != dat.size() || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+  }
+}
+
 }  // namespace
 
 cl_device_id cl_get_device_id(cl_device_type device_type) {
@@ -77,17 +174,30 @@ cl_device_id cl_get_device_id(cl_device_type device_type) {
   return nullptr;
 }
 
-cl_program cl_program_from_file(cl_context ctx, cl_device_id device_id, const char* path, const char* args) {
-  std::string src = util::read_file(path);
-  assert(src.length() > 0);
+cl_program cl_program_from_source(cl_context ctx, cl_device_id device_id, const std::string& src, const char* args, const char* name) {
+  double t1 = millis_since_boot();
+  const std::string key = cl_cache_key(device_id, src, args);
+  if (cl_program prg = cl_program_from_cache(ctx, device_id, key, args)) {
+    LOG("cl program %s loaded from cache in %.2f ms", name, millis_since_boot() - t1);
+    return prg;
+  }
+
   cl_program prg = CL_CHECK_ERR(clCreateProgramWithSource(ctx, 1, (const char*[]){src.c_str()}, NULL, &err));
   if (int err = clBuildProgram(prg, 1, &device_id, args, NULL, NULL); err != 0) {
     cl_print_build_errors(prg, device_id);
     assert(0);
   }
+  cl_program_to_cache(prg, key);
+  LOG("cl program %s built from source in %.2f ms", name, millis_since_boot() - t1);
   return prg;
 }
 
+cl_program cl_program_from_file(cl_context ctx, cl_device_id device_id, const char* path, const char* args) {
+  std::string src = util::read_file(path);
+  assert(src.length() > 0);
+  return cl_program_from_source(ctx, device_id, src, args, path);
+}
+
 // Given a cl code and return a string representation
 #define CL_ERR_TO_STR(err) case err: return #err
 const char* cl_get_error_string(int err) {
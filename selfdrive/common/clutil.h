@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <string>
 
 #ifdef __APPLE__
 #include <OpenCL/cl.h>
@@ -23,5 +24,6 @@
   })
 
 cl_device_id cl_get_device_id(cl_device_type device_type);
+cl_program cl_program_from_source(cl_context ctx, cl_device_id device_id, const std::string& src, const char* args, const char* name);
 cl_program cl_program_from_file(cl_context ctx, cl_device_id device_id, const char* path, const char* args);
 const char* cl_get_error_string(int err);
@@ -5,15 +5,23 @@
 #endif  // _GNU_SOURCE
 
 #include <dirent.h>
+#include <pthread.h>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 
 #include "selfdrive/common/swaglog.h"
@@ -41,27 +49,9 @@ int fsync_dir(const char* path) {
   return result;
 }
 
-int mkdir_p(std::string path) {
-  char * _path = (char *)path.c_str();
-
-  for (char *p = _path + 1; *p; p++) {
-    if (*p == '/') {
-      *p = '\0'; // Temporarily truncate
-      if (mkdir(_path, 0775) != 0) {
-        if (errno != EEXIST) return -1;
-      }
-      *p = '/';
-    }
-  }
-  if (mkdir(_path, 0775) != 0) {
-    if (errno != EEXIST) return -1;
-  }
-  return 0;
-}
-
 bool create_params_path(const std::string &param_path, const std::string &key_path) {
   // Make sure params path exists
-  if (!util::file_exists(param_path) && mkdir_p(param_path) != 0) {
+  if (!util::create_directories(param_path, 0775)) {
     return false;
   }
 
@@ -221,7 +211,128 @@ std::unordered_map<std::string, uint32_t> keys = {
 
 } // namespace
 
-Params::Params() : params_path(Path::params()) {
+// In-process cache of the default params, so polling a key in a loop doesn't cost
+// an open/read/close each time. Values are invalidated by an inotify watch on the
+// key directory, which also sees writes that don't go through Params (e.g. cp).
+class ParamsCache {
+public:
+  // nullptr if caching isn't available
+  static ParamsCache *instance(const std::string &key_path) {
+    static std::once_flag once_flag;
+    std::call_once(once_flag, []() {
+      // the watcher thread doesn't survive a fork, so the child starts over with a new cache
+      pthread_atfork([]() { instance_lock.lock(); },
+                     []() { instance_lock.unlock(); },
+                     []() { cache = nullptr; instance_lock.unlock(); });
+    });
+
+    std::lock_guard lk(instance_lock);
+    if (!cache) {
+      cache = new ParamsCache(key_path);  // lives for the whole process
+    }
+    return cache->watching ? cache : nullptr;
+  }
+
+  // returns true on a hit. on a miss, version must be passed to store()
+  bool lookup(const std::string &key, std::string &value, uint64_t &version) {
+    std::lock_guard lk(lock);
+    Entry &e = entries[key];
+    version = e.version;
+    if (e.cached && watching) {
+      value = e.value;
+      return true;
+    }
+    return false;
+  }
+
+  // only stores if nothing changed since the value was read from disk
+  void store(const std::string &key, const std::string &value, uint64_t version) {
+    std::lock_guard lk(lock);
+    Entry &e = entries[key];
+    if (e.version == version) {
+      e.value = value;
+      e.cached = true;
+    }
+  }
+
+  void invalidate(const std::string &key) {
+    std::lock_guard lk(lock);
+    Entry &e = entries[key];
+    e.version++;
+    e.cached = false;
+    e.value.clear();
+  }
+
+  // wait until the key changes on disk, returns false on timeout
+  bool waitForChange(const std::string &key, uint64_t version, int timeout_ms) {
+    std::unique_lock lk(lock);
+    return cv.wait_for(lk, std::chrono::milliseconds(timeout_ms), [&]() {
+      return !watching || entries[key].version != version;
+    });
+  }
+
+private:
+  struct Entry {
+    uint64_t version = 0;
+    bool cached = false;
+    std::string value;
+  };
+
+  ParamsCache(const std::string &key_path) {
+#ifdef __linux__
+    fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0) return;
+    const uint32_t mask = IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+    if (inotify_add_watch(fd, key_path.c_str(), mask) < 0) {
+      LOGE("params cache disabled, failed to watch %s, errno=%d", key_path.c_str(), errno);
+      close(fd);
+      return;
+    }
+    watching = true;
+    std::thread(&ParamsCache::watch, this).detach();
+#endif
+  }
+
+  void watch() {
+#ifdef __linux__
+    alignas(struct inotify_event) char buf[4096];
+    while (watching) {
+      ssize_t len = HANDLE_EINTR(read(fd, buf, sizeof(buf)));
+      if (len <= 0) break;
+
+      std::lock_guard lk(lock);
+      for (char *ptr = buf; ptr < buf + len;) {
+        auto event = (struct inotify_event *)ptr;
+        if (event->mask & (IN_Q_OVERFLOW | IN_IGNORED)) {
+          // lost events or the directory is gone, stop caching
+          watching = false;
+        } else if (event->len > 0) {
+          Entry &e = entries[event->name];
+          e.version++;
+          e.cached = false;
+          e.value.clear();
+        }
+        ptr += sizeof(struct inotify_event) + event->len;
+      }
+      cv.notify_all();
+    }
+    std::lock_guard lk(lock);
+    watching = false;
+    cv.notify_all();
+#endif
+  }
+
+  std::mutex lock;
+  std::condition_variable cv;
+  std::unordered_map<std::string, Entry> entries;
+  std::atomic<bool> watching = false;
+  int fd = -1;
+
+  inline static std::mutex instance_lock;
+  inline static ParamsCache *cache = nullptr;
+};
+
+Params::Params() : params_path(Path::params()), use_cache(true) {
   static std::once_flag once_flag;
   std::call_once(once_flag, ensure_params_path, params_path);
 }
@@ -271,6 +382,9 @@ int Params::put(const char* key, const char* value, size_t value_size) {
     // fsync parent directory
     path = params_path + "/d";
     result = fsync_dir(path.c_str());
+
+    // don't wait for the watcher, so the next get in this process sees the new value
+    if (ParamsCache *cache = getCache()) cache->invalidate(key);
   } while (false);
 
   close(tmp_fd);
@@ -284,6 +398,7 @@ int Params::remove(const char *key) {
   // Delete value.
   std::string path = params_path + "/d/" + key;
   int result = unlink(path.c_str());
+  if (ParamsCache *cache = getCache()) cache->invalidate(key);
   if (result != 0) {
     return result;
   }
@@ -292,10 +407,22 @@ int Params::remove(const char *key) {
   return fsync_dir(path.c_str());
 }
 
+ParamsCache *Params::getCache() {
+  return use_cache ? ParamsCache::instance(params_path + "/d") : nullptr;
+}
+
 std::string Params::get(const char *key, bool block) {
   std::string path = params_path + "/d/" + key;
+  ParamsCache *cache = getCache();
   if (!block) {
-    return util::read_file(path);
+    std::string value;
+    uint64_t version = 0;
+    if (cache && cache->lookup(key, value, version)) {
+      return value;
+    }
+    value = util::read_file(path);
+    if (cache) cache->store(key, value, version);
+    return value;
   } else {
     // blocking read until successful
     params_do_exit = 0;
@@ -304,10 +431,22 @@ std::string Params::get(const char *key, bool block) {
 
     std::string value;
     while (!params_do_exit) {
-      if (value = util::read_file(path); !value.empty()) {
+      uint64_t version = 0;
+      cache = getCache();
+      if (!cache || !cache->lookup(key, value, version)) {
+        value = util::read_file(path);
+        if (cache) cache->store(key, value, version);
+      }
+      if (!value.empty()) {
         break;
       }
-      util::sleep_for(100);  // 0.1 s
+
+      // wake up as soon as the key is written, the timeout is for checking params_do_exit
+      if (cache) {
+        cache->waitForChange(key, version, 100);
+      } else {
+        util::sleep_for(100);  // 0.1 s
+      }
     }
 
     std::signal(SIGINT, prev_handler_sigint);
@@ -328,11 +467,13 @@ void Params::clearAll(ParamKeyType key_type) {
   FileLock file_lock(params_path + "/.lock", LOCK_EX);
   std::lock_guard<FileLock> lk(file_lock);
 
+  ParamsCache *cache = getCache();
   std::string path;
   for (auto &[key, type] : keys) {
     if (type & key_type) {
       path = params_path + "/d/" + key;
       unlink(path.c_str());
+      if (cache) cache->invalidate(key);
     }
   }
 
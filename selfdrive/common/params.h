@@ -5,6 +5,8 @@
 #include <string>
 #include <optional>
 
+class ParamsCache;
+
 enum ParamKeyType {
   PERSISTENT = 0x02,
   CLEAR_ON_MANAGER_START = 0x04,
@@ -80,5 +82,8 @@ public:
   }
 
 private:
+  ParamsCache *getCache();
+
   const std::string params_path;
+  const bool use_cache = false;
 };
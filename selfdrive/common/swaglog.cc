@@ -4,10 +4,19 @@
 
 #include "selfdrive/common/swaglog.h"
 
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstdarg>
 #include <cstring>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <zmq.h>
 #include "json11.hpp"
@@ -16,6 +25,74 @@
 #include "selfdrive/common/version.h"
 #include "selfdrive/hardware/hw.h"
 
+// Log calls only format the message into a per-thread ring. A background thread
+// builds the json and does the zmq send, so logging from a realtime thread never
+// waits on a lock or a socket. If a ring is full the message is dropped and counted.
+// Errors are written by the caller right away instead, since an assert or an abort
+// often follows them.
+
+struct LogRecord {
+  int levelnum;
+  int lineno;
+  const char *filename;  // __FILE__ and __func__, so they outlive the record
+  const char *func;
+  double created;
+  char *long_msg;  // heap copy for messages that don't fit in msg
+  char msg[448];
+};
+
+class LogRing {
+public:
+  static constexpr size_t SIZE = 128;
+
+  // only called from the owning thread
+  bool push(int levelnum, const char *filename, int lineno, const char *func, const char *fmt, va_list args) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) == SIZE) {
+      return false;
+    }
+
+    LogRecord &r = records[head % SIZE];
+    r.levelnum = levelnum;
+    r.lineno = lineno;
+    r.filename = filename;
+    r.func = func;
+    r.created = seconds_since_epoch();
+    r.long_msg = nullptr;
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int len = vsnprintf(r.msg, sizeof(r.msg), fmt, args);
+    if (len >= (int)sizeof(r.msg)) {
+      vasprintf(&r.long_msg, fmt, args_copy);
+    }
+    va_end(args_copy);
+
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // only called from the flusher
+  template <typename F>
+  void drain(F f) {
+    const size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    for (; tail != head; tail++) {
+      LogRecord &r = records[tail % SIZE];
+      f(r);
+      free(r.long_msg);
+      tail_.store(tail + 1, std::memory_order_release);
+    }
+  }
+
+  std::atomic<bool> closed = false;  // owning thread exited
+
+private:
+  alignas(64) std::atomic<size_t> head_ = 0;
+  alignas(64) std::atomic<size_t> tail_ = 0;
+  LogRecord records[SIZE];
+};
+
 class LogState {
  public:
   LogState() = default;
@@ -26,19 +103,116 @@ class LogState {
   void *zctx;
   void *sock;
   int print_level;
+
+  // flusher
+  std::mutex rings_lock;
+  std::vector<std::shared_ptr<LogRing>> rings;
+  std::atomic<uint64_t> dropped = 0;
+  std::thread flusher;
+  std::atomic<bool> flusher_sleeping = false;
+  std::atomic<bool> do_exit = false;
+  std::mutex flusher_lock;
+  std::condition_variable flusher_cv;
 };
 
+static LogState s = {};
+
+struct RingHolder {
+  std::shared_ptr<LogRing> ring;
+  ~RingHolder() {
+    if (ring) ring->closed = true;
+  }
+};
+static thread_local RingHolder ring_holder;
+
+
 LogState::~LogState() {
-  zmq_close(sock);
-  zmq_ctx_destroy(zctx);
+  // the flusher writes what's left and exits, it can't outlive the state
+  if (flusher.joinable()) {
+    {
+      std::lock_guard lk(flusher_lock);
+      do_exit = true;
+    }
+    flusher_cv.notify_one();
+    flusher.join();
+  }
+  if (inited) {
+    zmq_close(sock);
+    zmq_ctx_destroy(zctx);
+  }
 }
 
-static LogState s = {};
-
 static void cloudlog_bind_locked(const char* k, const char* v) {
   s.ctx_j[k] = v;
 }
 
+static void log(int levelnum, const char* filename, int lineno, const char* func, const char* msg, double created) {
+  json11::Json log_j = json11::Json::object {
+    {"msg", msg},
+    {"ctx", s.ctx_j},
+    {"levelnum", levelnum},
+    {"filename", filename},
+    {"lineno", lineno},
+    {"funcname", func},
+    {"created", created}
+  };
+  std::string log_s = log_j.dump();
+
+  if (levelnum >= s.print_level) {
+    printf("%s: %s\n", filename, msg);
+    if (levelnum >= CLOUDLOG_ERROR) fflush(stdout);
+  }
+  char levelnum_c = levelnum;
+  zmq_send(s.sock, (levelnum_c + log_s).c_str(), log_s.length() + 1, ZMQ_NOBLOCK);
+}
+
+static void flush_rings() {
+  std::vector<std::shared_ptr<LogRing>> rings;
+  {
+    std::lock_guard lk(s.rings_lock);
+    rings = s.rings;
+  }
+
+  std::lock_guard lk(s.lock);
+  bool reap = false;
+  for (auto &ring : rings) {
+    // a ring closed before draining won't get any more records
+    reap |= ring->closed;
+    ring->drain([](const LogRecord &r) {
+      log(r.levelnum, r.filename, r.lineno, r.func, r.long_msg ? r.long_msg : r.msg, r.created);
+    });
+  }
+
+  static uint64_t reported_dropped = 0;
+  if (uint64_t dropped = s.dropped; dropped != reported_dropped) {
+    std::string msg = util::string_format("swaglog: %llu messages dropped", (unsigned long long)(dropped - reported_dropped));
+    log(CLOUDLOG_WARNING, __FILE__, __LINE__, __func__, msg.c_str(), seconds_since_epoch());
+    reported_dropped = dropped;
+  }
+
+  if (reap) {
+    std::lock_guard rings_lk(s.rings_lock);
+    s.rings.erase(std::remove_if(s.rings.begin(), s.rings.end(), [&](auto &ring) {
+      return ring->closed && std::find(rings.begin(), rings.end(), ring) != rings.end();
+    }), s.rings.end());
+  }
+}
+
+static void flusher_thread() {
+  set_thread_name("swaglog");
+  while (!s.do_exit) {
+    flush_rings();
+
+    // log calls only pay for a notify if the flusher is asleep
+    std::unique_lock lk(s.flusher_lock);
+    if (s.do_exit) break;
+    s.flusher_sleeping = true;
+    s.flusher_cv.wait_for(lk, std::chrono::milliseconds(100));
+    s.flusher_sleeping = false;
+  }
+  flush_rings();
+}
+
 static void cloudlog_init() {
   if (s.inited) return;
   s.ctx_j = json11::Json::object {};
@@ -79,41 +253,82 @@ static void cloudlog_init() {
     cloudlog_bind_locked("device", "pc");
   }
 
+  // the flusher doesn't survive a fork, the child sets everything up again on its first log.
+  // records still queued at the fork are flushed by the parent, so the child drops its copy.
+  static std::once_flag once_flag;
+  std::call_once(once_flag, []() {
+    pthread_atfork([]() {
+      s.lock.lock();
+      s.rings_lock.lock();
+      s.flusher_lock.lock();
+    }, []() {
+      s.flusher_lock.unlock();
+      s.rings_lock.unlock();
+      s.lock.unlock();
+    }, []() {
+      s.flusher_lock.unlock();
+      s.rings_lock.unlock();
+      s.lock.unlock();
+      // the parent's flusher may have been waiting on this, and its thread isn't in the child
+      new (&s.flusher_cv) std::condition_variable();
+      new (&s.flusher) std::thread();
+      s.inited = false;
+      s.rings.clear();
+      ring_holder.ring.reset();
+    });
+  });
+
+  s.flusher = std::thread(flusher_thread);
+
   s.inited = true;
 }
 
-void log(int levelnum, const char* filename, int lineno, const char* func, const char* msg, const std::string& log_s) {
-  std::lock_guard lk(s.lock);
-  cloudlog_init();
-  if (levelnum >= s.print_level) {
-    printf("%s: %s\n", filename, msg);
+static LogRing *thread_ring() {
+  if (!ring_holder.ring) {
+    {
+      std::lock_guard lk(s.lock);
+      cloudlog_init();
+    }
+    ring_holder.ring = std::make_shared<LogRing>();
+    std::lock_guard lk(s.rings_lock);
+    s.rings.push_back(ring_holder.ring);
   }
-  char levelnum_c = levelnum;
-  zmq_send(s.sock, (levelnum_c + log_s).c_str(), log_s.length() + 1, ZMQ_NOBLOCK);
+  return ring_holder.ring.get();
+}
+
+static void log_now(LogRing *ring, int levelnum, const char* filename, int lineno, const char* func,
+                    const char* fmt, va_list args) {
+  char *msg = nullptr;
+  if (vasprintf(&msg, fmt, args) < 0) return;
+
+  // the flusher drains under the same lock, so the thread's earlier records are written first
+  std::lock_guard lk(s.lock);
+  ring->drain([](const LogRecord &r) {
+    log(r.levelnum, r.filename, r.lineno, r.func, r.long_msg ? r.long_msg : r.msg, r.created);
+  });
+  log(levelnum, filename, lineno, func, msg, seconds_since_epoch());
+  free(msg);
 }
 
 void cloudlog_e(int levelnum, const char* filename, int lineno, const char* func,
                 const char* fmt, ...) {
-  char* msg_buf = nullptr;
+  LogRing *ring = thread_ring();
   va_list args;
   va_start(args, fmt);
-  vasprintf(&msg_buf, fmt, args);
+  if (levelnum >= CLOUDLOG_ERROR) {
+    log_now(ring, levelnum, filename, lineno, func, fmt, args);
+    va_end(args);
+    return;
+  }
+  bool pushed = ring->push(levelnum, filename, lineno, func, fmt, args);
   va_end(args);
 
-  if (!msg_buf) return;
-
-  json11::Json log_j = json11::Json::object {
-    {"msg", msg_buf},
-    {"ctx", s.ctx_j},
-    {"levelnum", levelnum},
-    {"filename", filename},
-    {"lineno", lineno},
-    {"funcname", func},
-    {"created", seconds_since_epoch()}
-  };
-  std::string log_s = log_j.dump();
-  log(levelnum, filename, lineno, func, msg_buf, log_s);
-  free(msg_buf);
+  if (!pushed) {
+    s.dropped++;
+  }
+  if (s.flusher_sleeping && s.flusher_sleeping.exchange(false)) {
+    s.flusher_cv.notify_one();
+  }
 }
 
 void cloudlog_bind(const char* k, const char* v) {
@@ -0,0 +1,41 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "selfdrive/common/swaglog.h"
+#include "selfdrive/common/timing.h"
+
+// the time spent in a log call, from several threads at once. nothing has to receive
+// the messages, the zmq sends don't block
+int main(int argc, char *argv[]) {
+  const int n = argc > 1 ? atoi(argv[1]) : 1000;  // calls per thread
+  const int us_between = argc > 2 ? atoi(argv[2]) : 100;
+
+  for (int threads : {1, 4, 8}) {
+    std::vector<std::vector<uint64_t>> times(threads, std::vector<uint64_t>(n));
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; t++) {
+      ts.emplace_back([&, t]() {
+        for (int i = 0; i < n; i++) {
+          uint64_t start = nanos_since_boot();
+          LOGD("benchmark thread %d message %d value %f", t, i, i * 0.5);
+          times[t][i] = nanos_since_boot() - start;
+          std::this_thread::sleep_for(std::chrono::microseconds(us_between));
+        }
+      });
+    }
+    for (auto &t : ts) t.join();
+
+    std::vector<uint64_t> all;
+    for (auto &v : times) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+    double mean = 0;
+    for (auto t : all) mean += t;
+    mean /= all.size();
+    printf("%d threads: mean %.2fus, median %.2fus, p99 %.2fus, max %.2fus per call\n", threads,
+           mean / 1e3, all[all.size() / 2] / 1e3, all[all.size() * 99 / 100] / 1e3, all.back() / 1e3);
+  }
+  return 0;
+}
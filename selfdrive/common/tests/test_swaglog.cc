@@ -0,0 +1,136 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zmq.h>
+
+#include <csignal>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json11.hpp"
+
+#include "selfdrive/common/swaglog.h"
+#include "selfdrive/common/util.h"
+
+// receives what's logged like logmessaged does, bound before anything is logged
+class LogReceiver {
+public:
+  LogReceiver() {
+    zctx = zmq_ctx_new();
+    sock = zmq_socket(zctx, ZMQ_PULL);
+    int timeout = 1000;
+    zmq_setsockopt(sock, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    zmq_bind(sock, "ipc:///tmp/logmessage");
+  }
+  ~LogReceiver() {
+    zmq_close(sock);
+    zmq_ctx_destroy(zctx);
+  }
+
+  // the messages whose text starts with prefix, and the number reported dropped,
+  // until there are n of both together or nothing is received for a second
+  std::vector<json11::Json> receive(const std::string &prefix, size_t n, uint64_t *dropped = nullptr) {
+    std::vector<json11::Json> msgs;
+    uint64_t drops = 0;
+    while (msgs.size() + drops < n) {
+      int len = zmq_recv(sock, buf, sizeof(buf), 0);
+      if (len <= 0) break;
+
+      std::string err;
+      auto msg = json11::Json::parse(std::string(buf + 1, std::min(len, (int)sizeof(buf)) - 1), err);
+      REQUIRE(err.empty());
+      REQUIRE(msg["levelnum"].int_value() == buf[0]);
+      const std::string &text = msg["msg"].string_value();
+      if (text.rfind(prefix, 0) == 0) {
+        msgs.push_back(msg);
+      } else if (text.rfind("swaglog: ", 0) == 0) {
+        drops += std::stoull(text.substr(9));
+      }
+    }
+    if (dropped) *dropped = drops;
+    return msgs;
+  }
+
+private:
+  void *zctx, *sock;
+  char buf[1 << 16];
+};
+
+LogReceiver receiver;
+
+TEST_CASE("messages from each thread arrive in order") {
+  const int threads = 4, n = 100;  // less than a ring, so none are dropped
+  std::vector<std::thread> ts;
+  for (int t = 0; t < threads; t++) {
+    ts.emplace_back([=]() {
+      for (int i = 0; i < n; i++) LOGD("order %d %d", t, i);
+    });
+  }
+  for (auto &t : ts) t.join();
+
+  auto msgs = receiver.receive("order", threads * n);
+  REQUIRE(msgs.size() == threads * n);
+
+  std::map<int, int> next;
+  for (auto &msg : msgs) {
+    int t, i;
+    REQUIRE(sscanf(msg["msg"].string_value().c_str(), "order %d %d", &t, &i) == 2);
+    REQUIRE(i == next[t]++);
+    REQUIRE(msg["levelnum"].int_value() == CLOUDLOG_DEBUG);
+    REQUIRE(msg["filename"].string_value() == __FILE__);
+    REQUIRE(msg["funcname"].string_value() == "operator()");
+    REQUIRE(msg["ctx"]["version"].is_string());
+  }
+}
+
+TEST_CASE("long messages") {
+  std::string text = "long " + std::string(4000, 'x');
+  LOGD("%s", text.c_str());
+  auto msgs = receiver.receive("long", 1);
+  REQUIRE(msgs.size() == 1);
+  REQUIRE(msgs[0]["msg"].string_value() == text);
+}
+
+TEST_CASE("messages over a full ring are counted") {
+  const int n = 20000;
+  for (int i = 0; i < n; i++) LOGD("burst %d", i);
+
+  uint64_t dropped = 0;
+  auto msgs = receiver.receive("burst", n, &dropped);
+  REQUIRE(msgs.size() + dropped == n);
+  REQUIRE(msgs.size() >= 128);
+}
+
+TEST_CASE("errors are written before they return") {
+  LOGD("order in the parent");
+
+  // a forked child logs on its own flusher, and its error is printed even though it aborts right after
+  fflush(stdout);
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  pid_t pid = fork();
+  if (pid == 0) {
+    dup2(fds[1], STDOUT_FILENO);
+    LOGW("warning before the error");
+    LOGE("error before abort");
+    signal(SIGABRT, SIG_DFL);
+    abort();
+  }
+  close(fds[1]);
+
+  std::string out;
+  char buf[256];
+  for (ssize_t len; (len = read(fds[0], buf, sizeof(buf))) > 0;) out.append(buf, len);
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+
+  REQUIRE(WIFSIGNALED(status));
+  size_t warning = out.find("warning before the error"), error = out.find("error before abort");
+  REQUIRE(error != std::string::npos);
+  REQUIRE(warning < error);
+}
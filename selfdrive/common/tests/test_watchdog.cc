@@ -0,0 +1,70 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <string>
+
+#include "selfdrive/common/timing.h"
+#include "selfdrive/common/watchdog.h"
+
+// a table of the test's own instead of the one in /dev/shm, set before it's mapped
+struct TempTable {
+  std::string path = "/tmp/test_watchdog_" + std::to_string(getpid());
+  TempTable() { setenv("WATCHDOG_TABLE", path.c_str(), 1); }
+  ~TempTable() { unlink(path.c_str()); }
+} temp_table;
+
+TEST_CASE("watchdog_kick") {
+  uint64_t start = nanos_since_boot();
+  REQUIRE(watchdog_kick());
+
+  // the slot is claimed on the first kick
+  uint64_t t = watchdog_wait(getpid(), start, 0);
+  REQUIRE(t > start);
+  REQUIRE(t <= nanos_since_boot());
+
+  SECTION("a kick updates the time") {
+    REQUIRE(watchdog_kick());
+    REQUIRE(watchdog_wait(getpid(), t, 0) > t);
+  }
+  SECTION("no kick times out") {
+    uint64_t before = nanos_since_boot();
+    REQUIRE(watchdog_wait(getpid(), t, 50) == 0);
+    REQUIRE(nanos_since_boot() - before >= 50 * 1000000ULL);
+  }
+}
+
+TEST_CASE("watchdog_wait wakes up on a kick") {
+  REQUIRE(watchdog_kick());
+
+  // the child gets a slot of its own even though its parent already had one
+  pid_t pid = fork();
+  if (pid == 0) {
+    watchdog_kick();
+    usleep(100 * 1000);
+    watchdog_kick();
+    _exit(0);
+  }
+
+  uint64_t first = 0;
+  for (int i = 0; i < 100 && first == 0; i++) {
+    // 0 right away until the child has a slot
+    first = watchdog_wait(pid, 0, 10);
+    if (first == 0) usleep(10 * 1000);
+  }
+  REQUIRE(first > 0);
+  REQUIRE(watchdog_wait(pid, first, 1000) > first);
+  // woken up by the kick, not the timeout
+  REQUIRE(nanos_since_boot() - first < 500 * 1000000ULL);
+
+  int status;
+  waitpid(pid, &status, 0);
+  REQUIRE(WIFEXITED(status));
+}
+
+TEST_CASE("unknown pid") {
+  REQUIRE(watchdog_wait(-1, 0, 10) == 0);
+}
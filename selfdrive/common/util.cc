@@ -121,6 +121,16 @@ bool file_exists(const std::string& fn) {
   return stat(fn.c_str(), &st) != -1;
 }
 
+bool create_directories(const std::string& dir, mode_t mode) {
+  std::string path = dir;
+  for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+    path[pos] = '\0';  // temporarily truncate
+    if (mkdir(path.c_str(), mode) != 0 && errno != EEXIST) return false;
+    path[pos] = '/';
+  }
+  return mkdir(path.c_str(), mode) == 0 || errno == EEXIST;
+}
+
 std::string getenv(const char* key, const char* default_val) {
   const char* val = ::getenv(key);
   return val ? val : default_val;
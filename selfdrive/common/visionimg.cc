@@ -50,11 +50,15 @@ EGLImageTexture::~EGLImageTexture() {
 
 #else // ifdef QCOM
 
+// the storage is allocated once, frames are uploaded into it with glTexSubImage2D
 EGLImageTexture::EGLImageTexture(const VisionBuf *buf) {
   glGenTextures(1, &frame_tex);
   glBindTexture(GL_TEXTURE_2D, frame_tex);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, buf->width, buf->height, 0, GL_RGB, GL_UNSIGNED_BYTE, buf->addr);
-  glGenerateMipmap(GL_TEXTURE_2D);
+#ifdef __APPLE__
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, buf->width, buf->height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+#else
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGB8, buf->width, buf->height);
+#endif
 }
 
 EGLImageTexture::~EGLImageTexture() {
@@ -1,19 +1,148 @@
 #include "selfdrive/common/watchdog.h"
 
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
-#include <cstdint>
-#include <string>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <mutex>
 
 #include "selfdrive/common/timing.h"
-#include "selfdrive/common/util.h"
 
-const std::string watchdog_fn_prefix = "/dev/shm/wd_";  // + <pid>
+namespace {
+
+const size_t table_size = sizeof(WatchdogSlot) * WATCHDOG_MAX_PROCS;
+
+std::mutex table_lock;
+WatchdogSlot *table = nullptr;
+std::atomic<WatchdogSlot *> own_slot = nullptr;
+
+// maps the table, it's created by whichever process uses it first
+WatchdogSlot *map_table() {
+  if (table != nullptr) return table;
+
+  const char *path = getenv("WATCHDOG_TABLE");
+  int fd = open(path ? path : WATCHDOG_TABLE_PATH, O_RDWR | O_CREAT, 0664);
+  if (fd < 0) return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (st.st_size < (off_t)table_size && ftruncate(fd, table_size) != 0)) {
+    close(fd);
+    return nullptr;
+  }
+  void *mem = mmap(NULL, table_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) return nullptr;
+
+  table = (WatchdogSlot *)mem;
+  return table;
+}
+
+WatchdogSlot *find_slot(WatchdogSlot *slots, int32_t pid) {
+  for (int i = 0; i < WATCHDOG_MAX_PROCS; i++) {
+    if (slots[i].pid.load() == pid) return &slots[i];
+  }
+  return nullptr;
+}
+
+// the slot of a process that had the same pid before, a free one, or one of a process that died
+WatchdogSlot *claim_slot(WatchdogSlot *slots, int32_t pid) {
+  if (WatchdogSlot *slot = find_slot(slots, pid)) return slot;
+
+  for (int i = 0; i < WATCHDOG_MAX_PROCS; i++) {
+    int32_t expected = 0;
+    if (slots[i].pid.compare_exchange_strong(expected, pid)) return &slots[i];
+  }
+  for (int i = 0; i < WATCHDOG_MAX_PROCS; i++) {
+    int32_t p = slots[i].pid.load();
+    if (p > 0 && kill(p, 0) != 0 && errno == ESRCH && slots[i].pid.compare_exchange_strong(p, pid)) {
+      return &slots[i];
+    }
+  }
+  return nullptr;
+}
+
+#ifdef __linux__
+// the futex is the low half of the time, which changes with every kick
+uint32_t *futex_word(WatchdogSlot *slot) {
+  return reinterpret_cast<uint32_t *>(&slot->time) + (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ ? 1 : 0);
+}
+#endif
+
+void wake_waiters(WatchdogSlot *slot) {
+#ifdef __linux__
+  syscall(SYS_futex, futex_word(slot), FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+#endif
+}
+
+void wait_for_kick(WatchdogSlot *slot, uint64_t time, uint64_t timeout_ns) {
+#ifdef __linux__
+  struct timespec ts = {.tv_sec = (time_t)(timeout_ns / 1000000000ULL), .tv_nsec = (long)(timeout_ns % 1000000000ULL)};
+  syscall(SYS_futex, futex_word(slot), FUTEX_WAIT, (uint32_t)time, &ts, NULL, 0);
+#else
+  usleep(std::min(timeout_ns / 1000, (uint64_t)1000));
+#endif
+}
+
+}  // namespace
 
 bool watchdog_kick() {
-  std::string fn = watchdog_fn_prefix + std::to_string(getpid());
-  std::string cur_t = std::to_string(nanos_since_boot());
+  WatchdogSlot *slot = own_slot.load();
+  if (slot == nullptr) {
+    std::lock_guard lk(table_lock);
+    slot = own_slot.load();
+    if (slot == nullptr) {
+      WatchdogSlot *slots = map_table();
+      slot = slots ? claim_slot(slots, getpid()) : nullptr;
+      if (slot == nullptr) return false;
+
+      // a forked child claims a slot of its own
+      static int atfork = pthread_atfork(nullptr, nullptr, [] { own_slot = nullptr; });
+      (void)atfork;
+      own_slot = slot;
+    }
+  }
+
+  // ordered with watchdog_wait registering as a waiter, so a kick can't miss a waiter
+  // that's about to sleep and the waker only makes a syscall when there is one
+  slot->time.store(nanos_since_boot());
+  if (slot->waiters.load() > 0) {
+    wake_waiters(slot);
+  }
+  return true;
+}
+
+uint64_t watchdog_wait(pid_t pid, uint64_t last_time, int timeout_ms) {
+  WatchdogSlot *slot = nullptr;
+  {
+    std::lock_guard lk(table_lock);
+    WatchdogSlot *slots = map_table();
+    slot = slots ? find_slot(slots, pid) : nullptr;
+  }
+  if (slot == nullptr) return 0;
 
-  int r = util::write_file(fn.c_str(), cur_t.data(), cur_t.length(), O_WRONLY | O_CREAT);
-  return r == 0;
+  const uint64_t deadline = nanos_since_boot() + timeout_ms * 1000000ULL;
+  slot->waiters.fetch_add(1);
+  uint64_t t = slot->time.load();
+  while (t <= last_time) {
+    uint64_t now = nanos_since_boot();
+    if (now >= deadline) {
+      t = 0;
+      break;
+    }
+    wait_for_kick(slot, t, deadline - now);
+    t = slot->time.load();
+  }
+  slot->waiters.fetch_sub(1);
+  return t;
 }
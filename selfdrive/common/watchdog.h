@@ -1,3 +1,27 @@
 #pragma once
 
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+
+// The watchdog is a table in shared memory with a slot per process. A process claims
+// its slot on the first kick, after that a kick is one store of the time, and the
+// manager reads the slots of all the processes in one pass. WATCHDOG_TABLE in the
+// environment overrides the path, for tests.
+#define WATCHDOG_TABLE_PATH "/dev/shm/wd_table"
+#define WATCHDOG_MAX_PROCS 64
+
+struct alignas(64) WatchdogSlot {
+  std::atomic<int32_t> pid;      // 0 if free
+  std::atomic<uint32_t> waiters;  // waiting in watchdog_wait, a kick only wakes them if there are any
+  std::atomic<uint64_t> time;    // nanos_since_boot of the last kick
+};
+static_assert(sizeof(WatchdogSlot) == 64, "one cache line per slot");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the slots are shared between processes");
+
 bool watchdog_kick();
+
+// Waits until the process kicks with a time later than last_time. Returns the time of
+// the kick, or 0 if it didn't kick in timeout_ms or has no slot.
+uint64_t watchdog_wait(pid_t pid, uint64_t last_time, int timeout_ms);
@@ -22,6 +22,7 @@ from selfdrive.controls.lib.latcontrol_indi import LatControlINDI
 from selfdrive.controls.lib.latcontrol_lqr import LatControlLQR
 from selfdrive.controls.lib.latcontrol_angle import LatControlAngle
 from selfdrive.controls.lib.events import Events, ET
+from selfdrive.controls.lib.controls_publisher.controls_publisher_pyx import ControlsPublisher  # pylint: disable=no-name-in-module, import-error
 from selfdrive.controls.lib.alertmanager import AlertManager
 from selfdrive.controls.lib.vehicle_model import VehicleModel
 from selfdrive.locationd.calibrationd import Calibration
@@ -136,6 +137,15 @@ class Controls:
     elif self.CP.lateralTuning.which() == 'lqr':
       self.LaC = LatControlLQR(self.CP)
 
+    # controlsState and carState are built in C++ in a reused segment every cycle
+    if self.joystick_mode:
+      lateral_state = 'debugState'
+    elif self.CP.steerControlType == car.CarParams.SteerControlType.angle:
+      lateral_state = 'angleState'
+    else:
+      lateral_state = self.CP.lateralTuning.which() + 'State'
+    self.publisher = ControlsPublisher(lateral_state)
+
     self.initialized = False
     self.state = State.disabled
     self.enabled = False
@@ -570,7 +580,10 @@ class Controls:
   def publish_logs(self, CS, start_time, actuators, lac_log):
     """Send actuators and hud commands to the car, send controlsstate and MPC logging"""
 
-    CC = car.CarControl.new_message()
+    # built in the message that's sent instead of copied into it
+    cc_send = messaging.new_message('carControl')
+    cc_send.valid = CS.canValid
+    CC = cc_send.carControl
     CC.enabled = self.enabled
     CC.active = self.active
     CC.actuators = actuators
@@ -625,60 +638,17 @@ class Controls:
     steer_angle_without_offset = math.radians(CS.steeringAngleDeg - params.angleOffsetAverageDeg)
     curvature = -self.VM.calc_curvature(steer_angle_without_offset, CS.vEgo)
 
-    # controlsState
-    dat = messaging.new_message('controlsState')
-    dat.valid = CS.canValid
-    controlsState = dat.controlsState
-    controlsState.alertText1 = self.AM.alert_text_1
-    controlsState.alertText2 = self.AM.alert_text_2
-    controlsState.alertSize = self.AM.alert_size
-    controlsState.alertStatus = self.AM.alert_status
-    controlsState.alertBlinkingRate = self.AM.alert_rate
-    controlsState.alertType = self.AM.alert_type
-    controlsState.alertSound = self.AM.audible_alert
-    controlsState.canMonoTimes = list(CS.canMonoTimes)
-    controlsState.longitudinalPlanMonoTime = self.sm.logMonoTime['longitudinalPlan']
-    controlsState.lateralPlanMonoTime = self.sm.logMonoTime['lateralPlan']
-    controlsState.enabled = self.enabled
-    controlsState.active = self.active
-    controlsState.curvature = curvature
-    controlsState.state = self.state
-    controlsState.engageable = not self.events.any(ET.NO_ENTRY)
-    controlsState.longControlState = self.LoC.long_control_state
-    controlsState.vPid = float(self.LoC.v_pid)
-    controlsState.vCruise = float(self.v_cruise_kph)
-    controlsState.upAccelCmd = float(self.LoC.pid.p)
-    controlsState.uiAccelCmd = float(self.LoC.pid.i)
-    controlsState.ufAccelCmd = float(self.LoC.pid.f)
-    controlsState.cumLagMs = -self.rk.remaining * 1000.
-    controlsState.startMonoTime = int(start_time * 1e9)
-    controlsState.forceDecel = bool(force_decel)
-    controlsState.canErrorCounter = self.can_error_counter
-
-    if self.joystick_mode:
-      controlsState.lateralControlState.debugState = lac_log
-    elif self.CP.steerControlType == car.CarParams.SteerControlType.angle:
-      controlsState.lateralControlState.angleState = lac_log
-    elif self.CP.lateralTuning.which() == 'pid':
-      controlsState.lateralControlState.pidState = lac_log
-    elif self.CP.lateralTuning.which() == 'lqr':
-      controlsState.lateralControlState.lqrState = lac_log
-    elif self.CP.lateralTuning.which() == 'indi':
-      controlsState.lateralControlState.indiState = lac_log
-    self.pm.send('controlsState', dat)
-
-    # carState
-    car_events = self.events.to_msg()
-    cs_send = messaging.new_message('carState')
-    cs_send.valid = CS.canValid
-    cs_send.carState = CS
-    cs_send.carState.events = car_events
-    self.pm.send('carState', cs_send)
+    self.pm.send('controlsState', self.publisher.controls_state(
+      CS.canValid, self.AM, CS, self.sm.logMonoTime['longitudinalPlan'], self.sm.logMonoTime['lateralPlan'],
+      self.enabled, self.active, curvature, self.state, not self.events.any(ET.NO_ENTRY), self.LoC,
+      float(self.v_cruise_kph), -self.rk.remaining * 1000., int(start_time * 1e9), bool(force_decel),
+      self.can_error_counter, lac_log))
+    self.pm.send('carState', self.publisher.car_state(CS.canValid, CS, self.events.names))
 
     # carEvents - logged every second or on change
     if (self.sm.frame % int(1. / DT_CTRL) == 0) or (self.events.names != self.events_prev):
       ce_send = messaging.new_message('carEvents', len(self.events))
-      ce_send.carEvents = car_events
+      ce_send.carEvents = self.events.to_msg()
       self.pm.send('carEvents', ce_send)
     self.events_prev = self.events.names.copy()
 
@@ -689,9 +659,6 @@ class Controls:
       self.pm.send('carParams', cp_send)
 
     # carControl
-    cc_send = messaging.new_message('carControl')
-    cc_send.valid = CS.canValid
-    cc_send.carControl = CC
     self.pm.send('carControl', cc_send)
 
     # copy CarControl to pass to CarInterface on the next iteration
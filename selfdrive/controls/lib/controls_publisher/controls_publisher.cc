@@ -0,0 +1,95 @@
+#include "selfdrive/controls/lib/controls_publisher/controls_publisher.h"
+
+#include <cstring>
+
+#include "selfdrive/common/timing.h"
+
+cereal::Event::Builder ServiceMessage::initEvent(bool valid) {
+  // a first segment passed to the builder has to be zeroed
+  builder.reset();
+  memset(segment.begin(), 0, segment.size() * sizeof(capnp::word));
+  builder.emplace(segment);
+
+  cereal::Event::Builder event = builder->initRoot<cereal::Event>();
+  event.setLogMonoTime(nanos_since_boot());
+  event.setValid(valid);
+  return event;
+}
+
+kj::ArrayPtr<capnp::byte> ServiceMessage::toBytes() {
+  size_t msg_words = capnp::computeSerializedSizeInWords(*builder);
+  if (msg_words > bytes.size()) {
+    bytes = kj::heapArray<capnp::word>(msg_words);
+  }
+  kj::ArrayOutputStream output_stream(bytes.asBytes());
+  capnp::writeMessage(output_stream, *builder);
+  return output_stream.getArray();
+}
+
+kj::ArrayPtr<capnp::byte> ControlsPublisher::controlsState(bool valid, const ControlsStateData &data, const char *lateral, size_t lateral_size) {
+  auto cs = controls_state_msg.initEvent(valid).initControlsState();
+  cs.setStartMonoTime(data.start_mono_time);
+  cs.setCanMonoTimes(kj::arrayPtr(data.can_mono_times.data(), data.can_mono_times.size()));
+  cs.setLongitudinalPlanMonoTime(data.longitudinal_plan_mono_time);
+  cs.setLateralPlanMonoTime(data.lateral_plan_mono_time);
+
+  cs.setState((cereal::ControlsState::OpenpilotState)data.state);
+  cs.setEnabled(data.enabled);
+  cs.setActive(data.active);
+
+  cs.setLongControlState((cereal::CarControl::Actuators::LongControlState)data.long_control_state);
+  cs.setVPid(data.v_pid);
+  cs.setVCruise(data.v_cruise);
+  cs.setUpAccelCmd(data.up_accel_cmd);
+  cs.setUiAccelCmd(data.ui_accel_cmd);
+  cs.setUfAccelCmd(data.uf_accel_cmd);
+  cs.setCurvature(data.curvature);
+  cs.setForceDecel(data.force_decel);
+
+  cs.setAlertText1(data.alert_text1);
+  cs.setAlertText2(data.alert_text2);
+  cs.setAlertStatus((cereal::ControlsState::AlertStatus)data.alert_status);
+  cs.setAlertSize((cereal::ControlsState::AlertSize)data.alert_size);
+  cs.setAlertBlinkingRate(data.alert_blinking_rate);
+  cs.setAlertType(data.alert_type);
+  cs.setAlertSound((cereal::CarControl::HUDControl::AudibleAlert)data.alert_sound);
+  cs.setEngageable(data.engageable);
+
+  cs.setCumLagMs(data.cum_lag_ms);
+  cs.setCanErrorCounter(data.can_error_counter);
+
+  capnp::FlatArrayMessageReader reader(aligned_buf.align(lateral, lateral_size));
+  auto lat = cs.initLateralControlState();
+  switch (lateral_state) {
+    case LateralState::INDI: lat.setIndiState(reader.getRoot<cereal::ControlsState::LateralINDIState>()); break;
+    case LateralState::PID: lat.setPidState(reader.getRoot<cereal::ControlsState::LateralPIDState>()); break;
+    case LateralState::LQR: lat.setLqrState(reader.getRoot<cereal::ControlsState::LateralLQRState>()); break;
+    case LateralState::ANGLE: lat.setAngleState(reader.getRoot<cereal::ControlsState::LateralAngleState>()); break;
+    case LateralState::DEBUG: lat.setDebugState(reader.getRoot<cereal::ControlsState::LateralDebugState>()); break;
+  }
+  return controls_state_msg.toBytes();
+}
+
+kj::ArrayPtr<capnp::byte> ControlsPublisher::carState(bool valid, const char *car_state, size_t car_state_size, const std::vector<CarEventData> &events) {
+  auto event = car_state_msg.initEvent(valid);
+  capnp::FlatArrayMessageReader reader(aligned_buf.align(car_state, car_state_size));
+  // the events of the car interface are replaced by the ones of controlsd
+  event.setCarState(reader.getRoot<cereal::CarState>());
+  auto cs = event.getCarState();
+
+  auto events_list = cs.initEvents(events.size());
+  for (size_t i = 0; i < events.size(); ++i) {
+    const CarEventData &e = events[i];
+    auto ev = events_list[i];
+    ev.setName((cereal::CarEvent::EventName)e.name);
+    ev.setEnable(e.enable);
+    ev.setNoEntry(e.no_entry);
+    ev.setWarning(e.warning);
+    ev.setUserDisable(e.user_disable);
+    ev.setSoftDisable(e.soft_disable);
+    ev.setImmediateDisable(e.immediate_disable);
+    ev.setPreEnable(e.pre_enable);
+    ev.setPermanent(e.permanent);
+  }
+  return car_state_msg.toBytes();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cereal/messaging/messaging.h"
+
+// Builds the controlsState and carState controlsd sends every cycle. Each service is built in
+// the same zeroed first segment and serialized into the same buffer every cycle, so there's no
+// allocation and no space left behind by fields that are set again.
+
+#define CONTROLS_STATE_MSG_WORDS 512
+#define CAR_STATE_MSG_WORDS 1024
+
+class ServiceMessage {
+public:
+  explicit ServiceMessage(size_t words) : segment(kj::heapArray<capnp::word>(words)), bytes(kj::heapArray<capnp::word>(words)) {}
+  // drops the last message
+  cereal::Event::Builder initEvent(bool valid);
+  kj::ArrayPtr<capnp::byte> toBytes();
+
+private:
+  kj::Array<capnp::word> segment;
+  kj::Array<capnp::word> bytes;
+  std::optional<capnp::MallocMessageBuilder> builder;
+};
+
+struct ControlsStateData {
+  uint64_t start_mono_time;
+  std::vector<uint64_t> can_mono_times;
+  uint64_t longitudinal_plan_mono_time, lateral_plan_mono_time;
+  int state;
+  bool enabled, active, engageable, force_decel;
+  int long_control_state;
+  float v_pid, v_cruise, up_accel_cmd, ui_accel_cmd, uf_accel_cmd, curvature, cum_lag_ms;
+  uint32_t can_error_counter;
+  std::string alert_text1, alert_text2, alert_type;
+  int alert_status, alert_size, alert_sound;
+  float alert_blinking_rate;
+};
+
+struct CarEventData {
+  int name;
+  bool enable, no_entry, warning, user_disable, soft_disable, immediate_disable, pre_enable, permanent;
+};
+
+// the member of ControlsState.lateralControlState that's set
+enum class LateralState {
+  INDI, PID, LQR, ANGLE, DEBUG,
+};
+
+class ControlsPublisher {
+public:
+  explicit ControlsPublisher(LateralState lateral_state) : lateral_state(lateral_state) {}
+  // lateral is the serialized lateral controller state. the bytes are valid until the next call
+  kj::ArrayPtr<capnp::byte> controlsState(bool valid, const ControlsStateData &data, const char *lateral, size_t lateral_size);
+  // car_state is the serialized CarState of the car interface, its events are replaced
+  kj::ArrayPtr<capnp::byte> carState(bool valid, const char *car_state, size_t car_state_size, const std::vector<CarEventData> &events);
+
+private:
+  const LateralState lateral_state;
+  ServiceMessage controls_state_msg{CONTROLS_STATE_MSG_WORDS};
+  ServiceMessage car_state_msg{CAR_STATE_MSG_WORDS};
+  AlignedBuffer aligned_buf;
+};
@@ -0,0 +1,35 @@
+# cython: language_level = 3
+from libc.stdint cimport uint32_t, uint64_t
+from libcpp cimport bool
+from libcpp.string cimport string
+from libcpp.vector cimport vector
+
+cdef extern from "selfdrive/controls/lib/controls_publisher/controls_publisher.h":
+  cdef cppclass MessageBytes "kj::ArrayPtr<capnp::byte>":
+    unsigned char *begin()
+    size_t size()
+
+  cdef struct ControlsStateData:
+    uint64_t start_mono_time
+    vector[uint64_t] can_mono_times
+    uint64_t longitudinal_plan_mono_time, lateral_plan_mono_time
+    int state
+    bool enabled, active, engageable, force_decel
+    int long_control_state
+    float v_pid, v_cruise, up_accel_cmd, ui_accel_cmd, uf_accel_cmd, curvature, cum_lag_ms
+    uint32_t can_error_counter
+    string alert_text1, alert_text2, alert_type
+    int alert_status, alert_size, alert_sound
+    float alert_blinking_rate
+
+  cdef struct CarEventData:
+    int name
+    bool enable, no_entry, warning, user_disable, soft_disable, immediate_disable, pre_enable, permanent
+
+  cpdef enum class LateralState:
+    INDI, PID, LQR, ANGLE, DEBUG
+
+  cdef cppclass ControlsPublisher:
+    ControlsPublisher(LateralState)
+    MessageBytes controlsState(bool, const ControlsStateData &, const char *, size_t)
+    MessageBytes carState(bool, const char *, size_t, const vector[CarEventData] &)
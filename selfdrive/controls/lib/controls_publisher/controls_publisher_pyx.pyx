@@ -0,0 +1,89 @@
+# distutils: language = c++
+# cython: language_level = 3
+from libcpp cimport bool
+from libcpp.vector cimport vector
+from selfdrive.controls.lib.controls_publisher.controls_publisher cimport MessageBytes, ControlsStateData, CarEventData, LateralState
+from selfdrive.controls.lib.controls_publisher.controls_publisher cimport ControlsPublisher as c_ControlsPublisher
+
+from selfdrive.controls.lib.events import EVENTS, ET
+
+LATERAL_STATES = {
+  'indiState': LateralState.INDI,
+  'pidState': LateralState.PID,
+  'lqrState': LateralState.LQR,
+  'angleState': LateralState.ANGLE,
+  'debugState': LateralState.DEBUG,
+}
+
+
+cdef bytes to_bytes(MessageBytes msg):
+  return (<char *>msg.begin())[:msg.size()]
+
+
+cdef CarEventData car_event(int name):
+  types = EVENTS.get(name, {})
+  cdef CarEventData e
+  e.name = name
+  e.enable = ET.ENABLE in types
+  e.no_entry = ET.NO_ENTRY in types
+  e.warning = ET.WARNING in types
+  e.user_disable = ET.USER_DISABLE in types
+  e.soft_disable = ET.SOFT_DISABLE in types
+  e.immediate_disable = ET.IMMEDIATE_DISABLE in types
+  e.pre_enable = ET.PRE_ENABLE in types
+  e.permanent = ET.PERMANENT in types
+  return e
+
+
+cdef class ControlsPublisher:
+  """Builds controlsd's controlsState and carState in C++, each in a reused first segment.
+  The methods return the serialized event for PubMaster.send"""
+  cdef c_ControlsPublisher *publisher
+  cdef ControlsStateData data
+  cdef vector[CarEventData] events
+
+  def __cinit__(self, str lateral_state):
+    self.publisher = new c_ControlsPublisher(LATERAL_STATES[lateral_state])
+
+  def __dealloc__(self):
+    del self.publisher
+
+  def controls_state(self, bool valid, AM, CS, long_plan_mono_time, lat_plan_mono_time, bool enabled, bool active,
+                     curvature, state, bool engageable, LoC, v_cruise, cum_lag_ms, start_mono_time, bool force_decel,
+                     can_error_counter, lac_log):
+    self.data.alert_text1 = AM.alert_text_1.encode()
+    self.data.alert_text2 = AM.alert_text_2.encode()
+    self.data.alert_size = AM.alert_size
+    self.data.alert_status = AM.alert_status
+    self.data.alert_blinking_rate = AM.alert_rate
+    self.data.alert_type = AM.alert_type.encode()
+    self.data.alert_sound = AM.audible_alert
+    self.data.can_mono_times = CS.canMonoTimes
+    self.data.longitudinal_plan_mono_time = long_plan_mono_time
+    self.data.lateral_plan_mono_time = lat_plan_mono_time
+    self.data.enabled = enabled
+    self.data.active = active
+    self.data.curvature = curvature
+    self.data.state = state
+    self.data.engageable = engageable
+    self.data.long_control_state = LoC.long_control_state
+    self.data.v_pid = LoC.v_pid
+    self.data.v_cruise = v_cruise
+    self.data.up_accel_cmd = LoC.pid.p
+    self.data.ui_accel_cmd = LoC.pid.i
+    self.data.uf_accel_cmd = LoC.pid.f
+    self.data.cum_lag_ms = cum_lag_ms
+    self.data.start_mono_time = start_mono_time
+    self.data.force_decel = force_decel
+    self.data.can_error_counter = can_error_counter
+
+    cdef bytes lat = lac_log.to_bytes()
+    return to_bytes(self.publisher.controlsState(valid, self.data, lat, len(lat)))
+
+  def car_state(self, bool valid, CS, event_names):
+    self.events.clear()
+    for name in event_names:
+      self.events.push_back(car_event(name))
+
+    cdef bytes cs = CS.to_bytes()
+    return to_bytes(self.publisher.carState(valid, cs, len(cs), self.events))
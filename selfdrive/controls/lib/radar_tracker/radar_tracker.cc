@@ -0,0 +1,299 @@
+#include "selfdrive/controls/lib/radar_tracker/radar_tracker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+extern "C" {
+#include "selfdrive/controls/lib/cluster/fastcluster.h"
+}
+
+// same as common/numpy_fast.py interp
+static double interp(double x, const double *xp, const double *fp, int n) {
+  int hi = 0;
+  while (hi < n && x > xp[hi]) {
+    hi++;
+  }
+  int low = hi - 1;
+  if (hi == n && x > xp[low]) {
+    return fp[n - 1];
+  } else if (hi == 0) {
+    return fp[0];
+  }
+  return (x - xp[low]) * (fp[hi] - fp[low]) / (xp[hi] - xp[low]) + fp[low];
+}
+
+static double laplacian_cdf(double x, double mu, double b) {
+  b = std::max(b, 1e-4);
+  return std::exp(-std::abs(x - mu) / b);
+}
+
+KalmanParams::KalmanParams(double dt) {
+  // Lead Kalman Filter params, calculating K from A, C, Q, R requires the control library.
+  // hardcoding a lookup table to compute K for values of radar_ts between 0.1s and 1.0s
+  assert(dt > .01 && dt < .1);
+  A[0][0] = 1.0; A[0][1] = dt;
+  A[1][0] = 0.0; A[1][1] = 1.0;
+  C[0] = 1.0; C[1] = 0.0;
+
+  double dts[10];
+  for (int i = 0; i < 10; i++) {
+    dts[i] = (i + 1) * 0.01;
+  }
+  const double K0[] = {0.12288, 0.14557, 0.16523, 0.18282, 0.19887, 0.21372, 0.22761, 0.24069, 0.2531, 0.26491};
+  const double K1[] = {0.29666, 0.29331, 0.29043, 0.28787, 0.28555, 0.28342, 0.28144, 0.27958, 0.27783, 0.27617};
+  K[0] = interp(dt, dts, K0, 10);
+  K[1] = interp(dt, dts, K1, 10);
+}
+
+KF1D::KF1D(double x0_0, double x1_0, const KalmanParams &p) : x0_0(x0_0), x1_0(x1_0) {
+  K0_0 = p.K[0];
+  K1_0 = p.K[1];
+  A_K_0 = p.A[0][0] - K0_0 * p.C[0];
+  A_K_1 = p.A[0][1] - K0_0 * p.C[1];
+  A_K_2 = p.A[1][0] - K1_0 * p.C[0];
+  A_K_3 = p.A[1][1] - K1_0 * p.C[1];
+}
+
+void KF1D::update(double meas) {
+  double x0 = A_K_0 * x0_0 + A_K_1 * x1_0 + K0_0 * meas;
+  double x1 = A_K_2 * x0_0 + A_K_3 * x1_0 + K1_0 * meas;
+  x0_0 = x0;
+  x1_0 = x1;
+}
+
+Track::Track(double v_lead, const KalmanParams &kalman_params)
+  : kalman_params(&kalman_params), kf(v_lead, 0.0, kalman_params) {}
+
+void Track::update(double d_rel, double y_rel, double v_rel, double v_lead, bool measured) {
+  // relative values, copy
+  this->d_rel = d_rel;  // LONG_DIST
+  this->y_rel = y_rel;  // -LAT_DIST
+  this->v_rel = v_rel;  // REL_SPEED
+  this->v_lead = v_lead;
+  this->measured = measured;  // measured or estimate
+
+  // computed velocity and accelerations
+  if (cnt > 0) {
+    kf.update(v_lead);
+  }
+
+  v_lead_k = kf.x0_0;
+  a_lead_k = kf.x1_0;
+
+  // Learn if constant acceleration
+  if (std::abs(a_lead_k) < 0.5) {
+    a_lead_tau = LEAD_ACCEL_TAU;
+  } else {
+    a_lead_tau *= 0.9;
+  }
+
+  cnt++;
+}
+
+void Track::reset_a_lead(double a_lead_k, double a_lead_tau) {
+  kf = KF1D(v_lead, a_lead_k, *kalman_params);
+  this->a_lead_k = a_lead_k;
+  this->a_lead_tau = a_lead_tau;
+}
+
+RadarLead Cluster::get_radar_state(double model_prob) const {
+  return {
+    .status = true,
+    .d_rel = d_rel,
+    .y_rel = y_rel,
+    .v_rel = v_rel,
+    .v_lead = v_lead,
+    .v_lead_k = v_lead_k,
+    .a_lead_k = a_lead_k,
+    .a_lead_tau = a_lead_tau,
+    .fcw = model_prob > .9,
+    .model_prob = model_prob,
+    .radar = true,
+  };
+}
+
+bool Cluster::potential_low_speed_lead(double v_ego) const {
+  // stop for stuff in front of you and low speed, even without model confirmation
+  return std::abs(y_rel) < 1.5 && (v_ego < V_EGO_STATIONARY) && d_rel < 25;
+}
+
+RadarTracker::RadarTracker(double radar_ts, int delay) : kalman_params(radar_ts), delay(delay) {
+  v_ego_hist.push_back(0.0);
+}
+
+void RadarTracker::update_v_ego(double v_ego) {
+  this->v_ego = v_ego;
+  v_ego_hist.push_back(v_ego);
+  if (v_ego_hist.size() > (size_t)delay + 1) {
+    v_ego_hist.pop_front();
+  }
+}
+
+void RadarTracker::update(const std::vector<RadarPoint> &points) {
+  // sorted by track id, a later point with the same id replaces an earlier one
+  sorted_points.clear();
+  for (const RadarPoint &pt : points) {
+    sorted_points.push_back(&pt);
+  }
+  std::stable_sort(sorted_points.begin(), sorted_points.end(),
+                   [](const RadarPoint *a, const RadarPoint *b) { return a->track_id < b->track_id; });
+  auto last = std::unique(sorted_points.rbegin(), sorted_points.rend(),
+                          [](const RadarPoint *a, const RadarPoint *b) { return a->track_id == b->track_id; });
+  sorted_points.erase(sorted_points.begin(), last.base());
+
+  // *** remove missing points from meta data ***
+  auto pt = sorted_points.begin();
+  for (auto it = tracks.begin(); it != tracks.end();) {
+    while (pt != sorted_points.end() && (*pt)->track_id < it->first) {
+      pt++;
+    }
+    if (pt == sorted_points.end() || (*pt)->track_id != it->first) {
+      it = tracks.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+  // *** compute the tracks ***
+  cluster_tracks.clear();
+  cluster_pts.clear();
+  for (const RadarPoint *rpt : sorted_points) {
+    // align v_ego by a fixed time to align it with the radar measurement
+    double v_lead = rpt->v_rel + v_ego_hist.front();
+
+    // create the track if it doesn't exist or it's a new track
+    auto it = tracks.try_emplace(rpt->track_id, v_lead, kalman_params).first;
+    Track &track = it->second;
+    track.update(rpt->d_rel, rpt->y_rel, rpt->v_rel, v_lead, rpt->measured);
+
+    // Weigh y higher since radar is inaccurate in this dimension
+    cluster_tracks.push_back(&track);
+    cluster_pts.insert(cluster_pts.end(), {track.d_rel, track.y_rel * 2, track.v_rel});
+  }
+
+  // If we have multiple points, cluster them
+  int n = cluster_tracks.size();
+  cluster_idxs.resize(n);
+  if (n > 1) {
+    cluster_points_centroid(n, 3, cluster_pts.data(), CLUSTER_DIST * CLUSTER_DIST, cluster_idxs.data());
+  } else if (n == 1) {
+    // cluster_points_centroid hangs forever with a single point
+    cluster_idxs[0] = 0;
+  }
+  int n_clusters = n > 0 ? *std::max_element(cluster_idxs.begin(), cluster_idxs.end()) + 1 : 0;
+
+  // sums over all tracks and over the tracks with more than one update
+  struct ClusterSums {
+    int cnt = 0, cnt_k = 0;
+    double d_rel = 0, y_rel = 0, v_rel = 0, v_lead = 0, v_lead_k = 0, a_lead_k = 0, a_lead_tau = 0;
+  };
+  std::vector<ClusterSums> sums(n_clusters);
+  for (int i = 0; i < n; i++) {
+    const Track &t = *cluster_tracks[i];
+    ClusterSums &s = sums[cluster_idxs[i]];
+    s.cnt++;
+    s.d_rel += t.d_rel;
+    s.y_rel += t.y_rel;
+    s.v_rel += t.v_rel;
+    s.v_lead += t.v_lead;
+    s.v_lead_k += t.v_lead_k;
+    if (t.cnt > 1) {
+      s.cnt_k++;
+      s.a_lead_k += t.a_lead_k;
+      s.a_lead_tau += t.a_lead_tau;
+    }
+  }
+
+  clusters.resize(n_clusters);
+  for (int i = 0; i < n_clusters; i++) {
+    const ClusterSums &s = sums[i];
+    assert(s.cnt > 0);
+    Cluster &c = clusters[i];
+    c.d_rel = s.d_rel / s.cnt;
+    c.y_rel = s.y_rel / s.cnt;
+    c.v_rel = s.v_rel / s.cnt;
+    c.v_lead = s.v_lead / s.cnt;
+    c.v_lead_k = s.v_lead_k / s.cnt;
+    c.a_lead_k = s.cnt_k > 0 ? s.a_lead_k / s.cnt_k : 0.0;
+    c.a_lead_tau = s.cnt_k > 0 ? s.a_lead_tau / s.cnt_k : LEAD_ACCEL_TAU;
+  }
+
+  // if a new point, reset accel to the rest of the cluster
+  // the cluster accel only depends on tracks with more than one update, so it isn't changed by the resets
+  for (int i = 0; i < n; i++) {
+    if (cluster_tracks[i]->cnt <= 1) {
+      const Cluster &c = clusters[cluster_idxs[i]];
+      cluster_tracks[i]->reset_a_lead(c.a_lead_k, c.a_lead_tau);
+    }
+  }
+}
+
+const Cluster *RadarTracker::match_vision_to_cluster(const VisionLead &lead) const {
+  // match vision point to best statistical cluster match
+  double offset_vision_dist = lead.x - RADAR_TO_CAMERA;
+
+  const Cluster *cluster = nullptr;
+  double max_prob = 0;
+  for (const Cluster &c : clusters) {
+    double prob_d = laplacian_cdf(c.d_rel, offset_vision_dist, lead.x_std);
+    double prob_y = laplacian_cdf(c.y_rel, -lead.y, lead.y_std);
+    double prob_v = laplacian_cdf(c.v_rel + v_ego, lead.v, lead.v_std);
+
+    // This is isn't exactly right, but good heuristic
+    double prob = prob_d * prob_y * prob_v;
+    if (cluster == nullptr || prob > max_prob) {
+      cluster = &c;
+      max_prob = prob;
+    }
+  }
+
+  // if no 'sane' match is found return -1
+  // stationary radar points can be false positives
+  bool dist_sane = std::abs(cluster->d_rel - offset_vision_dist) < std::max(offset_vision_dist * .25, 5.0);
+  bool vel_sane = (std::abs(cluster->v_rel + v_ego - lead.v) < 10) || (v_ego + cluster->v_rel > 3);
+  return (dist_sane && vel_sane) ? cluster : nullptr;
+}
+
+RadarLead RadarTracker::get_lead(const VisionLead &lead, bool low_speed_override) const {
+  // Determine leads, this is where the essential logic happens
+  const Cluster *cluster = nullptr;
+  if (clusters.size() > 0 && ready && lead.prob > .5) {
+    cluster = match_vision_to_cluster(lead);
+  }
+
+  RadarLead ret = {.status = false};
+  if (cluster != nullptr) {
+    ret = cluster->get_radar_state(lead.prob);
+  } else if (ready && lead.prob > .5) {
+    ret = {
+      .status = true,
+      .d_rel = lead.x - RADAR_TO_CAMERA,
+      .y_rel = -lead.y,
+      .v_rel = lead.v - v_ego,
+      .v_lead = lead.v,
+      .v_lead_k = lead.v,
+      .a_lead_k = 0.0,
+      .a_lead_tau = LEAD_ACCEL_TAU,
+      .fcw = false,
+      .model_prob = lead.prob,
+      .radar = false,
+    };
+  }
+
+  if (low_speed_override) {
+    const Cluster *closest_cluster = nullptr;
+    for (const Cluster &c : clusters) {
+      if (c.potential_low_speed_lead(v_ego) && (closest_cluster == nullptr || c.d_rel < closest_cluster->d_rel)) {
+        closest_cluster = &c;
+      }
+    }
+
+    // Only choose new cluster if it is actually closer than the previous one
+    if (closest_cluster != nullptr && (!ret.status || closest_cluster->d_rel < ret.d_rel)) {
+      ret = closest_cluster->get_radar_state();
+    }
+  }
+
+  return ret;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+// Native radard core: the track table, the per track lead filters, clustering and lead selection.
+// It follows the python RadarD in selfdrive/controls/radard.py, which is kept as the reference.
+
+const double LEAD_ACCEL_TAU = 1.5;  // the longer lead decels, the more likely it will keep decelerating
+const double V_EGO_STATIONARY = 4.0;  // no stationary object flag below this speed
+const double RADAR_TO_CAMERA = 1.52;  // RADAR is ~ 1.5m ahead from center of mesh frame
+const double CLUSTER_DIST = 2.5;
+
+struct RadarPoint {
+  uint64_t track_id;
+  double d_rel, y_rel, v_rel;
+  bool measured;
+};
+
+// first entries of a modelV2 lead
+struct VisionLead {
+  double x, y, v;
+  double x_std, y_std, v_std;
+  double prob;
+};
+
+// radarState.leadOne/leadTwo, only status is set when there is no lead
+struct RadarLead {
+  bool status;
+  double d_rel, y_rel, v_rel;
+  double v_lead, v_lead_k, a_lead_k, a_lead_tau;
+  bool fcw;
+  double model_prob;
+  bool radar;
+};
+
+struct KalmanParams {
+  KalmanParams(double dt);
+  double A[2][2];
+  double C[2];
+  double K[2];
+};
+
+// constant gain filter, same as common/kalman/simple_kalman_impl.pyx
+class KF1D {
+public:
+  KF1D(double x0_0, double x1_0, const KalmanParams &p);
+  void update(double meas);
+
+  double x0_0, x1_0;
+
+private:
+  double K0_0, K1_0;
+  double A_K_0, A_K_1, A_K_2, A_K_3;
+};
+
+struct Track {
+  Track(double v_lead, const KalmanParams &kalman_params);
+  void update(double d_rel, double y_rel, double v_rel, double v_lead, bool measured);
+  void reset_a_lead(double a_lead_k, double a_lead_tau);
+
+  int cnt = 0;
+  double a_lead_tau = LEAD_ACCEL_TAU;
+  double d_rel, y_rel, v_rel, v_lead;
+  double v_lead_k, a_lead_k;
+  bool measured;
+
+  const KalmanParams *kalman_params;
+  KF1D kf;
+};
+
+// the means over the tracks of a cluster
+struct Cluster {
+  RadarLead get_radar_state(double model_prob = 0.0) const;
+  bool potential_low_speed_lead(double v_ego) const;
+
+  double d_rel, y_rel, v_rel;
+  double v_lead, v_lead_k, a_lead_k, a_lead_tau;
+};
+
+class RadarTracker {
+public:
+  RadarTracker(double radar_ts, int delay = 0);
+
+  void update_v_ego(double v_ego);
+  // updates the tracks with the points of one radar message and clusters them
+  void update(const std::vector<RadarPoint> &points);
+  RadarLead get_lead(const VisionLead &lead, bool low_speed_override) const;
+
+  const std::map<uint64_t, Track> &get_tracks() const { return tracks; }
+
+  bool ready = false;
+  double v_ego = 0.0;
+
+private:
+  const Cluster *match_vision_to_cluster(const VisionLead &lead) const;
+
+  KalmanParams kalman_params;
+  std::map<uint64_t, Track> tracks;
+  std::vector<Cluster> clusters;
+
+  // v_ego delayed to align it with the radar measurement
+  int delay;
+  std::deque<double> v_ego_hist;
+
+  // reused between updates
+  std::vector<const RadarPoint *> sorted_points;
+  std::vector<Track *> cluster_tracks;
+  std::vector<double> cluster_pts;
+  std::vector<int> cluster_idxs;
+};
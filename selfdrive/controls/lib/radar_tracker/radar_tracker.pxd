@@ -0,0 +1,40 @@
+# cython: language_level = 3
+from libc.stdint cimport uint64_t
+from libcpp cimport bool
+from libcpp.map cimport map
+from libcpp.vector cimport vector
+
+cdef extern from "selfdrive/controls/lib/radar_tracker/radar_tracker.h":
+  cdef struct RadarPoint:
+    uint64_t track_id
+    double d_rel, y_rel, v_rel
+    bool measured
+
+  cdef struct VisionLead:
+    double x, y, v
+    double x_std, y_std, v_std
+    double prob
+
+  cdef struct RadarLead:
+    bool status
+    double d_rel, y_rel, v_rel
+    double v_lead, v_lead_k, a_lead_k, a_lead_tau
+    bool fcw
+    double model_prob
+    bool radar
+
+  cdef cppclass Track:
+    int cnt
+    double a_lead_tau
+    double d_rel, y_rel, v_rel, v_lead
+    double v_lead_k, a_lead_k
+    bool measured
+
+  cdef cppclass RadarTracker:
+    RadarTracker(double, int)
+    void update_v_ego(double)
+    void update(const vector[RadarPoint] &)
+    RadarLead get_lead(const VisionLead &, bool)
+    const map[uint64_t, Track] &get_tracks()
+    bool ready
+    double v_ego
@@ -0,0 +1,127 @@
+# distutils: language = c++
+# cython: language_level = 3
+from cython.operator cimport dereference as deref, preincrement as preinc
+from libc.stdint cimport uint64_t
+from libcpp cimport bool
+from libcpp.map cimport map
+from libcpp.vector cimport vector
+from selfdrive.controls.lib.radar_tracker.radar_tracker cimport RadarPoint, VisionLead, RadarLead, Track
+from selfdrive.controls.lib.radar_tracker.radar_tracker cimport RadarTracker as c_RadarTracker
+
+import cereal.messaging as messaging
+
+
+cdef dict lead_to_dict(RadarLead lead):
+  if not lead.status:
+    return {'status': False}
+  return {
+    "dRel": lead.d_rel,
+    "yRel": lead.y_rel,
+    "vRel": lead.v_rel,
+    "vLead": lead.v_lead,
+    "vLeadK": lead.v_lead_k,
+    "aLeadK": lead.a_lead_k,
+    "status": True,
+    "fcw": lead.fcw,
+    "modelProb": lead.model_prob,
+    "radar": lead.radar,
+    "aLeadTau": lead.a_lead_tau,
+  }
+
+
+cdef class RadarD:
+  """Same interface as selfdrive.controls.radard.RadarD, the tracking, clustering and lead selection run in C++"""
+  cdef c_RadarTracker *tracker
+  cdef vector[RadarPoint] points
+
+  def __cinit__(self, double radar_ts, int delay=0):
+    self.tracker = new c_RadarTracker(radar_ts, delay)
+
+  def __dealloc__(self):
+    del self.tracker
+
+  cdef dict get_lead(self, lead_msg, bool low_speed_override):
+    cdef VisionLead lead
+    lead.x = lead_msg.x[0]
+    lead.y = lead_msg.y[0]
+    lead.v = lead_msg.v[0]
+    lead.x_std = lead_msg.xStd[0]
+    lead.y_std = lead_msg.yStd[0]
+    lead.v_std = lead_msg.vStd[0]
+    lead.prob = lead_msg.prob
+    return lead_to_dict(self.tracker.get_lead(lead, low_speed_override))
+
+  def update(self, sm, rr, enable_lead):
+    if sm.updated['carState']:
+      self.tracker.update_v_ego(sm['carState'].vEgo)
+    if sm.updated['modelV2']:
+      self.tracker.ready = True
+
+    cdef RadarPoint point
+    self.points.clear()
+    for pt in rr.points:
+      point.track_id = pt.trackId
+      point.d_rel = pt.dRel
+      point.y_rel = pt.yRel
+      point.v_rel = pt.vRel
+      point.measured = pt.measured
+      self.points.push_back(point)
+    self.tracker.update(self.points)
+
+    # *** publish radarState ***
+    dat = messaging.new_message('radarState')
+    dat.valid = sm.all_alive_and_valid() and len(rr.errors) == 0
+    radarState = dat.radarState
+    radarState.mdMonoTime = sm.logMonoTime['modelV2']
+    radarState.canMonoTimes = list(rr.canMonoTimes)
+    radarState.radarErrors = list(rr.errors)
+    radarState.carStateMonoTime = sm.logMonoTime['carState']
+
+    if enable_lead:
+      leads = sm['modelV2'].leadsV3
+      if len(leads) > 1:
+        radarState.leadOne = self.get_lead(leads[0], True)
+        radarState.leadTwo = self.get_lead(leads[1], False)
+    return dat
+
+  def live_tracks(self):
+    """liveTracks for UI debugging, sorted by track id"""
+    cdef const map[uint64_t, Track] *tracks = &self.tracker.get_tracks()
+    cdef map[uint64_t, Track].const_iterator it = tracks.const_begin()
+    dat = messaging.new_message('liveTracks', tracks.size())
+
+    cnt = 0
+    while it != tracks.const_end():
+      dat.liveTracks[cnt] = {
+        "trackId": deref(it).first,
+        "dRel": deref(it).second.d_rel,
+        "yRel": deref(it).second.y_rel,
+        "vRel": deref(it).second.v_rel,
+      }
+      cnt += 1
+      preinc(it)
+    return dat
+
+  @property
+  def v_ego(self):
+    return self.tracker.v_ego
+
+  @property
+  def ready(self):
+    return self.tracker.ready
+
+  def get_tracks(self):
+    """track id to the filter state of each track, for tests"""
+    cdef const map[uint64_t, Track] *tracks = &self.tracker.get_tracks()
+    cdef map[uint64_t, Track].const_iterator it = tracks.const_begin()
+    cdef const Track *t
+
+    ret = {}
+    while it != tracks.const_end():
+      t = &deref(it).second
+      ret[deref(it).first] = {
+        'cnt': t.cnt, 'dRel': t.d_rel, 'yRel': t.y_rel, 'vRel': t.v_rel, 'vLead': t.v_lead,
+        'vLeadK': t.v_lead_k, 'aLeadK': t.a_lead_k, 'aLeadTau': t.a_lead_tau, 'measured': t.measured,
+      }
+      preinc(it)
+    return ret
@@ -11,6 +11,7 @@ from common.realtime import Ratekeeper, Priority, config_realtime_process
 from selfdrive.config import RADAR_TO_CAMERA
 from selfdrive.controls.lib.cluster.fastcluster_py import cluster_points_centroid
 from selfdrive.controls.lib.radar_helpers import Cluster, Track
+from selfdrive.controls.lib.radar_tracker.radar_tracker_pyx import RadarD as RadarDNative  # pylint: disable=no-name-in-module, import-error
 from selfdrive.swaglog import cloudlog
 from selfdrive.hardware import TICI
 
@@ -85,6 +86,7 @@ def get_lead(v_ego, ready, clusters, lead_msg, low_speed_override=True):
   return lead_dict
 
 
+# reference implementation of selfdrive/controls/lib/radar_tracker, which radard runs
 class RadarD():
   def __init__(self, radar_ts, delay=0):
     self.current_time = 0
@@ -196,7 +198,7 @@ def radard_thread(sm=None, pm=None, can_sock=None):
   RI = RadarInterface(CP)
 
   rk = Ratekeeper(1.0 / CP.radarTimeStep, print_delay_threshold=None)
-  RD = RadarD(CP.radarTimeStep, RI.delay)
+  RD = RadarDNative(CP.radarTimeStep, RI.delay)
 
   # TODO: always log leads once we can hide them conditionally
   enable_lead = CP.openpilotLongitudinalControl or not CP.radarOffCan
@@ -216,17 +218,7 @@ def radard_thread(sm=None, pm=None, can_sock=None):
     pm.send('radarState', dat)
 
     # *** publish tracks for UI debugging (keep last) ***
-    tracks = RD.tracks
-    dat = messaging.new_message('liveTracks', len(tracks))
-
-    for cnt, ids in enumerate(sorted(tracks.keys())):
-      dat.liveTracks[cnt] = {
-        "trackId": ids,
-        "dRel": float(tracks[ids].dRel),
-        "yRel": float(tracks[ids].yRel),
-        "vRel": float(tracks[ids].vRel),
-      }
-    pm.send('liveTracks', dat)
+    pm.send('liveTracks', RD.live_tracks())
 
     rk.monitor_time()
 
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Times building and serializing the messages controlsd publishes every cycle, with
+carControl built on its own and copied into the message that's sent, built in that message,
+and with controlsState and carState built by the native ControlsPublisher in reused segments
+like controlsd does. Reports the time, the new message builders and the bytes sent per cycle."""
+import argparse
+import time
+from types import SimpleNamespace
+
+import numpy as np
+
+import cereal.messaging as messaging
+from cereal import car, log
+from selfdrive.controls.lib.controls_publisher.controls_publisher_pyx import ControlsPublisher  # pylint: disable=no-name-in-module, import-error
+
+
+class SerializingPubMaster:
+  """serializes like PubMaster without the sockets"""
+  def __init__(self):
+    self.bytes_sent = 0
+
+  def send(self, s, dat):
+    if not isinstance(dat, bytes):
+      dat = dat.to_bytes()
+    self.bytes_sent += len(dat)
+
+
+def inputs(i):
+  CS = car.CarState.new_message()
+  CS.vEgo = 20. + (i % 100) * 0.1
+  CS.steeringAngleDeg = (i % 50) * 0.2
+  CS.canMonoTimes = [i * 10000000 + j for j in range(3)]
+  CS.cruiseState.enabled = True
+  CS.canValid = True
+
+  actuators = car.CarControl.Actuators.new_message()
+  actuators.steer = (i % 20) * 0.05
+  actuators.accel = 0.5
+
+  lac_log = log.ControlsState.LateralPIDState.new_message()
+  lac_log.active = True
+  lac_log.output = actuators.steer
+
+  event_names = [car.CarEvent.EventName.pcmEnable] if i % 200 == 0 else []
+  return CS, actuators, lac_log, event_names
+
+
+class Publisher:
+  """the carControl, controlsState and carState part of controlsd's publish_logs"""
+  def __init__(self, mode):
+    self.in_place = mode != "copied"
+    self.native = ControlsPublisher('pidState') if mode == "native" else None
+    self.pm = SerializingPubMaster()
+    self.messages_built = 0
+
+  def message(self, service, valid):
+    self.messages_built += 1
+    dat = messaging.new_message(service)
+    dat.valid = valid
+    return dat
+
+  def send(self, service, dat):
+    self.pm.send(service, dat)
+
+  def publish(self, i, CS, actuators, lac_log, event_names):
+    if self.in_place:
+      cc_send = self.message('carControl', CS.canValid)
+      CC = cc_send.carControl
+    else:
+      self.messages_built += 1
+      CC = car.CarControl.new_message()
+    CC.enabled = True
+    CC.active = True
+    CC.actuators = actuators
+    CC.cruiseControl.cancel = False
+    CC.hudControl.setSpeed = 25.
+    CC.hudControl.speedVisible = True
+    CC.hudControl.lanesVisible = True
+    CC.hudControl.leadVisible = i % 3 == 0
+    CC.hudControl.rightLaneVisible = True
+    CC.hudControl.leftLaneVisible = True
+    CC.hudControl.leftLaneDepart = False
+    CC.hudControl.rightLaneDepart = False
+    CC.hudControl.visualAlert = car.CarControl.HUDControl.VisualAlert.none
+
+    if self.native is not None:
+      self.publish_native(i, CS, lac_log, event_names)
+    else:
+      self.publish_new_messages(i, CS, lac_log, event_names)
+
+    if not self.in_place:
+      cc_send = self.message('carControl', CS.canValid)
+      cc_send.carControl = CC
+    self.send('carControl', cc_send)
+
+  def publish_native(self, i, CS, lac_log, event_names):
+    AM = SimpleNamespace(alert_text_1="TAKE CONTROL" if (i // 300) % 2 else "", alert_text_2="",
+                         alert_size=log.ControlsState.AlertSize.none, alert_status=log.ControlsState.AlertStatus.normal,
+                         alert_rate=0., alert_type="", audible_alert=car.CarControl.HUDControl.AudibleAlert.none)
+    LoC = SimpleNamespace(long_control_state=car.CarControl.Actuators.LongControlState.pid, v_pid=float(CS.vEgo),
+                          pid=SimpleNamespace(p=0.1, i=0.2, f=0.3))
+    self.send('controlsState', self.native.controls_state(
+      CS.canValid, AM, CS, i * 50000000, i * 50000000, True, True, 0.001, log.ControlsState.OpenpilotState.enabled,
+      True, LoC, 90., 1., i * 10000000, False, 0, lac_log))
+    self.send('carState', self.native.car_state(CS.canValid, CS, event_names))
+
+  def publish_new_messages(self, i, CS, lac_log, event_names):
+    dat = self.message('controlsState', CS.canValid)
+    controlsState = dat.controlsState
+    controlsState.alertText1 = "TAKE CONTROL" if (i // 300) % 2 else ""
+    controlsState.alertText2 = ""
+    controlsState.alertSize = log.ControlsState.AlertSize.none
+    controlsState.alertStatus = log.ControlsState.AlertStatus.normal
+    controlsState.alertBlinkingRate = 0.
+    controlsState.alertType = ""
+    controlsState.alertSound = car.CarControl.HUDControl.AudibleAlert.none
+    controlsState.canMonoTimes = list(CS.canMonoTimes)
+    controlsState.longitudinalPlanMonoTime = i * 50000000
+    controlsState.lateralPlanMonoTime = i * 50000000
+    controlsState.enabled = True
+    controlsState.active = True
+    controlsState.curvature = 0.001
+    controlsState.state = log.ControlsState.OpenpilotState.enabled
+    controlsState.engageable = True
+    controlsState.longControlState = car.CarControl.Actuators.LongControlState.pid
+    controlsState.vPid = float(CS.vEgo)
+    controlsState.vCruise = 90.
+    controlsState.upAccelCmd = 0.1
+    controlsState.uiAccelCmd = 0.2
+    controlsState.ufAccelCmd = 0.3
+    controlsState.cumLagMs = 1.
+    controlsState.startMonoTime = i * 10000000
+    controlsState.forceDecel = False
+    controlsState.canErrorCounter = 0
+    controlsState.lateralControlState.pidState = lac_log
+    self.send('controlsState', dat)
+
+    cs_send = self.message('carState', CS.canValid)
+    cs_send.carState = CS
+    cs_send.carState.events = [car.CarEvent.new_message(name=name, enable=True) for name in event_names]
+    self.send('carState', cs_send)
+
+
+def run(mode, cycles):
+  pub = Publisher(mode)
+  ins = [inputs(i) for i in range(cycles)]
+
+  times = np.empty(cycles)
+  for i in range(cycles):
+    t = time.perf_counter()
+    pub.publish(i, *ins[i])
+    times[i] = time.perf_counter() - t
+
+  print(f"{mode:>8}: {np.median(times) * 1e6:.0f} us median, {np.mean(times) * 1e6:.0f} us mean per cycle, "
+        f"{pub.messages_built / cycles:.2f} new builders, {pub.pm.bytes_sent / cycles:.0f} bytes sent per cycle")
+
+
+if __name__ == "__main__":
+  parser = argparse.ArgumentParser(description=__doc__)
+  parser.add_argument("--cycles", type=int, default=6000)
+  args = parser.parse_args()
+
+  for mode in ("copied", "in place", "native"):
+    run(mode, args.cycles)
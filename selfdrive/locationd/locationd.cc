@@ -1,7 +1,9 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 
+#include <cassert>
 #include <cmath>
+#include <cstring>
 
 #include "locationd.h"
 
@@ -19,35 +21,36 @@ const double VALID_TIME_SINCE_RESET = 1.0; // s
 const double VALID_POS_STD = 50.0; // m
 const double MAX_RESET_TRACKER = 5.0;
 
-static VectorXd floatlist2vector(const capnp::List<float, capnp::Kind::PRIMITIVE>::Reader& floatlist) {
-  VectorXd res(floatlist.size());
-  for (int i = 0; i < floatlist.size(); i++) {
-    res[i] = floatlist[i];
-  }
-  return res;
+// row-major like the filter covariances, so they pass to LiveKalman without a copy
+typedef Matrix<double, 3, 3, RowMajor> Matrix3dr;
+
+// the callers check the size, a malformed message is rejected rather than aborting
+static Vector3d floatlist2vector(const capnp::List<float, capnp::Kind::PRIMITIVE>::Reader& floatlist) {
+  assert(floatlist.size() == 3);
+  return Vector3d(floatlist[0], floatlist[1], floatlist[2]);
 }
 
 static Vector4d quat2vector(const Quaterniond& quat) {
   return Vector4d(quat.w(), quat.x(), quat.y(), quat.z());
 }
 
-static Quaterniond vector2quat(const VectorXd& vec) {
+static Quaterniond vector2quat(const Vector4d& vec) {
   return Quaterniond(vec(0), vec(1), vec(2), vec(3));
 }
 
-static void init_measurement(cereal::LiveLocationKalman::Measurement::Builder meas, const VectorXd& val, const VectorXd& std, bool valid) {
+static void init_measurement(cereal::LiveLocationKalman::Measurement::Builder meas, const Vector3d& val, const Vector3d& std, bool valid) {
   meas.setValue(kj::arrayPtr(val.data(), val.size()));
   meas.setStd(kj::arrayPtr(std.data(), std.size()));
   meas.setValid(valid);
 }
 
 
-static MatrixXdr rotate_cov(const MatrixXdr& rot_matrix, const MatrixXdr& cov_in) {
+static Matrix3d rotate_cov(const Matrix3d& rot_matrix, const Matrix3d& cov_in) {
   // To rotate a covariance matrix, the cov matrix needs to multiplied left and right by the transform matrix
   return ((rot_matrix *  cov_in) * rot_matrix.transpose());
 }
 
-static VectorXd rotate_std(const MatrixXdr& rot_matrix, const VectorXd& std_in) {
+static Vector3d rotate_std(const Matrix3d& rot_matrix, const Vector3d& std_in) {
   // Stds cannot be rotated like values, only covariances can be rotated
   return rotate_cov(rot_matrix, std_in.array().square().matrix().asDiagonal()).diagonal().array().sqrt();
 }
@@ -57,46 +60,45 @@ Localizer::Localizer() {
   this->reset_kalman();
 
   this->calib = Vector3d(0.0, 0.0, 0.0);
-  this->device_from_calib = MatrixXdr::Identity(3, 3);
-  this->calib_from_device = MatrixXdr::Identity(3, 3);
+  this->device_from_calib = Matrix3d::Identity();
+  this->calib_from_device = Matrix3d::Identity();
 
-  for (int i = 0; i < POSENET_STD_HIST_HALF * 2; i++) {
-    this->posenet_stds.push_back(10.0);
-  }
+  this->posenet_stds.fill(10.0);
 
-  VectorXd ecef_pos = this->kf->get_x().segment<STATE_ECEF_POS_LEN>(STATE_ECEF_POS_START);
+  Vector3d ecef_pos = this->kf->get_x().segment<STATE_ECEF_POS_LEN>(STATE_ECEF_POS_START);
   this->converter = std::make_unique<LocalCoord>((ECEF) { .x = ecef_pos[0], .y = ecef_pos[1], .z = ecef_pos[2] });
 }
 
 void Localizer::build_live_location(cereal::LiveLocationKalman::Builder& fix) {
-  VectorXd predicted_state = this->kf->get_x();
-  MatrixXdr predicted_cov = this->kf->get_P();
-  VectorXd predicted_std = predicted_cov.diagonal().array().sqrt();
+  // fixed size temporaries and references into the filter, building the message doesn't allocate
+  const VectorXd& predicted_state = this->kf->get_x();
+  const MatrixXdr& predicted_cov = this->kf->get_P();
+  auto predicted_std = predicted_cov.diagonal().cwiseSqrt();
 
-  VectorXd fix_ecef = predicted_state.segment<STATE_ECEF_POS_LEN>(STATE_ECEF_POS_START);
+  Vector3d fix_ecef = predicted_state.segment<STATE_ECEF_POS_LEN>(STATE_ECEF_POS_START);
   ECEF fix_ecef_ecef = { .x = fix_ecef(0), .y = fix_ecef(1), .z = fix_ecef(2) };
-  VectorXd fix_ecef_std = predicted_std.segment<STATE_ECEF_POS_ERR_LEN>(STATE_ECEF_POS_ERR_START);
-  VectorXd vel_ecef = predicted_state.segment<STATE_ECEF_VELOCITY_LEN>(STATE_ECEF_VELOCITY_START);
-  VectorXd vel_ecef_std = predicted_std.segment<STATE_ECEF_VELOCITY_ERR_LEN>(STATE_ECEF_VELOCITY_ERR_START);
-  VectorXd fix_pos_geo_vec = this->get_position_geodetic();
+  Vector3d fix_ecef_std = predicted_std.segment<STATE_ECEF_POS_ERR_LEN>(STATE_ECEF_POS_ERR_START);
+  Vector3d vel_ecef = predicted_state.segment<STATE_ECEF_VELOCITY_LEN>(STATE_ECEF_VELOCITY_START);
+  Vector3d vel_ecef_std = predicted_std.segment<STATE_ECEF_VELOCITY_ERR_LEN>(STATE_ECEF_VELOCITY_ERR_START);
+  Vector3d fix_pos_geo_vec = this->get_position_geodetic();
   //fix_pos_geo_std = np.abs(coord.ecef2geodetic(fix_ecef + fix_ecef_std) - fix_pos_geo)
-  VectorXd orientation_ecef = quat2euler(vector2quat(predicted_state.segment<STATE_ECEF_ORIENTATION_LEN>(STATE_ECEF_ORIENTATION_START)));
-  VectorXd orientation_ecef_std = predicted_std.segment<STATE_ECEF_ORIENTATION_ERR_LEN>(STATE_ECEF_ORIENTATION_ERR_START);
-  MatrixXdr device_from_ecef = euler2rot(orientation_ecef).transpose();
+  Vector3d orientation_ecef = quat2euler(vector2quat(predicted_state.segment<STATE_ECEF_ORIENTATION_LEN>(STATE_ECEF_ORIENTATION_START)));
+  Vector3d orientation_ecef_std = predicted_std.segment<STATE_ECEF_ORIENTATION_ERR_LEN>(STATE_ECEF_ORIENTATION_ERR_START);
+  Matrix3d device_from_ecef = euler2rot(orientation_ecef).transpose();
   //VectorXd calibrated_orientation_ecef = rot2euler(device_from_ecef);
-  VectorXd calibrated_orientation_ecef = rot2euler((this->calib_from_device * device_from_ecef).transpose());
+  Vector3d calibrated_orientation_ecef = rot2euler((this->calib_from_device * device_from_ecef).transpose());
 
-  VectorXd acc_calib = this->calib_from_device * predicted_state.segment<STATE_ACCELERATION_LEN>(STATE_ACCELERATION_START);
-  MatrixXdr acc_calib_cov = predicted_cov.block<STATE_ACCELERATION_ERR_LEN, STATE_ACCELERATION_ERR_LEN>(STATE_ACCELERATION_ERR_START, STATE_ACCELERATION_ERR_START);
-  VectorXd acc_calib_std = rotate_cov(this->calib_from_device, acc_calib_cov).diagonal().array().sqrt();
-  VectorXd ang_vel_calib = this->calib_from_device * predicted_state.segment<STATE_ANGULAR_VELOCITY_LEN>(STATE_ANGULAR_VELOCITY_START);
+  Vector3d acc_calib = this->calib_from_device * predicted_state.segment<STATE_ACCELERATION_LEN>(STATE_ACCELERATION_START);
+  Matrix3d acc_calib_cov = predicted_cov.block<STATE_ACCELERATION_ERR_LEN, STATE_ACCELERATION_ERR_LEN>(STATE_ACCELERATION_ERR_START, STATE_ACCELERATION_ERR_START);
+  Vector3d acc_calib_std = rotate_cov(this->calib_from_device, acc_calib_cov).diagonal().array().sqrt();
+  Vector3d ang_vel_calib = this->calib_from_device * predicted_state.segment<STATE_ANGULAR_VELOCITY_LEN>(STATE_ANGULAR_VELOCITY_START);
 
-  MatrixXdr vel_angular_cov = predicted_cov.block<STATE_ANGULAR_VELOCITY_ERR_LEN, STATE_ANGULAR_VELOCITY_ERR_LEN>(STATE_ANGULAR_VELOCITY_ERR_START, STATE_ANGULAR_VELOCITY_ERR_START);
-  VectorXd ang_vel_calib_std = rotate_cov(this->calib_from_device, vel_angular_cov).diagonal().array().sqrt();
+  Matrix3d vel_angular_cov = predicted_cov.block<STATE_ANGULAR_VELOCITY_ERR_LEN, STATE_ANGULAR_VELOCITY_ERR_LEN>(STATE_ANGULAR_VELOCITY_ERR_START, STATE_ANGULAR_VELOCITY_ERR_START);
+  Vector3d ang_vel_calib_std = rotate_cov(this->calib_from_device, vel_angular_cov).diagonal().array().sqrt();
 
-  VectorXd vel_device = device_from_ecef * vel_ecef;
-  VectorXd device_from_ecef_eul = quat2euler(vector2quat(predicted_state.segment<STATE_ECEF_ORIENTATION_LEN>(STATE_ECEF_ORIENTATION_START))).transpose();
-  MatrixXdr condensed_cov(STATE_ECEF_ORIENTATION_ERR_LEN + STATE_ECEF_VELOCITY_ERR_LEN, STATE_ECEF_ORIENTATION_ERR_LEN + STATE_ECEF_VELOCITY_ERR_LEN);
+  Vector3d vel_device = device_from_ecef * vel_ecef;
+  Vector3d device_from_ecef_eul = quat2euler(vector2quat(predicted_state.segment<STATE_ECEF_ORIENTATION_LEN>(STATE_ECEF_ORIENTATION_START)));
+  Matrix<double, STATE_ECEF_ORIENTATION_ERR_LEN + STATE_ECEF_VELOCITY_ERR_LEN, STATE_ECEF_ORIENTATION_ERR_LEN + STATE_ECEF_VELOCITY_ERR_LEN, RowMajor> condensed_cov;
   condensed_cov.topLeftCorner<STATE_ECEF_ORIENTATION_ERR_LEN, STATE_ECEF_ORIENTATION_ERR_LEN>() =
     predicted_cov.block<STATE_ECEF_ORIENTATION_ERR_LEN, STATE_ECEF_ORIENTATION_ERR_LEN>(STATE_ECEF_ORIENTATION_ERR_START, STATE_ECEF_ORIENTATION_ERR_START);
   condensed_cov.topRightCorner<STATE_ECEF_ORIENTATION_ERR_LEN, STATE_ECEF_VELOCITY_ERR_LEN>() =
@@ -105,27 +107,27 @@ void Localizer::build_live_location(cereal::LiveLocationKalman::Builder& fix) {
     predicted_cov.block<STATE_ECEF_VELOCITY_ERR_LEN, STATE_ECEF_VELOCITY_ERR_LEN>(STATE_ECEF_VELOCITY_ERR_START, STATE_ECEF_VELOCITY_ERR_START);
   condensed_cov.bottomLeftCorner<STATE_ECEF_VELOCITY_ERR_LEN, STATE_ECEF_ORIENTATION_ERR_LEN>() =
     predicted_cov.block<STATE_ECEF_VELOCITY_ERR_LEN, STATE_ECEF_ORIENTATION_ERR_LEN>(STATE_ECEF_VELOCITY_ERR_START, STATE_ECEF_ORIENTATION_ERR_START);
-  VectorXd H_input(device_from_ecef_eul.size() + vel_ecef.size());
+  Matrix<double, 6, 1> H_input;
   H_input << device_from_ecef_eul, vel_ecef;
-  MatrixXdr HH = this->kf->H(H_input);
-  MatrixXdr vel_device_cov = (HH * condensed_cov) * HH.transpose();
-  VectorXd vel_device_std = vel_device_cov.diagonal().array().sqrt();
+  Matrix<double, 3, 6, RowMajor> HH = this->kf->H(H_input);
+  Matrix3d vel_device_cov = (HH * condensed_cov) * HH.transpose();
+  Vector3d vel_device_std = vel_device_cov.diagonal().array().sqrt();
 
-  VectorXd vel_calib = this->calib_from_device * vel_device;
-  VectorXd vel_calib_std = rotate_cov(this->calib_from_device, vel_device_cov).diagonal().array().sqrt();
+  Vector3d vel_calib = this->calib_from_device * vel_device;
+  Vector3d vel_calib_std = rotate_cov(this->calib_from_device, vel_device_cov).diagonal().array().sqrt();
 
-  VectorXd orientation_ned = ned_euler_from_ecef(fix_ecef_ecef, orientation_ecef);
+  Vector3d orientation_ned = ned_euler_from_ecef(fix_ecef_ecef, orientation_ecef);
   //orientation_ned_std = ned_euler_from_ecef(fix_ecef, orientation_ecef + orientation_ecef_std) - orientation_ned
-  VectorXd calibrated_orientation_ned = ned_euler_from_ecef(fix_ecef_ecef, calibrated_orientation_ecef);
-  VectorXd nextfix_ecef = fix_ecef + vel_ecef;
-  VectorXd ned_vel = this->converter->ecef2ned((ECEF) { .x = nextfix_ecef(0), .y = nextfix_ecef(1), .z = nextfix_ecef(2) }).to_vector() - converter->ecef2ned(fix_ecef_ecef).to_vector();
+  Vector3d calibrated_orientation_ned = ned_euler_from_ecef(fix_ecef_ecef, calibrated_orientation_ecef);
+  Vector3d nextfix_ecef = fix_ecef + vel_ecef;
+  Vector3d ned_vel = this->converter->ecef2ned((ECEF) { .x = nextfix_ecef(0), .y = nextfix_ecef(1), .z = nextfix_ecef(2) }).to_vector() - converter->ecef2ned(fix_ecef_ecef).to_vector();
   //ned_vel_std = self.converter->ecef2ned(fix_ecef + vel_ecef + vel_ecef_std) - self.converter->ecef2ned(fix_ecef + vel_ecef)
 
-  VectorXd accDevice = predicted_state.segment<STATE_ACCELERATION_LEN>(STATE_ACCELERATION_START);
-  VectorXd accDeviceErr = predicted_std.segment<STATE_ACCELERATION_ERR_LEN>(STATE_ACCELERATION_ERR_START);
+  Vector3d accDevice = predicted_state.segment<STATE_ACCELERATION_LEN>(STATE_ACCELERATION_START);
+  Vector3d accDeviceErr = predicted_std.segment<STATE_ACCELERATION_ERR_LEN>(STATE_ACCELERATION_ERR_START);
 
-  VectorXd angVelocityDevice = predicted_state.segment<STATE_ANGULAR_VELOCITY_LEN>(STATE_ANGULAR_VELOCITY_START);
-  VectorXd angVelocityDeviceErr = predicted_std.segment<STATE_ANGULAR_VELOCITY_ERR_LEN>(STATE_ANGULAR_VELOCITY_ERR_START);
+  Vector3d angVelocityDevice = predicted_state.segment<STATE_ANGULAR_VELOCITY_LEN>(STATE_ANGULAR_VELOCITY_START);
+  Vector3d angVelocityDeviceErr = predicted_std.segment<STATE_ANGULAR_VELOCITY_ERR_LEN>(STATE_ANGULAR_VELOCITY_ERR_START);
 
   Vector3d nans = Vector3d(NAN, NAN, NAN);
 
@@ -146,14 +148,13 @@ void Localizer::build_live_location(cereal::LiveLocationKalman::Builder& fix) {
   init_measurement(fix.initAccelerationCalibrated(), acc_calib, acc_calib_std, this->calibrated);
 
   double old_mean = 0.0, new_mean = 0.0;
-  int i = 0;
-  for (double x : this->posenet_stds) {
+  for (int i = 0; i < POSENET_STD_HIST_HALF * 2; i++) {
+    double x = this->posenet_stds[(this->posenet_stds_idx + i) % this->posenet_stds.size()];
     if (i < POSENET_STD_HIST_HALF) {
       old_mean += x;
     } else {
       new_mean += x;
     }
-    i++;
   }
   old_mean /= POSENET_STD_HIST_HALF;
   new_mean /= POSENET_STD_HIST_HALF;
@@ -180,8 +181,8 @@ void Localizer::build_live_location(cereal::LiveLocationKalman::Builder& fix) {
   }
 }
 
-VectorXd Localizer::get_position_geodetic() {
-  VectorXd fix_ecef = this->kf->get_x().segment<STATE_ECEF_POS_LEN>(STATE_ECEF_POS_START);
+Vector3d Localizer::get_position_geodetic() {
+  Vector3d fix_ecef = this->kf->get_x().segment<STATE_ECEF_POS_LEN>(STATE_ECEF_POS_START);
   ECEF fix_ecef_ecef = { .x = fix_ecef(0), .y = fix_ecef(1), .z = fix_ecef(2) };
   Geodetic fix_pos_geo = ecef2geodetic(fix_ecef_ecef);
   return Vector3d(fix_pos_geo.lat, fix_pos_geo.lon, fix_pos_geo.alt);
@@ -223,7 +224,7 @@ void Localizer::handle_sensors(double current_time, const capnp::List<cereal::Se
       auto v = sensor_reading.getGyroUncalibrated().getV();
       auto meas = Vector3d(-v[2], -v[1], -v[0]);
       if (meas.norm() < ROTATION_SANITY_CHECK) {
-        this->kf->predict_and_observe(sensor_time, OBSERVATION_PHONE_GYRO, { meas });
+        this->kf->predict_and_observe(sensor_time, OBSERVATION_PHONE_GYRO, meas);
       }
     }
 
@@ -233,11 +234,11 @@ void Localizer::handle_sensors(double current_time, const capnp::List<cereal::Se
 
       // check if device fell, estimate 10 for g
       // 40m/s**2 is a good filter for falling detection, no false positives in 20k minutes of driving
-      this->device_fell |= (floatlist2vector(v) - Vector3d(10.0, 0.0, 0.0)).norm() > 40.0;
+      this->device_fell |= (Vector3d(v[0], v[1], v[2]) - Vector3d(10.0, 0.0, 0.0)).norm() > 40.0;
 
       auto meas = Vector3d(-v[2], -v[1], -v[0]);
       if (meas.norm() < ACCEL_SANITY_CHECK) {
-        this->kf->predict_and_observe(sensor_time, OBSERVATION_PHONE_ACCEL, { meas });
+        this->kf->predict_and_observe(sensor_time, OBSERVATION_PHONE_ACCEL, meas);
       }
     }
   }
@@ -258,27 +259,27 @@ void Localizer::handle_gps(double current_time, const cereal::GpsLocationData::R
     return;
   }
 
-  if (floatlist2vector(log.getVNED()).norm() > TRANS_SANITY_CHECK) {
+  if (log.getVNED().size() != 3 || floatlist2vector(log.getVNED()).norm() > TRANS_SANITY_CHECK) {
     return;
   }
 
   // Process message
   this->last_gps_fix = current_time;
   Geodetic geodetic = { log.getLatitude(), log.getLongitude(), log.getAltitude() };
-  this->converter = std::make_unique<LocalCoord>(geodetic);
+  *this->converter = LocalCoord(geodetic);
 
-  VectorXd ecef_pos = this->converter->ned2ecef({ 0.0, 0.0, 0.0 }).to_vector();
-  VectorXd ecef_vel = this->converter->ned2ecef({ log.getVNED()[0], log.getVNED()[1], log.getVNED()[2] }).to_vector() - ecef_pos;
-  MatrixXdr ecef_pos_R = Vector3d::Constant(std::pow(10.0 * log.getAccuracy(),2) + std::pow(10.0 * log.getVerticalAccuracy(),2)).asDiagonal();
-  MatrixXdr ecef_vel_R = Vector3d::Constant(std::pow(log.getSpeedAccuracy() * 10.0, 2)).asDiagonal();
+  Vector3d ecef_pos = this->converter->ned2ecef({ 0.0, 0.0, 0.0 }).to_vector();
+  Vector3d ecef_vel = this->converter->ned2ecef({ log.getVNED()[0], log.getVNED()[1], log.getVNED()[2] }).to_vector() - ecef_pos;
+  Matrix3dr ecef_pos_R = Vector3d::Constant(std::pow(10.0 * log.getAccuracy(),2) + std::pow(10.0 * log.getVerticalAccuracy(),2)).asDiagonal();
+  Matrix3dr ecef_vel_R = Vector3d::Constant(std::pow(log.getSpeedAccuracy() * 10.0, 2)).asDiagonal();
   
   this->unix_timestamp_millis = log.getTimestamp();
   double gps_est_error = (this->kf->get_x().head(3) - ecef_pos).norm();
 
-  VectorXd orientation_ecef = quat2euler(vector2quat(this->kf->get_x().segment<STATE_ECEF_ORIENTATION_LEN>(STATE_ECEF_ORIENTATION_START)));
-  VectorXd orientation_ned = ned_euler_from_ecef({ ecef_pos(0), ecef_pos(1), ecef_pos(2) }, orientation_ecef);
-  VectorXd orientation_ned_gps = Vector3d(0.0, 0.0, DEG2RAD(log.getBearingDeg()));
-  VectorXd orientation_error = (orientation_ned - orientation_ned_gps).array() - M_PI;
+  Vector3d orientation_ecef = quat2euler(vector2quat(this->kf->get_x().segment<STATE_ECEF_ORIENTATION_LEN>(STATE_ECEF_ORIENTATION_START)));
+  Vector3d orientation_ned = ned_euler_from_ecef({ ecef_pos(0), ecef_pos(1), ecef_pos(2) }, orientation_ecef);
+  Vector3d orientation_ned_gps = Vector3d(0.0, 0.0, DEG2RAD(log.getBearingDeg()));
+  Vector3d orientation_error = (orientation_ned - orientation_ned_gps).array() - M_PI;
   for (int i = 0; i < orientation_error.size(); i++) {
     orientation_error(i) = std::fmod(orientation_error(i), 2.0 * M_PI);
     if (orientation_error(i) < 0.0) {
@@ -286,38 +287,42 @@ void Localizer::handle_gps(double current_time, const cereal::GpsLocationData::R
     }
     orientation_error(i) -= M_PI;
   }
-  VectorXd initial_pose_ecef_quat = quat2vector(euler2quat(ecef_euler_from_ned({ ecef_pos(0), ecef_pos(1), ecef_pos(2) }, orientation_ned_gps)));
+  Vector4d initial_pose_ecef_quat = quat2vector(euler2quat(ecef_euler_from_ned({ ecef_pos(0), ecef_pos(1), ecef_pos(2) }, orientation_ned_gps)));
 
   if (ecef_vel.norm() > 5.0 && orientation_error.norm() > 1.0) {
     LOGE("Locationd vs ubloxLocation orientation difference too large, kalman reset");
     this->reset_kalman(NAN, initial_pose_ecef_quat, ecef_pos);
-    this->kf->predict_and_observe(current_time, OBSERVATION_ECEF_ORIENTATION_FROM_GPS, { initial_pose_ecef_quat });
+    this->kf->predict_and_observe(current_time, OBSERVATION_ECEF_ORIENTATION_FROM_GPS, initial_pose_ecef_quat);
   } else if (gps_est_error > 100.0) {
     LOGE("Locationd vs ubloxLocation position difference too large, kalman reset");
     this->reset_kalman(NAN, initial_pose_ecef_quat, ecef_pos);
   }
 
-  this->kf->predict_and_observe(current_time, OBSERVATION_ECEF_POS, { ecef_pos }, { ecef_pos_R });
-  this->kf->predict_and_observe(current_time, OBSERVATION_ECEF_VEL, { ecef_vel }, { ecef_vel_R });
+  this->kf->predict_and_observe(current_time, OBSERVATION_ECEF_POS, ecef_pos, ecef_pos_R);
+  this->kf->predict_and_observe(current_time, OBSERVATION_ECEF_VEL, ecef_vel, ecef_vel_R);
 }
 
 void Localizer::handle_car_state(double current_time, const cereal::CarState::Reader& log) {
   this->car_speed = std::abs(log.getVEgo());
   if (log.getStandstill()) {
-    this->kf->predict_and_observe(current_time, OBSERVATION_NO_ROT, { Vector3d(0.0, 0.0, 0.0) });
+    this->kf->predict_and_observe(current_time, OBSERVATION_NO_ROT, Vector3d(0.0, 0.0, 0.0));
   }
 }
 
 void Localizer::handle_cam_odo(double current_time, const cereal::CameraOdometry::Reader& log) {
-  VectorXd rot_device = this->device_from_calib * floatlist2vector(log.getRot());
-  VectorXd trans_device = this->device_from_calib * floatlist2vector(log.getTrans());
+  if (log.getRot().size() != 3 || log.getTrans().size() != 3 || log.getRotStd().size() != 3 || log.getTransStd().size() != 3) {
+    return;
+  }
+
+  Vector3d rot_device = this->device_from_calib * floatlist2vector(log.getRot());
+  Vector3d trans_device = this->device_from_calib * floatlist2vector(log.getTrans());
 
   if ((rot_device.norm() > ROTATION_SANITY_CHECK) || (trans_device.norm() > TRANS_SANITY_CHECK)) {
     return;
   }
 
-  VectorXd rot_calib_std = floatlist2vector(log.getRotStd());
-  VectorXd trans_calib_std = floatlist2vector(log.getTransStd());
+  Vector3d rot_calib_std = floatlist2vector(log.getRotStd());
+  Vector3d trans_calib_std = floatlist2vector(log.getTransStd());
 
   if ((rot_calib_std.minCoeff() <= MIN_STD_SANITY_CHECK) || (trans_calib_std.minCoeff() <= MIN_STD_SANITY_CHECK)) {
     return;
@@ -327,24 +332,23 @@ void Localizer::handle_cam_odo(double current_time, const cereal::CameraOdometry
     return;
   }
 
-  this->posenet_stds.pop_front();
-  this->posenet_stds.push_back(trans_calib_std[0]);
+  // overwrite the oldest
+  this->posenet_stds[this->posenet_stds_idx] = trans_calib_std[0];
+  this->posenet_stds_idx = (this->posenet_stds_idx + 1) % this->posenet_stds.size();
 
   // Multiply by 10 to avoid to high certainty in kalman filter because of temporally correlated noise
   trans_calib_std *= 10.0;
   rot_calib_std *= 10.0;
-  MatrixXdr rot_device_cov = rotate_std(this->device_from_calib, rot_calib_std).array().square().matrix().asDiagonal();
-  MatrixXdr trans_device_cov = rotate_std(this->device_from_calib, trans_calib_std).array().square().matrix().asDiagonal();
+  Matrix3dr rot_device_cov = rotate_std(this->device_from_calib, rot_calib_std).array().square().matrix().asDiagonal();
+  Matrix3dr trans_device_cov = rotate_std(this->device_from_calib, trans_calib_std).array().square().matrix().asDiagonal();
   
-  this->kf->predict_and_observe(current_time, OBSERVATION_CAMERA_ODO_ROTATION,
-    { rot_device }, { rot_device_cov });
-  this->kf->predict_and_observe(current_time, OBSERVATION_CAMERA_ODO_TRANSLATION,
-    { trans_device }, { trans_device_cov });
+  this->kf->predict_and_observe(current_time, OBSERVATION_CAMERA_ODO_ROTATION, rot_device, rot_device_cov);
+  this->kf->predict_and_observe(current_time, OBSERVATION_CAMERA_ODO_TRANSLATION, trans_device, trans_device_cov);
 }
 
 void Localizer::handle_live_calib(double current_time, const cereal::LiveCalibrationData::Reader& log) {
-  if (log.getRpyCalib().size() > 0) {
-    auto calib = floatlist2vector(log.getRpyCalib());
+  if (log.getRpyCalib().size() == 3) {
+    Vector3d calib = floatlist2vector(log.getRpyCalib());
     if ((calib.minCoeff() < -CALIB_RPY_SANITY_CHECK) || (calib.maxCoeff() > CALIB_RPY_SANITY_CHECK)) {
       return;
     }
@@ -390,7 +394,7 @@ void Localizer::update_reset_tracker() {
   }
 }
 
-void Localizer::reset_kalman(double current_time, VectorXd init_orient, VectorXd init_pos) {
+void Localizer::reset_kalman(double current_time, const Vector4d& init_orient, const Vector3d& init_pos) {
   // too nonlinear to init on completely wrong
   VectorXd init_x = this->kf->get_initial_x();
   MatrixXdr init_P = this->kf->get_initial_P();
@@ -403,9 +407,7 @@ void Localizer::reset_kalman(double current_time, VectorXd init_orient, VectorXd
 }
 
 void Localizer::handle_msg_bytes(const char *data, const size_t size) {
-  AlignedBuffer aligned_buf;
-
-  capnp::FlatArrayMessageReader cmsg(aligned_buf.align(data, size));
+  capnp::FlatArrayMessageReader cmsg(this->aligned_buf.align(data, size));
   cereal::Event::Reader event = cmsg.getRoot<cereal::Event>();
 
   this->handle_msg(event);
@@ -429,17 +431,27 @@ void Localizer::handle_msg(const cereal::Event::Reader& log) {
   this->update_reset_tracker();
 }
 
-kj::ArrayPtr<capnp::byte> Localizer::get_message_bytes(MessageBuilder& msg_builder, uint64_t logMonoTime,
-  bool inputsOK, bool sensorsOK, bool gpsOK)
-{
-  cereal::Event::Builder evt = msg_builder.initEvent();
+kj::ArrayPtr<capnp::byte> Localizer::get_message_bytes(uint64_t logMonoTime, bool inputsOK, bool sensorsOK, bool gpsOK) {
+  // a first segment passed to the builder has to be zeroed
+  memset(this->msg_segment.begin(), 0, this->msg_segment.size() * sizeof(capnp::word));
+  capnp::MallocMessageBuilder msg_builder(this->msg_segment);
+
+  cereal::Event::Builder evt = msg_builder.initRoot<cereal::Event>();
   evt.setLogMonoTime(logMonoTime);
+  evt.setValid(true);
   cereal::LiveLocationKalman::Builder liveLoc = evt.initLiveLocationKalman();
   this->build_live_location(liveLoc);
   liveLoc.setInputsOK(inputsOK);
   liveLoc.setSensorsOK(sensorsOK);
   liveLoc.setGpsOK(gpsOK);
-  return msg_builder.toBytes();
+
+  size_t msg_words = capnp::computeSerializedSizeInWords(msg_builder);
+  if (msg_words > this->msg_bytes.size()) {
+    this->msg_bytes = kj::heapArray<capnp::word>(msg_words);
+  }
+  kj::ArrayOutputStream output_stream(this->msg_bytes.asBytes());
+  capnp::writeMessage(output_stream, msg_builder);
+  return output_stream.getArray();
 }
 
 
@@ -470,12 +482,11 @@ int Localizer::locationd_thread() {
       bool sensorsOK = sm.alive("sensorEvents") && sm.valid("sensorEvents");
       bool gpsOK = this->isGpsOK();
 
-      MessageBuilder msg_builder;
-      kj::ArrayPtr<capnp::byte> bytes = this->get_message_bytes(msg_builder, logMonoTime, inputsOK, sensorsOK, gpsOK);
+      kj::ArrayPtr<capnp::byte> bytes = this->get_message_bytes(logMonoTime, inputsOK, sensorsOK, gpsOK);
       pm.send("liveLocationKalman", bytes.begin(), bytes.size());
 
       if (sm.frame % 1200 == 0 && gpsOK) {  // once a minute
-        VectorXd posGeo = this->get_position_geodetic();
+        Vector3d posGeo = this->get_position_geodetic();
         std::string lastGPSPosJSON = util::string_format(
           "{\"latitude\": %.15f, \"longitude\": %.15f, \"altitude\": %.15f}", posGeo(0), posGeo(1), posGeo(2));
 
@@ -487,10 +498,3 @@ int Localizer::locationd_thread() {
   }
   return 0;
 }
-
-int main() {
-  set_realtime_priority(5);
-
-  Localizer localizer;
-  return localizer.locationd_thread();
-}
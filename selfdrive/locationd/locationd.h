@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <eigen3/Eigen/Dense>
 #include <fstream>
 #include <memory>
@@ -19,6 +20,7 @@
 #include "selfdrive/locationd/models/live_kf.h"
 
 #define POSENET_STD_HIST_HALF 20
+#define LIVE_LOCATION_MSG_WORDS 1024
 
 class Localizer {
 public:
@@ -27,17 +29,17 @@ public:
   int locationd_thread();
 
   void reset_kalman(double current_time = NAN);
-  void reset_kalman(double current_time, Eigen::VectorXd init_orient, Eigen::VectorXd init_pos);
+  void reset_kalman(double current_time, const Eigen::Vector4d& init_orient, const Eigen::Vector3d& init_pos);
   void finite_check(double current_time = NAN);
   void time_check(double current_time = NAN);
   void update_reset_tracker();
   bool isGpsOK();
 
-  kj::ArrayPtr<capnp::byte> get_message_bytes(MessageBuilder& msg_builder, uint64_t logMonoTime,
-    bool inputsOK, bool sensorsOK, bool gpsOK);
+  // the returned bytes are valid until the next call
+  kj::ArrayPtr<capnp::byte> get_message_bytes(uint64_t logMonoTime, bool inputsOK, bool sensorsOK, bool gpsOK);
   void build_live_location(cereal::LiveLocationKalman::Builder& fix);
 
-  Eigen::VectorXd get_position_geodetic();
+  Eigen::Vector3d get_position_geodetic();
   Eigen::VectorXd get_state();
   Eigen::VectorXd get_stdev();
 
@@ -52,14 +54,16 @@ public:
 private:
   std::unique_ptr<LiveKalman> kf;
 
-  Eigen::VectorXd calib;
-  MatrixXdr device_from_calib;
-  MatrixXdr calib_from_device;
+  Eigen::Vector3d calib;
+  Eigen::Matrix3d device_from_calib;
+  Eigen::Matrix3d calib_from_device;
   bool calibrated = false;
 
   double car_speed = 0.0;
   double last_reset_time = NAN;
-  std::deque<double> posenet_stds;
+  // ring of the last posenet translation stds, posenet_stds_idx is the oldest
+  std::array<double, POSENET_STD_HIST_HALF * 2> posenet_stds;
+  int posenet_stds_idx = 0;
 
   std::unique_ptr<LocalCoord> converter;
 
@@ -67,4 +71,10 @@ private:
   double last_gps_fix = 0;
   double reset_tracker = 0.0;
   bool device_fell = false;
+
+  AlignedBuffer aligned_buf;
+
+  // the published message is built in a reused first segment and serialized into a reused buffer
+  kj::Array<capnp::word> msg_segment = kj::heapArray<capnp::word>(LIVE_LOCATION_MSG_WORDS);
+  kj::Array<capnp::word> msg_bytes = kj::heapArray<capnp::word>(LIVE_LOCATION_MSG_WORDS);
 };
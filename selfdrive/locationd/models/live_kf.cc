@@ -58,11 +58,11 @@ void LiveKalman::init_state(VectorXd& state, double filter_time) {
   this->filter->init_state(get_mapvec(state), get_mapmat(covs), filter_time);
 }
 
-VectorXd LiveKalman::get_x() {
+const VectorXd& LiveKalman::get_x() {
   return this->filter->state();
 }
 
-MatrixXdr LiveKalman::get_P() {
+const MatrixXdr& LiveKalman::get_P() {
   return this->filter->covs();
 }
 
@@ -87,6 +87,14 @@ std::optional<Estimate> LiveKalman::predict_and_observe(double t, int kind, std:
   return r;
 }
 
+bool LiveKalman::predict_and_observe(double t, int kind, const Ref<const VectorXd>& meas) {
+  return this->filter->predict_and_update(t, kind, meas, this->obs_noise.at(kind));
+}
+
+bool LiveKalman::predict_and_observe(double t, int kind, const Ref<const VectorXd>& meas, const Ref<const MatrixXdr>& R) {
+  return this->filter->predict_and_update(t, kind, meas, R);
+}
+
 Eigen::VectorXd LiveKalman::get_initial_x() {
   return this->initial_x;
 }
@@ -95,9 +103,9 @@ MatrixXdr LiveKalman::get_initial_P() {
   return this->initial_P;
 }
 
-MatrixXdr LiveKalman::H(VectorXd in) {
-  assert(in.size() == 6);
+Matrix<double, 3, 6, Eigen::RowMajor> LiveKalman::H(const Matrix<double, 6, 1>& in) {
+  Matrix<double, 6, 1> in_copy = in;
   Matrix<double, 3, 6, Eigen::RowMajor> res;
-  this->filter->get_extra_routine("H")(in.data(), res.data());
+  this->filter->get_extra_routine("H")(in_copy.data(), res.data());
   return res;
 }
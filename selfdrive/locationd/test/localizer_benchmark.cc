@@ -0,0 +1,184 @@
+// replays a drive of sensor, camera odometry, gps, car state and calibration messages
+// through Localizer the way locationd_thread does, and publishes liveLocationKalman on
+// every camera odometry message. Prints the latency per message type and the heap
+// allocations per message once the filter is warm. Malformed messages at the end have
+// to be rejected without aborting.
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "selfdrive/locationd/locationd.h"
+
+// counts heap allocations, Eigen, kj and the std containers all go through malloc
+static size_t allocations = 0;
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *malloc(size_t size) {
+  allocations++;
+  return __libc_malloc(size);
+}
+
+struct Msg {
+  std::string service;
+  kj::Array<capnp::word> words;
+};
+
+// 100Hz sensors and car state, 20Hz camera odometry, 10Hz gps and 4Hz calibration for a
+// car driving north at 20 m/s
+static std::vector<Msg> drive(double duration) {
+  std::mt19937 gen(0);
+  std::normal_distribution<float> noise(0.0, 0.02);
+  const uint64_t t0 = 1000000000ULL;
+  const double speed = 20.0;
+
+  std::vector<Msg> msgs;
+  auto add = [&](const char *service, MessageBuilder &msg, uint64_t t) {
+    msg.getRoot<cereal::Event>().setLogMonoTime(t);
+    msgs.push_back({service, capnp::messageToFlatArray(msg)});
+  };
+
+  for (int i = 0; i < duration * 100; i++) {
+    uint64_t t = t0 + i * 10000000ULL;
+    {
+      MessageBuilder msg;
+      auto sensors = msg.initEvent().initSensorEvents(2);
+      sensors[0].setSource(cereal::SensorEventData::SensorSource::LSM6DS3);
+      sensors[0].setSensor(SENSOR_ACCELEROMETER);
+      sensors[0].setType(SENSOR_TYPE_ACCELEROMETER);
+      sensors[0].setTimestamp(t);
+      sensors[0].initAcceleration().setV({9.81f + noise(gen), noise(gen), noise(gen)});
+      sensors[1].setSource(cereal::SensorEventData::SensorSource::LSM6DS3);
+      sensors[1].setSensor(SENSOR_GYRO_UNCALIBRATED);
+      sensors[1].setType(SENSOR_TYPE_GYROSCOPE_UNCALIBRATED);
+      sensors[1].setTimestamp(t);
+      sensors[1].initGyroUncalibrated().setV({noise(gen), noise(gen), noise(gen)});
+      add("sensorEvents", msg, t);
+    }
+    {
+      MessageBuilder msg;
+      msg.initEvent().initCarState().setVEgo(speed + noise(gen));
+      add("carState", msg, t);
+    }
+    if (i % 5 == 0) {
+      MessageBuilder msg;
+      auto odo = msg.initEvent().initCameraOdometry();
+      odo.setTrans({(float)speed + noise(gen), noise(gen), noise(gen)});
+      odo.setRot({noise(gen), noise(gen), noise(gen)});
+      odo.setTransStd({0.5f, 0.5f, 0.5f});
+      odo.setRotStd({0.01f, 0.01f, 0.01f});
+      add("cameraOdometry", msg, t);
+    }
+    if (i % 10 == 0) {
+      MessageBuilder msg;
+      auto gps = msg.initEvent().initGpsLocationExternal();
+      double north = speed * i * 0.01;
+      gps.setFlags(1);
+      gps.setLatitude(32.7 + north / 111111.0 + noise(gen) * 1e-6);
+      gps.setLongitude(-117.1 + noise(gen) * 1e-6);
+      gps.setAltitude(100.0 + noise(gen));
+      gps.setSpeed(speed);
+      gps.setBearingDeg(0.0);
+      gps.setVNED({(float)speed + noise(gen), noise(gen), noise(gen)});
+      gps.setAccuracy(1.0);
+      gps.setVerticalAccuracy(2.0);
+      gps.setSpeedAccuracy(0.2);
+      gps.setBearingAccuracyDeg(1.0);
+      gps.setTimestamp(1600000000000LL + i * 10);
+      add("gpsLocationExternal", msg, t);
+    }
+    if (i % 25 == 0) {
+      MessageBuilder msg;
+      auto calib = msg.initEvent().initLiveCalibration();
+      calib.setCalStatus(1);
+      calib.setRpyCalib({0.0f, 0.01f, -0.01f});
+      add("liveCalibration", msg, t);
+    }
+  }
+  return msgs;
+}
+
+// gps without a velocity, camera odometry and calibration with vectors of the wrong size
+static std::vector<Msg> malformed(uint64_t t) {
+  std::vector<Msg> msgs;
+  {
+    MessageBuilder msg;
+    auto gps = msg.initEvent().initGpsLocationExternal();
+    gps.setFlags(1);
+    gps.setVerticalAccuracy(2.0);
+    gps.setSpeedAccuracy(0.2);
+    gps.setBearingAccuracyDeg(1.0);
+    msg.getRoot<cereal::Event>().setLogMonoTime(t);
+    msgs.push_back({"gpsLocationExternal", capnp::messageToFlatArray(msg)});
+  }
+  {
+    MessageBuilder msg;
+    auto odo = msg.initEvent().initCameraOdometry();
+    odo.setTrans({1.0f, 0.0f});
+    odo.setRot({0.0f, 0.0f, 0.0f});
+    msg.getRoot<cereal::Event>().setLogMonoTime(t);
+    msgs.push_back({"cameraOdometry", capnp::messageToFlatArray(msg)});
+  }
+  {
+    MessageBuilder msg;
+    msg.initEvent().initLiveCalibration().setRpyCalib({0.1f});
+    msg.getRoot<cereal::Event>().setLogMonoTime(t);
+    msgs.push_back({"liveCalibration", capnp::messageToFlatArray(msg)});
+  }
+  return msgs;
+}
+
+int main() {
+  std::vector<Msg> msgs = drive(120.0);
+  Localizer localizer;
+
+  std::map<std::string, std::vector<double>> latency;
+  std::map<std::string, size_t> steady_allocations, steady_count;
+  size_t warm = msgs.size() / 2, published = 0;
+  for (size_t i = 0; i < msgs.size(); i++) {
+    const Msg &m = msgs[i];
+    size_t start = allocations;
+    auto t = std::chrono::steady_clock::now();
+
+    capnp::FlatArrayMessageReader reader(m.words);
+    const cereal::Event::Reader event = reader.getRoot<cereal::Event>();
+    localizer.handle_msg(event);
+    if (m.service == "cameraOdometry") {
+      kj::ArrayPtr<capnp::byte> bytes = localizer.get_message_bytes(event.getLogMonoTime(), true, true, localizer.isGpsOK());
+      published += bytes.size() > 0;
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count();
+    size_t n = allocations - start;
+
+    latency[m.service].push_back(us);
+    if (i >= warm) {
+      steady_allocations[m.service] += n;
+      steady_count[m.service]++;
+    }
+  }
+
+  printf("%zu messages, %zu published\n", msgs.size(), published);
+  for (auto &[service, us] : latency) {
+    std::sort(us.begin(), us.end());
+    printf("%-20s median %6.1f us, p99 %6.1f us, max %7.1f us, %.2f allocations per message in steady state\n",
+           service.c_str(), us[us.size() / 2], us[us.size() * 99 / 100], us.back(),
+           (double)steady_allocations[service] / steady_count[service]);
+  }
+  assert(localizer.isGpsOK());
+  assert(localizer.get_state().array().isFinite().all());
+
+  Eigen::VectorXd before = localizer.get_state();
+  for (const Msg &m : malformed(1000000000ULL + 120 * 1000000000ULL)) {
+    localizer.handle_msg_bytes((const char *)m.words.begin(), m.words.size() * sizeof(capnp::word));
+  }
+  // rejected, the filter only predicted forward
+  assert(localizer.get_state().array().isFinite().all());
+  assert((localizer.get_state() - before).norm() < 100.0);
+  printf("malformed messages rejected\n");
+  return 0;
+}
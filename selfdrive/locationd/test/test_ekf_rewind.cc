@@ -0,0 +1,148 @@
+// feeds a sensor stream with late camera and gps observations through EKFSym with
+// different rewind checkpoint intervals, the outputs have to be identical. The
+// single observation path has to end in the same state without heap allocations.
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "rednose/helpers/ekf_sym.h"
+#include "selfdrive/locationd/models/generated/live_kf_constants.h"
+
+using namespace EKFS;
+using namespace Eigen;
+
+// counts heap allocations, Eigen and the std containers all go through malloc
+static size_t allocations = 0;
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *malloc(size_t size) {
+  allocations++;
+  return __libc_malloc(size);
+}
+
+struct Event {
+  double t;
+  int kind;
+  VectorXd z;
+};
+
+// gyro and accel at 100Hz in order, camera odometry at 20Hz arriving 50ms late,
+// gps at 10Hz arriving 120ms late
+static std::vector<Event> sensor_stream(double duration) {
+  std::mt19937 gen(0);
+  std::normal_distribution<double> noise(0.0, 0.05);
+  auto meas = [&](int n) {
+    VectorXd z(n);
+    for (int i = 0; i < n; i++) z[i] = noise(gen);
+    return z;
+  };
+
+  std::vector<std::pair<double, Event>> arrivals;
+  for (int i = 0; i < duration * 100; i++) {
+    double t = i * 0.01;
+    arrivals.push_back({t, {t, OBSERVATION_PHONE_GYRO, meas(3)}});
+    arrivals.push_back({t + 0.001, {t + 0.001, OBSERVATION_PHONE_ACCEL, meas(3) + Vector3d(0, 0, 9.81)}});
+    if (i % 5 == 0) {
+      arrivals.push_back({t + 0.05, {t, OBSERVATION_CAMERA_ODO_ROTATION, meas(3)}});
+    }
+    if (i % 10 == 0) {
+      VectorXd pos = Vector3d(-2.7e6, 4.2e6, 3.8e6) + meas(3);
+      arrivals.push_back({t + 0.12, {t, OBSERVATION_ECEF_POS, pos}});
+    }
+  }
+  std::stable_sort(arrivals.begin(), arrivals.end(), [](auto &a, auto &b) { return a.first < b.first; });
+
+  std::vector<Event> events;
+  for (auto &a : arrivals) events.push_back(a.second);
+  return events;
+}
+
+static std::unique_ptr<EKFSym> make_filter(int interval) {
+  VectorXd x = live_initial_x;
+  MatrixXdr P = live_initial_P_diag.asDiagonal();
+  MatrixXdr Q = live_Q_diag.asDiagonal();
+  return std::make_unique<EKFSym>("live", Map<MatrixXdr>(Q.data(), Q.rows(), Q.cols()), Map<VectorXd>(x.data(), x.rows()),
+                                  Map<MatrixXdr>(P.data(), P.rows(), P.cols()), 23, 22, 0, 0, 0, std::vector<int>(),
+                                  std::vector<int>{3}, std::vector<std::string>(), 0.2, interval);
+}
+
+static std::vector<std::optional<Estimate>> run(const std::vector<Event> &events, int interval, double *runtime,
+                                                VectorXd *x = nullptr, MatrixXdr *P = nullptr) {
+  std::unique_ptr<EKFSym> filter = make_filter(interval);
+
+  std::vector<std::optional<Estimate>> res;
+  auto t0 = std::chrono::steady_clock::now();
+  for (const Event &e : events) {
+    MatrixXdr R = MatrixXdr(VectorXd(live_obs_noise_diag.at(e.kind)).asDiagonal());
+    VectorXd z = e.z;
+    res.push_back(filter->predict_and_update_batch(e.t, e.kind, {Map<VectorXd>(z.data(), z.rows())},
+                                                  {Map<MatrixXdr>(R.data(), R.rows(), R.cols())}));
+  }
+  *runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  if (x) *x = filter->state();
+  if (P) *P = filter->covs();
+  return res;
+}
+
+static void run_single(const std::vector<Event> &events, int interval, VectorXd *x, MatrixXdr *P, size_t *steady_allocations) {
+  std::unique_ptr<EKFSym> filter = make_filter(interval);
+
+  std::map<int, MatrixXdr> R;
+  for (auto &[kind, noise] : live_obs_noise_diag) {
+    R[kind] = VectorXd(noise).asDiagonal();
+  }
+
+  // the rewind buffer slots get their storage during the first pass over them
+  size_t warm = events.size() / 2, start = 0;
+  for (int i = 0; i < events.size(); i++) {
+    if (i == warm) start = allocations;
+    filter->predict_and_update(events[i].t, events[i].kind, events[i].z, R.at(events[i].kind));
+  }
+  *steady_allocations = allocations - start;
+  *x = filter->state();
+  *P = filter->covs();
+}
+
+int main() {
+  std::vector<Event> events = sensor_stream(20.0);
+
+  double base_time;
+  VectorXd base_x;
+  MatrixXdr base_P;
+  auto base = run(events, 1, &base_time, &base_x, &base_P);
+  printf("interval  1: %.1f us per observation\n", base_time * 1e6 / events.size());
+
+  for (int interval : {4, 16}) {
+    double time;
+    auto res = run(events, interval, &time);
+    printf("interval %2d: %.1f us per observation\n", interval, time * 1e6 / events.size());
+
+    assert(res.size() == base.size());
+    for (int i = 0; i < res.size(); i++) {
+      assert(res[i].has_value() == base[i].has_value());
+      if (!res[i]) continue;
+      // replaying runs the same operations on the same inputs, so this is exact
+      assert(res[i]->xk == base[i]->xk && res[i]->Pk == base[i]->Pk);
+      assert(res[i]->xk1 == base[i]->xk1 && res[i]->Pk1 == base[i]->Pk1);
+      assert(res[i]->y == base[i]->y);
+    }
+  }
+  printf("outputs identical for %zu observations\n", events.size());
+
+  for (int interval : {1, 4}) {
+    VectorXd x;
+    MatrixXdr P;
+    size_t steady_allocations;
+    run_single(events, interval, &x, &P, &steady_allocations);
+    printf("single observation path, interval %d: %zu allocations in steady state\n", interval, steady_allocations);
+    assert(x == base_x && P == base_P);
+    assert(steady_allocations == 0);
+  }
+  return 0;
+}
@@ -0,0 +1,131 @@
+// checks the fixed size update kernels generated for the live filter against the
+// dynamically sized update they replaced, and times them and the sympy generated functions
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "rednose/helpers/ekf_sym.h"
+#include "selfdrive/locationd/models/generated/live.h"
+#include "selfdrive/locationd/models/generated/live_kf_constants.h"
+
+using namespace EKFS;
+using namespace Eigen;
+
+static void update_ref(const EKF *ekf, int kind, VectorXd &x, MatrixXdr &P, const VectorXd &z, const MatrixXdr &R) {
+  const int dim_x = x.rows(), dim_err = P.rows(), dim_z = z.rows();
+  VectorXd hx(dim_z);
+  MatrixXdr H(dim_z, dim_x), H_mod(dim_x, dim_err);
+  ekf->hs.at(kind)(x.data(), nullptr, hx.data());
+  ekf->Hs.at(kind)(x.data(), nullptr, H.data());
+  ekf->H_mod_fun(x.data(), H_mod.data());
+
+  VectorXd y = z - hx;
+  MatrixXdr H_err = H * H_mod;
+  MatrixXdr S = H_err * P * H_err.transpose() + R;
+  MatrixXdr KT = S.fullPivLu().solve(H_err * P.transpose());
+  MatrixXdr I_KH = MatrixXdr::Identity(dim_err, dim_err) - KT.transpose() * H_err;
+
+  VectorXd dx = KT.transpose() * y;
+  VectorXd x_new(dim_x);
+  ekf->err_fun(x.data(), dx.data(), x_new.data());
+  x = x_new;
+  P = I_KH * P * I_KH.transpose() + KT.transpose() * R * KT;
+}
+
+// best of a few runs, this machine may be busy
+template <typename F>
+static double time_us(int n, F f) {
+  double best = INFINITY;
+  for (int run = 0; run < 5; run++) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) f();
+    best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / n);
+  }
+  return best;
+}
+
+static double rel_err(const MatrixXdr &a, const MatrixXdr &b) {
+  return (a - b).norm() / std::max(1.0, b.norm());
+}
+
+int main() {
+  const EKF *ekf = ekf_lookup("live");
+  assert(ekf);
+
+  std::mt19937 gen(0);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  MatrixXdr Q = live_Q_diag.asDiagonal();
+
+  std::vector<std::pair<int, MatrixXdr>> obs;
+  for (auto &[kind, R_diag] : live_obs_noise_diag) {
+    obs.push_back({kind, MatrixXdr(VectorXd(R_diag).asDiagonal())});
+  }
+
+  // run both filters through the same sequence of predicts and updates
+  VectorXd x = live_initial_x, x_ref = live_initial_x;
+  MatrixXdr P = live_initial_P_diag.asDiagonal(), P_ref = P;
+  double max_err = 0;
+  for (int i = 0; i < 2000; i++) {
+    ekf->predict(x.data(), P.data(), Q.data(), 0.01);
+    ekf->predict(x_ref.data(), P_ref.data(), Q.data(), 0.01);
+
+    auto &[kind, R] = obs[i % obs.size()];
+    VectorXd z(R.rows());
+    ekf->hs.at(kind)(x_ref.data(), nullptr, z.data());
+    for (int j = 0; j < z.rows(); j++) z[j] += std::sqrt(R(j, j)) * noise(gen);
+
+    VectorXd y = z;
+    ekf->updates.at(kind)(x.data(), P.data(), y.data(), R.data(), nullptr);
+    update_ref(ekf, kind, x_ref, P_ref, z, R);
+
+    // keep the quaternion normalized like EKFSym does
+    x.segment<4>(STATE_ECEF_ORIENTATION_START).normalize();
+    x_ref.segment<4>(STATE_ECEF_ORIENTATION_START).normalize();
+
+    max_err = std::max({max_err, rel_err(x, x_ref), rel_err(P, P_ref)});
+  }
+  printf("max relative error after 2000 steps: %g\n", max_err);
+  assert(max_err < 1e-6);
+
+  // time the generated functions, separate and with shared subexpressions
+  const int N = 20000;
+  {
+    double nx[23], F[22 * 22], hx[3], H[3 * 23];
+    double separate = time_us(N, [&]() { live_f_fun(x.data(), 0.01, nx); live_F_fun(x.data(), 0.01, F); });
+    double shared = time_us(N, [&]() { live_f_F_fun(x.data(), 0.01, nx, F); });
+    printf("f and F:      separate %.2f us, shared %.2f us\n", separate, shared);
+
+    separate = time_us(N, [&]() { live_h_10(x.data(), nullptr, hx); live_H_10(x.data(), nullptr, H); });
+    shared = time_us(N, [&]() { live_hH_10(x.data(), nullptr, hx, H); });
+    printf("h and H (10): separate %.2f us, shared %.2f us\n", separate, shared);
+  }
+
+  // time predict and the updates locationd runs most often
+  VectorXd x0 = x;
+  MatrixXdr P0 = P;
+  printf("predict: %.2f us\n", time_us(N, [&]() {
+    x = x0; P = P0;
+    ekf->predict(x.data(), P.data(), Q.data(), 0.01);
+  }));
+  for (int kind : {OBSERVATION_PHONE_GYRO, OBSERVATION_PHONE_ACCEL, OBSERVATION_ECEF_POS}) {
+    MatrixXdr R = MatrixXdr(VectorXd(live_obs_noise_diag.at(kind)).asDiagonal());
+    VectorXd z(R.rows());
+    ekf->hs.at(kind)(x0.data(), nullptr, z.data());
+
+    double fixed = time_us(N, [&]() {
+      VectorXd y = z;
+      x = x0; P = P0;
+      ekf->updates.at(kind)(x.data(), P.data(), y.data(), R.data(), nullptr);
+    });
+    double dynamic = time_us(N, [&]() {
+      x = x0; P = P0;
+      update_ref(ekf, kind, x, P, z, R);
+    });
+    printf("kind %2d: fixed %.2f us, dynamic %.2f us per update\n", kind, fixed, dynamic);
+  }
+
+  return 0;
+}
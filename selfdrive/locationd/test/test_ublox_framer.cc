@@ -0,0 +1,205 @@
+// feeds a stream of UBX frames, NMEA sentences, garbage and corrupted frames through
+// UbloxFramer in differently sized chunks, the frames that come out have to be exactly the
+// valid ones. Then measures the throughput for a 10Hz measurement + ephemeris + nav mix.
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "selfdrive/locationd/ublox_framer.h"
+
+// counts heap allocations, the framer should not make any after its construction
+static size_t allocations = 0;
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *malloc(size_t size) {
+  allocations++;
+  return __libc_malloc(size);
+}
+
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes ubx_frame(uint8_t cls, uint8_t id, const Bytes &payload) {
+  Bytes frame = {ublox::PREAMBLE1, ublox::PREAMBLE2, cls, id, (uint8_t)(payload.size() & 0xff), (uint8_t)(payload.size() >> 8)};
+  frame.insert(frame.end(), payload.begin(), payload.end());
+  uint8_t ck_a = 0, ck_b = 0;
+  for (size_t i = 2; i < frame.size(); i++) {
+    ck_a += frame[i];
+    ck_b += ck_a;
+  }
+  frame.push_back(ck_a);
+  frame.push_back(ck_b);
+  return frame;
+}
+
+static Bytes nmea_sentence(const std::string &body) {
+  uint8_t ck = 0;
+  for (char c : body) ck ^= c;
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", ck);
+  std::string s = "$" + body + tail;
+  return Bytes(s.begin(), s.end());
+}
+
+static bool has_sync(const Bytes &b, size_t start) {
+  for (size_t i = start; i < b.size(); i++) {
+    if (b[i] == ublox::PREAMBLE1 || b[i] == '$') return true;
+  }
+  return false;
+}
+
+struct Stream {
+  Bytes data;
+  std::vector<Bytes> frames;
+  size_t nmea = 0;
+};
+
+static Stream fuzz_stream(std::mt19937 &gen, int items) {
+  std::uniform_int_distribution<int> byte(0, 255), kind(0, 9), small(0, 300);
+  auto random_bytes = [&](size_t n) {
+    Bytes b(n);
+    for (auto &c : b) c = byte(gen);
+    return b;
+  };
+
+  Stream s;
+  for (int i = 0; i < items; i++) {
+    int k = kind(gen);
+    if (k < 5) {
+      // payloads can contain anything, the frame is taken as a whole
+      size_t len = (k == 0 && i % 50 == 0) ? 40000 : small(gen);
+      Bytes frame = ubx_frame(byte(gen), byte(gen), random_bytes(len));
+      s.data.insert(s.data.end(), frame.begin(), frame.end());
+      s.frames.push_back(frame);
+    } else if (k == 5) {
+      Bytes sentence = nmea_sentence("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,," + std::to_string(i));
+      s.data.insert(s.data.end(), sentence.begin(), sentence.end());
+      s.nmea++;
+    } else if (k == 6) {
+      // corrupted checksum, the framer resyncs inside it so it can't contain another start
+      Bytes sentence;
+      do {
+        sentence = nmea_sentence("GPRMC,bad" + std::to_string(byte(gen)));
+        sentence[sentence.size() - 3] ^= 0x1;
+      } while (has_sync(sentence, 1));
+      s.data.insert(s.data.end(), sentence.begin(), sentence.end());
+    } else if (k < 9) {
+      Bytes frame;
+      do {
+        frame = ubx_frame(byte(gen), byte(gen), random_bytes(small(gen)));
+        frame[6 + byte(gen) % (frame.size() - 6)] ^= 1 << (byte(gen) % 8);
+      } while (has_sync(frame, 1));
+      s.data.insert(s.data.end(), frame.begin(), frame.end());
+    } else {
+      Bytes garbage;
+      do {
+        garbage = random_bytes(small(gen) % 20 + 1);
+      } while (has_sync(garbage, 0));
+      s.data.insert(s.data.end(), garbage.begin(), garbage.end());
+    }
+  }
+  return s;
+}
+
+// feeds the stream in chunks of up to max_chunk bytes and collects the frames
+static std::vector<Bytes> run(UbloxFramer &framer, const Bytes &data, size_t max_chunk, std::mt19937 &gen) {
+  std::uniform_int_distribution<size_t> chunk_size(1, max_chunk);
+  std::vector<Bytes> frames;
+  for (size_t pos = 0; pos < data.size();) {
+    // a copy that is freed afterwards, the framer can't hold on to the chunk
+    size_t n = std::min(chunk_size(gen), data.size() - pos);
+    Bytes chunk(data.begin() + pos, data.begin() + pos + n);
+    framer.add_data(chunk.data(), chunk.size());
+
+    const uint8_t *frame;
+    size_t len;
+    while (framer.next_frame(&frame, &len)) {
+      frames.emplace_back(frame, frame + len);
+    }
+    pos += n;
+  }
+  return frames;
+}
+
+static void test_fuzz() {
+  std::mt19937 gen(0);
+  Stream s = fuzz_stream(gen, 5000);
+
+  for (size_t max_chunk : {(size_t)1, (size_t)7, (size_t)64, (size_t)1500, (size_t)100000, s.data.size()}) {
+    UbloxFramer framer;
+    std::vector<Bytes> frames = run(framer, s.data, max_chunk, gen);
+    assert(frames == s.frames);
+    assert(framer.nmea_sentences == s.nmea);
+  }
+  printf("fuzz: %zu bytes, %zu frames and %zu nmea sentences found in all chunkings\n", s.data.size(), s.frames.size(), s.nmea);
+}
+
+static void test_throughput() {
+  // 10Hz epochs of RXM-RAWX with 32 measurements, NAV-PVT, MON-HW, MON-HW2, 16 RXM-SFRBX and two NMEA sentences
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> byte(0, 255);
+  auto payload = [&](size_t n) {
+    Bytes b(n);
+    for (auto &c : b) c = byte(gen);
+    return b;
+  };
+
+  Bytes data;
+  size_t n_frames = 0;
+  auto add = [&](const Bytes &b, bool frame) {
+    data.insert(data.end(), b.begin(), b.end());
+    n_frames += frame;
+  };
+  for (int epoch = 0; epoch < 1000; epoch++) {
+    add(ubx_frame(0x02, 0x15, payload(16 + 32 * 32)), true);
+    add(ubx_frame(0x01, 0x07, payload(92)), true);
+    add(ubx_frame(0x0a, 0x09, payload(60)), true);
+    add(ubx_frame(0x0a, 0x0b, payload(28)), true);
+    for (int i = 0; i < 16; i++) {
+      add(ubx_frame(0x02, 0x13, payload(8 + 4 * 10)), true);
+    }
+    add(nmea_sentence("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,"), false);
+    add(nmea_sentence("GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W"), false);
+  }
+
+  // the raw messages are read off the serial port in chunks of up to a few kB
+  std::vector<Bytes> chunks;
+  std::uniform_int_distribution<size_t> chunk_size(256, 4096);
+  for (size_t pos = 0; pos < data.size();) {
+    size_t n = std::min(chunk_size(gen), data.size() - pos);
+    chunks.emplace_back(data.begin() + pos, data.begin() + pos + n);
+    pos += n;
+  }
+
+  UbloxFramer framer;
+  const int passes = 20;
+  size_t found = 0, start = allocations;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (const Bytes &chunk : chunks) {
+      framer.add_data(chunk.data(), chunk.size());
+      const uint8_t *frame;
+      size_t len;
+      while (framer.next_frame(&frame, &len)) {
+        found++;
+      }
+    }
+  }
+  double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  size_t steady_allocations = allocations - start;
+
+  printf("throughput: %.0f MB/s, %.1f ns per frame, %zu allocations\n",
+         data.size() * passes / t / 1e6, t * 1e9 / found, steady_allocations);
+  assert(found == n_frames * passes);
+  assert(framer.dropped_bytes == 0);
+  assert(steady_allocations == 0);
+}
+
+int main() {
+  test_fuzz();
+  test_throughput();
+  return 0;
+}
@@ -0,0 +1,200 @@
+// decodes UBX frames with known payloads and checks every published field. The expected
+// values were produced by the kaitai generated ubx_t parser that the decoding at fixed
+// offsets in ublox_msg.cc replaced, so the two agree on NAV-PVT, RXM-RAWX, RXM-SFRBX and
+// MON-HW/HW2. The payloads are random apart from the fields that have to be valid.
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "selfdrive/locationd/ublox_msg.h"
+
+using namespace std::string_literals;
+
+const std::string nav_pvt = "\xb5\x62\x01\x07\x5c\x00\x2f\xd3\x26\x35\xe5\x07\x06\x0f\x0d\x25\x2a\xe9\x9a\x1e\xab\x9e\x15\xcd"
+    "\x5b\x07\xba\x78\x70\xdc\x45\x50\xc9\x7f\xf6\xfe\xaf\x32\xf0\xfb\x4c\x25\x22\xa6\xfa\xc3\xe7\x8b"
+    "\x80\xe9\x4b\x50\x03\x02\x13\x8c\xc1\xcb\x73\x6b\xfa\xd1\x0e\xf3\xc7\x3c\xea\x6b\xae\x9c\x51\x57"
+    "\x0d\x74\x60\x8c\xc5\xfd\x71\xdf\xe5\x9f\xf9\xfc\x59\x54\x2d\x10\x29\x48\xb8\xec\x46\xb8\x56\xac"
+    "\xda\xd3\x9b\x33"s;
+const std::string rxm_rawx = "\xb5\x62\x02\x15\x70\x00\x46\xb6\xf3\x7d\x38\x19\x15\x41\x26\x87\xe4\x03\x85\xee\x2f\xf6\x00\x00"
+    "\x00\x00\xf4\x06\x74\x41\x00\x00\x00\x00\xde\x39\x9a\x41\x00\x50\x9a\xc4\x69\x00\x79\x62\xf9\x5a"
+    "\xa1\x72\x79\xf1\x15\xc7\x00\x00\x00\x28\x41\x07\x74\x41\x00\x00\x00\x73\xdc\x39\x9a\x41\x00\x30"
+    "\x9a\xc4\x13\x1a\xe0\x44\x7b\xe4\x40\x96\xb8\xd4\x88\xac\x00\x00\x00\x50\x8e\x07\x74\x41\x00\x00"
+    "\x00\xe6\xda\x39\x9a\x41\x00\x10\x9a\xc4\x79\xaa\x02\xd7\x6d\xd4\x23\x12\x4c\xc5\x75\x51\x86\x79"s;
+const std::string mon_hw = "\xb5\x62\x0a\x09\x3c\x00\xd0\x08\xed\x4b\x0f\x14\x10\xc0\x3d\x71\x60\x7e\xd3\x39\x31\x3e\xb9\xd3"
+    "\x9b\x57\x02\x01\xa4\x54\x3d\x1c\x01\x0b\xbe\xfd\x91\x1e\x26\x62\x99\x38\xe7\x98\x0c\xcc\x60\x08"
+    "\x2f\x57\x19\xed\x15\x96\xad\x13\x29\xaf\xa4\xe7\x27\x91\x27\xbb\xd2\x7b\xfa\x7b"s;
+const std::string mon_hw2 = "\xb5\x62\x0a\x0b\x1c\x00\xa5\x62\x57\xf2\x66\x88\xb6\x91\x29\x2f\x93\xab\xac\x23\xaa\x94\x1a\x59"
+    "\x6b\x97\x82\xe8\x41\xd9\x1b\xce\x44\xdb\x5a\xf3"s;
+const std::string rxm_sfrbx_1 = "\xb5\x62\x02\x13\x30\x00\x00\x07\x03\x7f\x0a\x2e\x5e\xfd\xdd\x80\xda\x62\x74\xe9\x6b\x34\xd0\x1d"
+    "\xc8\xaf\x11\x0c\x4e\xe3\xbc\x97\x4e\xda\x3d\x4f\xee\xa8\x2e\x5c\xfe\xd4\x22\x4f\x62\x7d\x59\xec"
+    "\x8c\x2c\x58\xf4\xb1\x9a\x85\xc0"s;
+const std::string rxm_sfrbx_2 = "\xb5\x62\x02\x13\x30\x00\x00\x07\x67\xd7\x0a\xfb\x4c\x3a\x7a\xcd\xed\xe2\xa4\xea\xdf\x05\x85\x3d"
+    "\x04\xb8\xb7\x73\xb4\x81\xbf\x0b\x61\xee\xef\xb5\xe1\x32\xcc\x29\xac\x64\x3d\x92\x38\x64\x04\x2a"
+    "\x8d\x6b\xa9\x40\xeb\x7c\x30\x71"s;
+const std::string rxm_sfrbx_3 = "\xb5\x62\x02\x13\x30\x00\x00\x07\x9a\x0a\x0a\x18\xc9\x0c\x86\xd9\xed\xe2\xfb\xeb\xc4\x98\xa6\x0a"
+    "\x3f\x1b\xd1\x3e\x8c\x3b\x17\xac\x16\x1b\xaa\xcb\x88\x80\x9b\x09\x7f\x68\xb8\xeb\x70\xb8\x95\x71"
+    "\xa9\x8e\x99\x9d\x68\x3e\x17\x80"s;
+const std::string rxm_sfrbx_4 = "\xb5\x62\x02\x13\x30\x00\x00\x07\xb2\x4a\x0a\x2e\xf9\x41\x84\x6d\xcb\x22\xa1\x94\xcc\x72\x8e\x12"
+    "\x16\xde\x6b\xda\x25\x13\x44\xdf\x95\xa2\xca\x34\xcf\x0d\xab\xb1\xe7\xc3\xe9\xb2\x4d\xc9\x14\xce"
+    "\xd3\xfb\x5c\x72\x8d\x41\x53\x7e"s;
+const std::string rxm_sfrbx_5 = "\xb5\x62\x02\x13\x30\x00\x00\x07\x32\xec\x0a\xb3\xb4\xb1\xdc\xed\xe1\xa2\x36\xdd\x3b\x70\x84\xae"
+    "\xdd\xc7\x54\xfa\x7e\xcc\x6f\xd8\x06\xb7\x6b\xf0\x8a\x47\x38\x06\x4c\xb6\xef\xc0\x43\x38\x87\xd4"
+    "\x91\x46\x4f\xdf\x2b\x5a\x83\x2e"s;
+
+// the serialized message, copied to get word alignment
+struct Decoded {
+  Decoded(UbloxMsgParser &parser, const std::string &frame) {
+    auto bytes = parser.gen_msg((const uint8_t *)frame.data(), frame.size(), &service);
+    words = kj::heapArray<capnp::word>(bytes.size() / sizeof(capnp::word));
+    memcpy(words.begin(), bytes.begin(), bytes.size());
+  }
+  bool empty() const { return words.size() == 0; }
+  cereal::Event::Reader event() {
+    reader = std::make_unique<capnp::FlatArrayMessageReader>(words);
+    return reader->getRoot<cereal::Event>();
+  }
+
+  const char *service = nullptr;
+  kj::Array<capnp::word> words;
+  std::unique_ptr<capnp::FlatArrayMessageReader> reader;
+};
+
+static void test_nav_pvt(UbloxMsgParser &parser) {
+  Decoded d(parser, nav_pvt);
+  assert(strcmp(d.service, "gpsLocationExternal") == 0);
+  auto loc = d.event().getGpsLocationExternal();
+  assert(loc.getSource() == cereal::GpsLocationData::SensorSource::UBLOX);
+  assert(loc.getFlags() == 120);
+  assert(loc.getLatitude() == 85.039486999999994);
+  assert(loc.getLongitude() == 214.38997169999999);
+  assert(loc.getAltitude() == 625802.22400000005);
+  assert(loc.getSpeed() == (float)-1666290.71);
+  assert(loc.getBearingDeg() == (float)19470.313770000001);
+  assert(loc.getAccuracy() == (float)3917515.7510000002);
+  assert(loc.getTimestamp() == 1623764262123);
+  auto vned = loc.getVNED();
+  assert(vned.size() == 3);
+  assert(vned[0] == -876508.188f && vned[1] == -772117.688f && vned[2] == 1019736.88f);
+  assert(loc.getVerticalAccuracy() == (float)33771.595000000001);
+  assert(loc.getSpeedAccuracy() == (float)-37385.120000000003);
+  assert(loc.getBearingAccuracyDeg() == (float)26826.422890000002);
+}
+
+static void test_rxm_rawx(UbloxMsgParser &parser) {
+  Decoded d(parser, rxm_rawx);
+  assert(strcmp(d.service, "ubloxGnss") == 0);
+  auto mr = d.event().getUbloxGnss().getMeasurementReport();
+  assert(mr.getRcvTow() == 345678.12300000002);
+  assert(mr.getGpsWeek() == 34598);
+  assert(mr.getLeapSeconds() == (uint16_t)-28);
+  assert(mr.getNumMeas() == 3);
+  assert(mr.getReceiverStatus().getLeapSecValid());
+  assert(mr.getReceiverStatus().getClkReset());
+
+  struct Meas {
+    uint8_t sv_id;
+    double pseudorange, carrier_cycles;
+    float doppler;
+    uint8_t gnss_id, freq_id;
+    uint16_t locktime;
+    uint8_t cno;
+    double pr_stdev, cp_stdev, do_stdev;
+    uint8_t trk_stat;
+  };
+  const Meas expected[] = {
+    {0, 21000000, 110000000, -1234.5, 105, 98, 23289, 161, 0.040000000000000001, 0.036000000000000004, 0.0040000000000000001, 21},
+    {26, 21001234.5, 109999900.75, -1233.5, 19, 68, 58491, 64, 0.64000000000000001, 0.032000000000000001, 0.032000000000000001, 136},
+    {170, 21002469, 109999801.5, -1232.5, 121, 215, 54381, 35, 0.040000000000000001, 0.048000000000000001, 0.064000000000000001, 117},
+  };
+  auto meas = mr.getMeasurements();
+  assert(meas.size() == 3);
+  for (int i = 0; i < 3; i++) {
+    const Meas &e = expected[i];
+    assert(meas[i].getSvId() == e.sv_id);
+    assert(meas[i].getPseudorange() == e.pseudorange);
+    assert(meas[i].getCarrierCycles() == e.carrier_cycles);
+    assert(meas[i].getDoppler() == e.doppler);
+    assert(meas[i].getGnssId() == e.gnss_id);
+    assert(meas[i].getGlonassFrequencyIndex() == e.freq_id);
+    assert(meas[i].getLocktime() == e.locktime);
+    assert(meas[i].getCno() == e.cno);
+    assert(meas[i].getPseudorangeStdev() == (float)e.pr_stdev);
+    assert(meas[i].getCarrierPhaseStdev() == (float)e.cp_stdev);
+    assert(meas[i].getDopplerStdev() == (float)e.do_stdev);
+    auto ts = meas[i].getTrackingStatus();
+    assert(ts.getPseudorangeValid() == (bool)(e.trk_stat & 1));
+    assert(ts.getCarrierPhaseValid() == (bool)(e.trk_stat & 2));
+    assert(ts.getHalfCycleValid() == (bool)(e.trk_stat & 4));
+    assert(ts.getHalfCycleSubtracted() == (bool)(e.trk_stat & 8));
+  }
+}
+
+static void test_rxm_sfrbx(UbloxMsgParser &parser) {
+  // the ephemeris is published once all 5 subframes of the satellite are in
+  for (const std::string &frame : {rxm_sfrbx_1, rxm_sfrbx_2, rxm_sfrbx_3, rxm_sfrbx_4}) {
+    Decoded d(parser, frame);
+    assert(strcmp(d.service, "ubloxGnss") == 0);
+    assert(d.empty());
+  }
+  Decoded d(parser, rxm_sfrbx_5);
+  auto eph = d.event().getUbloxGnss().getEphemeris();
+  assert(eph.getSvId() == 7);
+  assert(eph.getGpsWeek() == 764);
+  assert(eph.getAf0() == 0.00081467069685459137);
+  assert(eph.getToc() == 562112);
+  assert(eph.getEcc() == -0.078958968748338521);
+  assert(eph.getA() == 5409232.6581546497);
+  assert(eph.getToe() == 998096);
+  assert(eph.getIode() == 249);
+  assert(eph.getOmegaDot() == 1.3727450374837407e-06);
+  assert(eph.getIonoAlpha().size() == 4 && eph.getIonoAlpha()[0] == 8.1956386566162109e-08);
+  assert(eph.getIonoBeta().size() == 4 && eph.getIonoBeta()[3] == 8192000);
+}
+
+static void test_mon_hw(UbloxMsgParser &parser) {
+  Decoded d(parser, mon_hw);
+  assert(strcmp(d.service, "ubloxGnss") == 0);
+  auto hw = d.event().getUbloxGnss().getHwStatus();
+  assert(hw.getNoisePerMS() == 54201);
+  assert(hw.getFlags() == 164);
+  assert(hw.getAgcCnt() == 22427);
+  assert(hw.getAStatus() == cereal::UbloxGnss::HwStatus::AntennaSupervisorState::OK);
+  assert(hw.getAPower() == cereal::UbloxGnss::HwStatus::AntennaPowerStatus::ON);
+  assert(hw.getJamInd() == 237);
+
+  Decoded d2(parser, mon_hw2);
+  auto hw2 = d2.event().getUbloxGnss().getHwStatus2();
+  assert(hw2.getOfsI() == -91);
+  assert(hw2.getMagI() == 98);
+  assert(hw2.getOfsQ() == 87);
+  assert(hw2.getMagQ() == 242);
+  assert(hw2.getCfgSource() == cereal::UbloxGnss::HwStatus2::ConfigSource::FLASH);
+  assert(hw2.getLowLevCfg() == 2878549801);
+  assert(hw2.getPostStatus() == 3644975234);
+}
+
+static void test_short_payloads(UbloxMsgParser &parser) {
+  // a payload shorter than its fields isn't published
+  for (const std::string &frame : {nav_pvt, rxm_rawx, mon_hw, mon_hw2}) {
+    std::string payload = frame.substr(ublox::UBLOX_HEADER_SIZE, frame.size() - ublox::UBLOX_HEADER_SIZE - ublox::UBLOX_CHECKSUM_SIZE - 1);
+    std::string header = frame.substr(0, ublox::UBLOX_HEADER_SIZE);
+    header[4] = payload.size() & 0xff;
+    header[5] = payload.size() >> 8;
+    Decoded d(parser, ublox::ubx_add_checksum(header + payload));
+    assert(d.empty());
+  }
+}
+
+int main() {
+  UbloxMsgParser parser;
+  test_nav_pvt(parser);
+  test_rxm_rawx(parser);
+  test_rxm_sfrbx(parser);
+  test_mon_hw(parser);
+  test_short_payloads(parser);
+  printf("ublox_msg: all fields match\n");
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include "selfdrive/locationd/ublox_framer.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const size_t UBLOX_MAX_FRAME_SIZE = ublox::UBLOX_HEADER_SIZE + ublox::UBLOX_MAX_MSG_SIZE + ublox::UBLOX_CHECKSUM_SIZE;
+static_assert(UBLOX_MAX_FRAME_SIZE <= (1 << 17), "ring has to fit the largest frame");
+
+static int hex_value(uint8_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+UbloxFramer::UbloxFramer() {
+  ring = std::make_unique<uint8_t[]>(RING_SIZE);
+  frame_buf = std::make_unique<uint8_t[]>(UBLOX_MAX_FRAME_SIZE);
+}
+
+// classifies what starts at the first byte, get(i) returns the byte i for i < available.
+// len is the size of the frame, the sentence or the bytes to skip, or for an incomplete
+// frame the number of bytes needed to go on.
+template <typename Get>
+UbloxFramer::Scan UbloxFramer::scan(Get get, size_t available, size_t *len) {
+  if (get(0) == ublox::PREAMBLE1) {
+    if (available < 2) {
+      *len = ublox::UBLOX_HEADER_SIZE;
+      return Scan::INCOMPLETE;
+    }
+    if (get(1) != ublox::PREAMBLE2) {
+      *len = 1;
+      return Scan::SKIP;
+    }
+    if (available < ublox::UBLOX_HEADER_SIZE) {
+      *len = ublox::UBLOX_HEADER_SIZE;
+      return Scan::INCOMPLETE;
+    }
+    size_t frame_len = ublox::UBLOX_HEADER_SIZE + (get(4) | (get(5) << 8)) + ublox::UBLOX_CHECKSUM_SIZE;
+    if (available < frame_len) {
+      *len = frame_len;
+      return Scan::INCOMPLETE;
+    }
+
+    // 8-bit Fletcher over class, id, length and payload
+    uint8_t ck_a = 0, ck_b = 0;
+    for (size_t i = 2; i < frame_len - ublox::UBLOX_CHECKSUM_SIZE; i++) {
+      ck_a += get(i);
+      ck_b += ck_a;
+    }
+    if (ck_a != get(frame_len - 2) || ck_b != get(frame_len - 1)) {
+      *len = 1;
+      return Scan::SKIP;
+    }
+    *len = frame_len;
+    return Scan::UBX;
+  } else if (get(0) == '$') {
+    // $<printable characters>*<xor of the characters in hex>\r\n
+    uint8_t ck = 0;
+    for (size_t i = 1; i + 5 <= ublox::NMEA_MAX_SIZE; i++) {
+      if (i >= available) {
+        *len = ublox::NMEA_MAX_SIZE;
+        return Scan::INCOMPLETE;
+      }
+      uint8_t c = get(i);
+      if (c == '*') {
+        if (available < i + 5) {
+          *len = i + 5;
+          return Scan::INCOMPLETE;
+        }
+        bool valid = hex_value(get(i + 1)) == (ck >> 4) && hex_value(get(i + 2)) == (ck & 0xf) &&
+                     get(i + 3) == '\r' && get(i + 4) == '\n';
+        *len = valid ? i + 5 : 1;
+        return valid ? Scan::NMEA : Scan::SKIP;
+      } else if (c < 0x20 || c > 0x7e) {
+        break;
+      }
+      ck ^= c;
+    }
+    *len = 1;
+    return Scan::SKIP;
+  }
+
+  // skip ahead to the next possible start
+  size_t i = 1;
+  while (i < available && get(i) != ublox::PREAMBLE1 && get(i) != '$') {
+    i++;
+  }
+  *len = i;
+  return Scan::SKIP;
+}
+
+void UbloxFramer::ring_push(const uint8_t *data, size_t len) {
+  if (ring_len == 0) {
+    ring_head = 0;
+  }
+  size_t tail = (ring_head + ring_len) & (RING_SIZE - 1);
+  size_t first = std::min(len, RING_SIZE - tail);
+  memcpy(&ring[tail], data, first);
+  memcpy(&ring[0], data + first, len - first);
+  ring_len += len;
+}
+
+void UbloxFramer::add_data(const uint8_t *data, size_t len) {
+  chunk = data;
+  chunk_len = len;
+  chunk_pos = 0;
+}
+
+bool UbloxFramer::next_frame(const uint8_t **frame, size_t *len) {
+  while (true) {
+    Scan res;
+    size_t n;
+    if (ring_len == 0) {
+      // nothing carried over, work on the chunk in place
+      size_t available = chunk_len - chunk_pos;
+      if (available == 0) {
+        return false;
+      }
+      const uint8_t *p = chunk + chunk_pos;
+      res = scan([p](size_t i) { return p[i]; }, available, &n);
+      if (res == Scan::INCOMPLETE) {
+        ring_push(p, available);
+        chunk_pos = chunk_len;
+        return false;
+      }
+      chunk_pos += n;
+      if (res == Scan::UBX) {
+        *frame = p;
+        *len = n;
+        return true;
+      }
+    } else {
+      const uint8_t *r = ring.get();
+      size_t head = ring_head;
+      res = scan([r, head](size_t i) { return r[(head + i) & (RING_SIZE - 1)]; }, ring_len, &n);
+      if (res == Scan::INCOMPLETE) {
+        // take only what's needed from the chunk, the rest is parsed in place
+        size_t pull = std::min(n - ring_len, chunk_len - chunk_pos);
+        if (pull == 0) {
+          return false;
+        }
+        ring_push(chunk + chunk_pos, pull);
+        chunk_pos += pull;
+        continue;
+      }
+      if (res == Scan::UBX) {
+        size_t first = std::min(n, RING_SIZE - ring_head);
+        if (first == n) {
+          *frame = &ring[ring_head];
+        } else {
+          memcpy(&frame_buf[0], &ring[ring_head], first);
+          memcpy(&frame_buf[first], &ring[0], n - first);
+          *frame = frame_buf.get();
+        }
+      }
+      ring_head = (ring_head + n) & (RING_SIZE - 1);
+      ring_len -= n;
+      if (res == Scan::UBX) {
+        *len = n;
+        return true;
+      }
+    }
+
+    if (res == Scan::SKIP) {
+      dropped_bytes += n;
+    } else {
+      nmea_sentences++;
+    }
+  }
+}
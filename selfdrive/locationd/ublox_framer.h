@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// protocol constants
+namespace ublox {
+  const uint8_t PREAMBLE1 = 0xb5;
+  const uint8_t PREAMBLE2 = 0x62;
+
+  const int UBLOX_HEADER_SIZE = 6;
+  const int UBLOX_CHECKSUM_SIZE = 2;
+  const int UBLOX_MAX_MSG_SIZE = 65536;
+
+  const int NMEA_MAX_SIZE = 82;  // from $ to \r\n
+}
+
+// Splits the raw receiver stream into UBX frames with valid checksums, NMEA sentences
+// are checked and skipped. Frames that are complete in a chunk are returned in place.
+// Only a frame that continues in the next chunk is copied, into a ring buffer that also
+// keeps the bytes for resyncing after a corrupted frame without moving them.
+class UbloxFramer {
+public:
+  UbloxFramer();
+
+  // the chunk has to stay valid until next_frame returns false
+  void add_data(const uint8_t *data, size_t len);
+  // the next frame from the preamble to the checksum, valid until the next call
+  bool next_frame(const uint8_t **frame, size_t *len);
+
+  size_t dropped_bytes = 0;
+  size_t nmea_sentences = 0;
+
+private:
+  enum class Scan { UBX, NMEA, SKIP, INCOMPLETE };
+  template <typename Get>
+  static Scan scan(Get get, size_t available, size_t *len);
+  void ring_push(const uint8_t *data, size_t len);
+
+  const uint8_t *chunk = nullptr;
+  size_t chunk_len = 0, chunk_pos = 0;
+
+  // a power of two that fits the largest frame
+  static const size_t RING_SIZE = 1 << 17;
+  std::unique_ptr<uint8_t[]> ring;
+  size_t ring_head = 0, ring_len = 0;
+  // a frame that wraps around the end of the ring is returned from here
+  std::unique_ptr<uint8_t[]> frame_buf;
+};
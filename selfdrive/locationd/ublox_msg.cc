@@ -7,164 +7,148 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <unordered_map>
 
 #include "selfdrive/common/swaglog.h"
+#include "selfdrive/common/timing.h"
 
 const double gpsPi = 3.1415926535898;
-#define UBLOX_MSG_SIZE(hdr) (*(uint16_t *)&hdr[4])
 
 inline static bool bit_to_bool(uint8_t val, int shifts) {
   return (bool)(val & (1 << shifts));
 }
 
-inline int UbloxMsgParser::needed_bytes() {
-  // Msg header incomplete?
-  if(bytes_in_parse_buf < ublox::UBLOX_HEADER_SIZE)
-    return ublox::UBLOX_HEADER_SIZE + ublox::UBLOX_CHECKSUM_SIZE - bytes_in_parse_buf;
-  uint16_t needed = UBLOX_MSG_SIZE(msg_parse_buf) + ublox::UBLOX_HEADER_SIZE + ublox::UBLOX_CHECKSUM_SIZE;
-  // too much data
-  if(needed < (uint16_t)bytes_in_parse_buf)
-    return -1;
-  return needed - (uint16_t)bytes_in_parse_buf;
+// little endian field of a UBX payload
+template <typename T>
+inline static T get(const uint8_t *msg, size_t offset) {
+  T val;
+  memcpy(&val, msg + offset, sizeof(T));
+  return val;
 }
 
-inline bool UbloxMsgParser::valid_cheksum() {
-  uint8_t ck_a = 0, ck_b = 0;
-  for(int i = 2; i < bytes_in_parse_buf - ublox::UBLOX_CHECKSUM_SIZE;i++) {
-    ck_a = (ck_a + msg_parse_buf[i]) & 0xFF;
-    ck_b = (ck_b + ck_a) & 0xFF;
-  }
-  if(ck_a != msg_parse_buf[bytes_in_parse_buf - 2]) {
-    LOGD("Checksum a mismtach: %02X, %02X", ck_a, msg_parse_buf[6]);
-    return false;
-  }
-  if(ck_b != msg_parse_buf[bytes_in_parse_buf - 1]) {
-    LOGD("Checksum b mismtach: %02X, %02X", ck_b, msg_parse_buf[7]);
+bool UbloxMsgParser::next_msg(const char **service, kj::ArrayPtr<capnp::byte> *bytes) {
+  const uint8_t *frame;
+  size_t len;
+  if (!framer.next_frame(&frame, &len)) {
     return false;
   }
-  return true;
-}
 
-inline bool UbloxMsgParser::valid() {
-  return bytes_in_parse_buf >= ublox::UBLOX_HEADER_SIZE + ublox::UBLOX_CHECKSUM_SIZE &&
-         needed_bytes() == 0 && valid_cheksum();
-}
-
-inline bool UbloxMsgParser::valid_so_far() {
-  if(bytes_in_parse_buf > 0 && msg_parse_buf[0] != ublox::PREAMBLE1) {
-    return false;
-  }
-  if(bytes_in_parse_buf > 1 && msg_parse_buf[1] != ublox::PREAMBLE2) {
-    return false;
-  }
-  if(needed_bytes() == 0 && !valid()) {
-    return false;
+  try {
+    *bytes = gen_msg(frame, len, service);
+  } catch (const std::exception& e) {
+    LOGE("Error parsing ublox message %s", e.what());
+    *bytes = kj::ArrayPtr<capnp::byte>();
   }
   return true;
 }
 
 
-bool UbloxMsgParser::add_data(const uint8_t *incoming_data, uint32_t incoming_data_len, size_t &bytes_consumed) {
-  int needed = needed_bytes();
-  if(needed > 0) {
-    bytes_consumed = std::min((uint32_t)needed, incoming_data_len );
-    // Add data to buffer
-    memcpy(msg_parse_buf + bytes_in_parse_buf, incoming_data, bytes_consumed);
-    bytes_in_parse_buf += bytes_consumed;
-  } else {
-    bytes_consumed = incoming_data_len;
-  }
-
-  // Validate msg format, detect invalid header and invalid checksum.
-  while(!valid_so_far() && bytes_in_parse_buf != 0) {
-    // Corrupted msg, drop a byte.
-    bytes_in_parse_buf -= 1;
-    if(bytes_in_parse_buf > 0)
-      memmove(&msg_parse_buf[0], &msg_parse_buf[1], bytes_in_parse_buf);
-  }
-
-  // There is redundant data at the end of buffer, reset the buffer.
-  if(needed_bytes() == -1) {
-    bytes_in_parse_buf = 0;
-  }
-  return valid();
-}
-
-
-std::pair<std::string, kj::Array<capnp::word>> UbloxMsgParser::gen_msg() {
-  std::string dat = data();
-  kaitai::kstream stream(dat);
+kj::ArrayPtr<capnp::byte> UbloxMsgParser::gen_msg(const uint8_t *frame, size_t len, const char **service) {
+  uint16_t msg_type = (frame[2] << 8) | frame[3];
+  const uint8_t *msg = frame + ublox::UBLOX_HEADER_SIZE;
+  size_t msg_len = len - ublox::UBLOX_HEADER_SIZE - ublox::UBLOX_CHECKSUM_SIZE;
 
-  ubx_t ubx_message(&stream);
-  auto body = ubx_message.body();
+  // a first segment passed to the builder has to be zeroed
+  memset(msg_segment.begin(), 0, msg_segment.size() * sizeof(capnp::word));
+  capnp::MallocMessageBuilder msg_builder(msg_segment);
+  cereal::Event::Builder event = msg_builder.initRoot<cereal::Event>();
+  event.setLogMonoTime(nanos_since_boot());
+  event.setValid(true);
 
-  switch (ubx_message.msg_type()) {
+  bool ret;
+  switch (msg_type) {
   case 0x0107:
-    return {"gpsLocationExternal", gen_nav_pvt(static_cast<ubx_t::nav_pvt_t*>(body))};
+    *service = "gpsLocationExternal";
+    ret = gen_nav_pvt(msg, msg_len, event);
     break;
   case 0x0213:
-    return {"ubloxGnss", gen_rxm_sfrbx(static_cast<ubx_t::rxm_sfrbx_t*>(body))};
+    *service = "ubloxGnss";
+    ret = gen_rxm_sfrbx(msg, msg_len, event);
     break;
   case 0x0215:
-    return {"ubloxGnss", gen_rxm_rawx(static_cast<ubx_t::rxm_rawx_t*>(body))};
+    *service = "ubloxGnss";
+    ret = gen_rxm_rawx(msg, msg_len, event);
     break;
   case 0x0a09:
-    return {"ubloxGnss", gen_mon_hw(static_cast<ubx_t::mon_hw_t*>(body))};
+    *service = "ubloxGnss";
+    ret = gen_mon_hw(msg, msg_len, event);
     break;
   case 0x0a0b:
-    return {"ubloxGnss", gen_mon_hw2(static_cast<ubx_t::mon_hw2_t*>(body))};
+    *service = "ubloxGnss";
+    ret = gen_mon_hw2(msg, msg_len, event);
     break;
   default:
-    LOGE("Unknown message type %x", ubx_message.msg_type());
-    return {"ubloxGnss", kj::Array<capnp::word>()};
-    break;
+    LOGE("Unknown message type %x", msg_type);
+    return kj::ArrayPtr<capnp::byte>();
   }
+  if (!ret) {
+    return kj::ArrayPtr<capnp::byte>();
+  }
+
+  size_t msg_words = capnp::computeSerializedSizeInWords(msg_builder);
+  if (msg_words > msg_bytes.size()) {
+    msg_bytes = kj::heapArray<capnp::word>(msg_words);
+  }
+  kj::ArrayOutputStream output_stream(msg_bytes.asBytes());
+  capnp::writeMessage(output_stream, msg_builder);
+  return output_stream.getArray();
 }
 
 
-kj::Array<capnp::word> UbloxMsgParser::gen_nav_pvt(ubx_t::nav_pvt_t *msg) {
-  MessageBuilder msg_builder;
-  auto gpsLoc = msg_builder.initEvent().initGpsLocationExternal();
+bool UbloxMsgParser::gen_nav_pvt(const uint8_t *msg, size_t len, cereal::Event::Builder event) {
+  if (len < 92) {
+    LOGE("Short NAV-PVT message %zu", len);
+    return false;
+  }
+
+  auto gpsLoc = event.initGpsLocationExternal();
   gpsLoc.setSource(cereal::GpsLocationData::SensorSource::UBLOX);
-  gpsLoc.setFlags(msg->flags());
-  gpsLoc.setLatitude(msg->lat() * 1e-07);
-  gpsLoc.setLongitude(msg->lon() * 1e-07);
-  gpsLoc.setAltitude(msg->height() * 1e-03);
-  gpsLoc.setSpeed(msg->g_speed() * 1e-03);
-  gpsLoc.setBearingDeg(msg->head_mot() * 1e-5);
-  gpsLoc.setAccuracy(msg->h_acc() * 1e-03);
+  gpsLoc.setFlags(get<uint8_t>(msg, 21));
+  gpsLoc.setLatitude(get<int32_t>(msg, 28) * 1e-07);
+  gpsLoc.setLongitude(get<int32_t>(msg, 24) * 1e-07);
+  gpsLoc.setAltitude(get<int32_t>(msg, 32) * 1e-03);
+  gpsLoc.setSpeed(get<int32_t>(msg, 60) * 1e-03);
+  gpsLoc.setBearingDeg(get<int32_t>(msg, 64) * 1e-5);
+  gpsLoc.setAccuracy(get<uint32_t>(msg, 40) * 1e-03);
   std::tm timeinfo = std::tm();
-  timeinfo.tm_year = msg->year() - 1900;
-  timeinfo.tm_mon = msg->month() - 1;
-  timeinfo.tm_mday = msg->day();
-  timeinfo.tm_hour = msg->hour();
-  timeinfo.tm_min = msg->min();
-  timeinfo.tm_sec = msg->sec();
+  timeinfo.tm_year = get<uint16_t>(msg, 4) - 1900;
+  timeinfo.tm_mon = get<uint8_t>(msg, 6) - 1;
+  timeinfo.tm_mday = get<uint8_t>(msg, 7);
+  timeinfo.tm_hour = get<uint8_t>(msg, 8);
+  timeinfo.tm_min = get<uint8_t>(msg, 9);
+  timeinfo.tm_sec = get<uint8_t>(msg, 10);
 
   std::time_t utc_tt = timegm(&timeinfo);
-  gpsLoc.setTimestamp(utc_tt * 1e+03 + msg->nano() * 1e-06);
-  float f[] = { msg->vel_n() * 1e-03f, msg->vel_e() * 1e-03f, msg->vel_d() * 1e-03f };
+  gpsLoc.setTimestamp(utc_tt * 1e+03 + get<int32_t>(msg, 16) * 1e-06);
+  float f[] = { get<int32_t>(msg, 48) * 1e-03f, get<int32_t>(msg, 52) * 1e-03f, get<int32_t>(msg, 56) * 1e-03f };
   gpsLoc.setVNED(f);
-  gpsLoc.setVerticalAccuracy(msg->v_acc() * 1e-03);
-  gpsLoc.setSpeedAccuracy(msg->s_acc() * 1e-03);
-  gpsLoc.setBearingAccuracyDeg(msg->head_acc() * 1e-05);
-  return capnp::messageToFlatArray(msg_builder);
+  gpsLoc.setVerticalAccuracy(get<uint32_t>(msg, 44) * 1e-03);
+  gpsLoc.setSpeedAccuracy(get<int32_t>(msg, 68) * 1e-03);
+  gpsLoc.setBearingAccuracyDeg(get<uint32_t>(msg, 72) * 1e-05);
+  return true;
 }
 
 
-kj::Array<capnp::word> UbloxMsgParser::gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg) {
-  auto body = *msg->body();
+bool UbloxMsgParser::gen_rxm_sfrbx(const uint8_t *msg, size_t len, cereal::Event::Builder event) {
+  if (len < 8 || len < 8 + 4 * get<uint8_t>(msg, 4)) {
+    LOGE("Short RXM-SFRBX message %zu", len);
+    return false;
+  }
+  uint8_t gnss_id = get<uint8_t>(msg, 0);
+  uint8_t sv_id = get<uint8_t>(msg, 1);
+  uint8_t num_words = get<uint8_t>(msg, 4);
 
-  if (msg->gnss_id() == ubx_t::gnss_type_t::GNSS_TYPE_GPS) {
+  if (gnss_id == 0) {  // GPS
     // GPS subframes are packed into 10x 4 bytes, each containing 3 actual bytes
     // We will first need to separate the data from the padding and parity
-    assert(body.size() == 10);
+    assert(num_words == 10);
 
     std::string subframe_data;
     subframe_data.reserve(30);
-    for (uint32_t word : body) {
+    for (int i = 0; i < num_words; i++) {
+      uint32_t word = get<uint32_t>(msg, 8 + 4 * i);
       word = word >> 6; // TODO: Verify parity
       subframe_data.push_back(word >> 16);
       subframe_data.push_back(word >> 8);
@@ -176,17 +160,16 @@ kj::Array<capnp::word> UbloxMsgParser::gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg) {
     gps_t subframe(&stream);
     int subframe_id = subframe.how()->subframe_id();
 
-    if (subframe_id == 1) gps_subframes[msg->sv_id()].clear();
-    gps_subframes[msg->sv_id()][subframe_id] = subframe_data;
+    if (subframe_id == 1) gps_subframes[sv_id].clear();
+    gps_subframes[sv_id][subframe_id] = subframe_data;
 
-    if (gps_subframes[msg->sv_id()].size() == 5) {
-      MessageBuilder msg_builder;
-      auto eph = msg_builder.initEvent().initUbloxGnss().initEphemeris();
-      eph.setSvId(msg->sv_id());
+    if (gps_subframes[sv_id].size() == 5) {
+      auto eph = event.initUbloxGnss().initEphemeris();
+      eph.setSvId(sv_id);
 
       // Subframe 1
       {
-        kaitai::kstream stream(gps_subframes[msg->sv_id()][1]);
+        kaitai::kstream stream(gps_subframes[sv_id][1]);
         gps_t subframe(&stream);
         gps_t::subframe_1_t* subframe_1 = static_cast<gps_t::subframe_1_t*>(subframe.body());
 
@@ -200,7 +183,7 @@ kj::Array<capnp::word> UbloxMsgParser::gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg) {
 
       // Subframe 2
       {
-        kaitai::kstream stream(gps_subframes[msg->sv_id()][2]);
+        kaitai::kstream stream(gps_subframes[sv_id][2]);
         gps_t subframe(&stream);
         gps_t::subframe_2_t* subframe_2 = static_cast<gps_t::subframe_2_t*>(subframe.body());
 
@@ -216,7 +199,7 @@ kj::Array<capnp::word> UbloxMsgParser::gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg) {
 
       // Subframe 3
       {
-        kaitai::kstream stream(gps_subframes[msg->sv_id()][3]);
+        kaitai::kstream stream(gps_subframes[sv_id][3]);
         gps_t subframe(&stream);
         gps_t::subframe_3_t* subframe_3 = static_cast<gps_t::subframe_3_t*>(subframe.body());
 
@@ -233,7 +216,7 @@ kj::Array<capnp::word> UbloxMsgParser::gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg) {
 
       // Subframe 4
       {
-        kaitai::kstream stream(gps_subframes[msg->sv_id()][4]);
+        kaitai::kstream stream(gps_subframes[sv_id][4]);
         gps_t subframe(&stream);
         gps_t::subframe_4_t* subframe_4 = static_cast<gps_t::subframe_4_t*>(subframe.body());
 
@@ -254,81 +237,94 @@ kj::Array<capnp::word> UbloxMsgParser::gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg) {
         }
       }
 
-      return capnp::messageToFlatArray(msg_builder);
+      return true;
     }
   }
-  return kj::Array<capnp::word>();
+  return false;
 }
 
-kj::Array<capnp::word> UbloxMsgParser::gen_rxm_rawx(ubx_t::rxm_rawx_t *msg) {
-  MessageBuilder msg_builder;
-  auto mr = msg_builder.initEvent().initUbloxGnss().initMeasurementReport();
-  mr.setRcvTow(msg->rcv_tow());
-  mr.setGpsWeek(msg->week());
-  mr.setLeapSeconds(msg->leap_s());
-  mr.setGpsWeek(msg->week());
-
-  auto mb = mr.initMeasurements(msg->num_meas());
-  auto measurements = *msg->measurements();
-  for(int8_t i = 0; i < msg->num_meas(); i++) {
-    mb[i].setSvId(measurements[i]->sv_id());
-    mb[i].setPseudorange(measurements[i]->pr_mes());
-    mb[i].setCarrierCycles(measurements[i]->cp_mes());
-    mb[i].setDoppler(measurements[i]->do_mes());
-    mb[i].setGnssId(measurements[i]->gnss_id());
-    mb[i].setGlonassFrequencyIndex(measurements[i]->freq_id());
-    mb[i].setLocktime(measurements[i]->lock_time());
-    mb[i].setCno(measurements[i]->cno());
-    mb[i].setPseudorangeStdev(0.01 * (pow(2, (measurements[i]->pr_stdev() & 15)))); // weird scaling, might be wrong
-    mb[i].setCarrierPhaseStdev(0.004 * (measurements[i]->cp_stdev() & 15));
-    mb[i].setDopplerStdev(0.002 * (pow(2, (measurements[i]->do_stdev() & 15)))); // weird scaling, might be wrong
+bool UbloxMsgParser::gen_rxm_rawx(const uint8_t *msg, size_t len, cereal::Event::Builder event) {
+  if (len < 16 || len < 16 + 32 * get<uint8_t>(msg, 11)) {
+    LOGE("Short RXM-RAWX message %zu", len);
+    return false;
+  }
+  uint8_t num_meas = get<uint8_t>(msg, 11);
+  uint8_t rec_stat = get<uint8_t>(msg, 12);
+
+  auto mr = event.initUbloxGnss().initMeasurementReport();
+  mr.setRcvTow(get<double>(msg, 0));
+  mr.setGpsWeek(get<uint16_t>(msg, 8));
+  mr.setLeapSeconds(get<int8_t>(msg, 10));
+
+  auto mb = mr.initMeasurements(num_meas);
+  for(int i = 0; i < num_meas; i++) {
+    const uint8_t *meas = msg + 16 + 32 * i;
+    mb[i].setSvId(get<uint8_t>(meas, 21));
+    mb[i].setPseudorange(get<double>(meas, 0));
+    mb[i].setCarrierCycles(get<double>(meas, 8));
+    mb[i].setDoppler(get<float>(meas, 16));
+    mb[i].setGnssId(get<uint8_t>(meas, 20));
+    mb[i].setGlonassFrequencyIndex(get<uint8_t>(meas, 23));
+    mb[i].setLocktime(get<uint16_t>(meas, 24));
+    mb[i].setCno(get<uint8_t>(meas, 26));
+    mb[i].setPseudorangeStdev(0.01 * (pow(2, (get<uint8_t>(meas, 27) & 15)))); // weird scaling, might be wrong
+    mb[i].setCarrierPhaseStdev(0.004 * (get<uint8_t>(meas, 28) & 15));
+    mb[i].setDopplerStdev(0.002 * (pow(2, (get<uint8_t>(meas, 29) & 15)))); // weird scaling, might be wrong
 
     auto ts = mb[i].initTrackingStatus();
-    auto trk_stat = measurements[i]->trk_stat();
+    auto trk_stat = get<uint8_t>(meas, 30);
     ts.setPseudorangeValid(bit_to_bool(trk_stat, 0));
     ts.setCarrierPhaseValid(bit_to_bool(trk_stat, 1));
     ts.setHalfCycleValid(bit_to_bool(trk_stat, 2));
     ts.setHalfCycleSubtracted(bit_to_bool(trk_stat, 3));
   }
 
-  mr.setNumMeas(msg->num_meas());
+  mr.setNumMeas(num_meas);
   auto rs = mr.initReceiverStatus();
-  rs.setLeapSecValid(bit_to_bool(msg->rec_stat(), 0));
-  rs.setClkReset(bit_to_bool(msg->rec_stat(), 2));
-  return capnp::messageToFlatArray(msg_builder);
+  rs.setLeapSecValid(bit_to_bool(rec_stat, 0));
+  rs.setClkReset(bit_to_bool(rec_stat, 2));
+  return true;
 }
 
-kj::Array<capnp::word> UbloxMsgParser::gen_mon_hw(ubx_t::mon_hw_t *msg) {
-  MessageBuilder msg_builder;
-  auto hwStatus = msg_builder.initEvent().initUbloxGnss().initHwStatus();
-  hwStatus.setNoisePerMS(msg->noise_per_ms());
-  hwStatus.setFlags(msg->flags());
-  hwStatus.setAgcCnt(msg->agc_cnt());
-  hwStatus.setAStatus((cereal::UbloxGnss::HwStatus::AntennaSupervisorState) msg->a_status());
-  hwStatus.setAPower((cereal::UbloxGnss::HwStatus::AntennaPowerStatus) msg->a_power());
-  hwStatus.setJamInd(msg->jam_ind());
-  return capnp::messageToFlatArray(msg_builder);
+bool UbloxMsgParser::gen_mon_hw(const uint8_t *msg, size_t len, cereal::Event::Builder event) {
+  if (len < 60) {
+    LOGE("Short MON-HW message %zu", len);
+    return false;
+  }
+
+  auto hwStatus = event.initUbloxGnss().initHwStatus();
+  hwStatus.setNoisePerMS(get<uint16_t>(msg, 16));
+  hwStatus.setFlags(get<uint8_t>(msg, 22));
+  hwStatus.setAgcCnt(get<uint16_t>(msg, 18));
+  hwStatus.setAStatus((cereal::UbloxGnss::HwStatus::AntennaSupervisorState) get<uint8_t>(msg, 20));
+  hwStatus.setAPower((cereal::UbloxGnss::HwStatus::AntennaPowerStatus) get<uint8_t>(msg, 21));
+  hwStatus.setJamInd(get<uint8_t>(msg, 45));
+  return true;
 }
 
-kj::Array<capnp::word> UbloxMsgParser::gen_mon_hw2(ubx_t::mon_hw2_t *msg) {
-  MessageBuilder msg_builder;
-  auto hwStatus = msg_builder.initEvent().initUbloxGnss().initHwStatus2();
-  hwStatus.setOfsI(msg->ofs_i());
-  hwStatus.setMagI(msg->mag_i());
-  hwStatus.setOfsQ(msg->ofs_q());
-  hwStatus.setMagQ(msg->mag_q());
+bool UbloxMsgParser::gen_mon_hw2(const uint8_t *msg, size_t len, cereal::Event::Builder event) {
+  if (len < 28) {
+    LOGE("Short MON-HW2 message %zu", len);
+    return false;
+  }
+
+  auto hwStatus = event.initUbloxGnss().initHwStatus2();
+  hwStatus.setOfsI(get<int8_t>(msg, 0));
+  hwStatus.setMagI(get<uint8_t>(msg, 1));
+  hwStatus.setOfsQ(get<int8_t>(msg, 2));
+  hwStatus.setMagQ(get<uint8_t>(msg, 3));
 
-  switch (msg->cfg_source()) {
-    case ubx_t::mon_hw2_t::config_source_t::CONFIG_SOURCE_ROM:
+  switch (get<uint8_t>(msg, 4)) {
+    case 113:  // 'q'
       hwStatus.setCfgSource(cereal::UbloxGnss::HwStatus2::ConfigSource::ROM);
       break;
-    case ubx_t::mon_hw2_t::config_source_t::CONFIG_SOURCE_OTP:
+    case 111:  // 'o'
       hwStatus.setCfgSource(cereal::UbloxGnss::HwStatus2::ConfigSource::OTP);
       break;
-    case ubx_t::mon_hw2_t::config_source_t::CONFIG_SOURCE_CONFIG_PINS:
+    case 112:  // 'p'
       hwStatus.setCfgSource(cereal::UbloxGnss::HwStatus2::ConfigSource::CONFIGPINS);
       break;
-    case ubx_t::mon_hw2_t::config_source_t::CONFIG_SOURCE_FLASH:
+    case 102:  // 'f'
       hwStatus.setCfgSource(cereal::UbloxGnss::HwStatus2::ConfigSource::FLASH);
       break;
     default:
@@ -336,8 +332,7 @@ kj::Array<capnp::word> UbloxMsgParser::gen_mon_hw2(ubx_t::mon_hw2_t *msg) {
       break;
   }
 
-  hwStatus.setLowLevCfg(msg->low_lev_cfg());
-  hwStatus.setPostStatus(msg->post_status());
-
-  return capnp::messageToFlatArray(msg_builder);
+  hwStatus.setLowLevCfg(get<uint32_t>(msg, 8));
+  hwStatus.setPostStatus(get<uint32_t>(msg, 20));
+  return true;
 }
@@ -10,19 +10,13 @@
 #include "cereal/messaging/messaging.h"
 #include "selfdrive/common/util.h"
 #include "selfdrive/locationd/generated/gps.h"
-#include "selfdrive/locationd/generated/ubx.h"
+#include "selfdrive/locationd/ublox_framer.h"
 
 using namespace std::string_literals;
 
-// protocol constants
-namespace ublox {
-  const uint8_t PREAMBLE1 = 0xb5;
-  const uint8_t PREAMBLE2 = 0x62;
-
-  const int UBLOX_HEADER_SIZE = 6;
-  const int UBLOX_CHECKSUM_SIZE = 2;
-  const int UBLOX_MAX_MSG_SIZE = 65536;
+#define UBLOX_MSG_WORDS 1024
 
+namespace ublox {
   // Boardd still uses these:
   const uint8_t CLASS_NAV = 0x01;
   const uint8_t CLASS_RXM = 0x02;
@@ -90,27 +84,25 @@ namespace ublox {
 
 class UbloxMsgParser {
   public:
-    bool add_data(const uint8_t *incoming_data, uint32_t incoming_data_len, size_t &bytes_consumed);
-    inline void reset() {bytes_in_parse_buf = 0;}
-    inline int needed_bytes();
-    inline std::string data() {return std::string((const char*)msg_parse_buf, bytes_in_parse_buf);}
-
-    std::pair<std::string, kj::Array<capnp::word>> gen_msg();
-    kj::Array<capnp::word> gen_nav_pvt(ubx_t::nav_pvt_t *msg);
-    kj::Array<capnp::word> gen_rxm_sfrbx(ubx_t::rxm_sfrbx_t *msg);
-    kj::Array<capnp::word> gen_rxm_rawx(ubx_t::rxm_rawx_t *msg);
-    kj::Array<capnp::word> gen_mon_hw(ubx_t::mon_hw_t *msg);
-    kj::Array<capnp::word> gen_mon_hw2(ubx_t::mon_hw2_t *msg);
+    // the chunk of the raw stream has to stay valid until next_msg returns false
+    inline void add_data(const uint8_t *data, size_t len) { framer.add_data(data, len); }
+    // decodes the next frame in the stream, returns false when the data is used up. The bytes
+    // are empty for frames without a message and valid until the next call.
+    bool next_msg(const char **service, kj::ArrayPtr<capnp::byte> *bytes);
+
+    kj::ArrayPtr<capnp::byte> gen_msg(const uint8_t *frame, size_t len, const char **service);
+    bool gen_nav_pvt(const uint8_t *msg, size_t len, cereal::Event::Builder event);
+    bool gen_rxm_sfrbx(const uint8_t *msg, size_t len, cereal::Event::Builder event);
+    bool gen_rxm_rawx(const uint8_t *msg, size_t len, cereal::Event::Builder event);
+    bool gen_mon_hw(const uint8_t *msg, size_t len, cereal::Event::Builder event);
+    bool gen_mon_hw2(const uint8_t *msg, size_t len, cereal::Event::Builder event);
 
   private:
-    inline bool valid_cheksum();
-    inline bool valid();
-    inline bool valid_so_far();
+    UbloxFramer framer;
 
     std::unordered_map<int, std::unordered_map<int, std::string>> gps_subframes;
 
-    size_t bytes_in_parse_buf = 0;
-    uint8_t msg_parse_buf[ublox::UBLOX_HEADER_SIZE + ublox::UBLOX_MAX_MSG_SIZE];
-
+    // the messages are built in a reused first segment and serialized into a reused buffer
+    kj::Array<capnp::word> msg_segment = kj::heapArray<capnp::word>(UBLOX_MSG_WORDS);
+    kj::Array<capnp::word> msg_bytes = kj::heapArray<capnp::word>(UBLOX_MSG_WORDS);
 };
-
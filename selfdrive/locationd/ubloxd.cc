@@ -1,7 +1,5 @@
 #include <cassert>
 
-#include <kaitai/kaitaistream.h>
-
 #include "cereal/messaging/messaging.h"
 #include "selfdrive/common/swaglog.h"
 #include "selfdrive/common/util.h"
@@ -36,27 +34,14 @@ int main() {
     cereal::Event::Reader event = cmsg.getRoot<cereal::Event>();
     auto ubloxRaw = event.getUbloxRaw();
 
-    const uint8_t *data = ubloxRaw.begin();
-    size_t len = ubloxRaw.size();
-    size_t bytes_consumed = 0;
-
-    while(bytes_consumed < len && !do_exit) {
-      size_t bytes_consumed_this_time = 0U;
-      if(parser.add_data(data + bytes_consumed, (uint32_t)(len - bytes_consumed), bytes_consumed_this_time)) {
-
-        try {
-          auto msg = parser.gen_msg();
-          if (msg.second.size() > 0) {
-            auto bytes = msg.second.asBytes();
-            pm.send(msg.first.c_str(), bytes.begin(), bytes.size());
-          }
-        } catch (const std::exception& e) {
-          LOGE("Error parsing ublox message %s", e.what());
-        }
+    parser.add_data(ubloxRaw.begin(), ubloxRaw.size());
 
-        parser.reset();
+    const char *service;
+    kj::ArrayPtr<capnp::byte> bytes;
+    while (!do_exit && parser.next_msg(&service, &bytes)) {
+      if (bytes.size() > 0) {
+        pm.send(service, bytes.begin(), bytes.size());
       }
-      bytes_consumed += bytes_consumed_this_time;
     }
     delete msg;
   }
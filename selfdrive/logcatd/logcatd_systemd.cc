@@ -1,20 +1,160 @@
 #include <systemd/sd-journal.h>
+#include <syslog.h>
 
+#include <algorithm>
 #include <cassert>
 #include <csignal>
-#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 
-#include "json11.hpp"
-
 #include "cereal/messaging/messaging.h"
 #include "selfdrive/common/timing.h"
 #include "selfdrive/common/util.h"
 
+#define LOGCATD_MSG_WORDS 1024
+
+const int BATCH_SIZE = 256;  // entries read before checking for exit
+
+// entries above LOG_ERR are dropped over this rate, errors are always published
+const double MAX_RATE = 500.;  // entries per second
+const double MAX_BURST = 1000.;
+
+// the fields published, in the message as a json object. the journal has many more
+// for each entry but only these are read
+const char *FIELDS[] = {"MESSAGE", "SYSLOG_IDENTIFIER", "_PID", "PRIORITY", "_COMM", "_SYSTEMD_UNIT"};
+enum Field { MESSAGE, SYSLOG_IDENTIFIER, PID, PRIORITY, COMM, SYSTEMD_UNIT, NUM_FIELDS };
+
+struct Entry {
+  uint64_t ts = 0;
+  bool has[NUM_FIELDS] = {};
+  std::string value[NUM_FIELDS];
+};
+
+// reads a field of the current entry into a buffer that's kept across entries. the
+// data from the journal is only valid until the next field is read
+bool read_field(sd_journal *journal, Field field, Entry &entry) {
+  const void *data;
+  size_t length;
+  entry.has[field] = sd_journal_get_data(journal, FIELDS[field], &data, &length) >= 0;
+  if (entry.has[field]) {
+    const size_t prefix = strlen(FIELDS[field]) + 1;  // "FIELD="
+    entry.value[field].assign((const char *)data + prefix, length > prefix ? length - prefix : 0);
+  }
+  return entry.has[field];
+}
+
+// escaped for json, like json11 did
+void append_json_string(std::string &out, const std::string &s) {
+  out += '"';
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\b': out += "\\b"; break;
+      case '\f': out += "\\f"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if (c < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          out += buf;
+        } else {
+          out += c;
+        }
+    }
+  }
+  out += '"';
+}
+
+class AndroidLogPublisher {
+public:
+  AndroidLogPublisher() : pm({"androidLog"}) {}
+
+  void publish(const Entry &entry) {
+    // the fields sorted by name like the map that used to be dumped
+    json.clear();
+    json += '{';
+    for (Field f : {MESSAGE, PRIORITY, SYSLOG_IDENTIFIER, COMM, PID, SYSTEMD_UNIT}) {
+      if (!entry.has[f]) continue;
+      if (json.size() > 1) json += ", ";
+      append_json_string(json, FIELDS[f]);
+      json += ": ";
+      append_json_string(json, entry.value[f]);
+    }
+    json += '}';
+
+    // a first segment passed to the builder has to be zeroed
+    memset(msg_segment.begin(), 0, msg_segment.size() * sizeof(capnp::word));
+    capnp::MallocMessageBuilder msg_builder(msg_segment);
+    cereal::Event::Builder evt = msg_builder.initRoot<cereal::Event>();
+    evt.setLogMonoTime(nanos_since_boot());
+    evt.setValid(true);
+
+    auto androidEntry = evt.initAndroidLog();
+    androidEntry.setTs(entry.ts);
+    androidEntry.setMessage(capnp::Text::Reader(json.data(), json.size()));
+    if (entry.has[PID]) androidEntry.setPid(std::atoi(entry.value[PID].c_str()));
+    if (entry.has[PRIORITY]) androidEntry.setPriority(std::atoi(entry.value[PRIORITY].c_str()));
+    if (entry.has[SYSLOG_IDENTIFIER]) androidEntry.setTag(entry.value[SYSLOG_IDENTIFIER]);
+
+    size_t msg_words = capnp::computeSerializedSizeInWords(msg_builder);
+    if (msg_words > msg_bytes.size()) {
+      msg_bytes = kj::heapArray<capnp::word>(msg_words);
+    }
+    kj::ArrayOutputStream output_stream(msg_bytes.asBytes());
+    capnp::writeMessage(output_stream, msg_builder);
+    auto bytes = output_stream.getArray();
+    pm.send("androidLog", bytes.begin(), bytes.size());
+  }
+
+  void publish_dropped(uint64_t dropped) {
+    Entry entry;
+    entry.ts = nanos_since_epoch() / 1000;
+    entry.has[MESSAGE] = entry.has[SYSLOG_IDENTIFIER] = entry.has[PID] = entry.has[PRIORITY] = true;
+    entry.value[MESSAGE] = "dropped " + std::to_string(dropped) + " entries over " + std::to_string((int)MAX_RATE) + "/s";
+    entry.value[SYSLOG_IDENTIFIER] = "logcatd";
+    entry.value[PID] = std::to_string(getpid());
+    entry.value[PRIORITY] = std::to_string(LOG_WARNING);
+    publish(entry);
+  }
+
+private:
+  PubMaster pm;
+  std::string json;
+  kj::Array<capnp::word> msg_segment = kj::heapArray<capnp::word>(LOGCATD_MSG_WORDS);
+  kj::Array<capnp::word> msg_bytes = kj::heapArray<capnp::word>(LOGCATD_MSG_WORDS);
+};
+
+// token bucket over the time the entries are read. the realtime stamps of the entries
+// can step back with the wall clock, which would stop the refill until it catches up
+class RateLimiter {
+public:
+  bool allow(uint64_t t) {
+    if (last_t != 0) {
+      tokens = std::min(MAX_BURST, tokens + (t - last_t) * 1e-9 * MAX_RATE);
+    }
+    last_t = t;
+    if (tokens < 1.) return false;
+    tokens -= 1.;
+    return true;
+  }
+
+private:
+  double tokens = MAX_BURST;
+  uint64_t last_t = 0;
+};
+
 ExitHandler do_exit;
 int main(int argc, char *argv[]) {
-
-  PubMaster pm({"androidLog"});
+  AndroidLogPublisher publisher;
+  RateLimiter limiter;
+  Entry entry;
+  uint64_t dropped = 0;
+  uint64_t last_dropped_report = 0;
 
   sd_journal *journal;
   int err = sd_journal_open(&journal, 0);
@@ -25,45 +165,40 @@ int main(int argc, char *argv[]) {
   assert(err >= 0);
 
   while (!do_exit) {
-    err = sd_journal_next(journal);
-    assert(err >= 0);
+    // read what's there in batches, only waiting once the journal is drained
+    int n = 0;
+    for (; n < BATCH_SIZE; n++) {
+      err = sd_journal_next(journal);
+      assert(err >= 0);
+      if (err == 0) break;
+
+      err = sd_journal_get_realtime_usec(journal, &entry.ts);
+      assert(err >= 0);
+
+      int priority = read_field(journal, PRIORITY, entry) ? std::atoi(entry.value[PRIORITY].c_str()) : LOG_INFO;
+      if (!limiter.allow(nanos_since_boot()) && priority > LOG_ERR) {
+        dropped++;
+        continue;
+      }
+      for (Field f : {MESSAGE, SYSLOG_IDENTIFIER, PID, COMM, SYSTEMD_UNIT}) {
+        read_field(journal, f, entry);
+      }
+      publisher.publish(entry);
+    }
+
+    // the drops are reported at most once a second
+    uint64_t t = nanos_since_boot();
+    if (dropped > 0 && t - last_dropped_report > 1000000000ULL) {
+      publisher.publish_dropped(dropped);
+      dropped = 0;
+      last_dropped_report = t;
+    }
 
     // Wait for new message if we didn't receive anything
-    if (err == 0) {
+    if (n < BATCH_SIZE) {
       err = sd_journal_wait(journal, 1000 * 1000);
       assert (err >= 0);
-      continue; // Try again
-    }
-
-    uint64_t timestamp = 0;
-    err = sd_journal_get_realtime_usec(journal, &timestamp);
-    assert(err >= 0);
-
-    const void *data;
-    size_t length;
-    std::map<std::string, std::string> kv;
-
-    SD_JOURNAL_FOREACH_DATA(journal, data, length) {
-      std::string str((char*)data, length);
-
-      // Split "KEY=VALUE"" on "=" and put in map
-      std::size_t found = str.find("=");
-      if (found != std::string::npos) {
-        kv[str.substr(0, found)] = str.substr(found + 1, std::string::npos);
-      }
     }
-
-    MessageBuilder msg;
-
-    // Build message
-    auto androidEntry = msg.initEvent().initAndroidLog();
-    androidEntry.setTs(timestamp);
-    androidEntry.setMessage(json11::Json(kv).dump());
-    if (kv.count("_PID")) androidEntry.setPid(std::atoi(kv["_PID"].c_str()));
-    if (kv.count("PRIORITY")) androidEntry.setPriority(std::atoi(kv["PRIORITY"].c_str()));
-    if (kv.count("SYSLOG_IDENTIFIER")) androidEntry.setTag(kv["SYSLOG_IDENTIFIER"]);
-
-    pm.send("androidLog", msg);
   }
 
   sd_journal_close(journal);
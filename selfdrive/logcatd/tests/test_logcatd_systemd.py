@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+import json
+import os
+import random
+import shutil
+import string
+import subprocess
+import time
+import unittest
+
+import cereal.messaging as messaging
+from selfdrive.manager.process_config import managed_processes
+
+LOGCATD = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), "logcatd")
+CAN_RUN = shutil.which("systemd-cat") is not None and os.path.exists(LOGCATD)
+
+# journald drops over 10000 entries in 30s from a unit by default, the tests stay under it
+FLOOD_ENTRIES = 4000
+
+
+def cpu_time(pid):
+  with open(f"/proc/{pid}/stat") as f:
+    stat = f.read().rsplit(")", 1)[1].split()
+  return (int(stat[11]) + int(stat[12])) / os.sysconf("SC_CLK_TCK")
+
+
+@unittest.skipUnless(CAN_RUN, "needs systemd-cat and logcatd built")
+class TestLogcatdSystemd(unittest.TestCase):
+  @classmethod
+  def setUpClass(cls):
+    managed_processes['logcatd'].start()
+    time.sleep(1)
+
+  @classmethod
+  def tearDownClass(cls):
+    managed_processes['logcatd'].stop()
+
+  def setUp(self):
+    self.sock = messaging.sub_sock('androidLog', timeout=100)
+    self.tag = "logcatd_test_" + ''.join(random.choices(string.ascii_lowercase, k=8))
+
+  def journal(self, lines, priority="info"):
+    subprocess.run(["systemd-cat", "-t", self.tag, "-p", priority], input="\n".join(lines).encode(), check=True)
+
+  def receive(self, n, timeout=10):
+    """the entries with the test's tag and the drops logcatd reported, until there are n of both.
+    the drops can include other entries in the journal at the same time"""
+    entries, dropped = [], 0
+    end = time.monotonic() + timeout
+    while time.monotonic() < end and len(entries) + dropped < n:
+      for m in messaging.drain_sock(self.sock, wait_for_one=True):
+        if m.androidLog.tag == self.tag:
+          entries.append(m.androidLog)
+        elif m.androidLog.tag == "logcatd":
+          dropped += int(json.loads(m.androidLog.message)['MESSAGE'].split()[1])
+    return entries, dropped
+
+  def test_fields(self):
+    lines = [f"entry {i} \"quoted\"\t{random.random()}" for i in range(10)]
+    self.journal(lines, "warning")
+    entries, _ = self.receive(len(lines))
+
+    self.assertEqual(len(entries), len(lines))
+    for line, e in zip(lines, entries):
+      msg = json.loads(e.message)
+      self.assertEqual(msg['MESSAGE'], line)
+      self.assertEqual(msg['SYSLOG_IDENTIFIER'], self.tag)
+      self.assertEqual(int(msg['_PID']), e.pid)
+      self.assertEqual(e.priority, 4)
+      self.assertGreater(e.pid, 0)
+
+  def test_flood(self):
+    pid = managed_processes['logcatd'].proc.pid
+    cpu_start = cpu_time(pid)
+    start = time.monotonic()
+    self.journal([f"flood {i}" for i in range(FLOOD_ENTRIES)])
+    entries, dropped = self.receive(FLOOD_ENTRIES)
+    dt = time.monotonic() - start
+    cpu = cpu_time(pid) - cpu_start
+
+    print(f"\n{FLOOD_ENTRIES} entries in {dt:.2f}s, {FLOOD_ENTRIES / dt:.0f} entries/s: {len(entries)} published, "
+          f"{dropped} dropped. logcatd used {cpu:.2f}s of cpu, {FLOOD_ENTRIES / max(cpu, 1e-3):.0f} entries/cpu s")
+    self.assertGreaterEqual(len(entries) + dropped, FLOOD_ENTRIES)
+    self.assertGreater(dropped, 0)
+    published = [int(json.loads(e.message)['MESSAGE'].split()[1]) for e in entries]
+    self.assertEqual(published, sorted(published))
+
+  def test_errors_not_dropped(self):
+    self.journal([f"flood {i}" for i in range(FLOOD_ENTRIES // 2)])
+    self.journal([f"error {i}" for i in range(200)], "err")
+    entries, _ = self.receive(float('inf'), timeout=5)
+    errors = [e for e in entries if e.priority == 3]
+    self.assertEqual(len(errors), 200)
+
+
+if __name__ == "__main__":
+  unittest.main()
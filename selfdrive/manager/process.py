@@ -15,9 +15,9 @@ from common.params import Params
 from common.realtime import sec_since_boot
 from selfdrive.swaglog import cloudlog
 from selfdrive.hardware import HARDWARE
+from selfdrive.manager.watchdog import WatchdogTable
 from cereal import log
 
-WATCHDOG_FN = "/dev/shm/wd_"
 ENABLE_WATCHDOG = os.getenv("NO_WATCHDOG") is None
 
 
@@ -82,15 +82,11 @@ class ManagerProcess(ABC):
     self.stop()
     self.start()
 
-  def check_watchdog(self, started):
+  def check_watchdog(self, started, kicks):
     if self.watchdog_max_dt is None or self.proc is None:
       return
 
-    try:
-      fn = WATCHDOG_FN + str(self.proc.pid)
-      self.last_watchdog_time = int(open(fn).read())
-    except Exception:
-      pass
+    self.last_watchdog_time = kicks.get(self.proc.pid, self.last_watchdog_time)
 
     dt = sec_since_boot() - self.last_watchdog_time / 1e9
 
@@ -269,10 +265,19 @@ class DaemonProcess(ManagerProcess):
     pass
 
 
+watchdog_table = None
+
+
 def ensure_running(procs, started, driverview=False, not_run=None):
+  global watchdog_table
   if not_run is None:
     not_run = []
 
+  # the last kicks of all the processes at once
+  if watchdog_table is None:
+    watchdog_table = WatchdogTable()
+  kicks = watchdog_table.read()
+
   for p in procs:
     if p.name in not_run:
       p.stop(block=False)
@@ -287,5 +292,5 @@ def ensure_running(procs, started, driverview=False, not_run=None):
     else:
       p.stop(block=False)
 
-    p.check_watchdog(started)
+    p.check_watchdog(started, kicks)
 
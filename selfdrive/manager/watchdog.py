@@ -0,0 +1,33 @@
+import mmap
+import os
+
+import numpy as np
+
+# the table of selfdrive/common/watchdog.h, a slot per process with the time of its last kick
+WATCHDOG_TABLE_PATH = "/dev/shm/wd_table"
+WATCHDOG_MAX_PROCS = 64
+SLOT_DTYPE = np.dtype({'names': ['pid', 'waiters', 'time'], 'formats': [np.int32, np.uint32, np.uint64],
+                       'offsets': [0, 4, 8], 'itemsize': 64})
+
+
+class WatchdogTable:
+  def __init__(self, path=None):
+    if path is None:
+      path = os.getenv("WATCHDOG_TABLE", WATCHDOG_TABLE_PATH)
+    size = SLOT_DTYPE.itemsize * WATCHDOG_MAX_PROCS
+    fd = os.open(path, os.O_RDWR | os.O_CREAT, 0o664)
+    try:
+      if os.fstat(fd).st_size < size:
+        os.ftruncate(fd, size)
+      self.mem = mmap.mmap(fd, size)
+    finally:
+      os.close(fd)
+    self.slots = np.ndarray(WATCHDOG_MAX_PROCS, dtype=SLOT_DTYPE, buffer=self.mem)
+
+  def read(self):
+    """nanos_since_boot of the last kick by pid, for every process that kicked"""
+    pids = self.slots['pid'].copy()
+    times = self.slots['time'].copy()
+    kicked = (pids != 0) & (times != 0)
+    return dict(zip(pids[kicked].tolist(), times[kicked].tolist()))
+
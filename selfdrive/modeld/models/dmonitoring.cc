@@ -1,23 +1,13 @@
 #include <cstring>
 
-#include "libyuv.h"
-
 #include "selfdrive/common/mat.h"
 #include "selfdrive/common/params.h"
 #include "selfdrive/common/timing.h"
-#include "selfdrive/hardware/hw.h"
 
 #include "selfdrive/modeld/models/dmonitoring.h"
 
-#define MODEL_WIDTH 320
-#define MODEL_HEIGHT 640
-#define FULL_W 852 // should get these numbers from camerad
-
 void dmonitoring_init(DMonitoringModelState* s) {
-  s->is_rhd = Params().getBool("IsRHD");
-  for (int x = 0; x < std::size(s->tensor); ++x) {
-    s->tensor[x] = (x - 128.f) * 0.0078125f;
-  }
+  dmonitoring_preprocess_init(&s->preprocess, Params().getBool("IsRHD"));
 
 #ifdef USE_ONNX_MODEL
   s->m = new ONNXModel("../../models/dmonitoring_model.onnx", &s->output[0], OUTPUT_SIZE, USE_DSP_RUNTIME);
@@ -26,128 +16,13 @@ void dmonitoring_init(DMonitoringModelState* s) {
 #endif
 }
 
-template <class T>
-static inline T *get_buffer(std::vector<T> &buf, const size_t size) {
-  if (buf.size() < size) buf.resize(size);
-  return buf.data();
-}
-
-static inline auto get_yuv_buf(std::vector<uint8_t> &buf, const int width, int height) {
-  uint8_t *y = get_buffer(buf, width * height * 3 / 2);
-  uint8_t *u = y + width * height;
-  uint8_t *v = u + (width /2) * (height / 2);
-  return std::make_tuple(y, u, v);
-}
-
-struct Rect {int x, y, w, h;};
-void crop_yuv(uint8_t *raw, int width, int height, uint8_t *y, uint8_t *u, uint8_t *v, const Rect &rect) {
-  uint8_t *raw_y = raw;
-  uint8_t *raw_u = raw_y + (width * height);
-  uint8_t *raw_v = raw_u + ((width / 2) * (height / 2));
-  for (int r = 0; r < rect.h / 2; r++) {
-    memcpy(y + 2 * r * rect.w, raw_y + (2 * r + rect.y) * width + rect.x, rect.w);
-    memcpy(y + (2 * r + 1) * rect.w, raw_y + (2 * r + rect.y + 1) * width + rect.x, rect.w);
-    memcpy(u + r * (rect.w / 2), raw_u + (r + (rect.y / 2)) * width / 2 + (rect.x / 2), rect.w / 2);
-    memcpy(v + r * (rect.w / 2), raw_v + (r + (rect.y / 2)) * width / 2 + (rect.x / 2), rect.w / 2);
-  }
-}
-
 DMonitoringResult dmonitoring_eval_frame(DMonitoringModelState* s, void* stream_buf, int width, int height) {
-  Rect crop_rect;
-  if (Hardware::TICI()) {
-    const int full_width_tici = 1928;
-    const int full_height_tici = 1208;
-    const int adapt_width_tici = 954;
-    const int x_offset_tici = -72;
-    const int y_offset_tici = -144;
-    const int cropped_height = adapt_width_tici / 1.33;
-    crop_rect = {full_width_tici / 2 - adapt_width_tici / 2 + x_offset_tici,
-                 full_height_tici / 2 - cropped_height / 2 + y_offset_tici,
-                 cropped_height / 2,
-                 cropped_height};
-    if (!s->is_rhd) {
-      crop_rect.x += adapt_width_tici - crop_rect.w;
-    }
-
-  } else {
-    const int adapt_width = 372;
-    crop_rect = {0, 0, adapt_width, height};
-    if (!s->is_rhd) {
-      crop_rect.x += width - crop_rect.w;
-    }
-  }
-
-  int resized_width = MODEL_WIDTH;
-  int resized_height = MODEL_HEIGHT;
-
-  auto [cropped_y, cropped_u, cropped_v] = get_yuv_buf(s->cropped_buf, crop_rect.w, crop_rect.h);
-  if (!s->is_rhd) {
-    crop_yuv((uint8_t *)stream_buf, width, height, cropped_y, cropped_u, cropped_v, crop_rect);
-  } else {
-    auto [mirror_y, mirror_u, mirror_v] = get_yuv_buf(s->premirror_cropped_buf, crop_rect.w, crop_rect.h);
-    crop_yuv((uint8_t *)stream_buf, width, height, mirror_y, mirror_u, mirror_v, crop_rect);
-    libyuv::I420Mirror(mirror_y, crop_rect.w,
-                       mirror_u, crop_rect.w / 2,
-                       mirror_v, crop_rect.w / 2,
-                       cropped_y, crop_rect.w,
-                       cropped_u, crop_rect.w / 2,
-                       cropped_v, crop_rect.w / 2,
-                       crop_rect.w, crop_rect.h);
-  }
-
-  auto [resized_buf, resized_u, resized_v] = get_yuv_buf(s->resized_buf, resized_width, resized_height);
-  uint8_t *resized_y = resized_buf;
-  libyuv::FilterMode mode = libyuv::FilterModeEnum::kFilterBilinear;
-  if (Hardware::TICI()) {
-    libyuv::I420Scale(cropped_y, crop_rect.w,
-                    cropped_u, crop_rect.w / 2,
-                    cropped_v, crop_rect.w / 2,
-                    crop_rect.w, crop_rect.h,
-                    resized_y, resized_width,
-                    resized_u, resized_width / 2,
-                    resized_v, resized_width / 2,
-                    resized_width, resized_height,
-                    mode);
-  } else {
-    const int source_height = 0.7*resized_height;
-    const int extra_height = (resized_height - source_height) / 2;
-    const int extra_width = (resized_width - source_height / 2) / 2;
-    const int source_width = source_height / 2 + extra_width;
-    libyuv::I420Scale(cropped_y, crop_rect.w,
-                    cropped_u, crop_rect.w / 2,
-                    cropped_v, crop_rect.w / 2,
-                    crop_rect.w, crop_rect.h,
-                    resized_y + extra_height * resized_width, resized_width,
-                    resized_u + extra_height / 2 * resized_width / 2, resized_width / 2,
-                    resized_v + extra_height / 2 * resized_width / 2, resized_width / 2,
-                    source_width, source_height,
-                    mode);
-  }
-
-  int yuv_buf_len = (MODEL_WIDTH/2) * (MODEL_HEIGHT/2) * 6; // Y|u|v -> y|y|y|y|u|v
-  float *net_input_buf = get_buffer(s->net_input_buf, yuv_buf_len);
-  // one shot conversion, O(n) anyway
-  // yuvframe2tensor, normalize
-  for (int r = 0; r < MODEL_HEIGHT/2; r++) {
-    for (int c = 0; c < MODEL_WIDTH/2; c++) {
-      // Y_ul
-      net_input_buf[(r*MODEL_WIDTH/2) + c + (0*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_y[(2*r)*resized_width + 2*c]];
-      // Y_dl
-      net_input_buf[(r*MODEL_WIDTH/2) + c + (1*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_y[(2*r+1)*resized_width + 2*c]];
-      // Y_ur
-      net_input_buf[(r*MODEL_WIDTH/2) + c + (2*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_y[(2*r)*resized_width + 2*c+1]];
-      // Y_dr
-      net_input_buf[(r*MODEL_WIDTH/2) + c + (3*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_y[(2*r+1)*resized_width + 2*c+1]];
-      // U
-      net_input_buf[(r*MODEL_WIDTH/2) + c + (4*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_u[r*resized_width/2 + c]];
-      // V
-      net_input_buf[(r*MODEL_WIDTH/2) + c + (5*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_v[r*resized_width/2 + c]];
-    }
-  }
+  float *net_input_buf = dmonitoring_preprocess(&s->preprocess, stream_buf, width, height);
+  const int yuv_buf_len = DMONITORING_INPUT_SIZE;
 
   //printf("preprocess completed. %d \n", yuv_buf_len);
   //FILE *dump_yuv_file = fopen("/tmp/rawdump.yuv", "wb");
-  //fwrite(resized_buf, yuv_buf_len, sizeof(uint8_t), dump_yuv_file);
+  //fwrite(s->preprocess.resized_buf.data(), yuv_buf_len, sizeof(uint8_t), dump_yuv_file);
   //fclose(dump_yuv_file);
 
   // *** testing ***
@@ -155,7 +30,7 @@ DMonitoringResult dmonitoring_eval_frame(DMonitoringModelState* s, void* stream_
   // imshow(cv2.cvtColor(tensor_to_frames(idat[None]/0.0078125+128)[0], cv2.COLOR_YUV2RGB_I420))
 
   //FILE *dump_yuv_file2 = fopen("/tmp/inputdump.yuv", "wb");
-  //fwrite(net_input_buf, MODEL_HEIGHT*MODEL_WIDTH*3/2, sizeof(float), dump_yuv_file2);
+  //fwrite(net_input_buf, yuv_buf_len, sizeof(float), dump_yuv_file2);
   //fclose(dump_yuv_file2);
 
   double t1 = millis_since_boot();
@@ -5,6 +5,7 @@
 #include "cereal/messaging/messaging.h"
 #include "selfdrive/common/util.h"
 #include "selfdrive/modeld/models/commonmodel.h"
+#include "selfdrive/modeld/models/dmonitoring_preprocess.h"
 #include "selfdrive/modeld/runners/run.h"
 
 #define OUTPUT_SIZE 39
@@ -30,13 +31,8 @@ typedef struct DMonitoringResult {
 
 typedef struct DMonitoringModelState {
   RunModel *m;
-  bool is_rhd;
   float output[OUTPUT_SIZE];
-  std::vector<uint8_t> resized_buf;
-  std::vector<uint8_t> cropped_buf;
-  std::vector<uint8_t> premirror_cropped_buf;
-  std::vector<float> net_input_buf;
-  float tensor[UINT8_MAX + 1];
+  DMonitoringPreprocessState preprocess;
 } DMonitoringModelState;
 
 void dmonitoring_init(DMonitoringModelState* s);
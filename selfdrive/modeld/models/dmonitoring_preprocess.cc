@@ -0,0 +1,197 @@
+#include "selfdrive/modeld/models/dmonitoring_preprocess.h"
+
+#include <tuple>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "libyuv.h"
+
+#include "selfdrive/hardware/hw.h"
+
+#define MODEL_WIDTH 320
+#define MODEL_HEIGHT 640
+
+void dmonitoring_preprocess_init(DMonitoringPreprocessState* s, bool is_rhd) {
+  s->is_rhd = is_rhd;
+  for (int x = 0; x < std::size(s->tensor); ++x) {
+    s->tensor[x] = (x - 128.f) * 0.0078125f;
+  }
+}
+
+template <class T>
+static inline T *get_buffer(std::vector<T> &buf, const size_t size) {
+  if (buf.size() < size) buf.resize(size);
+  return buf.data();
+}
+
+static inline auto get_yuv_buf(std::vector<uint8_t> &buf, const int width, int height) {
+  // the tici crop has an odd height, libyuv rounds the chroma planes up
+  const int uv_size = ((width + 1) / 2) * ((height + 1) / 2);
+  uint8_t *y = get_buffer(buf, width * height + 2 * uv_size);
+  uint8_t *u = y + width * height;
+  uint8_t *v = u + uv_size;
+  return std::make_tuple(y, u, v);
+}
+
+struct Rect {int x, y, w, h;};
+
+// yuv -> model tensor conversion, (x - 128) * 0.0078125 matches s->tensor exactly
+#if defined(__ARM_NEON)
+static inline void normalize_u8x16(uint8x16_t v, float *dst) {
+  const float32x4_t offset = vdupq_n_f32(128.f), scale = vdupq_n_f32(0.0078125f);
+  const uint16x8_t lo = vmovl_u8(vget_low_u8(v)), hi = vmovl_u8(vget_high_u8(v));
+  vst1q_f32(dst + 0, vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), offset), scale));
+  vst1q_f32(dst + 4, vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), offset), scale));
+  vst1q_f32(dst + 8, vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), offset), scale));
+  vst1q_f32(dst + 12, vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), offset), scale));
+}
+#elif defined(__SSE2__)
+static inline void normalize_u16x8(__m128i v, float *dst) {
+  const __m128 offset = _mm_set1_ps(128.f), scale = _mm_set1_ps(0.0078125f);
+  const __m128i zero = _mm_setzero_si128();
+  _mm_storeu_ps(dst + 0, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), offset), scale));
+  _mm_storeu_ps(dst + 4, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), offset), scale));
+}
+#endif
+
+// splits a Y row into its even and odd columns
+static void deinterleave_row(const float *tensor, const uint8_t *src, float *even, float *odd, int n) {
+  int c = 0;
+#if defined(__ARM_NEON)
+  for (; c + 16 <= n; c += 16) {
+    const uint8x16x2_t px = vld2q_u8(src + 2 * c);
+    normalize_u8x16(px.val[0], even + c);
+    normalize_u8x16(px.val[1], odd + c);
+  }
+#elif defined(__SSE2__)
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+  for (; c + 8 <= n; c += 8) {
+    const __m128i px = _mm_loadu_si128((const __m128i *)(src + 2 * c));
+    normalize_u16x8(_mm_and_si128(px, mask), even + c);
+    normalize_u16x8(_mm_srli_epi16(px, 8), odd + c);
+  }
+#endif
+  for (src += 2 * c; c < n; c++, src += 2) {
+    even[c] = tensor[src[0]];
+    odd[c] = tensor[src[1]];
+  }
+}
+
+static void normalize_row(const float *tensor, const uint8_t *src, float *dst, int n) {
+  int c = 0;
+#if defined(__ARM_NEON)
+  for (; c + 16 <= n; c += 16) {
+    normalize_u8x16(vld1q_u8(src + c), dst + c);
+  }
+#elif defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; c + 16 <= n; c += 16) {
+    const __m128i px = _mm_loadu_si128((const __m128i *)(src + c));
+    normalize_u16x8(_mm_unpacklo_epi8(px, zero), dst + c);
+    normalize_u16x8(_mm_unpackhi_epi8(px, zero), dst + c + 8);
+  }
+#endif
+  for (; c < n; c++) {
+    dst[c] = tensor[src[c]];
+  }
+}
+
+float *dmonitoring_preprocess(DMonitoringPreprocessState* s, const void* stream_buf, int width, int height) {
+  Rect crop_rect;
+  if (Hardware::TICI()) {
+    const int full_width_tici = 1928;
+    const int full_height_tici = 1208;
+    const int adapt_width_tici = 954;
+    const int x_offset_tici = -72;
+    const int y_offset_tici = -144;
+    const int cropped_height = adapt_width_tici / 1.33;
+    crop_rect = {full_width_tici / 2 - adapt_width_tici / 2 + x_offset_tici,
+                 full_height_tici / 2 - cropped_height / 2 + y_offset_tici,
+                 cropped_height / 2,
+                 cropped_height};
+    if (!s->is_rhd) {
+      crop_rect.x += adapt_width_tici - crop_rect.w;
+    }
+
+  } else {
+    const int adapt_width = 372;
+    crop_rect = {0, 0, adapt_width, height};
+    if (!s->is_rhd) {
+      crop_rect.x += width - crop_rect.w;
+    }
+  }
+
+  int resized_width = MODEL_WIDTH;
+  int resized_height = MODEL_HEIGHT;
+
+  // crop by offsetting into the frame, no copy needed
+  const uint8_t *raw_y = (const uint8_t *)stream_buf;
+  const uint8_t *raw_u = raw_y + (width * height);
+  const uint8_t *raw_v = raw_u + ((width / 2) * (height / 2));
+  const uint8_t *cropped_y = raw_y + crop_rect.y * width + crop_rect.x;
+  const uint8_t *cropped_u = raw_u + (crop_rect.y / 2) * (width / 2) + (crop_rect.x / 2);
+  const uint8_t *cropped_v = raw_v + (crop_rect.y / 2) * (width / 2) + (crop_rect.x / 2);
+  int cropped_stride = width;
+  if (s->is_rhd) {
+    auto [mirror_y, mirror_u, mirror_v] = get_yuv_buf(s->cropped_buf, crop_rect.w, crop_rect.h);
+    libyuv::I420Mirror(cropped_y, width,
+                       cropped_u, width / 2,
+                       cropped_v, width / 2,
+                       mirror_y, crop_rect.w,
+                       mirror_u, crop_rect.w / 2,
+                       mirror_v, crop_rect.w / 2,
+                       crop_rect.w, crop_rect.h);
+    cropped_y = mirror_y;
+    cropped_u = mirror_u;
+    cropped_v = mirror_v;
+    cropped_stride = crop_rect.w;
+  }
+
+  auto [resized_buf, resized_u, resized_v] = get_yuv_buf(s->resized_buf, resized_width, resized_height);
+  uint8_t *resized_y = resized_buf;
+  libyuv::FilterMode mode = libyuv::FilterModeEnum::kFilterBilinear;
+  if (Hardware::TICI()) {
+    libyuv::I420Scale(cropped_y, cropped_stride,
+                    cropped_u, cropped_stride / 2,
+                    cropped_v, cropped_stride / 2,
+                    crop_rect.w, crop_rect.h,
+                    resized_y, resized_width,
+                    resized_u, resized_width / 2,
+                    resized_v, resized_width / 2,
+                    resized_width, resized_height,
+                    mode);
+  } else {
+    const int source_height = 0.7*resized_height;
+    const int extra_height = (resized_height - source_height) / 2;
+    const int extra_width = (resized_width - source_height / 2) / 2;
+    const int source_width = source_height / 2 + extra_width;
+    libyuv::I420Scale(cropped_y, cropped_stride,
+                    cropped_u, cropped_stride / 2,
+                    cropped_v, cropped_stride / 2,
+                    crop_rect.w, crop_rect.h,
+                    resized_y + extra_height * resized_width, resized_width,
+                    resized_u + extra_height / 2 * resized_width / 2, resized_width / 2,
+                    resized_v + extra_height / 2 * resized_width / 2, resized_width / 2,
+                    source_width, source_height,
+                    mode);
+  }
+
+  // Y|u|v -> y|y|y|y|u|v
+  float *net_input_buf = get_buffer(s->net_input_buf, DMONITORING_INPUT_SIZE);
+  // one shot conversion, O(n) anyway
+  // yuvframe2tensor, normalize: Y_ul|Y_dl|Y_ur|Y_dr|U|V
+  const int plane_size = (MODEL_WIDTH/2) * (MODEL_HEIGHT/2);
+  for (int r = 0; r < MODEL_HEIGHT/2; r++) {
+    float *out = net_input_buf + r*(MODEL_WIDTH/2);
+    deinterleave_row(s->tensor, resized_y + (2*r)*resized_width, out + 0*plane_size, out + 2*plane_size, MODEL_WIDTH/2);
+    deinterleave_row(s->tensor, resized_y + (2*r+1)*resized_width, out + 1*plane_size, out + 3*plane_size, MODEL_WIDTH/2);
+    normalize_row(s->tensor, resized_u + r*resized_width/2, out + 4*plane_size, MODEL_WIDTH/2);
+    normalize_row(s->tensor, resized_v + r*resized_width/2, out + 5*plane_size, MODEL_WIDTH/2);
+  }
+
+  return net_input_buf;
+}
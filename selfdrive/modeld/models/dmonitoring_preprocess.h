@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// 6 planes of 160x320: the four subsampled Y planes, U and V
+const int DMONITORING_INPUT_SIZE = 320 * 640 * 3 / 2;
+
+typedef struct DMonitoringPreprocessState {
+  bool is_rhd;
+  std::vector<uint8_t> resized_buf;
+  std::vector<uint8_t> cropped_buf;
+  std::vector<float> net_input_buf;
+  float tensor[UINT8_MAX + 1];
+} DMonitoringPreprocessState;
+
+void dmonitoring_preprocess_init(DMonitoringPreprocessState* s, bool is_rhd);
+// crops and scales a driver camera frame and converts it to the model input,
+// returns DMONITORING_INPUT_SIZE floats owned by s
+float *dmonitoring_preprocess(DMonitoringPreprocessState* s, const void* stream_buf, int width, int height);
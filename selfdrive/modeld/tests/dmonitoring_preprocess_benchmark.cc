@@ -0,0 +1,217 @@
+// times the driver monitoring preprocessing (crop, scale and conversion to the model
+// input) on full size driver camera frames against the old path, which copied the crop
+// into a scratch buffer and converted with a per-pixel lookup. The model inputs have
+// to be identical. No model is loaded.
+// usage: dmonitoring_preprocess_benchmark [iterations]
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "libyuv.h"
+
+#include "selfdrive/hardware/hw.h"
+#include "selfdrive/modeld/models/dmonitoring_preprocess.h"
+
+#define MODEL_WIDTH 320
+#define MODEL_HEIGHT 640
+
+// the preprocessing before the fused crop and the SIMD conversion
+namespace old_path {
+
+struct State {
+  bool is_rhd;
+  std::vector<uint8_t> resized_buf, cropped_buf, premirror_cropped_buf;
+  std::vector<float> net_input_buf;
+  float tensor[UINT8_MAX + 1];
+};
+
+template <class T>
+static inline T *get_buffer(std::vector<T> &buf, const size_t size) {
+  if (buf.size() < size) buf.resize(size);
+  return buf.data();
+}
+
+static inline auto get_yuv_buf(std::vector<uint8_t> &buf, const int width, int height) {
+  // the tici crop has an odd height, libyuv rounds the chroma planes up
+  const int uv_size = ((width + 1) / 2) * ((height + 1) / 2);
+  uint8_t *y = get_buffer(buf, width * height + 2 * uv_size);
+  uint8_t *u = y + width * height;
+  uint8_t *v = u + uv_size;
+  return std::make_tuple(y, u, v);
+}
+
+struct Rect {int x, y, w, h;};
+// this used to copy 2 * (h / 2) rows, which left the last row of the odd height tici
+// crop unset. it copies every row here, so the inputs can be compared exactly
+void crop_yuv(uint8_t *raw, int width, int height, uint8_t *y, uint8_t *u, uint8_t *v, const Rect &rect) {
+  uint8_t *raw_y = raw;
+  uint8_t *raw_u = raw_y + (width * height);
+  uint8_t *raw_v = raw_u + ((width / 2) * (height / 2));
+  for (int r = 0; r < rect.h; r++) {
+    memcpy(y + r * rect.w, raw_y + (r + rect.y) * width + rect.x, rect.w);
+  }
+  for (int r = 0; r < (rect.h + 1) / 2; r++) {
+    memcpy(u + r * (rect.w / 2), raw_u + (r + (rect.y / 2)) * width / 2 + (rect.x / 2), rect.w / 2);
+    memcpy(v + r * (rect.w / 2), raw_v + (r + (rect.y / 2)) * width / 2 + (rect.x / 2), rect.w / 2);
+  }
+}
+
+float *preprocess(State *s, void *stream_buf, int width, int height) {
+  Rect crop_rect;
+  if (Hardware::TICI()) {
+    const int full_width_tici = 1928;
+    const int full_height_tici = 1208;
+    const int adapt_width_tici = 954;
+    const int x_offset_tici = -72;
+    const int y_offset_tici = -144;
+    const int cropped_height = adapt_width_tici / 1.33;
+    crop_rect = {full_width_tici / 2 - adapt_width_tici / 2 + x_offset_tici,
+                 full_height_tici / 2 - cropped_height / 2 + y_offset_tici,
+                 cropped_height / 2,
+                 cropped_height};
+    if (!s->is_rhd) {
+      crop_rect.x += adapt_width_tici - crop_rect.w;
+    }
+
+  } else {
+    const int adapt_width = 372;
+    crop_rect = {0, 0, adapt_width, height};
+    if (!s->is_rhd) {
+      crop_rect.x += width - crop_rect.w;
+    }
+  }
+
+  int resized_width = MODEL_WIDTH;
+  int resized_height = MODEL_HEIGHT;
+
+  auto [cropped_y, cropped_u, cropped_v] = get_yuv_buf(s->cropped_buf, crop_rect.w, crop_rect.h);
+  if (!s->is_rhd) {
+    crop_yuv((uint8_t *)stream_buf, width, height, cropped_y, cropped_u, cropped_v, crop_rect);
+  } else {
+    auto [mirror_y, mirror_u, mirror_v] = get_yuv_buf(s->premirror_cropped_buf, crop_rect.w, crop_rect.h);
+    crop_yuv((uint8_t *)stream_buf, width, height, mirror_y, mirror_u, mirror_v, crop_rect);
+    libyuv::I420Mirror(mirror_y, crop_rect.w,
+                       mirror_u, crop_rect.w / 2,
+                       mirror_v, crop_rect.w / 2,
+                       cropped_y, crop_rect.w,
+                       cropped_u, crop_rect.w / 2,
+                       cropped_v, crop_rect.w / 2,
+                       crop_rect.w, crop_rect.h);
+  }
+
+  auto [resized_buf, resized_u, resized_v] = get_yuv_buf(s->resized_buf, resized_width, resized_height);
+  uint8_t *resized_y = resized_buf;
+  libyuv::FilterMode mode = libyuv::FilterModeEnum::kFilterBilinear;
+  if (Hardware::TICI()) {
+    libyuv::I420Scale(cropped_y, crop_rect.w,
+                    cropped_u, crop_rect.w / 2,
+                    cropped_v, crop_rect.w / 2,
+                    crop_rect.w, crop_rect.h,
+                    resized_y, resized_width,
+                    resized_u, resized_width / 2,
+                    resized_v, resized_width / 2,
+                    resized_width, resized_height,
+                    mode);
+  } else {
+    const int source_height = 0.7*resized_height;
+    const int extra_height = (resized_height - source_height) / 2;
+    const int extra_width = (resized_width - source_height / 2) / 2;
+    const int source_width = source_height / 2 + extra_width;
+    libyuv::I420Scale(cropped_y, crop_rect.w,
+                    cropped_u, crop_rect.w / 2,
+                    cropped_v, crop_rect.w / 2,
+                    crop_rect.w, crop_rect.h,
+                    resized_y + extra_height * resized_width, resized_width,
+                    resized_u + extra_height / 2 * resized_width / 2, resized_width / 2,
+                    resized_v + extra_height / 2 * resized_width / 2, resized_width / 2,
+                    source_width, source_height,
+                    mode);
+  }
+
+  int yuv_buf_len = (MODEL_WIDTH/2) * (MODEL_HEIGHT/2) * 6; // Y|u|v -> y|y|y|y|u|v
+  float *net_input_buf = get_buffer(s->net_input_buf, yuv_buf_len);
+  for (int r = 0; r < MODEL_HEIGHT/2; r++) {
+    for (int c = 0; c < MODEL_WIDTH/2; c++) {
+      // Y_ul
+      net_input_buf[(r*MODEL_WIDTH/2) + c + (0*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_y[(2*r)*resized_width + 2*c]];
+      // Y_dl
+      net_input_buf[(r*MODEL_WIDTH/2) + c + (1*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_y[(2*r+1)*resized_width + 2*c]];
+      // Y_ur
+      net_input_buf[(r*MODEL_WIDTH/2) + c + (2*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_y[(2*r)*resized_width + 2*c+1]];
+      // Y_dr
+      net_input_buf[(r*MODEL_WIDTH/2) + c + (3*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_y[(2*r+1)*resized_width + 2*c+1]];
+      // U
+      net_input_buf[(r*MODEL_WIDTH/2) + c + (4*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_u[r*resized_width/2 + c]];
+      // V
+      net_input_buf[(r*MODEL_WIDTH/2) + c + (5*(MODEL_WIDTH/2)*(MODEL_HEIGHT/2))] = s->tensor[resized_v[r*resized_width/2 + c]];
+    }
+  }
+  return net_input_buf;
+}
+
+}  // namespace old_path
+
+template <class F>
+static double median_ms(int iterations, F f) {
+  std::vector<double> t(iterations);
+  for (double &ms : t) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+  std::sort(t.begin(), t.end());
+  return t[t.size() / 2];
+}
+
+static void run(const char *name, int width, int height, bool is_rhd, int iterations) {
+  // gradients with noise, so the scaler and the conversion see every value
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> noise(0, 31);
+  std::vector<uint8_t> frame(width * height * 3 / 2);
+  for (int r = 0; r < height * 3 / 2; r++) {
+    for (int c = 0; c < width; c++) {
+      frame[r * width + c] = (r + 3 * c + noise(gen)) & 0xff;
+    }
+  }
+
+  DMonitoringPreprocessState s = {};
+  dmonitoring_preprocess_init(&s, is_rhd);
+  old_path::State old = {.is_rhd = is_rhd};
+  for (int x = 0; x < std::size(old.tensor); ++x) {
+    old.tensor[x] = (x - 128.f) * 0.0078125f;
+  }
+
+  float *input = dmonitoring_preprocess(&s, frame.data(), width, height);
+  float *expected = old_path::preprocess(&old, frame.data(), width, height);
+  assert(memcmp(input, expected, DMONITORING_INPUT_SIZE * sizeof(float)) == 0);
+
+  double new_ms = median_ms(iterations, [&] { dmonitoring_preprocess(&s, frame.data(), width, height); });
+  double old_ms = median_ms(iterations, [&] { old_path::preprocess(&old, frame.data(), width, height); });
+  printf("%-16s %4dx%-4d %s: old %.3f ms, new %.3f ms, %.2fx\n", name, width, height, is_rhd ? "RHD" : "LHD",
+         old_ms, new_ms, old_ms / new_ms);
+}
+
+int main(int argc, char *argv[]) {
+  const int iterations = argc > 1 ? atoi(argv[1]) : 500;
+
+  // Hardware::TICI() selects the crop, on PC it comes from the environment and both are run
+  if (Hardware::PC()) setenv("TICI", "1", 1);
+  if (Hardware::TICI()) {
+    run("tici", 1928, 1208, false, iterations);
+    run("tici", 1928, 1208, true, iterations);
+  }
+  if (Hardware::PC()) setenv("TICI", "0", 1);
+  if (!Hardware::TICI()) {
+    run("eon", 1152, 864, false, iterations);
+    run("eon", 1152, 864, true, iterations);
+  }
+  printf("model inputs match\n");
+  return 0;
+}
@@ -1,22 +1,68 @@
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
 #include <cassert>
+#include <functional>
 #include <set>
+#include <thread>
 
 #include "json11.hpp"
+#include "selfdrive/common/clutil.h"
+#include "selfdrive/common/timing.h"
 #include "selfdrive/modeld/thneed/thneed.h"
 using namespace json11;
 
 extern map<cl_program, string> g_program_source;
 
+// the kernels in a thneed are independent, so build their programs on all cores
+static void build_programs_parallel(const vector<string> &names, map<string, cl_program> &programs,
+                                    std::function<cl_program(int)> build) {
+  vector<cl_program> built(names.size(), NULL);
+  std::atomic<int> next = 0;
+  vector<std::thread> workers;
+  int num_workers = std::min<int>(names.size(), std::max(1U, std::thread::hardware_concurrency()));
+  for (int t = 0; t < num_workers; t++) {
+    workers.emplace_back([&]() {
+      for (int i = next++; i < names.size(); i = next++) {
+        built[i] = build(i);
+      }
+    });
+  }
+  for (auto &w : workers) w.join();
+  for (int i = 0; i < names.size(); i++) {
+    programs[names[i]] = built[i];
+  }
+}
+
+// drop the mapped pages backing [start, end) once their contents are on the GPU
+static void release_pages(const char *base, size_t start, size_t end) {
+  const size_t page_size = sysconf(_SC_PAGESIZE);
+  start = (start + page_size - 1) & ~(page_size - 1);
+  end &= ~(page_size - 1);
+  if (end > start) {
+    madvise((void *)(base + start), end - start, MADV_DONTNEED);
+  }
+}
+
 void Thneed::load(const char *filename) {
   printf("Thneed::load: loading from %s\n", filename);
-
-  FILE *f = fopen(filename, "rb");
-  fseek(f, 0L, SEEK_END);
-  int sz = ftell(f);
-  fseek(f, 0L, SEEK_SET);
-  char *buf = (char*)malloc(sz);
-  fread(buf, 1, sz, f);
-  fclose(f);
+  double t1 = millis_since_boot();
+
+  // map the file instead of reading it, weights are copied straight from the page cache
+  int fd = open(filename, O_RDONLY);
+  assert(fd >= 0);
+  struct stat st;
+  int ret = fstat(fd, &st);
+  assert(ret == 0);
+  size_t sz = st.st_size;
+  char *buf = (char *)mmap(NULL, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  assert(buf != MAP_FAILED);
+  madvise(buf, sz, MADV_SEQUENTIAL);
 
   int jsz = *(int *)buf;
   string jj(buf+4, jsz);
@@ -26,7 +72,7 @@ void Thneed::load(const char *filename) {
   map<cl_mem, cl_mem> real_mem;
   real_mem[NULL] = NULL;
 
-  int ptr = 4+jsz;
+  size_t ptr = 4+jsz;
   for (auto &obj : jdat["objects"].array_items()) {
     auto mobj = obj.object_items();
     int sz = mobj["size"].int_value();
@@ -40,6 +86,7 @@ void Thneed::load(const char *filename) {
       if (mobj["needs_load"].bool_value()) {
         //printf("loading %p %d @ 0x%X\n", clbuf, sz, ptr);
         clbuf = clCreateBuffer(context, CL_MEM_COPY_HOST_PTR | CL_MEM_READ_WRITE, sz, &buf[ptr], NULL);
+        release_pages(buf, ptr, ptr + sz);
         ptr += sz;
       } else {
         clbuf = clCreateBuffer(context, CL_MEM_READ_WRITE, sz, NULL, NULL);
@@ -67,45 +114,44 @@ void Thneed::load(const char *filename) {
   }
 
   map<string, cl_program> g_programs;
+  vector<string> source_names;
+  vector<const string *> sources;
   for (auto &obj : jdat["programs"].object_items()) {
-    const char *srcs[1];
-    srcs[0] = (const char *)obj.second.string_value().c_str();
-    size_t length = obj.second.string_value().size();
-
-    if (record & THNEED_DEBUG) printf("building %s with size %zu\n", obj.first.c_str(), length);
-
-    cl_program program = clCreateProgramWithSource(context, 1, srcs, &length, NULL);
-    int err = clBuildProgram(program, 1, &device_id, "", NULL, NULL);
-    if (err != 0) {
-      printf("got err %d\n", err);
-      size_t length;
-      char buffer[2048];
-      clGetProgramBuildInfo(program, device_id, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &length);
-      buffer[length] = '\0';
-      printf("%s\n", buffer);
-    }
-    assert(err == 0);
-
-    g_programs[obj.first] = program;
+    if (record & THNEED_DEBUG) printf("building %s with size %zu\n", obj.first.c_str(), obj.second.string_value().size());
+    source_names.push_back(obj.first);
+    sources.push_back(&obj.second.string_value());
   }
+  // built through the on-disk binary cache, so only the first load pays for the compile
+  build_programs_parallel(source_names, g_programs, [&](int i) {
+    return cl_program_from_source(context, device_id, *sources[i], "", source_names[i].c_str());
+  });
 
+  vector<string> binary_names;
+  vector<pair<size_t, size_t>> binaries;
   for (auto &obj : jdat["binaries"].array_items()) {
     string name = obj["name"].string_value();
     size_t length = obj["length"].int_value();
-    const unsigned char *srcs[1];
-    srcs[0] = (const unsigned char *)&buf[ptr];
-    ptr += length;
-
     if (record & THNEED_DEBUG) printf("binary %s with size %zu\n", name.c_str(), length);
 
+    binary_names.push_back(name);
+    binaries.push_back({ptr, length});
+    ptr += length;
+  }
+  build_programs_parallel(binary_names, g_programs, [&](int i) {
+    size_t length = binaries[i].second;
+    const unsigned char *srcs[1];
+    srcs[0] = (const unsigned char *)&buf[binaries[i].first];
+
     cl_int err;
     cl_program program = clCreateProgramWithBinary(context, 1, &device_id, &length, srcs, NULL, &err);
     assert(program != NULL && err == CL_SUCCESS);
     err = clBuildProgram(program, 1, &device_id, "", NULL, NULL);
     assert(err == CL_SUCCESS);
+    return program;
+  });
 
-    g_programs[name] = program;
-  }
+  // everything host side now lives in the CL objects
+  munmap(buf, sz);
 
   for (auto &obj : jdat["kernels"].array_items()) {
     auto gws = obj["global_work_size"];
@@ -135,8 +181,11 @@ void Thneed::load(const char *filename) {
     kq.push_back(kk);
   }
 
-  free(buf);
   clFinish(command_queue);
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("Thneed::load: %zu kernels loaded in %.2f ms, peak rss %ld kB\n", kq.size(), millis_since_boot() - t1, usage.ru_maxrss);
 }
 
 void Thneed::save(const char *filename, bool save_binaries) {
@@ -1,11 +1,15 @@
 #include "selfdrive/proclogd/proclog.h"
 
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
 #include <cassert>
-#include <fstream>
-#include <iterator>
-#include <sstream>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
 
 #include "selfdrive/common/swaglog.h"
 #include "selfdrive/common/util.h"
@@ -13,34 +17,49 @@
 namespace Parser {
 
 // parse /proc/stat
-std::vector<CPUTime> cpuTimes(std::istream &stream) {
-  std::vector<CPUTime> cpu_times;
-  std::string line;
+void cpuTimes(const char *buf, std::vector<CPUTime> &cpu_times) {
+  cpu_times.clear();
   // skip the first line for cpu total
-  std::getline(stream, line);
-  while (std::getline(stream, line)) {
-    if (line.compare(0, 3, "cpu") != 0) break;
-
+  const char *line = strchr(buf, '\n');
+  while (line && strncmp(++line, "cpu", 3) == 0) {
     CPUTime t = {};
-    std::istringstream iss(line);
-    if (iss.ignore(3) >> t.id >> t.utime >> t.ntime >> t.stime >> t.itime >> t.iowtime >> t.irqtime >> t.sirqtime)
+    if (sscanf(line, "cpu%d %lu %lu %lu %lu %lu %lu %lu", &t.id, &t.utime, &t.ntime, &t.stime,
+               &t.itime, &t.iowtime, &t.irqtime, &t.sirqtime) == 8) {
       cpu_times.push_back(t);
+    }
+    line = strchr(line, '\n');
   }
-  return cpu_times;
 }
 
 // parse /proc/meminfo
-std::unordered_map<std::string, uint64_t> memInfo(std::istream &stream) {
-  std::unordered_map<std::string, uint64_t> mem_info;
-  std::string line, key;
-  while (std::getline(stream, line)) {
-    uint64_t val = 0;
-    std::istringstream iss(line);
-    if (iss >> key >> val) {
-      mem_info[key] = val * 1024;
+void memInfo(const char *buf, MemInfo &mem_info) {
+  static const std::pair<const char *, uint64_t MemInfo::*> fields[] = {
+    {"MemTotal:", &MemInfo::total},
+    {"MemFree:", &MemInfo::free},
+    {"MemAvailable:", &MemInfo::available},
+    {"Buffers:", &MemInfo::buffers},
+    {"Cached:", &MemInfo::cached},
+    {"Active:", &MemInfo::active},
+    {"Inactive:", &MemInfo::inactive},
+    {"Shmem:", &MemInfo::shared},
+  };
+
+  mem_info = {};
+  for (const char *line = buf; *line;) {
+    const char *eol = strchr(line, '\n');
+    if (!eol) eol = line + strlen(line);
+    const char *colon = (const char *)memchr(line, ':', eol - line);
+    if (colon) {
+      const size_t key_len = colon - line + 1;
+      for (auto &[key, field] : fields) {
+        if (strncmp(line, key, key_len) == 0 && key[key_len] == '\0') {
+          mem_info.*field = strtoull(colon + 1, nullptr, 10) * 1024;
+          break;
+        }
+      }
     }
+    line = *eol ? eol + 1 : eol;
   }
-  return mem_info;
 }
 
 // field position (https://man7.org/linux/man-pages/man5/proc.5.html)
@@ -62,54 +81,71 @@ enum StatPos {
   MAX_FIELD = 52,
 };
 
+template <typename T>
+static bool parse_num(const char *s, T &v) {
+  char *end = nullptr;
+  errno = 0;
+  if constexpr (std::is_signed_v<T>) {
+    v = strtoll(s, &end, 10);
+  } else {
+    v = strtoull(s, &end, 10);
+  }
+  return end != s && errno == 0;
+}
+
 // parse /proc/pid/stat
-std::optional<ProcStat> procStat(std::string stat) {
+bool procStat(const char *stat, size_t len, ProcStat &p) {
   // To avoid being fooled by names containing a closing paren, scan backwards.
-  auto open_paren = stat.find('(');
-  auto close_paren = stat.rfind(')');
-  if (open_paren == std::string::npos || close_paren == std::string::npos || open_paren > close_paren) {
-    return std::nullopt;
+  const char *open_paren = (const char *)memchr(stat, '(', len);
+  const char *close_paren = (const char *)memrchr(stat, ')', len);
+  if (open_paren == nullptr || close_paren == nullptr || open_paren > close_paren) {
+    return false;
   }
 
-  std::string name = stat.substr(open_paren + 1, close_paren - open_paren - 1);
-  // repace space in name with _
-  std::replace(&stat[open_paren], &stat[close_paren], ' ', '_');
-  std::istringstream iss(stat);
-  std::vector<std::string> v{std::istream_iterator<std::string>(iss),
-                             std::istream_iterator<std::string>()};
-  try {
-    if (v.size() != StatPos::MAX_FIELD) {
-      throw std::invalid_argument("stat");
-    }
-    ProcStat p = {
-      .name = name,
-      .pid = stoi(v[StatPos::pid - 1]),
-      .state = v[StatPos::state - 1][0],
-      .ppid = stoi(v[StatPos::ppid - 1]),
-      .utime = stoul(v[StatPos::utime - 1]),
-      .stime = stoul(v[StatPos::stime - 1]),
-      .cutime = stol(v[StatPos::cutime - 1]),
-      .cstime = stol(v[StatPos::cstime - 1]),
-      .priority = stol(v[StatPos::priority - 1]),
-      .nice = stol(v[StatPos::nice - 1]),
-      .num_threads = stol(v[StatPos::num_threads - 1]),
-      .starttime = stoull(v[StatPos::starttime - 1]),
-      .vms = stoul(v[StatPos::vsize - 1]),
-      .rss = stoul(v[StatPos::rss - 1]),
-      .processor = stoi(v[StatPos::processor - 1]),
-    };
-    return p;
-  } catch (const std::invalid_argument &e) {
-    LOGE("failed to parse procStat (%s) :%s", e.what(), stat.c_str());
-  } catch (const std::out_of_range &e) {
-    LOGE("failed to parse procStat (%s) :%s", e.what(), stat.c_str());
-  }
-  return std::nullopt;
+  // pid and name come first, the remaining fields are separated by whitespace
+  const char *fields[StatPos::MAX_FIELD + 1] = {};
+  fields[StatPos::pid] = stat;
+  int n = 2;
+  const char *end = stat + len;
+  for (const char *s = close_paren + 1; s < end;) {
+    while (s < end && isspace(*s)) s++;
+    if (s == end) break;
+    if (++n > StatPos::MAX_FIELD) return false;
+    fields[n] = s;
+    while (s < end && !isspace(*s)) s++;
+  }
+  if (n != StatPos::MAX_FIELD) {
+    return false;
+  }
+
+  p.name.assign(open_paren + 1, close_paren - open_paren - 1);
+  p.state = *fields[StatPos::state];
+  return parse_num(fields[StatPos::pid], p.pid) &&
+         parse_num(fields[StatPos::ppid], p.ppid) &&
+         parse_num(fields[StatPos::utime], p.utime) &&
+         parse_num(fields[StatPos::stime], p.stime) &&
+         parse_num(fields[StatPos::cutime], p.cutime) &&
+         parse_num(fields[StatPos::cstime], p.cstime) &&
+         parse_num(fields[StatPos::priority], p.priority) &&
+         parse_num(fields[StatPos::nice], p.nice) &&
+         parse_num(fields[StatPos::num_threads], p.num_threads) &&
+         parse_num(fields[StatPos::starttime], p.starttime) &&
+         parse_num(fields[StatPos::vsize], p.vms) &&
+         parse_num(fields[StatPos::rss], p.rss) &&
+         parse_num(fields[StatPos::processor], p.processor);
 }
 
-// return list of PIDs from /proc
-std::vector<int> pids() {
-  std::vector<int> ids;
+std::optional<ProcStat> procStat(const std::string &stat) {
+  ProcStat p = {};
+  if (!procStat(stat.c_str(), stat.size(), p)) {
+    LOGE("failed to parse procStat: %s", stat.c_str());
+    return std::nullopt;
+  }
+  return p;
+}
+
+static void list_pids(std::vector<int> &ids) {
+  ids.clear();
   DIR *d = opendir("/proc");
   assert(d);
   char *p_end;
@@ -123,31 +159,41 @@ std::vector<int> pids() {
     }
   }
   closedir(d);
+}
+
+// return list of PIDs from /proc
+std::vector<int> pids() {
+  std::vector<int> ids;
+  list_pids(ids);
   return ids;
 }
 
 // null-delimited cmdline arguments to vector
-std::vector<std::string> cmdline(std::istream &stream) {
+std::vector<std::string> cmdline(const std::string &buf) {
   std::vector<std::string> ret;
-  std::string line;
-  while (std::getline(stream, line, '\0')) {
-    if (!line.empty()) {
-      ret.push_back(line);
+  for (size_t pos = 0; pos < buf.size();) {
+    size_t end = std::min(buf.find('\0', pos), buf.size());
+    if (end > pos) {
+      ret.push_back(buf.substr(pos, end - pos));
     }
+    pos = end + 1;
   }
   return ret;
 }
 
+static void read_extra_info(int pid, const std::string &name, ProcCache &cache) {
+  cache.pid = pid;
+  cache.name = name;
+  std::string proc_path = "/proc/" + std::to_string(pid);
+  cache.exe = util::readlink(proc_path + "/exe");
+  cache.cmdline = cmdline(util::read_file(proc_path + "/cmdline"));
+}
+
 const ProcCache &getProcExtraInfo(int pid, const std::string &name) {
   static std::unordered_map<pid_t, ProcCache> proc_cache;
   ProcCache &cache = proc_cache[pid];
   if (cache.pid != pid || cache.name != name) {
-    cache.pid = pid;
-    cache.name = name;
-    std::string proc_path = "/proc/" + std::to_string(pid);
-    cache.exe = util::readlink(proc_path + "/exe");
-    std::ifstream stream(proc_path + "/cmdline");
-    cache.cmdline = cmdline(stream);
+    read_extra_info(pid, name, cache);
   }
   return cache;
 }
@@ -157,14 +203,50 @@ const ProcCache &getProcExtraInfo(int pid, const std::string &name) {
 const double jiffy = sysconf(_SC_CLK_TCK);
 const size_t page_size = sysconf(_SC_PAGE_SIZE);
 
-void buildCPUTimes(cereal::ProcLog::Builder &builder) {
-  std::ifstream stream("/proc/stat");
-  std::vector<CPUTime> stats = Parser::cpuTimes(stream);
+// re-read a /proc file from the start, growing buf if needed. returns the length read or -1
+static ssize_t pread_all(int fd, std::string &buf) {
+  size_t len = 0;
+  while (true) {
+    if (len + 1 >= buf.size()) buf.resize(std::max<size_t>(4096, buf.size() * 2));
+    ssize_t n = HANDLE_EINTR(pread(fd, &buf[len], buf.size() - len - 1, len));
+    if (n < 0) return -1;
+    if (n == 0) break;
+    len += n;
+  }
+  buf[len] = '\0';
+  return len;
+}
 
-  auto log_cpu_times = builder.initCpuTimes(stats.size());
-  for (int i = 0; i < stats.size(); ++i) {
+ProcLogSampler::ProcLogSampler() {
+  // one fd per process is kept open
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
+  stat_fd = HANDLE_EINTR(open("/proc/stat", O_RDONLY | O_CLOEXEC));
+  meminfo_fd = HANDLE_EINTR(open("/proc/meminfo", O_RDONLY | O_CLOEXEC));
+  assert(stat_fd >= 0 && meminfo_fd >= 0);
+  buf.resize(64 * 1024);
+}
+
+ProcLogSampler::~ProcLogSampler() {
+  close(stat_fd);
+  close(meminfo_fd);
+  for (auto &[pid, proc] : procs) {
+    if (proc.stat_fd >= 0) close(proc.stat_fd);
+  }
+}
+
+void ProcLogSampler::buildCPUTimes(cereal::ProcLog::Builder &builder) {
+  if (pread_all(stat_fd, buf) < 0) return;
+  Parser::cpuTimes(buf.c_str(), cpu_times);
+
+  auto log_cpu_times = builder.initCpuTimes(cpu_times.size());
+  for (int i = 0; i < cpu_times.size(); ++i) {
     auto l = log_cpu_times[i];
-    const CPUTime &r = stats[i];
+    const CPUTime &r = cpu_times[i];
     l.setCpuNum(r.id);
     l.setUser(r.utime / jiffy);
     l.setNice(r.ntime / jiffy);
@@ -176,36 +258,78 @@ void buildCPUTimes(cereal::ProcLog::Builder &builder) {
   }
 }
 
-void buildMemInfo(cereal::ProcLog::Builder &builder) {
-  std::ifstream stream("/proc/meminfo");
-  auto mem_info = Parser::memInfo(stream);
+void ProcLogSampler::buildMemInfo(cereal::ProcLog::Builder &builder) {
+  if (pread_all(meminfo_fd, buf) < 0) return;
+  MemInfo mem_info;
+  Parser::memInfo(buf.c_str(), mem_info);
 
   auto mem = builder.initMem();
-  mem.setTotal(mem_info["MemTotal:"]);
-  mem.setFree(mem_info["MemFree:"]);
-  mem.setAvailable(mem_info["MemAvailable:"]);
-  mem.setBuffers(mem_info["Buffers:"]);
-  mem.setCached(mem_info["Cached:"]);
-  mem.setActive(mem_info["Active:"]);
-  mem.setInactive(mem_info["Inactive:"]);
-  mem.setShared(mem_info["Shmem:"]);
-}
-
-void buildProcs(cereal::ProcLog::Builder &builder) {
-  auto pids = Parser::pids();
-  std::vector<ProcStat> proc_stats;
-  proc_stats.reserve(pids.size());
+  mem.setTotal(mem_info.total);
+  mem.setFree(mem_info.free);
+  mem.setAvailable(mem_info.available);
+  mem.setBuffers(mem_info.buffers);
+  mem.setCached(mem_info.cached);
+  mem.setActive(mem_info.active);
+  mem.setInactive(mem_info.inactive);
+  mem.setShared(mem_info.shared);
+}
+
+bool ProcLogSampler::readStat(int pid, Proc &proc) {
+  // an fd for an exited process fails with ESRCH, even if the pid was reused. reopen once in that case
+  for (int attempt = 0; attempt < 2; attempt++) {
+    if (proc.stat_fd < 0) {
+      char path[64];
+      snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+      proc.stat_fd = HANDLE_EINTR(open(path, O_RDONLY | O_CLOEXEC));
+      if (proc.stat_fd < 0) return false;
+    }
+    ssize_t len = pread_all(proc.stat_fd, buf);
+    if (len > 0) {
+      if (Parser::procStat(buf.c_str(), len, proc.stat)) return true;
+      LOGE("failed to parse procStat: %s", buf.c_str());
+      return false;
+    }
+    close(proc.stat_fd);
+    proc.stat_fd = -1;
+  }
+  return false;
+}
+
+void ProcLogSampler::buildProcs(cereal::ProcLog::Builder &builder) {
+  Parser::list_pids(pids);
+  for (auto &[pid, proc] : procs) {
+    proc.alive = false;
+  }
+
+  int num_procs = 0;
   for (int pid : pids) {
-    std::string path = "/proc/" + std::to_string(pid) + "/stat";
-    if (auto stat = Parser::procStat(util::read_file(path))) {
-      proc_stats.push_back(*stat);
+    Proc &proc = procs[pid];
+    if (!readStat(pid, proc)) continue;
+
+    proc.alive = true;
+    num_procs++;
+    if (proc.cache.pid != pid || proc.cache.name != proc.stat.name) {
+      Parser::read_extra_info(pid, proc.stat.name, proc.cache);
+    }
+  }
+
+  for (auto it = procs.begin(); it != procs.end();) {
+    if (!it->second.alive) {
+      if (it->second.stat_fd >= 0) close(it->second.stat_fd);
+      it = procs.erase(it);
+    } else {
+      ++it;
     }
   }
 
-  auto procs = builder.initProcs(proc_stats.size());
-  for (size_t i = 0; i < proc_stats.size(); i++) {
-    auto l = procs[i];
-    const ProcStat &r = proc_stats[i];
+  auto lprocs = builder.initProcs(num_procs);
+  int i = 0;
+  for (int pid : pids) {
+    auto it = procs.find(pid);
+    if (it == procs.end()) continue;
+
+    auto l = lprocs[i++];
+    const ProcStat &r = it->second.stat;
     l.setPid(r.pid);
     l.setState(r.state);
     l.setPpid(r.ppid);
@@ -222,18 +346,23 @@ void buildProcs(cereal::ProcLog::Builder &builder) {
     l.setProcessor(r.processor);
     l.setName(r.name);
 
-    const ProcCache &extra_info = Parser::getProcExtraInfo(r.pid, r.name);
+    const ProcCache &extra_info = it->second.cache;
     l.setExe(extra_info.exe);
     auto lcmdline = l.initCmdline(extra_info.cmdline.size());
-    for (size_t i = 0; i < lcmdline.size(); i++) {
-      lcmdline.set(i, extra_info.cmdline[i]);
+    for (size_t j = 0; j < lcmdline.size(); j++) {
+      lcmdline.set(j, extra_info.cmdline[j]);
     }
   }
 }
 
-void buildProcLogMessage(MessageBuilder &msg) {
+void ProcLogSampler::build(MessageBuilder &msg) {
   auto procLog = msg.initEvent().initProcLog();
   buildProcs(procLog);
   buildCPUTimes(procLog);
   buildMemInfo(procLog);
 }
+
+void buildProcLogMessage(MessageBuilder &msg) {
+  static ProcLogSampler sampler;
+  sampler.build(msg);
+}
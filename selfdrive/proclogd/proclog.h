@@ -26,15 +26,51 @@ struct ProcStat {
   std::string name;
 };
 
+struct MemInfo {
+  uint64_t total, free, available, buffers, cached, active, inactive, shared;
+};
+
 namespace Parser {
 
 std::vector<int> pids();
-std::optional<ProcStat> procStat(std::string stat);
-std::vector<std::string> cmdline(std::istream &stream);
-std::vector<CPUTime> cpuTimes(std::istream &stream);
-std::unordered_map<std::string, uint64_t> memInfo(std::istream &stream);
+std::optional<ProcStat> procStat(const std::string &stat);
+std::vector<std::string> cmdline(const std::string &buf);
 const ProcCache &getProcExtraInfo(int pid, const std::string &name);
 
+// allocation-free versions used by the sampler, buf must be null-terminated
+bool procStat(const char *stat, size_t len, ProcStat &p);
+void cpuTimes(const char *buf, std::vector<CPUTime> &cpu_times);
+void memInfo(const char *buf, MemInfo &mem_info);
+
 };  // namespace Parser
 
+// keeps the /proc files it reads open between samples, and only
+// reads cmdline and exe for processes it hasn't seen before
+class ProcLogSampler {
+public:
+  ProcLogSampler();
+  ~ProcLogSampler();
+  void build(MessageBuilder &msg);
+
+private:
+  struct Proc {
+    int stat_fd = -1;
+    bool alive = false;
+    ProcStat stat;
+    ProcCache cache;
+  };
+
+  bool readStat(int pid, Proc &proc);
+  void updatePids();
+  void buildCPUTimes(cereal::ProcLog::Builder &builder);
+  void buildMemInfo(cereal::ProcLog::Builder &builder);
+  void buildProcs(cereal::ProcLog::Builder &builder);
+
+  int stat_fd, meminfo_fd;
+  std::string buf;
+  std::vector<int> pids;
+  std::vector<CPUTime> cpu_times;
+  std::unordered_map<int, Proc> procs;
+};
+
 void buildProcLogMessage(MessageBuilder &msg);
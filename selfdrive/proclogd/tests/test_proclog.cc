@@ -0,0 +1,137 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include "selfdrive/common/util.h"
+#include "selfdrive/proclogd/proclog.h"
+
+const std::string allowed_states = "RSDTtZXxKWPI";
+
+TEST_CASE("Parser::procStat") {
+  SECTION("a name with spaces and parens") {
+    std::string stat = "1234 (my (weird) proc) S 1 1234 1234 0 -1 4194560 1000 0 5 0 "
+                       "350 120 7 3 20 -5 4 0 987654 123456789 2048 18446744073709551615 "
+                       "1 1 0 0 0 0 0 4096 1260 0 0 0 17 3 0 0 0 0 0 0 0 0 0 0 0 0 0";
+    ProcStat p = {};
+    REQUIRE(Parser::procStat(stat.c_str(), stat.size(), p));
+    REQUIRE(p.pid == 1234);
+    REQUIRE(p.name == "my (weird) proc");
+    REQUIRE(p.state == 'S');
+    REQUIRE(p.ppid == 1);
+    REQUIRE(p.utime == 350);
+    REQUIRE(p.stime == 120);
+    REQUIRE(p.cutime == 7);
+    REQUIRE(p.cstime == 3);
+    REQUIRE(p.priority == 20);
+    REQUIRE(p.nice == -5);
+    REQUIRE(p.num_threads == 4);
+    REQUIRE(p.starttime == 987654);
+    REQUIRE(p.vms == 123456789);
+    REQUIRE(p.rss == 2048);
+    REQUIRE(p.processor == 3);
+  }
+  SECTION("the line ends with a newline") {
+    std::string stat = "1 (init) S 0 1 1 0 -1 4194560 0 0 0 0 1 2 0 0 20 0 1 0 5 100 10 "
+                       "18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n";
+    ProcStat p = {};
+    REQUIRE(Parser::procStat(stat.c_str(), stat.size(), p));
+    REQUIRE(p.name == "init");
+    REQUIRE(p.processor == 0);
+  }
+  SECTION("malformed") {
+    ProcStat p = {};
+    for (std::string stat : {"", "1234 (name S 1 2 3", "1234 name) S 1", "1234 (name) S 1 2 3",
+                             "1234 (name) S x 1 1 0 -1 4194560 0 0 0 0 1 2 0 0 20 0 1 0 5 100 10 "
+                             "18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0 0 0 0"}) {
+      REQUIRE(!Parser::procStat(stat.c_str(), stat.size(), p));
+    }
+    REQUIRE(!Parser::procStat("1234 (name) S 1 2 3"));
+  }
+}
+
+TEST_CASE("Parser::cpuTimes") {
+  const char *stat = "cpu  1000 20 300 40000 50 6 7 0 0 0\n"
+                     "cpu0 500 10 150 20000 25 3 4 0 0 0\n"
+                     "cpu1 500 10 150 20000 25 3 3 0 0 0\n"
+                     "intr 123456 0 0\n"
+                     "ctxt 98765\n";
+  std::vector<CPUTime> cpu_times = {{.id = 42}};
+  Parser::cpuTimes(stat, cpu_times);
+  REQUIRE(cpu_times.size() == 2);
+  REQUIRE(cpu_times[1].id == 1);
+  REQUIRE(cpu_times[1].utime == 500);
+  REQUIRE(cpu_times[1].ntime == 10);
+  REQUIRE(cpu_times[1].stime == 150);
+  REQUIRE(cpu_times[1].itime == 20000);
+  REQUIRE(cpu_times[1].iowtime == 25);
+  REQUIRE(cpu_times[1].irqtime == 3);
+  REQUIRE(cpu_times[1].sirqtime == 3);
+}
+
+TEST_CASE("Parser::memInfo") {
+  const char *meminfo = "MemTotal:        3869388 kB\n"
+                        "MemFree:          181612 kB\n"
+                        "MemAvailable:    1983912 kB\n"
+                        "Buffers:           53048 kB\n"
+                        "Cached:          1763456 kB\n"
+                        "SwapCached:            8 kB\n"
+                        "Active:          1566004 kB\n"
+                        "Inactive:        1510888 kB\n"
+                        "Active(anon):     640588 kB\n"
+                        "Shmem:             16756 kB\n"
+                        "HugePages_Total:       0";
+  MemInfo mem;
+  Parser::memInfo(meminfo, mem);
+  REQUIRE(mem.total == 3869388ULL * 1024);
+  REQUIRE(mem.free == 181612ULL * 1024);
+  REQUIRE(mem.available == 1983912ULL * 1024);
+  REQUIRE(mem.buffers == 53048ULL * 1024);
+  REQUIRE(mem.cached == 1763456ULL * 1024);  // not SwapCached
+  REQUIRE(mem.active == 1566004ULL * 1024);  // not Active(anon)
+  REQUIRE(mem.inactive == 1510888ULL * 1024);
+  REQUIRE(mem.shared == 16756ULL * 1024);
+}
+
+TEST_CASE("Parser::cmdline") {
+  REQUIRE(Parser::cmdline(std::string("python\0-m\0\0selfdrive.manager\0", 29)) ==
+          std::vector<std::string>{"python", "-m", "selfdrive.manager"});
+  REQUIRE(Parser::cmdline("no_trailing_null") == std::vector<std::string>{"no_trailing_null"});
+  REQUIRE(Parser::cmdline("").empty());
+}
+
+TEST_CASE("ProcLogSampler") {
+  ProcLogSampler sampler;
+  for (int i = 0; i < 2; i++) {  // the second sample reuses the open fds and the cache
+    MessageBuilder msg;
+    auto t = std::chrono::steady_clock::now();
+    sampler.build(msg);
+    WARN("sample " << i << ": " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count() << " ms");
+
+    kj::Array<capnp::word> buf = capnp::messageToFlatArray(msg);
+    capnp::FlatArrayMessageReader reader(buf);
+    auto proc_log = reader.getRoot<cereal::Event>().getProcLog();
+    REQUIRE(proc_log.getCpuTimes().size() > 0);
+    REQUIRE(proc_log.getMem().getTotal() > 0);
+    REQUIRE(proc_log.getMem().getTotal() >= proc_log.getMem().getAvailable());
+
+    auto procs = proc_log.getProcs();
+    REQUIRE(procs.size() > 0);
+    bool found_self = false;
+    for (auto p : procs) {
+      REQUIRE(allowed_states.find(p.getState()) != std::string::npos);
+      if (p.getPid() == getpid()) {
+        found_self = true;
+        REQUIRE(p.getPpid() == getppid());
+        REQUIRE(p.getExe() == util::readlink("/proc/self/exe"));
+        REQUIRE(p.getCmdline().size() > 0);
+        REQUIRE(std::string(p.getCmdline()[0]).find("test_proclog") != std::string::npos);
+      }
+    }
+    REQUIRE(found_self);
+  }
+}
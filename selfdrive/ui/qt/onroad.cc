@@ -40,6 +40,9 @@ OnroadWindow::OnroadWindow(QWidget *parent) : QWidget(parent) {
 }
 
 void OnroadWindow::updateState(const UIState &s) {
+  // only the border and the alerts are drawn here, the HUD is drawn with the camera frames
+  if (!isVisible() || !s.scene.started) return;
+
   SubMaster &sm = *(s.sm);
   QColor bgColor = bg_colors[s.status];
   if (sm.updated("controlsState")) {
@@ -48,7 +51,7 @@ void OnroadWindow::updateState(const UIState &s) {
                  QString::fromStdString(cs.getAlertText2()),
                  QString::fromStdString(cs.getAlertType()),
                  cs.getAlertSize(), cs.getAlertSound()}, bgColor);
-  } else if ((sm.frame - s.scene.started_frame) > 5 * UI_FREQ) {
+  } else if ((nanos_since_boot() - s.scene.started_time) / 1e9 > 5) {
     // Handle controls timeout
     if (sm.rcv_frame("controlsState") < s.scene.started_frame) {
       // car is started, but controlsState hasn't been seen at all
@@ -52,7 +52,21 @@ void Sidebar::mouseReleaseEvent(QMouseEvent *event) {
 void Sidebar::updateState(const UIState &s) {
   auto &sm = *(s.sm);
 
-  auto deviceState = sm["deviceState"].getDeviceState();
+  // the properties only repaint when they change
+  if (sm.updated("deviceState")) {
+    updateDeviceState(sm["deviceState"].getDeviceState());
+  }
+
+  ItemStatus pandaStatus = {"VEHICLE\nONLINE", good_color};
+  if (s.scene.pandaType == cereal::PandaState::PandaType::UNKNOWN) {
+    pandaStatus = {"NO\nPANDA", danger_color};
+  } else if (s.scene.started && !sm["liveLocationKalman"].getLiveLocationKalman().getGpsOK()) {
+    pandaStatus = {"GPS\nSEARCHING", warning_color};
+  }
+  setProperty("pandaStatus", QVariant::fromValue(pandaStatus));
+}
+
+void Sidebar::updateDeviceState(const cereal::DeviceState::Reader &deviceState) {
   setProperty("netType", network_type[deviceState.getNetworkType()]);
   int strength = (int)deviceState.getNetworkStrength();
   setProperty("netStrength", strength > 0 ? strength + 1 : 0);
@@ -74,14 +88,6 @@ void Sidebar::updateState(const UIState &s) {
     tempColor = warning_color;
   }
   setProperty("tempStatus", QVariant::fromValue(ItemStatus{QString("%1°C").arg((int)deviceState.getAmbientTempC()), tempColor}));
-
-  ItemStatus pandaStatus = {"VEHICLE\nONLINE", good_color};
-  if (s.scene.pandaType == cereal::PandaState::PandaType::UNKNOWN) {
-    pandaStatus = {"NO\nPANDA", danger_color};
-  } else if (s.scene.started && !sm["liveLocationKalman"].getLiveLocationKalman().getGpsOK()) {
-    pandaStatus = {"GPS\nSEARCHING", warning_color};
-  }
-  setProperty("pandaStatus", QVariant::fromValue(pandaStatus));
 }
 
 void Sidebar::paintEvent(QPaintEvent *event) {
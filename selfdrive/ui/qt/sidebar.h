@@ -31,6 +31,7 @@ protected:
   void paintEvent(QPaintEvent *event) override;
   void mouseReleaseEvent(QMouseEvent *event) override;
   void drawMetric(QPainter &p, const QString &label, const QString &val, QColor c, int y);
+  void updateDeviceState(const cereal::DeviceState::Reader &deviceState);
 
   QImage home_img, settings_img;
   const QMap<cereal::DeviceState::NetworkType, QString> network_type = {
@@ -1,5 +1,9 @@
 #include "selfdrive/ui/qt/widgets/cameraview.h"
 
+#include <cstring>
+
+#include <QCoreApplication>
+
 namespace {
 
 const char frame_vertex_shader[] =
@@ -94,18 +98,16 @@ mat4 get_fit_view_transform(float widget_aspect_ratio, float frame_aspect_ratio)
 CameraViewWidget::CameraViewWidget(VisionStreamType stream_type, bool zoom, QWidget* parent) :
                                    stream_type(stream_type), zoomed_view(zoom), QOpenGLWidget(parent) {
   setAttribute(Qt::WA_OpaquePaintEvent);
-
-  QTimer *t = new QTimer(this);
-  connect(t, &QTimer::timeout, this, &CameraViewWidget::updateFrame);
-  t->start(10);
 }
 
 CameraViewWidget::~CameraViewWidget() {
+  stopVipcThread();
   makeCurrent();
   if (isValid()) {
     glDeleteVertexArrays(1, &frame_vao);
     glDeleteBuffers(1, &frame_vbo);
     glDeleteBuffers(1, &frame_ibo);
+    glDeleteBuffers(2, frame_pbo);
   }
   doneCurrent();
 }
@@ -149,13 +151,70 @@ void CameraViewWidget::initializeGL() {
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
 
-  setStreamType(stream_type);
+  glGenBuffers(2, frame_pbo);
 }
 
+void CameraViewWidget::showEvent(QShowEvent *event) {
+  startVipcThread();
+}
 
 void CameraViewWidget::hideEvent(QHideEvent *event) {
-  vipc_client->connected = false;
-  latest_frame = nullptr;
+  stopVipcThread();
+}
+
+void CameraViewWidget::startVipcThread() {
+  if (!vipc_thread.joinable()) {
+    vipc_exit = false;
+    vipc_thread = std::thread(&CameraViewWidget::vipcThread, this);
+  }
+}
+
+void CameraViewWidget::stopVipcThread() {
+  if (vipc_thread.joinable()) {
+    vipc_exit = true;
+    vipc_thread.join();
+    // drop the frames that were sent before it stopped, they're in its buffers
+    QCoreApplication::removePostedEvents(this, QEvent::MetaCall);
+    latest_frame = nullptr;
+  }
+}
+
+void CameraViewWidget::vipcThread() {
+  // msgq wakes up the thread that subscribed, so the client is created here
+  VisionIpcClient client("camerad", stream_type, true);
+  while (!vipc_exit) {
+    if (!client.connected) {
+      std::unique_lock lk(frame_lock);
+      // connecting frees the buffers of the last connection
+      latest_frame = nullptr;
+      vipc_client = nullptr;
+      if (!client.connect(false)) {
+        lk.unlock();
+        util::sleep_for(100);
+        continue;
+      }
+      vipc_client = &client;
+      buffers_changed = true;
+    }
+
+    if (VisionBuf *buf = client.recv(nullptr, 50)) {
+      QMetaObject::invokeMethod(this, [=] { vipcFrameReceived(buf); }, Qt::QueuedConnection);
+    }
+  }
+
+  std::lock_guard lk(frame_lock);
+  vipc_client = nullptr;
+}
+
+void CameraViewWidget::vipcFrameReceived(VisionBuf *buf) {
+  {
+    std::lock_guard lk(frame_lock);
+    if (!vipc_client) return;
+    latest_frame = buf;
+    frame_pending = true;
+  }
+  update();
+  emit frameUpdated();
 }
 
 void CameraViewWidget::mouseReleaseEvent(QMouseEvent *event) {
@@ -167,9 +226,13 @@ void CameraViewWidget::resizeGL(int w, int h) {
 }
 
 void CameraViewWidget::setStreamType(VisionStreamType type) {
-  if (!vipc_client || type != stream_type) {
+  if (type != stream_type) {
+    bool running = vipc_thread.joinable();
+    stopVipcThread();
     stream_type = type;
-    vipc_client.reset(new VisionIpcClient("camerad", stream_type, true));
+    if (running) {
+      startVipcThread();
+    }
     updateFrameMat(width(), height());
   }
 }
@@ -199,16 +262,45 @@ void CameraViewWidget::updateFrameMat(int w, int h) {
       }};
       frame_mat = matmul(device_transform, frame_transform);
     }
-  } else if (vipc_client->connected) {
+  } else if (frame_width > 0 && frame_height > 0) {
     // fit frame to widget size
     float w  = (float)width() / height();
-    float f = (float)vipc_client->buffers[0].width  / vipc_client->buffers[0].height;
+    float f = (float)frame_width  / frame_height;
     frame_mat = matmul(device_transform, get_fit_view_transform(w, f));
   }
 }
 
 void CameraViewWidget::paintGL() {
-  if (!latest_frame) {
+  std::lock_guard lk(frame_lock);
+  if (buffers_changed && vipc_client) {
+    for (int i = 0; i < UI_BUF_COUNT; i++) {
+      texture[i].reset(i < vipc_client->num_buffers ? new EGLImageTexture(&vipc_client->buffers[i]) : nullptr);
+      if (!texture[i]) continue;
+
+      glBindTexture(GL_TEXTURE_2D, texture[i]->frame_tex);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+      // BGR
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_GREEN);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+      assert(glGetError() == GL_NO_ERROR);
+    }
+    if (!Hardware::EON()) {
+      for (GLuint pbo : frame_pbo) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, vipc_client->buffers[0].len, nullptr, GL_STREAM_DRAW);
+      }
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    frame_width = vipc_client->buffers[0].width;
+    frame_height = vipc_client->buffers[0].height;
+    buffers_changed = false;
+    updateFrameMat(width(), height());
+  }
+
+  if (!latest_frame || !texture[latest_frame->idx]) {
     glClearColor(bg.redF(), bg.greenF(), bg.blueF(), bg.alphaF());
     glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
     return;
@@ -220,11 +312,11 @@ void CameraViewWidget::paintGL() {
   glActiveTexture(GL_TEXTURE0);
 
   glBindTexture(GL_TEXTURE_2D, texture[latest_frame->idx]->frame_tex);
-  if (!Hardware::EON()) {
+  if (frame_pending && !Hardware::EON()) {
     // this is handled in ion on QCOM
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, latest_frame->width, latest_frame->height,
-                  0, GL_RGB, GL_UNSIGNED_BYTE, latest_frame->addr);
+    uploadFrame(latest_frame);
   }
+  frame_pending = false;
 
   glUseProgram(program->programId());
   glUniform1i(program->uniformLocation("uTexture"), 0);
@@ -237,40 +329,21 @@ void CameraViewWidget::paintGL() {
   glBindVertexArray(0);
 }
 
-void CameraViewWidget::updateFrame() {
-  if (!isVisible()) {
-    return;
-  }
-
-  if (!vipc_client->connected) {
-    makeCurrent();
-    if (vipc_client->connect(false)) {
-      // init vision
-      for (int i = 0; i < vipc_client->num_buffers; i++) {
-        texture[i].reset(new EGLImageTexture(&vipc_client->buffers[i]));
-
-        glBindTexture(GL_TEXTURE_2D, texture[i]->frame_tex);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-        // BGR
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_BLUE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_GREEN);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
-        assert(glGetError() == GL_NO_ERROR);
-      }
-      latest_frame = nullptr;
-      resizeGL(width(), height());
-    }
-  }
-
-  VisionBuf *buf = nullptr;
-  if (vipc_client->connected) {
-    buf = vipc_client->recv(nullptr, 0);
-    if (buf != nullptr) {
-      latest_frame = buf;
-      update();
-      emit frameUpdated();
-    }
+// copies the frame into a pixel buffer and fills the bound texture from it. the two
+// buffers alternate, so the copy doesn't wait for the last frame's upload to finish
+void CameraViewWidget::uploadFrame(const VisionBuf *buf) {
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, frame_pbo[pbo_idx]);
+  void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, buf->len, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (dst) {
+    memcpy(dst, buf->addr, buf->len);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, buf->stride / 3);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, buf->width, buf->height, GL_RGB, GL_UNSIGNED_BYTE, (const void *)0);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
   }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  pbo_idx = (pbo_idx + 1) % 2;
 }
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
@@ -29,22 +32,39 @@ protected:
   void paintGL() override;
   void resizeGL(int w, int h) override;
   void initializeGL() override;
+  void showEvent(QShowEvent *event) override;
   void hideEvent(QHideEvent *event) override;
   void mouseReleaseEvent(QMouseEvent *event) override;
   void updateFrameMat(int w, int h);
-  std::unique_ptr<VisionIpcClient> vipc_client;
-
-protected slots:
-  void updateFrame();
 
 private:
+  // frames are received on a thread while the widget is visible, the widget is
+  // repainted when one arrives
+  void startVipcThread();
+  void stopVipcThread();
+  void vipcThread();
+  void vipcFrameReceived(VisionBuf *buf);
+  void uploadFrame(const VisionBuf *buf);
+
   bool zoomed_view;
-  VisionBuf *latest_frame = nullptr;
   GLuint frame_vao, frame_vbo, frame_ibo;
   mat4 frame_mat;
+  int frame_width = 0, frame_height = 0;
   std::unique_ptr<EGLImageTexture> texture[UI_BUF_COUNT];
+  GLuint frame_pbo[2] = {};
+  int pbo_idx = 0;
   QOpenGLShaderProgram *program;
 
   VisionStreamType stream_type;
   QColor bg = QColor("#000000");
+
+  std::thread vipc_thread;
+  std::atomic<bool> vipc_exit = false;
+
+  // the buffers are replaced when the thread reconnects
+  std::mutex frame_lock;
+  VisionIpcClient *vipc_client = nullptr;
+  bool buffers_changed = false;
+  VisionBuf *latest_frame = nullptr;
+  bool frame_pending = false;  // not uploaded yet
 };
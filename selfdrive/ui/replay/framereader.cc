@@ -1,8 +1,8 @@
 #include "selfdrive/ui/replay/framereader.h"
 
-#include <unistd.h>
+#include <algorithm>
 #include <cassert>
-#include <mutex>
+#include <cstring>
 #include "libyuv.h"
 
 static int ffmpeg_lockmgr_cb(void **arg, enum AVLockOp op) {
@@ -33,34 +33,164 @@ struct AVInitializer {
   ~AVInitializer() { avformat_network_deinit(); }
 };
 
-FrameReader::FrameReader() {
+// a file read from its url once. each demuxer reads it through its own AVIOContext, reading
+// past the downloaded part downloads up to there
+class Download {
+public:
+  explicit Download(AVIOContext *io) : io_(io) {
+    int64_t size = avio_size(io_);
+    if (size > 0) data_.reserve(size);
+  }
+  ~Download() { avio_closep(&io_); }
+
+  AVIOContext *open() {
+    Reader *r = new Reader{this};
+    const int buf_size = 64 * 1024;
+    AVIOContext *pb = avio_alloc_context((uint8_t *)av_malloc(buf_size), buf_size, 0, r, &Download::read, nullptr, &Download::seek);
+    if (!pb) delete r;
+    return pb;
+  }
+
+  static void close(AVIOContext **pb) {
+    delete (Reader *)(*pb)->opaque;
+    av_freep(&(*pb)->buffer);
+    avio_context_free(pb);
+  }
+
+private:
+  struct Reader {
+    Download *download;
+    int64_t pos = 0;
+  };
+
+  // downloads until there are size bytes or the file ends
+  bool fill(int64_t size) {
+    const int chunk = 1024 * 1024;
+    while ((int64_t)data_.size() < size && !eof_) {
+      size_t n = data_.size();
+      data_.resize(n + chunk);
+      int ret = avio_read(io_, data_.data() + n, chunk);
+      data_.resize(n + std::max(ret, 0));
+      eof_ = ret <= 0;
+    }
+    return (int64_t)data_.size() >= size;
+  }
+
+  static int read(void *opaque, uint8_t *buf, int size) {
+    Reader *r = (Reader *)opaque;
+    r->download->fill(r->pos + size);
+    int n = std::min<int64_t>(size, r->download->data_.size() - r->pos);
+    if (n <= 0) return AVERROR_EOF;
+    memcpy(buf, r->download->data_.data() + r->pos, n);
+    r->pos += n;
+    return n;
+  }
+
+  static int64_t seek(void *opaque, int64_t offset, int whence) {
+    Reader *r = (Reader *)opaque;
+    Download *d = r->download;
+    if (whence & AVSEEK_SIZE) {
+      int64_t size = avio_size(d->io_);
+      if (size > 0) return size;
+      d->fill(INT64_MAX);
+      return d->data_.size();
+    }
+
+    whence &= ~AVSEEK_FORCE;
+    int64_t pos = offset;
+    if (whence == SEEK_CUR) {
+      pos += r->pos;
+    } else if (whence == SEEK_END) {
+      d->fill(INT64_MAX);
+      pos += d->data_.size();
+    } else if (whence != SEEK_SET) {
+      return AVERROR(EINVAL);
+    }
+    if (pos < 0 || !d->fill(pos)) return AVERROR(EINVAL);
+    return r->pos = pos;
+  }
+
+  AVIOContext *io_;
+  std::vector<uint8_t> data_;
+  bool eof_ = false;
+};
+
+FrameReader::FrameReader(int prefetch_frames, size_t cache_bytes) : prefetch_frames_(prefetch_frames), cache_bytes_(cache_bytes) {
   static AVInitializer av_initializer;
 }
 
 FrameReader::~FrameReader() {
-  for (auto &f : frames_) {
-    av_free_packet(&f.pkt);
+  if (decode_thread_.joinable()) {
+    {
+      std::lock_guard lk(mutex_);
+      exit_ = true;
+    }
+    cv_.notify_all();
+    decode_thread_.join();
+  }
+  if (has_pending_pkt_) {
+    av_packet_unref(&pending_pkt_);
   }
   if (pCodecCtx_) {
     avcodec_close(pCodecCtx_);
     avcodec_free_context(&pCodecCtx_);
   }
-  if (pFormatCtx_) {
-    avformat_close_input(&pFormatCtx_);
-  }
+  closeInput(&pFormatCtx_);
+  closeInput(&pIndexCtx_);
   if (av_frame_) {
     av_frame_free(&av_frame_);
   }
 }
 
+AVFormatContext *FrameReader::openInput(const std::string &url) {
+  AVFormatContext *ctx = avformat_alloc_context();
+  ctx->probesize = 10 * 1024 * 1024;  // 10MB
+  AVIOContext *pb = nullptr;
+  if (download_) {
+    if (!(pb = download_->open())) {
+      avformat_free_context(ctx);
+      return nullptr;
+    }
+    ctx->pb = pb;
+    ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+  }
+  if (avformat_open_input(&ctx, url.c_str(), NULL, NULL) != 0) {
+    // the context is freed on failure, the custom io isn't
+    if (pb) Download::close(&pb);
+    return nullptr;
+  }
+  avformat_find_stream_info(ctx, NULL);
+  return ctx;
+}
+
+void FrameReader::closeInput(AVFormatContext **ctx) {
+  if (!*ctx) return;
+
+  AVIOContext *pb = (*ctx)->flags & AVFMT_FLAG_CUSTOM_IO ? (*ctx)->pb : nullptr;
+  avformat_close_input(ctx);
+  if (pb) {
+    Download::close(&pb);
+  }
+}
+
 bool FrameReader::load(const std::string &url) {
-  pFormatCtx_ = avformat_alloc_context();
-  pFormatCtx_->probesize = 10 * 1024 * 1024;  // 10MB
-  if (avformat_open_input(&pFormatCtx_, url.c_str(), NULL, NULL) != 0) {
+  // local files are opened on each demuxer, anything else is downloaded once
+  if (url.find("://") != std::string::npos) {
+    AVIOContext *io = nullptr;
+    if (avio_open2(&io, url.c_str(), AVIO_FLAG_READ, NULL, NULL) < 0) {
+      printf("error loading %s\n", url.c_str());
+      return false;
+    }
+    download_ = std::make_unique<Download>(io);
+  }
+
+  // the index is read on its own demuxer, so the decoder never has to read past what it needs
+  pFormatCtx_ = openInput(url);
+  pIndexCtx_ = pFormatCtx_ ? openInput(url) : nullptr;
+  if (!pFormatCtx_ || !pIndexCtx_) {
     printf("error loading %s\n", url.c_str());
     return false;
   }
-  avformat_find_stream_info(pFormatCtx_, NULL);
   // av_dump_format(pFormatCtx_, 0, url.c_str(), 0);
 
   auto pCodecCtxOrig = pFormatCtx_->streams[0]->codec;
@@ -81,86 +211,279 @@ bool FrameReader::load(const std::string &url) {
   width = pCodecCtxOrig->width;
   height = pCodecCtxOrig->height;
 
-  frames_.reserve(60 * 20);  // 20fps, one minute
+  packets_.reserve(60 * 20);  // 20fps, one minute
+  valid_ = true;
+  decode_thread_ = std::thread(&FrameReader::decodeThread, this);
+  return true;
+}
+
+size_t FrameReader::getFrameCount() {
+  if (!valid_) return 0;
+  if (size_t count = frame_count_) return count;
+
+  std::unique_lock lk(mutex_);
+  count_waiters_++;
+  cv_.notify_all();
+  cv_.wait(lk, [this] { return index_complete_ || exit_; });
+  count_waiters_--;
+  return packets_.size();
+}
+
+bool FrameReader::get(int idx, uint8_t *rgb, uint8_t *yuv) {
+  assert(rgb != nullptr || yuv != nullptr);
+  if (!valid_ || idx < 0) {
+    return false;
+  }
+
+  std::unique_lock lk(mutex_);
+  cursor_ = idx;
+  cv_.notify_all();
+  cv_.wait(lk, [&] {
+    return exit_ || cache_.count(idx) ||
+           (idx < packets_.size() && packets_[idx].failed) ||
+           (index_complete_ && idx >= packets_.size());
+  });
+  auto it = cache_.find(idx);
+  if (it == cache_.end()) {
+    return false;
+  }
+
+  it->second.last_used = ++use_counter_;
+  const uint8_t *y = it->second.yuv.data();
+  const uint8_t *u = y + width * height;
+  const uint8_t *v = u + (width / 2) * (height / 2);
+  if (yuv) {
+    memcpy(yuv, y, getYUVSize());
+  }
+  if (rgb) {
+    libyuv::I420ToRGB24(y, width, u, width / 2, v, width / 2, rgb, width * 3, width, height);
+  }
+  return true;
+}
+
+void FrameReader::decodeThread() {
   while (true) {
-    Frame &frame = frames_.emplace_back();
-    int err = av_read_frame(pFormatCtx_, &frame.pkt);
-    if (err < 0) {
-      frames_.pop_back();
-      valid_ = (err == AVERROR_EOF);
-      break;
+    int target = -1;
+    bool index = false;
+    {
+      std::unique_lock lk(mutex_);
+      cv_.wait(lk, [&] {
+        if (exit_) return true;
+        target = nextTarget();
+        // read the index ahead when the decoder needs it, someone waits for the frame count or there's nothing to decode
+        index = !index_complete_ && (target < 0 || target >= packets_.size() || count_waiters_ > 0);
+        return target >= 0 || index;
+      });
+      if (exit_) break;
+    }
+
+    if (index) {
+      indexPacket();
+    } else {
+      decodeStep(target);
     }
-    // some stream seems to contian no keyframes
-    key_frames_count_ += frame.pkt.flags & AV_PKT_FLAG_KEY;
   }
-  return valid_;
 }
 
-bool FrameReader::get(int idx, uint8_t *rgb, uint8_t *yuv) {
-  assert(rgb != nullptr);
-  if (!valid_ || idx < 0 || idx >= frames_.size()) {
-    return false;
+// the first frame of the prefetch window that isn't decoded yet, -1 if there's nothing to do
+int FrameReader::nextTarget() {
+  for (int i = cursor_; i < cursor_ + prefetch_frames_; ++i) {
+    if (index_complete_ && i >= packets_.size()) break;
+    if (cache_.count(i) || (i < packets_.size() && packets_[i].failed)) continue;
+
+    // the requested frame is always decoded, the ones after it as long as the window fits in the budget
+    if (i == cursor_ || (i - cursor_ + 1) * (size_t)getYUVSize() <= cache_bytes_) return i;
+    break;
   }
-  return decode(idx, rgb, yuv);
+  return -1;
 }
 
-bool FrameReader::decode(int idx, uint8_t *rgb, uint8_t *yuv) {
-  auto get_keyframe = [=](int idx) {
-    for (int i = idx; i >= 0 && key_frames_count_ > 1; --i) {
-      if (frames_[i].pkt.flags & AV_PKT_FLAG_KEY) return i;
+void FrameReader::indexPacket() {
+  AVPacket pkt;
+  av_init_packet(&pkt);
+  pkt.data = NULL;
+  pkt.size = 0;
+  int err = av_read_frame(pIndexCtx_, &pkt);
+  {
+    std::lock_guard lk(mutex_);
+    if (err < 0) {
+      index_complete_ = true;
+      frame_count_ = packets_.size();
+    } else {
+      bool key = pkt.flags & AV_PKT_FLAG_KEY;
+      packets_.push_back({.pos = pkt.pos, .size = pkt.size, .key = key});
+      // some stream seems to contian no keyframes
+      key_frames_count_ += key;
     }
-    return idx;
-  };
+  }
+  if (err >= 0) {
+    av_packet_unref(&pkt);
+  }
+  cv_.notify_all();
+}
 
-  int from_idx = idx;
-  if (idx > 0 && !frames_[idx].decoded && !frames_[idx - 1].decoded) {
-    // find the previous keyframe
-    from_idx = get_keyframe(idx);
-  }
-
-  for (int i = from_idx; i <= idx; ++i) {
-    Frame &frame = frames_[i];
-    if ((!frame.decoded || i == idx) && !frame.failed) {
-      while (true) {
-        int ret = avcodec_decode_video2(pCodecCtx_, av_frame_, &frame.decoded, &(frame.pkt));
-        if (ret > 0 && !frame.decoded) {
-          // decode thread is still receiving the initial packets
-          usleep(0);
-        } else {
-          break;
-        }
-      }
-      frame.failed = !frame.decoded;
-      if (frame.decoded && i == idx) {
-        return decodeFrame(av_frame_, rgb, yuv);
+void FrameReader::decodeStep(int target) {
+  // keep going while the target is ahead in the same run, otherwise restart from its keyframe
+  int key = keyframe(target);
+  if (!decoding_ || target < decode_next_ || key > decode_next_) {
+    if (!seekTo(key)) {
+      markFailed(target, target + 1);
+      return;
+    }
+  }
+
+  if (demux_next_ < packets_.size() || has_pending_pkt_) {
+    decodePacket();
+  } else if (!index_complete_) {
+    // the frame is still in the decoder, it needs the packets after it
+    indexPacket();
+  } else {
+    drain();
+  }
+}
+
+int FrameReader::keyframe(int idx) {
+  for (int i = idx; i >= 0 && key_frames_count_ > 1; --i) {
+    if (packets_[i].key) return i;
+  }
+  return idx;
+}
+
+bool FrameReader::seekTo(int idx) {
+  if (has_pending_pkt_) {
+    av_packet_unref(&pending_pkt_);
+    has_pending_pkt_ = false;
+    demux_next_++;
+  }
+  avcodec_flush_buffers(pCodecCtx_);
+  decoding_ = true;
+  decode_next_ = idx;
+  if (demux_next_ == idx) {
+    return true;
+  }
+
+  AVPacket pkt;
+  av_init_packet(&pkt);
+  pkt.data = NULL;
+  pkt.size = 0;
+
+  // byte seeking in raw streams lands on the chunk the packet started in, the parser can
+  // return the tail of the previous packet first
+  const Packet &p = packets_[idx];
+  if (p.pos >= 0 && av_seek_frame(pFormatCtx_, 0, p.pos, AVSEEK_FLAG_BYTE) >= 0) {
+    for (int i = 0; i < 8 && av_read_frame(pFormatCtx_, &pkt) >= 0; ++i) {
+      bool key = pkt.flags & AV_PKT_FLAG_KEY;
+      if (pkt.pos == p.pos && pkt.size == p.size && key == p.key) {
+        pending_pkt_ = pkt;
+        has_pending_pkt_ = true;
+        demux_next_ = idx;
+        return true;
       }
+      bool past = pkt.pos > p.pos;
+      av_packet_unref(&pkt);
+      if (past) break;
     }
   }
-  return false;
+
+  // count the packets from the start
+  if (av_seek_frame(pFormatCtx_, 0, 0, AVSEEK_FLAG_BYTE) < 0) {
+    decoding_ = false;
+    return false;
+  }
+  for (demux_next_ = 0; demux_next_ < idx; ++demux_next_) {
+    if (av_read_frame(pFormatCtx_, &pkt) < 0) {
+      decoding_ = false;
+      return false;
+    }
+    av_packet_unref(&pkt);
+  }
+  return true;
 }
 
-bool FrameReader::decodeFrame(AVFrame *f, uint8_t *rgb, uint8_t *yuv) {
-  uint8_t *y = yuv;
-  if (!yuv) {
-    if (yuv_buf_.empty()) {
-      yuv_buf_.resize(getYUVSize());
+void FrameReader::decodePacket() {
+  AVPacket pkt;
+  if (has_pending_pkt_) {
+    pkt = pending_pkt_;
+    has_pending_pkt_ = false;
+  } else {
+    av_init_packet(&pkt);
+    pkt.data = NULL;
+    pkt.size = 0;
+    if (av_read_frame(pFormatCtx_, &pkt) < 0) {
+      markFailed(demux_next_, demux_next_ + 1);
+      drain();
+      return;
     }
-    y = yuv_buf_.data();
   }
 
-  int i, j, k;
-  for (i = 0; i < f->height; i++) {
-    memcpy(y + f->width * i, f->data[0] + f->linesize[0] * i, f->width);
+  // the packet number comes out with its frame
+  pkt.pts = pkt.dts = demux_next_++;
+  avcodec_send_packet(pCodecCtx_, &pkt);
+  av_packet_unref(&pkt);
+  receiveFrames();
+}
+
+void FrameReader::receiveFrames() {
+  while (avcodec_receive_frame(pCodecCtx_, av_frame_) == 0) {
+    int idx = av_frame_->pts == AV_NOPTS_VALUE ? decode_next_ : av_frame_->pts;
+    if (idx >= decode_next_) {
+      markFailed(decode_next_, idx);
+      storeFrame(idx, av_frame_);
+      decode_next_ = idx + 1;
+    }
+    av_frame_unref(av_frame_);
   }
-  for (j = 0; j < f->height / 2; j++) {
-    memcpy(y + f->width * i + f->width / 2 * j, f->data[1] + f->linesize[1] * j, f->width / 2);
+}
+
+void FrameReader::drain() {
+  avcodec_send_packet(pCodecCtx_, NULL);
+  receiveFrames();
+  markFailed(decode_next_, demux_next_);
+  decoding_ = false;
+}
+
+void FrameReader::markFailed(int from, int to) {
+  if (from >= to) return;
+  {
+    std::lock_guard lk(mutex_);
+    for (int i = from; i < to && i < packets_.size(); ++i) {
+      packets_[i].failed = true;
+    }
   }
-  for (k = 0; k < f->height / 2; k++) {
-    memcpy(y + f->width * i + f->width / 2 * j + f->width / 2 * k, f->data[2] + f->linesize[2] * k, f->width / 2);
+  cv_.notify_all();
+}
+
+void FrameReader::storeFrame(int idx, AVFrame *f) {
+  const size_t frame_size = getYUVSize();
+  std::vector<uint8_t> buf;
+  {
+    std::lock_guard lk(mutex_);
+    // frames before the window were only needed as references
+    if (!inWindow(idx) || cache_.count(idx)) return;
+
+    // evict the least recently used frames outside the window, and reuse the buffer
+    while ((cache_.size() + 1) * frame_size > cache_bytes_) {
+      auto lru = cache_.end();
+      for (auto it = cache_.begin(); it != cache_.end(); ++it) {
+        if (!inWindow(it->first) && (lru == cache_.end() || it->second.last_used < lru->second.last_used)) {
+          lru = it;
+        }
+      }
+      if (lru == cache_.end()) break;
+      buf = std::move(lru->second.yuv);
+      cache_.erase(lru);
+    }
   }
 
-  uint8_t *u = y + f->width * f->height;
-  uint8_t *v = u + (f->width / 2) * (f->height / 2);
-  libyuv::I420ToRGB24(y, f->width, u, f->width / 2, v, f->width / 2, rgb, f->width * 3, f->width, f->height);
-  return true;
+  buf.resize(frame_size);
+  uint8_t *y = buf.data();
+  uint8_t *u = y + width * height;
+  uint8_t *v = u + (width / 2) * (height / 2);
+  libyuv::I420Copy(f->data[0], f->linesize[0], f->data[1], f->linesize[1], f->data[2], f->linesize[2],
+                   y, width, u, width / 2, v, width / 2, width, height);
+  {
+    std::lock_guard lk(mutex_);
+    cache_[idx] = {.yuv = std::move(buf), .last_used = ++use_counter_};
+  }
+  cv_.notify_all();
 }
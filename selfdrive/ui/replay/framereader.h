@@ -1,6 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 extern "C" {
@@ -8,33 +14,81 @@ extern "C" {
 #include <libavformat/avformat.h>
 }
 
+class Download;
+
+// Decodes on a background thread that prefetches the frames after the last requested one.
+// The packet index is built while reading, and the decoded frames are kept in a cache that
+// evicts the least recently used ones to stay within a memory budget. A url is downloaded
+// once and kept in memory, the index and the decoder read it from there.
 class FrameReader {
 public:
-  FrameReader();
+  FrameReader(int prefetch_frames = 20, size_t cache_bytes = 256 * 1024 * 1024);
   ~FrameReader();
   bool load(const std::string &url);
+  // blocks until the frame is decoded, rgb or yuv can be null
   bool get(int idx, uint8_t *rgb, uint8_t *yuv);
   int getRGBSize() const { return width * height * 3; }
   int getYUVSize() const { return width * height * 3 / 2; }
-  size_t getFrameCount() const { return frames_.size(); }
+  // blocks until the whole file is indexed, returns right away after that
+  size_t getFrameCount();
   bool valid() const { return valid_; }
 
   int width = 0, height = 0;
 
 private:
-  bool decode(int idx, uint8_t *rgb, uint8_t *yuv);
-  bool decodeFrame(AVFrame *f, uint8_t *rgb, uint8_t *yuv);
-
-  struct Frame {
-    AVPacket pkt = {};
-    int decoded = false;
+  struct Packet {
+    int64_t pos;
+    int size;
+    bool key;
     bool failed = false;
   };
-  std::vector<Frame> frames_;
-  AVFrame *av_frame_ = nullptr;
+  struct CachedFrame {
+    std::vector<uint8_t> yuv;  // I420
+    uint64_t last_used;
+  };
+
+  AVFormatContext *openInput(const std::string &url);
+  void closeInput(AVFormatContext **ctx);
+  void decodeThread();
+  int nextTarget();
+  bool inWindow(int idx) const { return idx >= cursor_ && idx < cursor_ + prefetch_frames_; }
+  void indexPacket();
+  void decodeStep(int target);
+  int keyframe(int idx);
+  bool seekTo(int idx);
+  void decodePacket();
+  void receiveFrames();
+  void drain();
+  void markFailed(int from, int to);
+  void storeFrame(int idx, AVFrame *f);
+
+  const int prefetch_frames_;
+  const size_t cache_bytes_;
+  bool valid_ = false;
+
+  // decode thread only
+  std::unique_ptr<Download> download_;
   AVFormatContext *pFormatCtx_ = nullptr;
+  AVFormatContext *pIndexCtx_ = nullptr;
   AVCodecContext *pCodecCtx_ = nullptr;
+  AVFrame *av_frame_ = nullptr;
+  AVPacket pending_pkt_ = {};  // read while seeking, decoded next
+  bool has_pending_pkt_ = false;
+  bool decoding_ = false;
+  int demux_next_ = 0;   // next packet from pFormatCtx_
+  int decode_next_ = 0;  // next frame expected from the decoder
   int key_frames_count_ = 0;
-  std::vector<uint8_t> yuv_buf_;
-  bool valid_ = false;
+
+  // shared with the callers
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Packet> packets_;  // only appended by the decode thread
+  bool index_complete_ = false;
+  std::atomic<size_t> frame_count_ = 0;  // set once the index is complete
+  int count_waiters_ = 0;
+  std::map<int, CachedFrame> cache_;
+  uint64_t use_counter_ = 0;
+  int cursor_ = 0;
+  bool exit_ = false;
+  std::thread decode_thread_;
 };
@@ -0,0 +1,86 @@
+// measures FrameReader on a local file: the time to the first frame, sequential decoding,
+// random seeks and three cameras decoding at once, with the peak memory use.
+// usage: framereader_benchmark <video file>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "selfdrive/ui/replay/framereader.h"
+
+static double millis_since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+}
+
+static long peak_rss_kb() {
+  std::ifstream f("/proc/self/status");
+  std::string line;
+  while (std::getline(f, line)) {
+    if (line.rfind("VmHWM:", 0) == 0) return std::stol(line.substr(6));
+  }
+  return 0;
+}
+
+static double sequential(FrameReader &fr, int count) {
+  std::vector<uint8_t> rgb(fr.getRGBSize());
+  auto t = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i) {
+    fr.get(i, rgb.data(), nullptr);
+  }
+  return count / (millis_since(t) / 1000.);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    printf("usage: %s <video file>\n", argv[0]);
+    return 1;
+  }
+  const std::string file = argv[1];
+
+  {
+    FrameReader fr;
+    auto t = std::chrono::steady_clock::now();
+    if (!fr.load(file)) return 1;
+    double load_ms = millis_since(t);
+    std::vector<uint8_t> rgb(fr.getRGBSize());
+    fr.get(0, rgb.data(), nullptr);
+    printf("load: %.1f ms, first frame: %.1f ms\n", load_ms, millis_since(t));
+
+    t = std::chrono::steady_clock::now();
+    int count = fr.getFrameCount();
+    printf("index: %d frames %dx%d in %.1f ms\n", count, fr.width, fr.height, millis_since(t));
+    printf("sequential: %.1f fps\n", sequential(fr, count));
+
+    std::mt19937 gen(0);
+    std::vector<double> seeks;
+    for (int i = 0; i < 50; ++i) {
+      int idx = gen() % count;
+      t = std::chrono::steady_clock::now();
+      fr.get(idx, rgb.data(), nullptr);
+      seeks.push_back(millis_since(t));
+    }
+    std::sort(seeks.begin(), seeks.end());
+    printf("random seek: median %.1f ms, max %.1f ms\n", seeks[seeks.size() / 2], seeks.back());
+  }
+
+  // road, wide road and driver camera
+  std::vector<std::unique_ptr<FrameReader>> readers;
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back(new FrameReader())->load(file);
+  }
+  std::vector<double> fps(readers.size());
+  std::vector<std::thread> threads;
+  for (int i = 0; i < readers.size(); ++i) {
+    threads.emplace_back([&, i] { fps[i] = sequential(*readers[i], readers[i]->getFrameCount()); });
+  }
+  for (auto &t : threads) t.join();
+  printf("3 cameras: %.1f %.1f %.1f fps\n", fps[0], fps[1], fps[2]);
+  printf("peak rss: %.1f MB\n", peak_rss_kb() / 1024.);
+  return 0;
+}
@@ -0,0 +1,101 @@
+#define CATCH_CONFIG_MAIN
+#include "catch2/catch.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "selfdrive/ui/replay/framereader.h"
+
+const int FRAME_COUNT = 60;
+
+// a short clip with a keyframe every 10 frames, generated once for all the tests
+static const std::string &test_clip() {
+  static std::string path = [] {
+    std::string p = "/tmp/test_framereader_" + std::to_string(getpid()) + ".m4v";
+    std::string cmd = "ffmpeg -loglevel error -y -f lavfi -i testsrc=size=320x240:rate=20 -frames:v " +
+                      std::to_string(FRAME_COUNT) + " -g 10 -c:v mpeg4 -q:v 2 -f m4v " + p;
+    int ret = system(cmd.c_str());
+    return ret == 0 ? p : std::string();
+  }();
+  return path;
+}
+
+struct ClipCleanup {
+  ~ClipCleanup() {
+    if (!test_clip().empty()) unlink(test_clip().c_str());
+  }
+} clip_cleanup;
+
+static std::vector<std::vector<uint8_t>> decode_sequential(const std::string &file) {
+  FrameReader fr;
+  REQUIRE(fr.load(file));
+  std::vector<std::vector<uint8_t>> frames;
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    std::vector<uint8_t> rgb(fr.getRGBSize());
+    REQUIRE(fr.get(i, rgb.data(), nullptr));
+    frames.push_back(std::move(rgb));
+  }
+  return frames;
+}
+
+TEST_CASE("FrameReader") {
+  const std::string &file = test_clip();
+  if (file.empty()) {
+    WARN("ffmpeg is needed to generate the test clip");
+    return;
+  }
+
+  SECTION("frame count") {
+    FrameReader fr;
+    REQUIRE(fr.load(file));
+    REQUIRE(fr.width == 320);
+    REQUIRE(fr.height == 240);
+    REQUIRE(fr.getFrameCount() == FRAME_COUNT);
+
+    std::vector<uint8_t> rgb(fr.getRGBSize());
+    REQUIRE(!fr.get(FRAME_COUNT, rgb.data(), nullptr));
+
+    // once indexed, the count doesn't wait on the decode thread
+    auto t = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10000; ++i) {
+      REQUIRE(fr.getFrameCount() == FRAME_COUNT);
+    }
+    REQUIRE(std::chrono::steady_clock::now() - t < std::chrono::milliseconds(100));
+  }
+
+  SECTION("the frames don't depend on the order they're read in") {
+    auto expected = decode_sequential(file);
+
+    // a cache that only holds a few frames, so most reads seek back to a keyframe
+    FrameReader fr(5, 8 * 320 * 240 * 3 / 2);
+    REQUIRE(fr.load(file));
+    std::vector<uint8_t> rgb(fr.getRGBSize());
+
+    std::vector<int> order(FRAME_COUNT);
+    for (int i = 0; i < FRAME_COUNT; ++i) order[i] = FRAME_COUNT - 1 - i;
+    std::shuffle(order.begin(), order.begin() + FRAME_COUNT / 2, std::mt19937(0));
+    for (int idx : order) {
+      REQUIRE(fr.get(idx, rgb.data(), nullptr));
+      REQUIRE(rgb == expected[idx]);
+    }
+  }
+
+  SECTION("a url is read from the in-memory download") {
+    auto expected = decode_sequential(file);
+
+    FrameReader fr(5, 8 * 320 * 240 * 3 / 2);
+    REQUIRE(fr.load("file://" + file));
+    REQUIRE(fr.getFrameCount() == FRAME_COUNT);
+    std::vector<uint8_t> rgb(fr.getRGBSize());
+    for (int idx : {FRAME_COUNT - 1, 0, 35, 12, FRAME_COUNT - 1}) {
+      REQUIRE(fr.get(idx, rgb.data(), nullptr));
+      REQUIRE(rgb == expected[idx]);
+    }
+  }
+}
@@ -0,0 +1,92 @@
+// measures the time CameraViewWidget takes to paint, with frames published at 20Hz by
+// a VisionIpcServer in the same process. with Mesa's software renderer:
+// usage: LIBGL_ALWAYS_SOFTWARE=1 QT_QPA_PLATFORM=offscreen cameraview_benchmark [seconds]
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <QApplication>
+#include <QTimer>
+
+#include "cereal/visionipc/visionipc_server.h"
+#include "selfdrive/common/timing.h"
+#include "selfdrive/common/util.h"
+#include "selfdrive/ui/qt/widgets/cameraview.h"
+
+const int FRAME_WIDTH = 1928, FRAME_HEIGHT = 1208;
+
+class TimedCameraView : public CameraViewWidget {
+public:
+  TimedCameraView() : CameraViewWidget(VISION_STREAM_RGB_BACK, false) {
+    // repainted for the overlays between frames too, like the onroad view
+    connect(this, &CameraViewWidget::frameUpdated, [=]() { new_frame = true; });
+  }
+
+  std::vector<double> frame_times, repaint_times;
+
+protected:
+  void paintGL() override {
+    double t = millis_since_boot();
+    CameraViewWidget::paintGL();
+    glFinish();
+    (new_frame ? frame_times : repaint_times).push_back(millis_since_boot() - t);
+    new_frame = false;
+  }
+
+  bool new_frame = false;
+};
+
+static void print_times(const char *name, std::vector<double> &times) {
+  if (times.empty()) return;
+  std::sort(times.begin(), times.end());
+  printf("%s: %zu paints, median %.2f ms, 99th %.2f ms, max %.2f ms\n", name, times.size(),
+         times[times.size() / 2], times[times.size() * 99 / 100], times.back());
+}
+
+int main(int argc, char *argv[]) {
+  const int seconds = argc > 1 ? atoi(argv[1]) : 10;
+
+  VisionIpcServer server("camerad");
+  server.create_buffers(VISION_STREAM_RGB_BACK, UI_BUF_COUNT, true, FRAME_WIDTH, FRAME_HEIGHT);
+  server.start_listener();
+
+  std::atomic<bool> do_exit = false;
+  std::thread publisher([&]() {
+    for (uint32_t frame_id = 0; !do_exit; frame_id++) {
+      VisionBuf *buf = server.get_buffer(VISION_STREAM_RGB_BACK);
+      memset(buf->addr, frame_id & 0xff, buf->len);
+      VisionIpcBufExtra extra = {.frame_id = frame_id};
+      server.send(buf, &extra);
+      util::sleep_for(50);
+    }
+  });
+
+  QApplication a(argc, argv);
+  TimedCameraView view;
+  view.resize(1920, 1080);
+  view.show();
+
+  QTimer repaint;
+  QObject::connect(&repaint, &QTimer::timeout, &view, qOverload<>(&QWidget::update));
+  repaint.start(1000 / UI_FREQ);
+
+  // skip the startup
+  QTimer::singleShot(1000, [&]() {
+    view.frame_times.clear();
+    view.repaint_times.clear();
+  });
+  QTimer::singleShot(1000 + seconds * 1000, &a, &QApplication::quit);
+  a.exec();
+
+  do_exit = true;
+  publisher.join();
+
+  print_times("new frame", view.frame_times);
+  print_times("repaint", view.repaint_times);
+  return 0;
+}
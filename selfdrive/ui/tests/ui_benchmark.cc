@@ -0,0 +1,136 @@
+// measures the CPU use of the UI state updates and the latency from a message being
+// sent to the widget that shows it being painted, with the services published at
+// their usual rates by a child process.
+// usage: QT_QPA_PLATFORM=offscreen ui_benchmark [seconds]
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <QApplication>
+#include <QPainter>
+#include <QTimer>
+#include <QWidget>
+
+#include "selfdrive/common/timing.h"
+#include "selfdrive/common/util.h"
+#include "selfdrive/ui/ui.h"
+
+static void publish() {
+  PubMaster pm({"carState", "controlsState", "modelV2", "deviceState"});
+  for (uint64_t i = 0; true; i++) {
+    MessageBuilder car;
+    car.initEvent().initCarState().setVEgo(i * 0.01);
+    pm.send("carState", car);
+
+    MessageBuilder controls;
+    auto cs = controls.initEvent().initControlsState();
+    cs.setEnabled(true);
+    cs.setAlertText1((i / 100) % 2 ? "TAKE CONTROL" : "");
+    pm.send("controlsState", controls);
+
+    if (i % 5 == 0) {
+      MessageBuilder model;
+      model.initEvent().initModelV2().setFrameId(i / 5);
+      pm.send("modelV2", model);
+    }
+    if (i % 50 == 0) {
+      MessageBuilder device;
+      device.initEvent().initDeviceState().setStarted(true);
+      pm.send("deviceState", device);
+    }
+    util::sleep_for(10);
+  }
+}
+
+// repaints when the alert changes, like the onroad alerts
+class Probe : public QWidget {
+public:
+  Probe() {
+    resize(200, 100);
+  }
+
+  void updateState(const UIState &s) {
+    SubMaster &sm = *(s.sm);
+    if (!sm.updated("controlsState")) return;
+
+    std::string text = sm["controlsState"].getControlsState().getAlertText1().cStr();
+    if (text != alert) {
+      alert = text;
+      sent_time = sm["controlsState"].getLogMonoTime();
+      update();
+    }
+  }
+
+  std::vector<double> latencies;
+
+protected:
+  void paintEvent(QPaintEvent *event) override {
+    QPainter p(this);
+    p.drawText(rect(), Qt::AlignCenter, QString::fromStdString(alert));
+    if (sent_time > 0) {
+      latencies.push_back((nanos_since_boot() - sent_time) / 1e6);
+      sent_time = 0;
+    }
+  }
+
+  std::string alert;
+  uint64_t sent_time = 0;
+};
+
+static double cpu_seconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+  const int seconds = argc > 1 ? atoi(argv[1]) : 10;
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    publish();
+    return 0;
+  }
+
+  QApplication a(argc, argv);
+  QUIState qs;
+  Probe probe;
+  probe.show();
+  QObject::connect(&qs, &QUIState::uiUpdate, &probe, &Probe::updateState);
+
+  int updates = 0;
+  QObject::connect(&qs, &QUIState::uiUpdate, [&]() { updates++; });
+
+  // skip the startup
+  double cpu_start = 0, t_start = 0;
+  QTimer::singleShot(1000, [&]() {
+    cpu_start = cpu_seconds();
+    t_start = millis_since_boot();
+    updates = 0;
+    probe.latencies.clear();
+  });
+  QTimer::singleShot(1000 + seconds * 1000, &a, &QApplication::quit);
+  a.exec();
+
+  kill(pid, SIGTERM);
+  waitpid(pid, nullptr, 0);
+
+  double elapsed = (millis_since_boot() - t_start) / 1000.;
+  printf("%d updates in %.1f s, %.1f Hz\n", updates, elapsed, updates / elapsed);
+  printf("cpu: %.1f%%\n", (cpu_seconds() - cpu_start) / elapsed * 100.);
+
+  auto &l = probe.latencies;
+  if (!l.empty()) {
+    std::sort(l.begin(), l.end());
+    printf("send to paint: %zu alerts, median %.1f ms, max %.1f ms\n", l.size(), l[l.size() / 2], l.back());
+  }
+  return 0;
+}
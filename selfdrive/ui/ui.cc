@@ -7,6 +7,7 @@
 #include <cmath>
 #include <cstdio>
 
+#include "selfdrive/common/timing.h"
 #include "selfdrive/common/util.h"
 #include "selfdrive/common/watchdog.h"
 #include "selfdrive/hardware/hw.h"
@@ -110,10 +111,11 @@ static void update_state(UIState *s) {
   SubMaster &sm = *(s->sm);
   UIScene &scene = s->scene;
 
-  // update engageability and DM icons at 2Hz
-  if (sm.frame % (UI_FREQ / 2) == 0) {
+  if (sm.updated("controlsState")) {
     auto cs = sm["controlsState"].getControlsState();
     scene.engageable = cs.getEngageable() || cs.getEnabled();
+  }
+  if (sm.updated("driverMonitoringState")) {
     scene.dm_active = sm["driverMonitoringState"].getDriverMonitoringState().getIsActiveMode();
   }
 
@@ -157,7 +159,7 @@ static void update_state(UIState *s) {
         }
       }
     }
-  } else if ((s->sm->frame - s->sm->rcv_frame("pandaStates")) > 5*UI_FREQ) {
+  } else if ((nanos_since_boot() - sm.rcv_time("pandaStates")) / 1e9 > 5) {
     scene.pandaType = cereal::PandaState::PandaType::UNKNOWN;
   }
   if (sm.updated("carParams")) {
@@ -206,11 +208,10 @@ static void update_state(UIState *s) {
   }
 }
 
-static void update_params(UIState *s) {
-  const uint64_t frame = s->sm->frame;
+static void update_params(UIState *s, uint64_t tick) {
   UIScene &scene = s->scene;
   Params params;
-  if (frame % (5*UI_FREQ) == 0) {
+  if (tick % (5*UI_FREQ) == 0) {
     scene.is_metric = Params().getBool("IsMetric");
   }
 
@@ -251,6 +252,7 @@ static void update_status(UIState *s) {
     if (s->scene.started) {
       s->status = STATUS_DISENGAGED;
       s->scene.started_frame = s->sm->frame;
+      s->scene.started_time = nanos_since_boot();
       s->scene.end_to_end = Params().getBool("EndToEndToggle");
       s->scene.laneless_mode = std::stoi(Params().get("LanelessMode"));
       s->wide_camera = Hardware::TICI() ? Params().getBool("EnableWideCamera") : false;
@@ -263,35 +265,93 @@ static void update_status(UIState *s) {
 
 
 QUIState::QUIState(QObject *parent) : QObject(parent) {
-  ui_state.sm = std::make_unique<SubMaster, const std::initializer_list<const char *>>({
-    "modelV2", "controlsState", "liveCalibration", "deviceState", "roadCameraState",
-    "pandaStates", "carParams", "driverMonitoringState", "sensorEvents", "carState", "liveLocationKalman",
-    "lateralPlan",
-  });
-
   ui_state.wide_camera = Hardware::TICI() ? Params().getBool("EnableWideCamera") : false;
 
-  // update timer
+  std::unique_lock lk(lock);
+  poll_thread = std::thread(&QUIState::pollSockets, this);
+  cv.wait(lk, [=] { return ui_state.sm != nullptr; });
+
+  // params, the watchdog and the device are updated at a fixed rate
   timer = new QTimer(this);
-  QObject::connect(timer, &QTimer::timeout, this, &QUIState::update);
+  QObject::connect(timer, &QTimer::timeout, this, &QUIState::tick);
   timer->start(1000 / UI_FREQ);
 }
 
+QUIState::~QUIState() {
+  {
+    std::lock_guard lk(lock);
+    do_exit = true;
+  }
+  cv.notify_one();
+  poll_thread.join();
+}
+
+void QUIState::pollSockets() {
+  // msgq wakes up the thread that subscribed when a message is sent. if a reader is
+  // reset by update() this falls back to the poll timeout, the old fixed rate
+  {
+    std::lock_guard lk(lock);
+    ui_state.sm = std::make_unique<SubMaster, const std::initializer_list<const char *>>({
+      "modelV2", "controlsState", "liveCalibration", "deviceState", "roadCameraState",
+      "pandaStates", "carParams", "driverMonitoringState", "sensorEvents", "carState", "liveLocationKalman",
+      "lateralPlan",
+    });
+  }
+  cv.notify_one();
+
+  double last_update = 0;
+  while (!do_exit) {
+    if (!ui_state.sm->poll(1000 / UI_FREQ)) continue;
+
+    // right away after a quiet period, at most UI_FREQ times a second otherwise
+    double dt = millis_since_boot() - last_update;
+    if (dt < 1000. / UI_FREQ) {
+      util::sleep_for(1000. / UI_FREQ - dt);
+    }
+
+    // the sockets are only used by one thread at a time
+    std::unique_lock lk(lock);
+    update_pending = true;
+    QMetaObject::invokeMethod(this, &QUIState::update, Qt::QueuedConnection);
+    cv.wait(lk, [=] { return !update_pending || do_exit; });
+    last_update = millis_since_boot();
+  }
+}
+
 void QUIState::update() {
-  update_params(&ui_state);
-  update_sockets(&ui_state);
+  {
+    std::lock_guard lk(lock);
+    update_sockets(&ui_state);
+    update_pending = false;
+  }
+  cv.notify_one();
+
   update_state(&ui_state);
   update_status(&ui_state);
 
-  if (ui_state.scene.started != started_prev || ui_state.sm->frame == 1) {
+  if (ui_state.scene.started != started_prev || !transitioned) {
     started_prev = ui_state.scene.started;
+    transitioned = true;
     emit offroadTransition(!ui_state.scene.started);
   }
 
-  watchdog_kick();
   emit uiUpdate(ui_state);
 }
 
+void QUIState::tick() {
+  update_params(&ui_state, ticks++);
+
+  // start offroad if nothing has been received yet
+  if (!transitioned) {
+    started_prev = false;
+    transitioned = true;
+    emit offroadTransition(true);
+  }
+
+  watchdog_kick();
+  emit uiTick(ui_state);
+}
+
 Device::Device(QObject *parent) : brightness_filter(BACKLIGHT_OFFROAD, BACKLIGHT_TS, BACKLIGHT_DT), QObject(parent) {
 }
 
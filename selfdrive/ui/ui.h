@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include <QObject>
 #include <QTimer>
@@ -135,7 +139,7 @@ typedef struct UIScene {
 
   float light_sensor, accel_sensor, gyro_sensor;
   bool started, ignition, is_metric, longitudinal_control, end_to_end;
-  uint64_t started_frame;
+  uint64_t started_frame, started_time;
 
   struct _LateralPlan
   {
@@ -174,20 +178,35 @@ class QUIState : public QObject {
 
 public:
   QUIState(QObject* parent = 0);
+  ~QUIState();
 
   // TODO: get rid of this, only use signal
   inline static UIState ui_state = {0};
 
 signals:
+  // when messages arrive, at most UI_FREQ times a second
   void uiUpdate(const UIState &s);
+  // at UI_FREQ
+  void uiTick(const UIState &s);
   void offroadTransition(bool offroad);
 
 private slots:
   void update();
+  void tick();
 
 private:
+  void pollSockets();
+
   QTimer *timer;
-  bool started_prev = true;
+  uint64_t ticks = 0;
+  bool started_prev = true, transitioned = false;
+
+  // the poll thread waits for messages, then for update() to receive them
+  std::thread poll_thread;
+  std::mutex lock;
+  std::condition_variable cv;
+  bool update_pending = false;
+  std::atomic<bool> do_exit = false;
 };
 
 
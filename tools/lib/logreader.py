@@ -2,8 +2,10 @@
 import os
 import sys
 import bz2
+import math
 import urllib.parse
 import capnp
+import numpy as np
 
 try:
   from xx.chffr.lib.filereader import FileReader
@@ -11,11 +13,21 @@ except ImportError:
   from tools.lib.filereader import FileReader
 from cereal import log as capnp_log
 
+try:
+  from tools.lib.native_logreader.logreader_pyx import read_file, read_bytes, read_files  # pylint: disable=no-name-in-module, import-error
+  NATIVE = True
+except ImportError:
+  NATIVE = False
+
+# segments read at once by MultiLogIterator
+LOAD_AHEAD = min(4, os.cpu_count() or 1)
+
 # this is an iterator itself, and uses private variables from LogReader
 class MultiLogIterator(object):
-  def __init__(self, log_paths, wraparound=True):
+  def __init__(self, log_paths, wraparound=True, services=None):
     self._log_paths = log_paths
     self._wraparound = wraparound
+    self._services = services
 
     self._first_log_idx = next(i for i in range(len(log_paths)) if log_paths[i] is not None)
     self._current_log = self._first_log_idx
@@ -25,9 +37,14 @@ class MultiLogIterator(object):
 
   def _log_reader(self, i):
     if self._log_readers[i] is None and self._log_paths[i] is not None:
-      log_path = self._log_paths[i]
-      print("LogReader:%s" % log_path)
-      self._log_readers[i] = LogReader(log_path)
+      # the next segments are read along with it
+      todo = [j for j in range(i, len(self._log_paths))
+              if self._log_readers[j] is None and self._log_paths[j] is not None][:LOAD_AHEAD]
+      for j in todo:
+        print("LogReader:%s" % self._log_paths[j])
+      lrs = LogReader.read_many([self._log_paths[j] for j in todo], services=self._services)
+      for j, lr in zip(todo, lrs):
+        self._log_readers[j] = lr
 
     return self._log_readers[i]
 
@@ -68,33 +85,73 @@ class MultiLogIterator(object):
 
     self._current_log = minute
 
-    # HACK: O(n) seek afterward
-    self._idx = 0
-    while self.tell() < ts:
+    # the first event at or after ts, it can be in one of the next segments
+    mono_time = self.start_time + math.ceil(ts * 1e9)
+    while True:
+      lr = self._log_reader(self._current_log)
+      self._idx = lr.seek(mono_time)
+      if self._idx < len(lr._ents):
+        return True
+      self._idx = len(lr._ents) - 1
+      prev_log = self._current_log
       self._inc()
-    return True
+      if self._current_log <= prev_log:
+        return True
 
 
 class LogReader(object):
-  def __init__(self, fn, canonicalize=True, only_union_types=False):
+  def __init__(self, fn, canonicalize=True, only_union_types=False, services=None, _ents=None):
     data_version = None
     _, ext = os.path.splitext(urllib.parse.urlparse(fn).path)
-    with FileReader(fn) as f:
-      dat = f.read()
+    if ext not in ("", ".bz2"):
+      raise Exception(f"unknown extension {ext}")
 
-    if ext == "":
+    if _ents is not None:
+      ents = _ents
+    elif NATIVE:
+      # the events are read from the decompressed log when they're accessed
+      if os.path.isfile(fn):
+        ents = read_file(fn, services)
+      else:
+        with FileReader(fn) as f:
+          ents = read_bytes(f.read(), services)
+    else:
+      with FileReader(fn) as f:
+        dat = f.read()
+      if ext == ".bz2":
+        dat = bz2.decompress(dat)
       # old rlogs weren't bz2 compressed
       ents = capnp_log.Event.read_multiple_bytes(dat)
-    elif ext == ".bz2":
-      dat = bz2.decompress(dat)
-      ents = capnp_log.Event.read_multiple_bytes(dat)
-    else:
-      raise Exception(f"unknown extension {ext}")
+      if services is not None:
+        ents = (e for e in ents if e.which() in services)
+      ents = list(ents)
 
-    self._ents = list(ents)
-    self._ts = [x.logMonoTime for x in self._ents]
+    self._ents = ents
+    self._native = not isinstance(ents, list)
+    self._ts = ents.mono_times if self._native else np.array([x.logMonoTime for x in ents], dtype=np.int64)
     self.data_version = data_version
     self._only_union_types = only_union_types
+    self._max_ts = None
+
+  @classmethod
+  def read_many(cls, fns, services=None, threads=LOAD_AHEAD):
+    """reads the local files in parallel with the native reader"""
+    if not NATIVE or not all(os.path.isfile(fn) for fn in fns):
+      return [cls(fn, services=services) for fn in fns]
+
+    ents = read_files(fns, services, threads)
+    for fn, e in zip(fns, ents):
+      if e is None:
+        raise Exception(f"failed to read {fn}")
+    return [cls(fn, services=services, _ents=e) for fn, e in zip(fns, ents)]
+
+  def seek(self, mono_time):
+    """index of the first event in log order at or after mono_time"""
+    if self._native:
+      return self._ents.seek(mono_time)
+    if self._max_ts is None:
+      self._max_ts = np.maximum.accumulate(self._ts)
+    return int(np.searchsorted(self._max_ts, mono_time))
 
   def __iter__(self):
     for ent in self._ents:
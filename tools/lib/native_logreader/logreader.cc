@@ -0,0 +1,182 @@
+#include "tools/lib/native_logreader/logreader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "cereal/gen/cpp/log.capnp.h"
+
+const size_t CHUNK_SIZE = 1 << 20;
+const size_t MAX_SEGMENTS = 512;
+
+// the size of the message in words from its segment table, more than available when it
+// isn't complete yet, 0 if it isn't a message
+static size_t message_size(const capnp::word *w, size_t available) {
+  const uint32_t *table = (const uint32_t *)w;
+  size_t segments = (size_t)table[0] + 1;
+  if (segments > MAX_SEGMENTS) return 0;
+
+  // the count and a size for each segment, padded to a word
+  size_t size = (segments + 2) / 2;
+  if (available < size) return size;
+  for (size_t i = 0; i < segments; i++) {
+    size += table[i + 1];
+  }
+  return size;
+}
+
+LogReader::LogReader(const std::vector<uint16_t> &allow) : allow_(allow) {}
+
+LogReader::~LogReader() {
+  if (compressed_) {
+    BZ2_bzDecompressEnd(&bz_);
+  }
+}
+
+bool LogReader::load(const std::string &file) {
+  FILE *f = fopen(file.c_str(), "rb");
+  if (!f) return false;
+
+  std::vector<char> chunk(CHUNK_SIZE);
+  bool ok = true;
+  size_t n;
+  while (ok && (n = fread(chunk.data(), 1, chunk.size(), f)) > 0) {
+    ok = feed(chunk.data(), n);
+  }
+  ok = ok && !ferror(f);
+  fclose(f);
+  return ok && finish();
+}
+
+bool LogReader::load(const char *data, size_t size) {
+  for (size_t pos = 0; pos < size; pos += CHUNK_SIZE) {
+    if (!feed(data + pos, std::min(CHUNK_SIZE, size - pos))) return false;
+  }
+  return finish();
+}
+
+void LogReader::reserve(size_t bytes) {
+  size_t words = (end_ + bytes + sizeof(capnp::word) - 1) / sizeof(capnp::word);
+  if (words > buf_.size()) {
+    auto buf = kj::heapArray<capnp::word>(std::max(words, buf_.size() * 2));
+    if (end_ > 0) {
+      memcpy(buf.begin(), buf_.begin(), end_);
+    }
+    buf_ = std::move(buf);
+  }
+}
+
+bool LogReader::feed(const char *chunk, size_t len) {
+  if (!started_) {
+    started_ = true;
+    compressed_ = len >= 3 && memcmp(chunk, "BZh", 3) == 0;
+    if (compressed_ && BZ2_bzDecompressInit(&bz_, 0, 0) != BZ_OK) {
+      compressed_ = false;
+      return false;
+    }
+  }
+
+  if (!compressed_) {
+    reserve(len);
+    memcpy((char *)buf_.begin() + end_, chunk, len);
+    end_ += len;
+    return parse();
+  }
+
+  bz_.next_in = (char *)chunk;
+  bz_.avail_in = len;
+  while (bz_.avail_in > 0) {
+    if (stream_end_) {
+      // concatenated streams
+      BZ2_bzDecompressEnd(&bz_);
+      if (BZ2_bzDecompressInit(&bz_, 0, 0) != BZ_OK) return false;
+      stream_end_ = false;
+    }
+
+    reserve(CHUNK_SIZE);
+    size_t avail = buf_.size() * sizeof(capnp::word) - end_;
+    bz_.next_out = (char *)buf_.begin() + end_;
+    bz_.avail_out = avail;
+    int ret = BZ2_bzDecompress(&bz_);
+    if (ret != BZ_OK && ret != BZ_STREAM_END) return false;
+
+    end_ += avail - bz_.avail_out;
+    stream_end_ = ret == BZ_STREAM_END;
+    if (!parse()) return false;
+  }
+  return true;
+}
+
+// a partial message at the end of a log that was cut off is left out
+bool LogReader::finish() {
+  end_ = kept_ * sizeof(capnp::word);
+  return !compressed_ || stream_end_;
+}
+
+// reads the complete messages after parsed_, the ones that are kept are moved down to kept_
+bool LogReader::parse() {
+  size_t words = end_ / sizeof(capnp::word);
+  try {
+    while (parsed_ < words) {
+      const capnp::word *msg = &buf_[parsed_];
+      size_t size = message_size(msg, words - parsed_);
+      if (size == 0) return false;
+      if (size > words - parsed_) break;
+
+      capnp::FlatArrayMessageReader reader(kj::arrayPtr(msg, size));
+      cereal::Event::Reader event = reader.getRoot<cereal::Event>();
+      uint16_t which = (uint16_t)event.which();
+      if (allow_.empty() || std::find(allow_.begin(), allow_.end(), which) != allow_.end()) {
+        uint64_t mono_time = event.getLogMonoTime();
+        if (kept_ != parsed_) {
+          memmove(&buf_[kept_], msg, size * sizeof(capnp::word));
+        }
+        events_.push_back({.mono_time = mono_time, .which = which, .offset = (uint32_t)kept_, .size = (uint32_t)size});
+        max_mono_time_.push_back(std::max(mono_time, max_mono_time_.empty() ? 0 : max_mono_time_.back()));
+        kept_ += size;
+      }
+      parsed_ += size;
+    }
+  } catch (const kj::Exception &e) {
+    printf("invalid message at word %zu: %s\n", parsed_, e.getDescription().cStr());
+    return false;
+  }
+
+  // the space of the dropped messages is reused, so the buffer only grows by what's kept
+  if (parsed_ > kept_) {
+    size_t dropped = (parsed_ - kept_) * sizeof(capnp::word);
+    memmove(&buf_[kept_], &buf_[parsed_], end_ - parsed_ * sizeof(capnp::word));
+    end_ -= dropped;
+    parsed_ = kept_;
+  }
+  return true;
+}
+
+size_t LogReader::seek(uint64_t mono_time) const {
+  return std::lower_bound(max_mono_time_.begin(), max_mono_time_.end(), mono_time) - max_mono_time_.begin();
+}
+
+std::vector<std::unique_ptr<LogReader>> load_logs(const std::vector<std::string> &files,
+                                                  const std::vector<uint16_t> &allow, int threads) {
+  std::vector<std::unique_ptr<LogReader>> readers(files.size());
+  std::atomic<size_t> next = 0;
+  auto worker = [&]() {
+    for (size_t i = next++; i < files.size(); i = next++) {
+      auto lr = std::make_unique<LogReader>(allow);
+      if (lr->load(files[i])) {
+        readers[i] = std::move(lr);
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int i = 0; i < std::min<int>(threads, files.size()); i++) {
+    pool.emplace_back(worker);
+  }
+  for (auto &t : pool) {
+    t.join();
+  }
+  return readers;
+}
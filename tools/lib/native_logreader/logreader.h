@@ -0,0 +1,57 @@
+#pragma once
+
+#include <bzlib.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <capnp/serialize.h>
+
+// Reads a log a chunk at a time, decompressing bz2 as it goes. The messages stay in one
+// buffer and are read in place. Only the union tag and logMonoTime of each event are read
+// while loading, the events of services that aren't allowed are dropped right away.
+class LogReader {
+public:
+  struct Event {
+    uint64_t mono_time;
+    uint16_t which;  // cereal::Event::Which
+    uint32_t offset, size;  // in words
+  };
+
+  // keeps the union tags in allow, or everything if it's empty
+  LogReader(const std::vector<uint16_t> &allow = {});
+  ~LogReader();
+  bool load(const std::string &file);
+  // a whole raw or bz2 compressed log in memory
+  bool load(const char *data, size_t size);
+
+  const std::vector<Event> &events() const { return events_; }
+  kj::ArrayPtr<const capnp::word> words(const Event &e) const { return kj::arrayPtr(&buf_[e.offset], e.size); }
+  const char *data() const { return (const char *)buf_.begin(); }
+  size_t dataSize() const { return kept_ * sizeof(capnp::word); }
+  // the first event in log order at or after mono_time, the log isn't strictly in order
+  size_t seek(uint64_t mono_time) const;
+
+private:
+  bool feed(const char *chunk, size_t len);
+  bool finish();
+  void reserve(size_t bytes);
+  bool parse();
+
+  const std::vector<uint16_t> allow_;
+  std::vector<Event> events_;
+  std::vector<uint64_t> max_mono_time_;  // up to and including each event
+
+  bool started_ = false, compressed_ = false, stream_end_ = false;
+  bz_stream bz_ = {};
+
+  kj::Array<capnp::word> buf_;
+  size_t end_ = 0;     // decompressed bytes
+  size_t parsed_ = 0;  // words
+  size_t kept_ = 0;    // words
+};
+
+// loads the files on a pool of threads, the ones that fail to load are null
+std::vector<std::unique_ptr<LogReader>> load_logs(const std::vector<std::string> &files,
+                                                  const std::vector<uint16_t> &allow, int threads);
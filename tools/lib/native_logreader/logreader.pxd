@@ -0,0 +1,23 @@
+# cython: language_level = 3
+from libc.stdint cimport uint16_t, uint32_t, uint64_t
+from libcpp cimport bool
+from libcpp.memory cimport unique_ptr
+from libcpp.string cimport string
+from libcpp.vector cimport vector
+
+cdef extern from "tools/lib/native_logreader/logreader.h":
+  cdef cppclass Event "LogReader::Event":
+    uint64_t mono_time
+    uint16_t which
+    uint32_t offset, size
+
+  cdef cppclass LogReader:
+    LogReader(const vector[uint16_t] &)
+    bool load(const string &) nogil
+    bool load(const char *, size_t) nogil
+    const vector[Event] &events()
+    const char *data()
+    size_t dataSize()
+    size_t seek(uint64_t)
+
+  vector[unique_ptr[LogReader]] load_logs(const vector[string] &, const vector[uint16_t] &, int) nogil
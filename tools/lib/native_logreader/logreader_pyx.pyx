@@ -0,0 +1,114 @@
+# distutils: language = c++
+# cython: language_level = 3
+from cpython.buffer cimport PyBuffer_FillInfo
+from cython.operator cimport dereference as deref
+from libc.stdint cimport int64_t, uint16_t
+from libcpp cimport bool
+from libcpp.memory cimport unique_ptr
+from libcpp.string cimport string
+from libcpp.vector cimport vector
+from tools.lib.native_logreader.logreader cimport Event, LogReader, load_logs
+
+import numpy as np
+from cereal import log as capnp_log
+
+UNION_TAGS = {name: f.proto.discriminantValue for name, f in capnp_log.Event.schema.fields.items()
+              if f.proto.discriminantValue != 0xffff}
+UNION_NAMES = {tag: name for name, tag in UNION_TAGS.items()}
+
+
+cdef vector[uint16_t] union_tags(services):
+  cdef vector[uint16_t] tags
+  if services is not None:
+    for s in services:
+      tags.push_back(UNION_TAGS[s])
+  return tags
+
+
+cdef class NativeLogReader:
+  """The events of a log, read from the loaded messages when they are accessed"""
+  cdef unique_ptr[LogReader] lr
+  cdef readonly object mono_times
+
+  @staticmethod
+  cdef NativeLogReader wrap(unique_ptr[LogReader] &lr):
+    cdef NativeLogReader r = NativeLogReader.__new__(NativeLogReader)
+    r.lr.reset(lr.release())
+
+    cdef const vector[Event] *events = &deref(r.lr).events()
+    r.mono_times = np.empty(events.size(), dtype=np.int64)
+    cdef int64_t[::1] ts = r.mono_times
+    cdef size_t i
+    for i in range(events.size()):
+      ts[i] = deref(events)[i].mono_time
+    return r
+
+  def __getbuffer__(self, Py_buffer *buffer, int flags):
+    PyBuffer_FillInfo(buffer, self, <void *>deref(self.lr).data(), deref(self.lr).dataSize(), 1, flags)
+
+  def __releasebuffer__(self, Py_buffer *buffer):
+    pass
+
+  def __len__(self):
+    return deref(self.lr).events().size()
+
+  cdef object event(self, object view, size_t i):
+    cdef Event e = deref(self.lr).events()[i]
+    return capnp_log.Event.from_bytes(view[e.offset * 8:(e.offset + e.size) * 8])
+
+  def __getitem__(self, i):
+    n = len(self)
+    if i < 0:
+      i += n
+    if not 0 <= i < n:
+      raise IndexError("event index out of range")
+    return self.event(memoryview(self), i)
+
+  def __iter__(self):
+    view = memoryview(self)
+    cdef size_t i
+    for i in range(len(self)):
+      yield self.event(view, i)
+
+  def which(self, size_t i):
+    """the service of an event without reading it"""
+    tag = deref(self.lr).events().at(i).which
+    return UNION_NAMES.get(tag, tag)
+
+  def seek(self, mono_time):
+    """index of the first event in log order at or after mono_time"""
+    return deref(self.lr).seek(max(mono_time, 0))
+
+
+def read_file(fn, services=None):
+  cdef string c_fn = fn.encode()
+  cdef unique_ptr[LogReader] lr
+  lr.reset(new LogReader(union_tags(services)))
+  cdef bool ok
+  with nogil:
+    ok = deref(lr).load(c_fn)
+  if not ok:
+    raise Exception(f"failed to read {fn}")
+  return NativeLogReader.wrap(lr)
+
+
+def read_bytes(const unsigned char[::1] dat, services=None):
+  cdef unique_ptr[LogReader] lr
+  lr.reset(new LogReader(union_tags(services)))
+  cdef bool ok = True
+  if dat.shape[0] > 0:
+    with nogil:
+      ok = deref(lr).load(<const char *>&dat[0], dat.shape[0])
+  if not ok:
+    raise Exception("failed to read log")
+  return NativeLogReader.wrap(lr)
+
+
+def read_files(fns, services=None, int threads=4):
+  """reads the files on a pool of threads, None for the ones that fail"""
+  cdef vector[string] c_fns = [fn.encode() for fn in fns]
+  cdef vector[uint16_t] tags = union_tags(services)
+  cdef vector[unique_ptr[LogReader]] lrs
+  with nogil:
+    lrs = load_logs(c_fns, tags, threads)
+  return [NativeLogReader.wrap(lrs[i]) if lrs[i] else None for i in range(lrs.size())]
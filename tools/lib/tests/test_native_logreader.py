@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+import bz2
+import os
+import random
+import shutil
+import tempfile
+import time
+import unittest
+from unittest import mock
+
+from cereal import log as capnp_log
+import tools.lib.logreader as logreader
+from tools.lib.logreader import LogReader, MultiLogIterator
+
+SERVICES = ['can', 'carState', 'controlsState', 'sensorEvents', 'logMessage']
+
+
+def make_segment(fn, start, n, compress=True):
+  t = start
+  dat = []
+  for i in range(n):
+    # the log is mostly in order
+    t += random.randint(-2000000, 10000000)
+    which = random.choice(SERVICES)
+    e = capnp_log.Event.new_message(logMonoTime=t, valid=True)
+    if which == 'can':
+      for j, c in enumerate(e.init('can', 4)):
+        c.address = 0x100 + j
+        c.dat = bytes([i & 0xff] * 8)
+    elif which == 'carState':
+      e.init('carState').vEgo = i * 0.1
+    elif which == 'controlsState':
+      e.init('controlsState').vCruise = i % 100
+    elif which == 'sensorEvents':
+      e.init('sensorEvents', 2)
+    else:
+      e.logMessage = f"message {i}"
+    dat.append(e.to_bytes())
+
+  dat = b''.join(dat)
+  with open(fn, 'wb') as f:
+    f.write(bz2.compress(dat) if compress else dat)
+  return t
+
+
+def python_reader(fn, **kwargs):
+  with mock.patch.object(logreader, 'NATIVE', False):
+    return LogReader(fn, **kwargs)
+
+
+@unittest.skipUnless(logreader.NATIVE, "native log reader isn't built")
+class TestNativeLogReader(unittest.TestCase):
+  @classmethod
+  def setUpClass(cls):
+    random.seed(0)
+    cls.tmp = tempfile.mkdtemp()
+    cls.segments = []
+    t = int(1e12)
+    for i in range(4):
+      fn = os.path.join(cls.tmp, f"{i}_rlog.bz2")
+      t = make_segment(fn, t, 5000)
+      cls.segments.append(fn)
+    cls.raw = os.path.join(cls.tmp, "rlog")
+    make_segment(cls.raw, t, 2000, compress=False)
+
+  @classmethod
+  def tearDownClass(cls):
+    shutil.rmtree(cls.tmp)
+
+  def assertSameEvents(self, native, python):
+    self.assertEqual(len(native._ents), len(python._ents))
+    self.assertEqual(list(native._ts), list(python._ts))
+    for a, b in zip(native, python):
+      self.assertEqual(a.which(), b.which())
+      self.assertEqual(a.to_dict(), b.to_dict())
+
+  def test_same_events(self):
+    for fn in (self.segments[0], self.raw):
+      self.assertSameEvents(LogReader(fn), python_reader(fn))
+
+  def test_from_bytes(self):
+    # urls are read whole, then decompressed natively
+    with mock.patch("os.path.isfile", return_value=False):
+      lr = LogReader(self.segments[1])
+    self.assertSameEvents(lr, python_reader(self.segments[1]))
+
+  def test_services(self):
+    services = ['carState', 'can']
+    lr = LogReader(self.segments[0], services=services)
+    self.assertEqual(set(m.which() for m in lr), set(services))
+    self.assertSameEvents(lr, python_reader(self.segments[0], services=services))
+    self.assertEqual(lr._ents.which(0), next(iter(lr)).which())
+
+  def test_read_many(self):
+    lrs = LogReader.read_many(self.segments, threads=4)
+    for fn, lr in zip(self.segments, lrs):
+      self.assertSameEvents(lr, python_reader(fn))
+
+  def test_seek(self):
+    lr, lr_python = LogReader(self.segments[2]), python_reader(self.segments[2])
+    ts = list(lr._ts)
+    for t in random.sample(range(ts[0] - 10, max(ts) + 10), 200):
+      expected = next((i for i, x in enumerate(ts) if x >= t), len(ts))
+      self.assertEqual(lr.seek(t), expected)
+      self.assertEqual(lr_python.seek(t), expected)
+
+    # against walking the route, the segments don't line up with minutes here
+    paths = self.segments
+    mli = MultiLogIterator(paths, wraparound=False)
+    walk = MultiLogIterator(paths, wraparound=False)
+    for ts in (0., 3.5, 10., 21.):
+      mli.seek(ts)
+      walk._current_log, walk._idx = 0, 0
+      while walk.tell() < ts:
+        walk._inc()
+      self.assertEqual((mli._current_log, mli._idx), (walk._current_log, walk._idx))
+
+  def test_benchmark(self):
+    def run(read):
+      t = time.monotonic()
+      n = sum(len(lr._ents) for lr in read())
+      return n, time.monotonic() - t
+
+    n_python, t_python = run(lambda: [python_reader(fn) for fn in self.segments])
+    n_native, t_native = run(lambda: LogReader.read_many(self.segments, threads=4))
+    _, t_filtered = run(lambda: LogReader.read_many(self.segments, services=['carState'], threads=4))
+    print(f"{n_python} events: python {t_python:.2f}s, native {t_native:.2f}s, native carState only {t_filtered:.2f}s")
+    self.assertEqual(n_python, n_native)
+    self.assertLess(t_native, t_python)
+
+
+if __name__ == "__main__":
+  unittest.main()